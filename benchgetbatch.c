@@ -0,0 +1,119 @@
+/*--------------------------------------------------------------------*/
+/* benchgetbatch.c                                                    */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+/* Compare independent lookups made one at a time by SymTable_get with
+   the same lookups made in batches by SymTable_getBatch, in hash
+   tables from cache-sized to far larger than the last-level cache.
+   Half of the lookups hit. */
+
+#include "symtablehash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------*/
+
+enum {KEY_LENGTH = 24, LOOKUPS = 4194304, BATCH = 1024};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the CPU time between iStart and iEnd, in nanoseconds per
+   operation for uOperations operations. */
+
+static double nsPerOp(clock_t iStart, clock_t iEnd, size_t uOperations)
+{
+   return ((double)(iEnd - iStart)) * 1e9 / CLOCKS_PER_SEC
+      / (double)uOperations;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure tables of uBindings bindings and write one line of results
+   to stdout. */
+
+static void benchSize(size_t uBindings)
+{
+   SymTable_T oSymTable;
+   char (*aacKeys)[KEY_LENGTH];
+   char (*aacMissingKeys)[KEY_LENGTH];
+   const char **apcLookups;
+   void *apvValues[BATCH];
+   clock_t iStart;
+   double dGet;
+   double dBatch;
+   size_t uSum = 0;
+   size_t u;
+
+   aacKeys = (char(*)[KEY_LENGTH])malloc(uBindings * KEY_LENGTH);
+   aacMissingKeys = (char(*)[KEY_LENGTH])malloc(uBindings * KEY_LENGTH);
+   apcLookups = (const char**)malloc(LOOKUPS * sizeof(const char*));
+   oSymTable = SymTable_new();
+   if (aacKeys == NULL || aacMissingKeys == NULL || apcLookups == NULL
+       || oSymTable == NULL)
+   {
+      fprintf(stderr, "Insufficient memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   for (u = 0; u < uBindings; u++)
+   {
+      sprintf(aacKeys[u], "symbol_%lu", (unsigned long)u);
+      sprintf(aacMissingKeys[u], "missing_%lu", (unsigned long)u);
+      SymTable_put(oSymTable, aacKeys[u], aacKeys[u]);
+   }
+
+   /* Scatter the lookups over the table */
+   for (u = 0; u < LOOKUPS; u++)
+      apcLookups[u] = u % 2 == 0
+         ? aacKeys[(u * 7919) % uBindings]
+         : aacMissingKeys[(u * 7919) % uBindings];
+
+   iStart = clock();
+   for (u = 0; u < LOOKUPS; u++)
+      uSum += (size_t)SymTable_get(oSymTable, apcLookups[u]);
+   dGet = nsPerOp(iStart, clock(), LOOKUPS);
+
+   iStart = clock();
+   for (u = 0; u < LOOKUPS; u += BATCH)
+   {
+      SymTable_getBatch(oSymTable, &apcLookups[u], BATCH, apvValues);
+      uSum += (size_t)apvValues[0];
+   }
+   dBatch = nsPerOp(iStart, clock(), LOOKUPS);
+
+   printf("%10lu %10.1f %10.1f %8.2f\n", (unsigned long)uBindings, dGet,
+      dBatch, dGet / dBatch);
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+   free(aacKeys);
+   free(aacMissingKeys);
+   free(apcLookups);
+
+   /* Keep the lookups from being optimized away */
+   if (uSum == 1) printf("\n");
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Benchmark SymTable_getBatch. argv[0] is the name of the executable
+   binary file. Return 0. */
+
+int main(int argc, char *argv[])
+{
+   static const size_t auSizes[] = {1000, 100000, 1000000, 4000000};
+   size_t u;
+
+   (void)argc;
+
+   printf("%s: %d lookups per size, %d per batch\n", argv[0], LOOKUPS,
+      BATCH);
+   printf("%10s %10s %10s %8s\n", "bindings", "get ns", "batch ns",
+      "speedup");
+   for (u = 0; u < sizeof(auSizes) / sizeof(auSizes[0]); u++)
+      benchSize(auSizes[u]);
+
+   return 0;
+}
@@ -0,0 +1,146 @@
+/*--------------------------------------------------------------------*/
+/* benchkeyops.c                                                      */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+/* Measure each variant of the key hashing and comparison kernels
+   (keyops.c) that the processor supports, alone and inside the hash
+   table implementation, over a range of key lengths. */
+
+#include "keyops.h"
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------*/
+
+enum {KEY_COUNT = 4096, MAX_KEY_LENGTH = 128, OPERATIONS = 4000000};
+
+/*--------------------------------------------------------------------*/
+
+/* The keys, and equal copies of them at other addresses. */
+
+static char aacKeys[KEY_COUNT][MAX_KEY_LENGTH + 1];
+static char aacCopies[KEY_COUNT][MAX_KEY_LENGTH + 1];
+
+/*--------------------------------------------------------------------*/
+
+/* Return the CPU time between iStart and iEnd, in nanoseconds per
+   operation for uOperations operations. */
+
+static double nsPerOp(clock_t iStart, clock_t iEnd, size_t uOperations)
+{
+   return ((double)(iEnd - iStart)) * 1e9 / CLOCKS_PER_SEC
+      / (double)uOperations;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make every key uLength characters long. The keys share a long
+   prefix, as qualified identifiers do, and differ at the end. */
+
+static void makeKeys(size_t uLength)
+{
+   char acSuffix[32];
+   size_t uSuffixLength;
+   size_t u;
+   size_t v;
+
+   for (u = 0; u < KEY_COUNT; u++)
+   {
+      sprintf(acSuffix, "_%lu", (unsigned long)u);
+      uSuffixLength = strlen(acSuffix);
+      for (v = 0; v < uLength; v++)
+         aacKeys[u][v] = (char)('a' + v % 26);
+      if (uSuffixLength < uLength)
+         memcpy(&aacKeys[u][uLength - uSuffixLength], acSuffix,
+            uSuffixLength);
+      aacKeys[u][uLength] = '\0';
+      strcpy(aacCopies[u], aacKeys[u]);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the variant in use with keys of uLength characters and write
+   one line of results to stdout. */
+
+static void benchLength(size_t uLength)
+{
+   SymTable_T oSymTable;
+   clock_t iStart;
+   double dHash;
+   double dEquals;
+   double dGet;
+   size_t u;
+   size_t uSum = 0;
+
+   makeKeys(uLength);
+
+   iStart = clock();
+   for (u = 0; u < OPERATIONS; u++)
+      uSum += KeyOps_hash(aacKeys[u % KEY_COUNT]);
+   dHash = nsPerOp(iStart, clock(), OPERATIONS);
+
+   iStart = clock();
+   for (u = 0; u < OPERATIONS; u++)
+      uSum += (size_t)KeyOps_equals(aacKeys[u % KEY_COUNT],
+         aacCopies[u % KEY_COUNT]);
+   dEquals = nsPerOp(iStart, clock(), OPERATIONS);
+
+   oSymTable = SymTable_new();
+   if (oSymTable == NULL)
+   {
+      fprintf(stderr, "Insufficient memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (u = 0; u < KEY_COUNT; u++)
+      SymTable_put(oSymTable, aacKeys[u], aacKeys[u]);
+   iStart = clock();
+   for (u = 0; u < OPERATIONS; u++)
+      uSum += (size_t)SymTable_get(oSymTable,
+         aacCopies[(u * 7919) % KEY_COUNT]);
+   dGet = nsPerOp(iStart, clock(), OPERATIONS);
+   SymTable_free(oSymTable);
+
+   printf("%8lu %10.1f %10.1f %10.1f\n", (unsigned long)uLength, dHash,
+      dEquals, dGet);
+   fflush(stdout);
+
+   /* Keep the operations from being optimized away */
+   if (uSum == 1) printf("\n");
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Benchmark every supported variant of the key kernels. argv[0] is the
+   name of the executable binary file. Return 0. */
+
+int main(int argc, char *argv[])
+{
+   static const size_t auLengths[] = {4, 8, 16, 24, 40, 64, 128};
+   size_t uVariant;
+   size_t u;
+
+   (void)argc;
+
+   printf("%s: %d keys per length\n", argv[0], KEY_COUNT);
+   for (uVariant = 0; uVariant < KeyOps_getVariantCount(); uVariant++)
+   {
+      if (! KeyOps_useVariant(uVariant))
+      {
+         printf("%s: not supported by this processor\n",
+            KeyOps_getVariantName(uVariant));
+         continue;
+      }
+      printf("%s:\n", KeyOps_getVariantName(uVariant));
+      printf("%8s %10s %10s %10s\n", "length", "hash ns", "equal ns",
+         "get ns");
+      for (u = 0; u < sizeof(auLengths) / sizeof(auLengths[0]); u++)
+         benchLength(auLengths[u]);
+   }
+
+   return 0;
+}
@@ -0,0 +1,288 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtable.c                                                    */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+/* Measure the cost of the SymTable operations as a function of table
+   size, using many small tables of identifier-like keys, as a
+   compiler's scope tables would. Link it with each implementation
+   (make bench) and compare the columns to find where the
+   implementations cross over. Where Linux and the processor provide
+   hardware counters, the L1 data cache and last-level cache misses
+   per lookup are reported too. */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define BENCH_HAVE_MALLINFO2
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define BENCH_HAVE_PERF
+#endif
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_BINDINGS = 256, KEY_LENGTH = 32, TABLE_COUNT = 4096,
+   LOOKUPS_PER_SIZE = 4000000};
+
+/*--------------------------------------------------------------------*/
+
+/* The keys put into every table, and keys that are never put. */
+
+static char aacKeys[MAX_BINDINGS][KEY_LENGTH];
+static char aacMissingKeys[MAX_BINDINGS][KEY_LENGTH];
+
+/* The tables under measurement. */
+
+static SymTable_T aoSymTables[TABLE_COUNT];
+
+/* The descriptors of the hardware counters, each -1 if that counter
+   cannot be opened. */
+
+enum {COUNTER_L1D, COUNTER_LLC, COUNTER_COUNT};
+
+static int aiCounters[COUNTER_COUNT] = {-1, -1};
+
+/*--------------------------------------------------------------------*/
+
+/* Open the hardware counters of read misses in the L1 data cache and
+   in the last-level cache, counting this thread in user mode only. */
+
+static void openCounters(void)
+{
+#ifdef BENCH_HAVE_PERF
+   static const unsigned long aulCaches[COUNTER_COUNT] =
+      {PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_LL};
+   struct perf_event_attr sAttr;
+   int iCounter;
+
+   for (iCounter = 0; iCounter < COUNTER_COUNT; iCounter++)
+   {
+      memset(&sAttr, 0, sizeof(sAttr));
+      sAttr.size = sizeof(sAttr);
+      sAttr.type = PERF_TYPE_HW_CACHE;
+      sAttr.config = aulCaches[iCounter]
+         | ((unsigned long)PERF_COUNT_HW_CACHE_OP_READ << 8)
+         | ((unsigned long)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      sAttr.disabled = 1;
+      sAttr.exclude_kernel = 1;
+      sAttr.exclude_hv = 1;
+      aiCounters[iCounter] =
+         (int)syscall(SYS_perf_event_open, &sAttr, 0, -1, -1, 0);
+   }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Reset the open hardware counters and start them. */
+
+static void startCounters(void)
+{
+#ifdef BENCH_HAVE_PERF
+   int iCounter;
+
+   for (iCounter = 0; iCounter < COUNTER_COUNT; iCounter++)
+   {
+      if (aiCounters[iCounter] < 0) continue;
+      ioctl(aiCounters[iCounter], PERF_EVENT_IOC_RESET, 0);
+      ioctl(aiCounters[iCounter], PERF_EVENT_IOC_ENABLE, 0);
+   }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Stop the hardware counters and store each one's count per
+   operation, for uOperations operations, in adPerOp, or -1 for a
+   counter that is not open. */
+
+static void stopCounters(double adPerOp[], size_t uOperations)
+{
+   int iCounter;
+
+   for (iCounter = 0; iCounter < COUNTER_COUNT; iCounter++)
+   {
+      adPerOp[iCounter] = -1.0;
+#ifdef BENCH_HAVE_PERF
+      {
+         long long llCount;
+
+         if (aiCounters[iCounter] < 0) continue;
+         ioctl(aiCounters[iCounter], PERF_EVENT_IOC_DISABLE, 0);
+         if (read(aiCounters[iCounter], &llCount, sizeof(llCount))
+             == (ssize_t)sizeof(llCount))
+            adPerOp[iCounter] = (double)llCount / (double)uOperations;
+      }
+#else
+      (void)uOperations;
+#endif
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write dPerOp, a count per operation, to stdout, or "-" if it is
+   negative. */
+
+static void printCount(double dPerOp)
+{
+   if (dPerOp < 0.0) printf(" %8s", "-");
+   else printf(" %8.2f", dPerOp);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes currently allocated by malloc(), or 0
+   if the C library cannot report it. */
+
+static size_t getHeapBytes(void)
+{
+#ifdef BENCH_HAVE_MALLINFO2
+   return mallinfo2().uordblks;
+#else
+   return 0;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the CPU time between iStart and iEnd, in nanoseconds per
+   operation for uOperations operations. */
+
+static double nsPerOp(clock_t iStart, clock_t iEnd, size_t uOperations)
+{
+   return ((double)(iEnd - iStart)) * 1e9 / CLOCKS_PER_SEC
+      / (double)uOperations;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure tables of uBindings bindings and write one line of results
+   to stdout. Three quarters of the hits go to two "hot" keys, the
+   rest are spread over all keys. */
+
+static void benchSize(size_t uBindings)
+{
+   clock_t iStart;
+   double dPut;
+   double dHit;
+   double dMiss;
+   double adHitCounts[COUNTER_COUNT];
+   double adMissCounts[COUNTER_COUNT];
+   size_t uHeapBefore;
+   size_t uHeapAfter;
+   size_t uTable;
+   size_t u;
+   size_t uRounds;
+   unsigned long ulRandom = 12345;
+   size_t uKey;
+   size_t uSum = 0;
+
+   uHeapBefore = getHeapBytes();
+   iStart = clock();
+   for (uTable = 0; uTable < TABLE_COUNT; uTable++)
+   {
+      aoSymTables[uTable] = SymTable_new();
+      if (aoSymTables[uTable] == NULL)
+      {
+         fprintf(stderr, "Insufficient memory\n");
+         exit(EXIT_FAILURE);
+      }
+      for (u = 0; u < uBindings; u++)
+         SymTable_put(aoSymTables[uTable], aacKeys[u], aacKeys[u]);
+   }
+   dPut = nsPerOp(iStart, clock(), TABLE_COUNT * uBindings);
+   uHeapAfter = getHeapBytes();
+
+   uRounds = LOOKUPS_PER_SIZE / TABLE_COUNT;
+   startCounters();
+   iStart = clock();
+   for (u = 0; u < uRounds; u++)
+   {
+      for (uTable = 0; uTable < TABLE_COUNT; uTable++)
+      {
+         ulRandom = ulRandom * 1103515245UL + 12345UL;
+         uKey = (size_t)(ulRandom >> 8);
+         if (uKey % 4 != 0) uKey %= 2;
+         uKey %= uBindings;
+         uSum += (size_t)SymTable_get(aoSymTables[uTable],
+            aacKeys[uKey]);
+      }
+   }
+   dHit = nsPerOp(iStart, clock(), uRounds * TABLE_COUNT);
+   stopCounters(adHitCounts, uRounds * TABLE_COUNT);
+
+   startCounters();
+   iStart = clock();
+   for (u = 0; u < uRounds; u++)
+   {
+      for (uTable = 0; uTable < TABLE_COUNT; uTable++)
+         uSum += (size_t)SymTable_contains(aoSymTables[uTable],
+            aacMissingKeys[u % MAX_BINDINGS]);
+   }
+   dMiss = nsPerOp(iStart, clock(), uRounds * TABLE_COUNT);
+   stopCounters(adMissCounts, uRounds * TABLE_COUNT);
+
+   for (uTable = 0; uTable < TABLE_COUNT; uTable++)
+      SymTable_free(aoSymTables[uTable]);
+
+   printf("%8lu %10.1f %10.1f %10.1f %12lu", (unsigned long)uBindings,
+      dPut, dHit, dMiss,
+      (unsigned long)((uHeapAfter - uHeapBefore) / TABLE_COUNT));
+   printCount(adHitCounts[COUNTER_L1D]);
+   printCount(adHitCounts[COUNTER_LLC]);
+   printCount(adMissCounts[COUNTER_L1D]);
+   printCount(adMissCounts[COUNTER_LLC]);
+   printf("\n");
+   fflush(stdout);
+
+   /* Keep the lookups from being optimized away */
+   if (uSum == 1) printf("\n");
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Benchmark the SymTable implementation with which this program is
+   linked. argv[0] is the name of the executable binary file. Return
+   0. */
+
+int main(int argc, char *argv[])
+{
+   static const size_t auSizes[] = {1, 2, 4, 8, 12, 16, 24, 32, 48, 64,
+      128, 256};
+   size_t u;
+
+   (void)argc;
+
+   for (u = 0; u < MAX_BINDINGS; u++)
+   {
+      sprintf(aacKeys[u], "local_variable_%lu", (unsigned long)u);
+      sprintf(aacMissingKeys[u], "undefined_name_%lu", (unsigned long)u);
+   }
+
+   openCounters();
+   printf("%s: %d tables per size\n", argv[0], TABLE_COUNT);
+   printf("%8s %10s %10s %10s %12s %8s %8s %8s %8s\n", "bindings",
+      "put ns", "get ns", "miss ns", "bytes/table", "get L1", "get LLC",
+      "miss L1", "miss LLC");
+   for (u = 0; u < sizeof(auSizes) / sizeof(auSizes[0]); u++)
+      benchSize(auSizes[u]);
+
+   return 0;
+}
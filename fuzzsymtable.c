@@ -0,0 +1,804 @@
+/*--------------------------------------------------------------------*/
+/* fuzzsymtable.c                                                     */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+/* Differential fuzzing of the SymTable implementations. Each input is
+   read as a sequence of operations (put, get, replace, remove,
+   contains, map, getLength), which are applied to a table of every
+   implementation at once. symtablelist.c is the reference: after
+   each operation, every other implementation must have returned what
+   it returned and hold as many bindings, and map and the end of each
+   input compare the tables binding by binding. A difference is
+   reported on stderr and ends the program with abort, so that a
+   fuzzer keeps the input.
+
+   symtablehash.c is also tested as SymTable_newEx and
+   SymTable_newInterned create it: with a filter, with borrowed keys,
+   with interned keys, and with each change made in a transaction
+   that is first aborted and then made again and committed. A hash
+   table that evicts is compared instead with a model of a table of
+   CACHE_BINDINGS bindings that evicts the least recently used.
+
+   The implementations all define the same function names, so the
+   Makefile renames the SymTable_ functions of each object file to
+   list_SymTable_new, hash_SymTable_new and so on before linking
+   (make fuzzsymtable). Built with -D FUZZ_LIBFUZZER, this file is a
+   libFuzzer target (make libfuzz). Otherwise it has a main function
+   of its own, which runs random inputs or replays input files. */
+
+#include "symtable.h"
+#include "symtablehash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+/*--------------------------------------------------------------------*/
+
+/* Declare the functions of the implementation renamed with prefix p. */
+
+#define DECLARE_SYMTABLE(p) \
+   SymTable_T p##_SymTable_new(void); \
+   void p##_SymTable_free(SymTable_T oSymTable); \
+   size_t p##_SymTable_getLength(SymTable_T oSymTable); \
+   int p##_SymTable_put(SymTable_T oSymTable, const char *pcKey, \
+      const void *pvValue); \
+   void *p##_SymTable_replace(SymTable_T oSymTable, const char *pcKey, \
+      const void *pvValue); \
+   int p##_SymTable_contains(SymTable_T oSymTable, const char *pcKey); \
+   void *p##_SymTable_get(SymTable_T oSymTable, const char *pcKey); \
+   void *p##_SymTable_remove(SymTable_T oSymTable, const char *pcKey); \
+   void p##_SymTable_map(SymTable_T oSymTable, \
+      void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), \
+      const void *pvExtra);
+
+DECLARE_SYMTABLE(list)
+DECLARE_SYMTABLE(hash)
+DECLARE_SYMTABLE(tree)
+DECLARE_SYMTABLE(hybrid)
+DECLARE_SYMTABLE(hamt)
+DECLARE_SYMTABLE(swiss)
+DECLARE_SYMTABLE(cpp)
+
+/* The extensions of symtablehash.c that the variants of it use. */
+
+void hash_SymTable_initOptions(struct SymTable_Options *psOptions);
+SymTable_T hash_SymTable_newEx(const struct SymTable_Options *psOptions);
+SymTable_T hash_SymTable_newInterned(KeyPool_T oKeyPool);
+int hash_SymTable_begin(SymTable_T oSymTable, size_t uMaxChanges);
+void hash_SymTable_commit(SymTable_T oSymTable);
+void hash_SymTable_abort(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* The keys, of many lengths, some of them empty or sharing prefixes,
+   and the values, of which index 0 is NULL. */
+
+enum {KEY_COUNT = 1024, KEY_LENGTH = 48, VALUE_COUNT = 256};
+
+static char aacKeys[KEY_COUNT][KEY_LENGTH];
+static char acValues[VALUE_COUNT];
+
+/* The most bindings that a hash table that evicts holds. */
+
+enum {CACHE_BINDINGS = 64};
+
+/* The key of the binding that a hash table last evicted, and the
+   number of bindings it has evicted. */
+
+static char acEvictedKey[KEY_LENGTH];
+static size_t uEvictions;
+
+/* Record the eviction of the binding of pcKey. */
+
+static void recordEviction(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   (void)pvValue;
+   (void)pvExtra;
+   strcpy(acEvictedKey, pcKey);
+   uEvictions++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new hash table with a filter of its keys. */
+
+static SymTable_T newFiltered(void)
+{
+   struct SymTable_Options sOptions;
+
+   hash_SymTable_initOptions(&sOptions);
+   sOptions.uFilterBitsPerKey = 10;
+   return hash_SymTable_newEx(&sOptions);
+}
+
+/* Return a new hash table that borrows its keys, which are the
+   elements of aacKeys and so outlive it. */
+
+static SymTable_T newBorrowing(void)
+{
+   struct SymTable_Options sOptions;
+
+   hash_SymTable_initOptions(&sOptions);
+   sOptions.iBorrowKeys = 1;
+   return hash_SymTable_newEx(&sOptions);
+}
+
+/* Return a new hash table whose keys are interned in a pool that all
+   such tables share, and that is never freed. */
+
+static SymTable_T newInterning(void)
+{
+   static KeyPool_T oKeyPool = NULL;
+
+   if (oKeyPool == NULL)
+      oKeyPool = KeyPool_new();
+   if (oKeyPool == NULL)
+      return NULL;
+   return hash_SymTable_newInterned(oKeyPool);
+}
+
+/* Return a new hash table that holds at most CACHE_BINDINGS bindings,
+   evicting the least recently used. */
+
+static SymTable_T newCache(void)
+{
+   struct SymTable_Options sOptions;
+
+   hash_SymTable_initOptions(&sOptions);
+   sOptions.uMaxBindings = CACHE_BINDINGS;
+   sOptions.iEvict = 1;
+   sOptions.pfEvict = recordEviction;
+   return hash_SymTable_newEx(&sOptions);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put pcKey and pvValue into hash table oSymTable in a transaction
+   that is aborted, and then in one that is committed. Return what the
+   second put returns. */
+
+static int putInTransaction(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue)
+{
+   int iResult;
+
+   if (hash_SymTable_begin(oSymTable, 1))
+   {
+      (void)hash_SymTable_put(oSymTable, pcKey, pvValue);
+      hash_SymTable_abort(oSymTable);
+   }
+   if (! hash_SymTable_begin(oSymTable, 1))
+      return hash_SymTable_put(oSymTable, pcKey, pvValue);
+   iResult = hash_SymTable_put(oSymTable, pcKey, pvValue);
+   hash_SymTable_commit(oSymTable);
+   return iResult;
+}
+
+/* Replace the value of pcKey in hash table oSymTable with pvValue in
+   a transaction that is aborted, and then in one that is committed.
+   Return what the second replace returns. */
+
+static void *replaceInTransaction(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue)
+{
+   void *pvResult;
+
+   if (hash_SymTable_begin(oSymTable, 1))
+   {
+      (void)hash_SymTable_replace(oSymTable, pcKey, pvValue);
+      hash_SymTable_abort(oSymTable);
+   }
+   if (! hash_SymTable_begin(oSymTable, 1))
+      return hash_SymTable_replace(oSymTable, pcKey, pvValue);
+   pvResult = hash_SymTable_replace(oSymTable, pcKey, pvValue);
+   hash_SymTable_commit(oSymTable);
+   return pvResult;
+}
+
+/* Remove pcKey from hash table oSymTable in a transaction that is
+   aborted, and then in one that is committed. Return what the second
+   remove returns. */
+
+static void *removeInTransaction(SymTable_T oSymTable,
+   const char *pcKey)
+{
+   void *pvResult;
+
+   if (hash_SymTable_begin(oSymTable, 1))
+   {
+      (void)hash_SymTable_remove(oSymTable, pcKey);
+      hash_SymTable_abort(oSymTable);
+   }
+   if (! hash_SymTable_begin(oSymTable, 1))
+      return hash_SymTable_remove(oSymTable, pcKey);
+   pvResult = hash_SymTable_remove(oSymTable, pcKey);
+   hash_SymTable_commit(oSymTable);
+   return pvResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The functions of one implementation, and whether its tables evict,
+   and so are compared with the model instead of the reference. */
+
+struct Backend
+{
+   const char *pcName;
+   SymTable_T (*pfNew)(void);
+   void (*pfFree)(SymTable_T oSymTable);
+   size_t (*pfGetLength)(SymTable_T oSymTable);
+   int (*pfPut)(SymTable_T oSymTable, const char *pcKey,
+      const void *pvValue);
+   void *(*pfReplace)(SymTable_T oSymTable, const char *pcKey,
+      const void *pvValue);
+   int (*pfContains)(SymTable_T oSymTable, const char *pcKey);
+   void *(*pfGet)(SymTable_T oSymTable, const char *pcKey);
+   void *(*pfRemove)(SymTable_T oSymTable, const char *pcKey);
+   void (*pfMap)(SymTable_T oSymTable,
+      void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+      const void *pvExtra);
+   int iEvicts;
+};
+
+#define BACKEND(p) \
+   {#p, p##_SymTable_new, p##_SymTable_free, p##_SymTable_getLength, \
+    p##_SymTable_put, p##_SymTable_replace, p##_SymTable_contains, \
+    p##_SymTable_get, p##_SymTable_remove, p##_SymTable_map, 0}
+
+/* A hash table created by pfNew, named pcName. */
+
+#define HASH_VARIANT(pcName, pfNew, iEvicts) \
+   {pcName, pfNew, hash_SymTable_free, hash_SymTable_getLength, \
+    hash_SymTable_put, hash_SymTable_replace, hash_SymTable_contains, \
+    hash_SymTable_get, hash_SymTable_remove, hash_SymTable_map, iEvicts}
+
+/* The implementations under test, the reference first. */
+
+static const struct Backend asBackends[] =
+{
+   BACKEND(list),
+   BACKEND(hash),
+   BACKEND(tree),
+   BACKEND(hybrid),
+   BACKEND(hamt),
+   BACKEND(swiss),
+   BACKEND(cpp),
+   HASH_VARIANT("hashfilter", newFiltered, 0),
+   HASH_VARIANT("hashborrow", newBorrowing, 0),
+   HASH_VARIANT("hashintern", newInterning, 0),
+   {"hashtransact", hash_SymTable_new, hash_SymTable_free,
+    hash_SymTable_getLength, putInTransaction, replaceInTransaction,
+    hash_SymTable_contains, hash_SymTable_get, removeInTransaction,
+    hash_SymTable_map, 0},
+   HASH_VARIANT("hashcache", newCache, 1)
+};
+
+enum {BACKEND_COUNT = sizeof(asBackends) / sizeof(asBackends[0])};
+
+/*--------------------------------------------------------------------*/
+
+/* The operations, each encoded as OP_BYTES bytes: the operation, the
+   low and high bytes of the index of its key, and the index of its
+   value. OP_FILL puts a run of keys, as many as twice the value
+   index, so that inputs reach the sizes at which tables expand. */
+
+enum Op {OP_PUT, OP_GET, OP_REMOVE, OP_REPLACE, OP_CONTAINS, OP_MAP,
+   OP_GETLENGTH, OP_FILL, OP_RENEW};
+
+enum {OP_BYTES = 4};
+
+/* The operation of each value of the low 4 bits of an operation byte,
+   weighted toward puts and lookups. */
+
+static const enum Op aeOps[16] =
+{
+   OP_PUT, OP_PUT, OP_PUT, OP_GET, OP_GET, OP_GET, OP_REMOVE, OP_REMOVE,
+   OP_REPLACE, OP_REPLACE, OP_CONTAINS, OP_CONTAINS, OP_MAP,
+   OP_GETLENGTH, OP_FILL, OP_RENEW
+};
+
+static const char *const apcOpNames[] =
+{
+   "put", "get", "remove", "replace", "contains", "map", "getLength",
+   "fill", "renew"
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The table of each implementation. */
+
+static SymTable_T aoSymTables[BACKEND_COUNT];
+
+/* The number of the operation being applied, for reports. */
+
+static size_t uStep;
+
+/* The model of the tables that evict: whether each key is bound, to
+   what, and when it was last used, as a step of uClock. */
+
+struct Cache
+{
+   unsigned char aucBound[KEY_COUNT];
+   void *apvValues[KEY_COUNT];
+   size_t auUsed[KEY_COUNT];
+   size_t uLength;
+   size_t uClock;
+};
+
+static struct Cache sCache;
+
+/*--------------------------------------------------------------------*/
+
+/* Report that implementation iBackend differs from the reference, or
+   from the model if it evicts, in pcWhat, at key pcKey unless it is
+   NULL, and abort. */
+
+static void fail(int iBackend, const char *pcWhat, const char *pcKey)
+{
+   fprintf(stderr, "fuzzsymtable: %s differs from %s in %s",
+      asBackends[iBackend].pcName,
+      asBackends[iBackend].iEvicts ? "its model" : asBackends[0].pcName,
+      pcWhat);
+   if (pcKey != NULL)
+      fprintf(stderr, " of key \"%s\"", pcKey);
+   fprintf(stderr, " at operation %lu\n", (unsigned long)uStep);
+   fflush(stderr);
+   abort();
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the value of index iValue. */
+
+static void *valueOf(int iValue)
+{
+   if (iValue == 0)
+      return NULL;
+   return &acValues[iValue];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply operation eOp, other than OP_MAP, OP_RENEW and OP_FILL, with
+   key index iKey and value pvValue to the model of the tables that
+   evict. Store what a table that evicts must return in *piExpected or
+   *ppvExpected, and the index of the key it must evict in *piVictim,
+   or -1 if it must evict none. */
+
+static void applyToCache(enum Op eOp, int iKey, void *pvValue,
+   int *piExpected, void **ppvExpected, int *piVictim)
+{
+   int iOldest = -1;
+   int i;
+
+   *piExpected = 0;
+   *ppvExpected = NULL;
+   *piVictim = -1;
+   switch (eOp)
+   {
+      case OP_PUT:
+         if (sCache.aucBound[iKey])
+            return;
+         if (sCache.uLength == CACHE_BINDINGS)
+         {
+            for (i = 0; i < KEY_COUNT; i++)
+               if (sCache.aucBound[i] && (iOldest == -1
+                      || sCache.auUsed[i] < sCache.auUsed[iOldest]))
+                  iOldest = i;
+            sCache.aucBound[iOldest] = 0;
+            sCache.uLength--;
+            *piVictim = iOldest;
+         }
+         sCache.aucBound[iKey] = 1;
+         sCache.apvValues[iKey] = pvValue;
+         sCache.uLength++;
+         *piExpected = 1;
+         break;
+      case OP_GET:
+         if (! sCache.aucBound[iKey])
+            return;
+         *ppvExpected = sCache.apvValues[iKey];
+         break;
+      case OP_CONTAINS:
+         if (! sCache.aucBound[iKey])
+            return;
+         *piExpected = 1;
+         break;
+      case OP_REPLACE:
+         if (! sCache.aucBound[iKey])
+            return;
+         *ppvExpected = sCache.apvValues[iKey];
+         sCache.apvValues[iKey] = pvValue;
+         break;
+      case OP_REMOVE:
+         if (sCache.aucBound[iKey])
+         {
+            *ppvExpected = sCache.apvValues[iKey];
+            sCache.aucBound[iKey] = 0;
+            sCache.uLength--;
+         }
+         return;
+      default:
+         return;
+   }
+   sCache.auUsed[iKey] = ++sCache.uClock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Fill aacKeys, once. */
+
+static void makeKeys(void)
+{
+   static const char acPad[] =
+      "keykeykeykeykeykeykeykeykeykeykeykeykeykeykey";
+   static int iMade = 0;
+   int i;
+
+   if (iMade)
+      return;
+   aacKeys[0][0] = '\0';
+   for (i = 1; i < KEY_COUNT; i++)
+      sprintf(aacKeys[i], "%.*s%d", (i * 7) % 41, acPad, i);
+   iMade = 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Create a table of each implementation, exiting if one cannot be
+   created, and empty the model. */
+
+static void newTables(void)
+{
+   int iBackend;
+
+   memset(&sCache, 0, sizeof(sCache));
+
+   for (iBackend = 0; iBackend < BACKEND_COUNT; iBackend++)
+   {
+      aoSymTables[iBackend] = (*asBackends[iBackend].pfNew)();
+      if (aoSymTables[iBackend] == NULL)
+      {
+         fprintf(stderr, "fuzzsymtable: %s: out of memory\n",
+            asBackends[iBackend].pcName);
+         exit(EXIT_FAILURE);
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the table of each implementation. */
+
+static void freeTables(void)
+{
+   int iBackend;
+
+   for (iBackend = 0; iBackend < BACKEND_COUNT; iBackend++)
+   {
+      (*asBackends[iBackend].pfFree)(aoSymTables[iBackend]);
+      aoSymTables[iBackend] = NULL;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The bindings of the reference, as its map visited them: whether
+   each key is bound, and to what. */
+
+static unsigned char aucBound[KEY_COUNT];
+static void *apvBoundValues[KEY_COUNT];
+
+/* The state of a check of the bindings that map visits. */
+
+struct MapCheck
+{
+   int iBackend;
+   size_t uVisits;
+   unsigned char aucSeen[KEY_COUNT];
+};
+
+/* Record the binding of pcKey to pvValue, which map visited in the
+   table of the implementation that *pvExtra names, checking that it
+   was not visited before and, unless the implementation is the
+   reference, that the reference has it too, or the model if the
+   implementation evicts. */
+
+static void checkBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct MapCheck *psCheck = (struct MapCheck*)pvExtra;
+   const char *pcDigits;
+   int iKey;
+
+   /* Every key but the empty one ends with its index */
+   pcDigits = pcKey + strlen(pcKey);
+   while (pcDigits > pcKey && isdigit((unsigned char)pcDigits[-1]))
+      pcDigits--;
+   iKey = (int)strtol(pcDigits, NULL, 10);
+   if (iKey < 0 || iKey >= KEY_COUNT
+       || strcmp(aacKeys[iKey], pcKey) != 0 || psCheck->aucSeen[iKey])
+      fail(psCheck->iBackend, "map", pcKey);
+   psCheck->aucSeen[iKey] = 1;
+   psCheck->uVisits++;
+
+   if (psCheck->iBackend == 0)
+   {
+      aucBound[iKey] = 1;
+      apvBoundValues[iKey] = pvValue;
+   }
+   else if (asBackends[psCheck->iBackend].iEvicts)
+   {
+      if (! sCache.aucBound[iKey] || sCache.apvValues[iKey] != pvValue)
+         fail(psCheck->iBackend, "map", pcKey);
+   }
+   else if (! aucBound[iKey] || apvBoundValues[iKey] != pvValue)
+      fail(psCheck->iBackend, "map", pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that the table of every implementation holds the bindings of
+   the reference, or of the model if it evicts, comparing map for every
+   implementation, and contains and get for every key of the others
+   that do not evict. The reference is a list, whose lookups would take
+   most of the time, and lookups would change which bindings a table
+   that evicts evicts next. */
+
+static void checkAll(void)
+{
+   static struct MapCheck sCheck;
+   size_t uLength;
+   int iBackend;
+   int iKey;
+
+   memset(aucBound, 0, sizeof(aucBound));
+   uLength = (*asBackends[0].pfGetLength)(aoSymTables[0]);
+   for (iBackend = 0; iBackend < BACKEND_COUNT; iBackend++)
+   {
+      memset(&sCheck, 0, sizeof(sCheck));
+      sCheck.iBackend = iBackend;
+      (*asBackends[iBackend].pfMap)(aoSymTables[iBackend],
+         checkBinding, &sCheck);
+      if (sCheck.uVisits
+          != (asBackends[iBackend].iEvicts ? sCache.uLength : uLength))
+         fail(iBackend, "map", NULL);
+      if (iBackend == 0 || asBackends[iBackend].iEvicts)
+         continue;
+
+      for (iKey = 0; iKey < KEY_COUNT; iKey++)
+      {
+         if ((*asBackends[iBackend].pfContains)(aoSymTables[iBackend],
+                aacKeys[iKey]) != aucBound[iKey])
+            fail(iBackend, "contains", aacKeys[iKey]);
+         if ((*asBackends[iBackend].pfGet)(aoSymTables[iBackend],
+                aacKeys[iKey])
+             != (aucBound[iKey] ? apvBoundValues[iKey] : NULL))
+            fail(iBackend, "get", aacKeys[iKey]);
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply operation eOp with key index iKey and value index iValue to
+   the table of every implementation, and check that each returns
+   what the reference returns and holds as many bindings, or, if it
+   evicts, returns what the model returns, holds as many bindings, and
+   evicts the binding that the model evicts. */
+
+static void applyOp(enum Op eOp, int iKey, int iValue)
+{
+   const char *pcKey = aacKeys[iKey];
+   void *pvValue = valueOf(iValue);
+   void *pvExpected = NULL;
+   void *pvResult = NULL;
+   void *pvCacheExpected;
+   int iExpected = 0;
+   int iCacheExpected;
+   int iResult = 0;
+   int iVictim;
+   int iBackend;
+   int i;
+
+   if (eOp == OP_MAP)
+   {
+      checkAll();
+      return;
+   }
+   if (eOp == OP_RENEW)
+   {
+      freeTables();
+      newTables();
+      return;
+   }
+   if (eOp == OP_FILL)
+   {
+      for (i = 0; i < iValue * 2; i++)
+         applyOp(OP_PUT, (iKey + i) % KEY_COUNT, (iKey + i) % VALUE_COUNT);
+      return;
+   }
+
+   applyToCache(eOp, iKey, pvValue, &iCacheExpected, &pvCacheExpected,
+      &iVictim);
+
+   for (iBackend = 0; iBackend < BACKEND_COUNT; iBackend++)
+   {
+      const struct Backend *psBackend = &asBackends[iBackend];
+      SymTable_T oSymTable = aoSymTables[iBackend];
+
+      uEvictions = 0;
+      switch (eOp)
+      {
+         case OP_PUT:
+            iResult = (*psBackend->pfPut)(oSymTable, pcKey, pvValue);
+            break;
+         case OP_GET:
+            pvResult = (*psBackend->pfGet)(oSymTable, pcKey);
+            break;
+         case OP_REMOVE:
+            pvResult = (*psBackend->pfRemove)(oSymTable, pcKey);
+            break;
+         case OP_REPLACE:
+            pvResult = (*psBackend->pfReplace)(oSymTable, pcKey, pvValue);
+            break;
+         case OP_CONTAINS:
+            iResult = (*psBackend->pfContains)(oSymTable, pcKey);
+            break;
+         default:
+            break;
+      }
+
+      if (psBackend->iEvicts)
+      {
+         if (iResult != iCacheExpected || pvResult != pvCacheExpected)
+            fail(iBackend, apcOpNames[eOp], pcKey);
+         if (uEvictions != (iVictim == -1 ? 0U : 1U)
+             || (iVictim != -1
+                 && strcmp(acEvictedKey, aacKeys[iVictim]) != 0))
+            fail(iBackend, "eviction", pcKey);
+         if ((*psBackend->pfGetLength)(oSymTable) != sCache.uLength)
+            fail(iBackend, "getLength", NULL);
+         continue;
+      }
+
+      if (iBackend == 0)
+      {
+         iExpected = iResult;
+         pvExpected = pvResult;
+      }
+      else if (iResult != iExpected || pvResult != pvExpected)
+         fail(iBackend, apcOpNames[eOp], pcKey);
+
+      if ((*psBackend->pfGetLength)(oSymTable)
+          != (*asBackends[0].pfGetLength)(aoSymTables[0]))
+         fail(iBackend, "getLength", NULL);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+int LLVMFuzzerTestOneInput(const uint8_t *pucData, size_t uSize);
+
+/* Apply the operations of the uSize bytes at pucData to new tables of
+   every implementation, checking them against the reference. Return
+   0, as libFuzzer requires. */
+
+int LLVMFuzzerTestOneInput(const uint8_t *pucData, size_t uSize)
+{
+   size_t u;
+
+   makeKeys();
+   newTables();
+   uStep = 0;
+   for (u = 0; u + OP_BYTES <= uSize; u += OP_BYTES)
+   {
+      applyOp(aeOps[pucData[u] & 0x0F],
+         (pucData[u + 1] | pucData[u + 2] << 8) % KEY_COUNT,
+         pucData[u + 3]);
+      uStep++;
+   }
+   checkAll();
+   freeTables();
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+#ifndef FUZZ_LIBFUZZER
+
+enum {MAX_INPUT_SIZE = 4096};
+
+/* The state of the random number generator of main. */
+
+static uint64_t uRandom;
+
+/* Return the next pseudo-random number (xorshift64*). */
+
+static uint64_t nextRandom(void)
+{
+   uRandom ^= uRandom >> 12;
+   uRandom ^= uRandom << 25;
+   uRandom ^= uRandom >> 27;
+   return uRandom * UINT64_C(0x2545F4914F6CDD1D);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply the contents of the file named pcFileName as an input. Return
+   0 (FALSE) if the file cannot be read, and 1 (TRUE) otherwise. */
+
+static int replayFile(const char *pcFileName)
+{
+   static uint8_t aucInput[1 << 20];
+   FILE *psFile;
+   size_t uSize;
+
+   psFile = fopen(pcFileName, "rb");
+   if (psFile == NULL)
+      return 0;
+   uSize = fread(aucInput, 1, sizeof(aucInput), psFile);
+   fclose(psFile);
+   LLVMFuzzerTestOneInput(aucInput, uSize);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run random inputs through every implementation, or replay inputs.
+   With arguments inputcount and seed, both optional, run inputcount
+   (by default 200) random inputs of up to MAX_INPUT_SIZE bytes
+   generated from seed. With argument -r followed by file names,
+   apply the contents of each file as an input, as libFuzzer would.
+   Return 0, or EXIT_FAILURE if the arguments are bad or a file
+   cannot be read. A difference aborts. */
+
+int main(int argc, char *argv[])
+{
+   static uint8_t aucInput[MAX_INPUT_SIZE];
+   unsigned long ulInputCount = 200;
+   unsigned long ulSeed = 1;
+   unsigned long ul;
+   size_t uSize;
+   size_t u;
+   int i;
+
+   if (argc >= 2 && strcmp(argv[1], "-r") == 0)
+   {
+      for (i = 2; i < argc; i++)
+         if (! replayFile(argv[i]))
+         {
+            fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[i]);
+            return EXIT_FAILURE;
+         }
+      printf("%d inputs replayed without differences.\n", argc - 2);
+      return 0;
+   }
+
+   if (argc > 3
+       || (argc >= 2 && sscanf(argv[1], "%lu", &ulInputCount) != 1)
+       || (argc == 3 && sscanf(argv[2], "%lu", &ulSeed) != 1))
+   {
+      fprintf(stderr, "Usage: %s [inputcount [seed]]\n", argv[0]);
+      fprintf(stderr, "       %s -r file...\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   uRandom = (uint64_t)ulSeed * UINT64_C(0x9E3779B97F4A7C15) + 1;
+   for (ul = 0; ul < ulInputCount; ul++)
+   {
+      uSize = (size_t)(nextRandom() % (MAX_INPUT_SIZE + 1));
+      for (u = 0; u < uSize; u++)
+         aucInput[u] = (uint8_t)(nextRandom() >> 56);
+      LLVMFuzzerTestOneInput(aucInput, uSize);
+   }
+   printf("%lu random inputs from seed %lu without differences.\n",
+      ulInputCount, ulSeed);
+   return 0;
+}
+
+#endif
@@ -0,0 +1,674 @@
+/*--------------------------------------------------------------------*/
+/* keyops.c                                                           */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "keyops.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && defined(__SSE2__)
+#define KEYOPS_SSE2
+#include <emmintrin.h>
+#if defined(__x86_64__)
+#define KEYOPS_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_NEON)
+#define KEYOPS_NEON
+#include <arm_neon.h>
+#endif
+
+/* The vector variants load whole blocks of characters, which may
+extend past the end of a key but never into another page. Address
+and thread sanitizers would report those harmless reads. */
+#if defined(__GNUC__)
+#define KEYOPS_NO_SANITIZE \
+    __attribute__((no_sanitize_address, no_sanitize_thread))
+#else
+#define KEYOPS_NO_SANITIZE
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* The smallest page size of any supported processor. A block that
+does not cross a multiple of PAGE_SIZE lies in one page, so if any of
+its characters may be read, all of them may. */
+
+enum {PAGE_SIZE = 4096};
+
+/*--------------------------------------------------------------------*/
+
+/* Powers of the hash multiplier 65599, modulo 2^64. Element i is
+65599^(32-i) for i <= 32, and 0 beyond. A block of uLength characters
+followed by anything contributes the sum of character j times element
+33-uLength+j, and shifts the hash code of the characters before it
+left by element 32-uLength. */
+
+static const uint64_t auPowers[65] = {
+    UINT64_C(0x272B16B3227EF801), UINT64_C(0x552D310C04BDF7BF),
+    UINT64_C(0xE146E4BAE70D2881), UINT64_C(0x36D46302871BA73F),
+    UINT64_C(0x6283F85A44CB9901), UINT64_C(0x14A64D96E03916BF),
+    UINT64_C(0x174B591B5FDA4981), UINT64_C(0x12A87FD3E3F6463F),
+    UINT64_C(0x513D14A06C593A01), UINT64_C(0xD7F62BA8563335BF),
+    UINT64_C(0x91F0EDABAE686A81), UINT64_C(0x11BB34DEEACFE53F),
+    UINT64_C(0x59700F277A27DB01), UINT64_C(0xDFF53C1645AC54BF),
+    UINT64_C(0x4DA9C32E33B78B81), UINT64_C(0xE638A5B8FAA8843F),
+    UINT64_C(0x91252E124F377C01), UINT64_C(0x79B79CF58DA473BF),
+    UINT64_C(0xA0320D6650C7AC81), UINT64_C(0xA4C912B67280233F),
+    UINT64_C(0x0CDA7B04CC881D01), UINT64_C(0x772DB89A0D1B92BF),
+    UINT64_C(0xF2D7B4186698CD81), UINT64_C(0x5950F7EAB156C23F),
+    UINT64_C(0xFDCBE423D319BE01), UINT64_C(0xD7C3E496A311B1BF),
+    UINT64_C(0x5D02F409D62AEE81), UINT64_C(0x9B302C28162C613F),
+    UINT64_C(0x00FC5D1543EC5F01), UINT64_C(0x000100BD2E86D0BF),
+    UINT64_C(0x00000001007E0F81), UINT64_C(0x000000000001003F),
+    UINT64_C(0x0000000000000001)
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A variant is one implementation of every operation. */
+
+struct Variant {
+    /* The name of the variant */
+    const char *pcName;
+
+    /* The address of a function that returns 1 (TRUE) if the
+    processor supports the variant, and 0 (FALSE) otherwise */
+    int (*pfIsSupported)(void);
+
+    /* The addresses of the variant's operations */
+    size_t (*pfHash)(const char *pcKey);
+    int (*pfEquals)(const char *pcKey1, const char *pcKey2);
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE). */
+static int KeyOps_always(void) {
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code of pcKey one character at a time. */
+static size_t KeyOps_hashScalar(const char *pcKey) {
+      const size_t HASH_MULTIPLIER = 65599;
+      size_t u;
+      size_t uHash = 0;
+
+      assert(pcKey != NULL);
+
+      for (u = 0; pcKey[u] != '\0'; u++)
+         uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+      return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if pcKey1 and pcKey2 are equal, using the C
+library. */
+static int KeyOps_equalsScalar(const char *pcKey1, const char *pcKey2) {
+    assert(pcKey1 != NULL);
+    assert(pcKey2 != NULL);
+
+    return strcmp(pcKey1, pcKey2) == 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+#if defined(KEYOPS_SSE2) || defined(KEYOPS_NEON)
+
+/* Return pcKey if the uWidth bytes starting there lie in one page.
+Otherwise copy the characters of pcKey up to and including its
+terminating null character, but at most uWidth of them, into
+acBuffer, fill the rest of acBuffer with null characters, and return
+acBuffer. */
+static const char *KeyOps_blockAt(const char *pcKey, size_t uWidth,
+                                  char *acBuffer) {
+    size_t u;
+
+    assert(pcKey != NULL);
+    assert(acBuffer != NULL);
+
+    if (((uintptr_t)pcKey & (PAGE_SIZE - 1)) <= PAGE_SIZE - uWidth)
+        return pcKey;
+
+    for (u = 0; u < uWidth && pcKey[u] != '\0'; u++)
+        acBuffer[u] = pcKey[u];
+    memset(acBuffer + u, '\0', uWidth - u);
+    return acBuffer;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code of a key whose characters before the last
+uLength have hash code uHash and whose last uLength characters are
+pcChars[0..uLength-1]. A last block of only a few characters is cheaper
+to hash one character at a time than as a vector. */
+static size_t KeyOps_hashTail(uint64_t uHash, const char *pcChars,
+                              unsigned int uLength) {
+    const uint64_t HASH_MULTIPLIER = 65599;
+    unsigned int u;
+
+    assert(pcChars != NULL);
+
+    for (u = 0; u < uLength; u++)
+        uHash = uHash * HASH_MULTIPLIER + (uint64_t)pcChars[u];
+
+    return (size_t)uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the amount by which the sum of characters times puPowers[j]
+over a block overstates the hash code's contribution when characters
+are signed. uNegatives has uBitsPerChar bits for each character of the
+block, and the lowest of them is set if the character is negative. */
+static uint64_t KeyOps_signCorrection(uint64_t uNegatives,
+                                      unsigned int uBitsPerChar,
+                                      const uint64_t *puPowers) {
+    uint64_t uCorrection = 0;
+    unsigned int uBit;
+
+    assert(puPowers != NULL);
+
+    for (; uNegatives != 0; uNegatives &= uNegatives - 1) {
+        uBit = (unsigned int)__builtin_ctzll(uNegatives);
+        if (uBit % uBitsPerChar == 0)
+            uCorrection += puPowers[uBit / uBitsPerChar] << 8;
+    }
+    return uCorrection;
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef KEYOPS_SSE2
+
+/* Add the products of the two 64-bit lanes of vPair and puPowers[0..1]
+to *pvLow and *pvHigh, the sums of products with the low and high 32
+bits of the powers. */
+static void KeyOps_accumulateSse2(__m128i vPair, const uint64_t *puPowers,
+                                  __m128i *pvLow, __m128i *pvHigh) {
+    __m128i vPowers;
+
+    vPowers = _mm_loadu_si128((const __m128i*)puPowers);
+    *pvLow = _mm_add_epi64(*pvLow, _mm_mul_epu32(vPair, vPowers));
+    *pvHigh = _mm_add_epi64(*pvHigh,
+        _mm_mul_epu32(vPair, _mm_srli_epi64(vPowers, 32)));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the sum of the 16 characters of vChars, as unsigned bytes,
+times puPowers[0..15], modulo 2^64. */
+static uint64_t KeyOps_dotSse2(__m128i vChars, const uint64_t *puPowers) {
+    const __m128i vZero = _mm_setzero_si128();
+    __m128i avWords[2];
+    __m128i vDwords;
+    __m128i vLow = vZero;
+    __m128i vHigh = vZero;
+    uint64_t uDot;
+    int i;
+
+    avWords[0] = _mm_unpacklo_epi8(vChars, vZero);
+    avWords[1] = _mm_unpackhi_epi8(vChars, vZero);
+    for (i = 0; i < 2; i++) {
+        vDwords = _mm_unpacklo_epi16(avWords[i], vZero);
+        KeyOps_accumulateSse2(_mm_unpacklo_epi32(vDwords, vZero),
+                              puPowers + 8 * i, &vLow, &vHigh);
+        KeyOps_accumulateSse2(_mm_unpackhi_epi32(vDwords, vZero),
+                              puPowers + 8 * i + 2, &vLow, &vHigh);
+        vDwords = _mm_unpackhi_epi16(avWords[i], vZero);
+        KeyOps_accumulateSse2(_mm_unpacklo_epi32(vDwords, vZero),
+                              puPowers + 8 * i + 4, &vLow, &vHigh);
+        KeyOps_accumulateSse2(_mm_unpackhi_epi32(vDwords, vZero),
+                              puPowers + 8 * i + 6, &vLow, &vHigh);
+    }
+
+    vLow = _mm_add_epi64(vLow, _mm_slli_epi64(vHigh, 32));
+    vLow = _mm_add_epi64(vLow, _mm_unpackhi_epi64(vLow, vLow));
+    _mm_storel_epi64((__m128i*)&uDot, vLow);
+    return uDot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code of pcKey 16 characters at a time. */
+KEYOPS_NO_SANITIZE
+static size_t KeyOps_hashSse2(const char *pcKey) {
+    char acBuffer[16];
+    const char *pcBlock;
+    __m128i vChars;
+    unsigned int uEnds;
+    unsigned int uLength;
+    uint64_t uHash = 0;
+
+    assert(pcKey != NULL);
+
+    for (;;) {
+        pcBlock = KeyOps_blockAt(pcKey, 16, acBuffer);
+        vChars = _mm_loadu_si128((const __m128i*)pcBlock);
+        uEnds = (unsigned int)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(vChars, _mm_setzero_si128()));
+        uLength = uEnds != 0 ? (unsigned int)__builtin_ctz(uEnds) : 16;
+        if (uLength <= 8)
+            return KeyOps_hashTail(uHash, pcBlock, uLength);
+
+        uHash = uHash * auPowers[32 - uLength]
+                + KeyOps_dotSse2(vChars, &auPowers[33 - uLength]);
+#if CHAR_MIN < 0
+        uHash -= KeyOps_signCorrection(
+            (unsigned int)_mm_movemask_epi8(vChars), 1,
+            &auPowers[33 - uLength]);
+#endif
+
+        if (uEnds != 0) return (size_t)uHash;
+        pcKey += 16;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if pcKey1 and pcKey2 are equal. Keys that differ
+usually do so early, so compare the first 16 characters as one block
+and leave any rest to the C library, whose strcmp is vectorized too. */
+KEYOPS_NO_SANITIZE
+static int KeyOps_equalsSse2(const char *pcKey1, const char *pcKey2) {
+    char acBuffer1[16];
+    char acBuffer2[16];
+    __m128i vChars1;
+    __m128i vChars2;
+    unsigned int uDiffs;
+    unsigned int uEnds;
+    unsigned int uFirst;
+
+    assert(pcKey1 != NULL);
+    assert(pcKey2 != NULL);
+
+    vChars1 = _mm_loadu_si128(
+        (const __m128i*)KeyOps_blockAt(pcKey1, 16, acBuffer1));
+    vChars2 = _mm_loadu_si128(
+        (const __m128i*)KeyOps_blockAt(pcKey2, 16, acBuffer2));
+    uDiffs = ~(unsigned int)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(vChars1, vChars2)) & 0xFFFF;
+    uEnds = (unsigned int)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(vChars1, _mm_setzero_si128()));
+
+    /* The keys are equal if the first difference or end is the end of
+    both */
+    if ((uDiffs | uEnds) != 0) {
+        uFirst = (unsigned int)__builtin_ctz(uDiffs | uEnds);
+        return (int)((uEnds & ~uDiffs) >> uFirst) & 1;
+    }
+    return strcmp(pcKey1 + 16, pcKey2 + 16) == 0;
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef KEYOPS_AVX2
+
+/* Return 1 (TRUE) if the processor supports AVX2. */
+static int KeyOps_hasAvx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add the products of the four 64-bit lanes of vQuad and
+puPowers[0..3] to *pvLow and *pvHigh, the sums of products with the
+low and high 32 bits of the powers. */
+__attribute__((target("avx2")))
+static void KeyOps_accumulateAvx2(__m256i vQuad, const uint64_t *puPowers,
+                                  __m256i *pvLow, __m256i *pvHigh) {
+    __m256i vPowers;
+
+    vPowers = _mm256_loadu_si256((const __m256i*)puPowers);
+    *pvLow = _mm256_add_epi64(*pvLow, _mm256_mul_epu32(vQuad, vPowers));
+    *pvHigh = _mm256_add_epi64(*pvHigh,
+        _mm256_mul_epu32(vQuad, _mm256_srli_epi64(vPowers, 32)));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the sum of the 32 characters of vChars, as unsigned bytes,
+times puPowers[0..31], modulo 2^64. */
+__attribute__((target("avx2")))
+static uint64_t KeyOps_dotAvx2(__m256i vChars, const uint64_t *puPowers) {
+    __m128i avHalves[2];
+    __m256i vLow = _mm256_setzero_si256();
+    __m256i vHigh = _mm256_setzero_si256();
+    __m128i vSum;
+    uint64_t uDot;
+    int i;
+
+    avHalves[0] = _mm256_castsi256_si128(vChars);
+    avHalves[1] = _mm256_extracti128_si256(vChars, 1);
+    for (i = 0; i < 2; i++) {
+        KeyOps_accumulateAvx2(_mm256_cvtepu8_epi64(avHalves[i]),
+                              puPowers + 16 * i, &vLow, &vHigh);
+        KeyOps_accumulateAvx2(
+            _mm256_cvtepu8_epi64(_mm_srli_si128(avHalves[i], 4)),
+            puPowers + 16 * i + 4, &vLow, &vHigh);
+        KeyOps_accumulateAvx2(
+            _mm256_cvtepu8_epi64(_mm_srli_si128(avHalves[i], 8)),
+            puPowers + 16 * i + 8, &vLow, &vHigh);
+        KeyOps_accumulateAvx2(
+            _mm256_cvtepu8_epi64(_mm_srli_si128(avHalves[i], 12)),
+            puPowers + 16 * i + 12, &vLow, &vHigh);
+    }
+
+    vLow = _mm256_add_epi64(vLow, _mm256_slli_epi64(vHigh, 32));
+    vSum = _mm_add_epi64(_mm256_castsi256_si128(vLow),
+                         _mm256_extracti128_si256(vLow, 1));
+    vSum = _mm_add_epi64(vSum, _mm_unpackhi_epi64(vSum, vSum));
+    _mm_storel_epi64((__m128i*)&uDot, vSum);
+    return uDot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code of pcKey 32 characters at a time. */
+__attribute__((target("avx2")))
+KEYOPS_NO_SANITIZE
+static size_t KeyOps_hashAvx2(const char *pcKey) {
+    char acBuffer[32];
+    const char *pcBlock;
+    __m256i vChars;
+    unsigned int uEnds;
+    unsigned int uLength;
+    uint64_t uHash = 0;
+
+    assert(pcKey != NULL);
+
+    for (;;) {
+        pcBlock = KeyOps_blockAt(pcKey, 32, acBuffer);
+        vChars = _mm256_loadu_si256((const __m256i*)pcBlock);
+        uEnds = (unsigned int)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(vChars, _mm256_setzero_si256()));
+        uLength = uEnds != 0 ? (unsigned int)__builtin_ctz(uEnds) : 32;
+        if (uLength <= 16)
+            return KeyOps_hashTail(uHash, pcBlock, uLength);
+
+        uHash = uHash * auPowers[32 - uLength]
+                + KeyOps_dotAvx2(vChars, &auPowers[33 - uLength]);
+#if CHAR_MIN < 0
+        uHash -= KeyOps_signCorrection(
+            (unsigned int)_mm256_movemask_epi8(vChars), 1,
+            &auPowers[33 - uLength]);
+#endif
+
+        if (uEnds != 0) return (size_t)uHash;
+        pcKey += 32;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if pcKey1 and pcKey2 are equal, comparing the first
+32 characters as one block. */
+__attribute__((target("avx2")))
+KEYOPS_NO_SANITIZE
+static int KeyOps_equalsAvx2(const char *pcKey1, const char *pcKey2) {
+    char acBuffer1[32];
+    char acBuffer2[32];
+    __m256i vChars1;
+    __m256i vChars2;
+    unsigned int uDiffs;
+    unsigned int uEnds;
+    unsigned int uFirst;
+
+    assert(pcKey1 != NULL);
+    assert(pcKey2 != NULL);
+
+    vChars1 = _mm256_loadu_si256(
+        (const __m256i*)KeyOps_blockAt(pcKey1, 32, acBuffer1));
+    vChars2 = _mm256_loadu_si256(
+        (const __m256i*)KeyOps_blockAt(pcKey2, 32, acBuffer2));
+    uDiffs = ~(unsigned int)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(vChars1, vChars2));
+    uEnds = (unsigned int)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(vChars1, _mm256_setzero_si256()));
+
+    if ((uDiffs | uEnds) != 0) {
+        uFirst = (unsigned int)__builtin_ctz(uDiffs | uEnds);
+        return (int)((uEnds & ~uDiffs) >> uFirst) & 1;
+    }
+    return strcmp(pcKey1 + 32, pcKey2 + 32) == 0;
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef KEYOPS_NEON
+
+/* Return a mask with 4 bits for each byte of vFlags, which are all
+set if the byte is 0xFF and all clear if it is 0. NEON has no direct
+counterpart of the x86 movemask instructions. */
+static uint64_t KeyOps_maskNeon(uint8x16_t vFlags) {
+    return vget_lane_u64(vreinterpret_u64_u8(
+        vshrn_n_u16(vreinterpretq_u16_u8(vFlags), 4)), 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the sum of the 16 characters of vChars, as unsigned bytes,
+times puPowers[0..15], modulo 2^64. */
+static uint64_t KeyOps_dotNeon(uint8x16_t vChars,
+                               const uint64_t *puPowers) {
+    uint16x8_t avWords[2];
+    uint32x4_t vDwords;
+    uint64x2_t vPowers;
+    uint64x2_t vLow = vdupq_n_u64(0);
+    uint64x2_t vHigh = vdupq_n_u64(0);
+    int i;
+    int j;
+
+    avWords[0] = vmovl_u8(vget_low_u8(vChars));
+    avWords[1] = vmovl_u8(vget_high_u8(vChars));
+    for (i = 0; i < 4; i++) {
+        vDwords = i % 2 == 0 ? vmovl_u16(vget_low_u16(avWords[i / 2]))
+                             : vmovl_u16(vget_high_u16(avWords[i / 2]));
+        for (j = 0; j < 2; j++) {
+            vPowers = vld1q_u64(puPowers + 4 * i + 2 * j);
+            vLow = vmlal_u32(vLow, j == 0 ? vget_low_u32(vDwords)
+                                          : vget_high_u32(vDwords),
+                             vmovn_u64(vPowers));
+            vHigh = vmlal_u32(vHigh, j == 0 ? vget_low_u32(vDwords)
+                                            : vget_high_u32(vDwords),
+                              vshrn_n_u64(vPowers, 32));
+        }
+    }
+
+    vLow = vaddq_u64(vLow, vshlq_n_u64(vHigh, 32));
+    return vgetq_lane_u64(vLow, 0) + vgetq_lane_u64(vLow, 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code of pcKey 16 characters at a time. */
+KEYOPS_NO_SANITIZE
+static size_t KeyOps_hashNeon(const char *pcKey) {
+    char acBuffer[16];
+    const char *pcBlock;
+    uint8x16_t vChars;
+    uint64_t uEnds;
+    unsigned int uLength;
+    uint64_t uHash = 0;
+
+    assert(pcKey != NULL);
+
+    for (;;) {
+        pcBlock = KeyOps_blockAt(pcKey, 16, acBuffer);
+        vChars = vld1q_u8((const uint8_t*)pcBlock);
+        uEnds = KeyOps_maskNeon(vceqq_u8(vChars, vdupq_n_u8(0)));
+        uLength = uEnds != 0 ? (unsigned int)__builtin_ctzll(uEnds) / 4
+                             : 16;
+        if (uLength <= 8)
+            return KeyOps_hashTail(uHash, pcBlock, uLength);
+
+        uHash = uHash * auPowers[32 - uLength]
+                + KeyOps_dotNeon(vChars, &auPowers[33 - uLength]);
+#if CHAR_MIN < 0
+        uHash -= KeyOps_signCorrection(
+            KeyOps_maskNeon(vcltq_s8(vreinterpretq_s8_u8(vChars),
+                                     vdupq_n_s8(0))), 4,
+            &auPowers[33 - uLength]);
+#endif
+
+        if (uEnds != 0) return (size_t)uHash;
+        pcKey += 16;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if pcKey1 and pcKey2 are equal, comparing the first
+16 characters as one block. */
+KEYOPS_NO_SANITIZE
+static int KeyOps_equalsNeon(const char *pcKey1, const char *pcKey2) {
+    char acBuffer1[16];
+    char acBuffer2[16];
+    uint8x16_t vChars1;
+    uint8x16_t vChars2;
+    uint64_t uDiffs;
+    uint64_t uEnds;
+    unsigned int uFirst;
+
+    assert(pcKey1 != NULL);
+    assert(pcKey2 != NULL);
+
+    vChars1 = vld1q_u8(
+        (const uint8_t*)KeyOps_blockAt(pcKey1, 16, acBuffer1));
+    vChars2 = vld1q_u8(
+        (const uint8_t*)KeyOps_blockAt(pcKey2, 16, acBuffer2));
+    uDiffs = ~KeyOps_maskNeon(vceqq_u8(vChars1, vChars2));
+    uEnds = KeyOps_maskNeon(vceqq_u8(vChars1, vdupq_n_u8(0)));
+
+    if ((uDiffs | uEnds) != 0) {
+        uFirst = (unsigned int)__builtin_ctzll(uDiffs | uEnds);
+        return (int)((uEnds & ~uDiffs) >> uFirst) & 1;
+    }
+    return strcmp(pcKey1 + 16, pcKey2 + 16) == 0;
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* The variants compiled into this module, slowest first */
+
+static const struct Variant asVariants[] = {
+    {"scalar", KeyOps_always, KeyOps_hashScalar, KeyOps_equalsScalar}
+#ifdef KEYOPS_SSE2
+    , {"sse2", KeyOps_always, KeyOps_hashSse2, KeyOps_equalsSse2}
+#endif
+#ifdef KEYOPS_AVX2
+    , {"avx2", KeyOps_hasAvx2, KeyOps_hashAvx2, KeyOps_equalsAvx2}
+#endif
+#ifdef KEYOPS_NEON
+    , {"neon", KeyOps_always, KeyOps_hashNeon, KeyOps_equalsNeon}
+#endif
+};
+
+/* The variant in use, or NULL if none has been chosen yet. Threads
+may choose it at once, so it is only read and written atomically;
+each chooses the same variant. */
+
+static const struct Variant *psVariant = NULL;
+
+/*--------------------------------------------------------------------*/
+
+/* Return the fastest variant that the processor supports. */
+static const struct Variant *KeyOps_select(void) {
+    size_t u;
+
+    for (u = sizeof(asVariants) / sizeof(asVariants[0]) - 1; u > 0; u--)
+        if ((*asVariants[u].pfIsSupported)())
+            return &asVariants[u];
+    return &asVariants[0];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store psNewVariant as the variant in use. */
+static void KeyOps_setVariant(const struct Variant *psNewVariant) {
+    assert(psNewVariant != NULL);
+
+#ifdef __GNUC__
+    __atomic_store_n(&psVariant, psNewVariant, __ATOMIC_RELEASE);
+#else
+    psVariant = psNewVariant;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the variant in use, choosing it if none has been yet. */
+static const struct Variant *KeyOps_getVariant(void) {
+    const struct Variant *psCurrent;
+
+#ifdef __GNUC__
+    psCurrent = __atomic_load_n(&psVariant, __ATOMIC_ACQUIRE);
+#else
+    psCurrent = psVariant;
+#endif
+    if (psCurrent == NULL) {
+        psCurrent = KeyOps_select();
+        KeyOps_setVariant(psCurrent);
+    }
+    return psCurrent;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t KeyOps_hash(const char *pcKey) {
+    assert(pcKey != NULL);
+
+    return (*KeyOps_getVariant()->pfHash)(pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+int KeyOps_equals(const char *pcKey1, const char *pcKey2) {
+    assert(pcKey1 != NULL);
+    assert(pcKey2 != NULL);
+
+    return (*KeyOps_getVariant()->pfEquals)(pcKey1, pcKey2);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t KeyOps_getVariantCount(void) {
+    return sizeof(asVariants) / sizeof(asVariants[0]);
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *KeyOps_getVariantName(size_t uVariant) {
+    assert(uVariant < KeyOps_getVariantCount());
+
+    return asVariants[uVariant].pcName;
+}
+
+/*--------------------------------------------------------------------*/
+
+int KeyOps_useVariant(size_t uVariant) {
+    assert(uVariant < KeyOps_getVariantCount());
+
+    if (!(*asVariants[uVariant].pfIsSupported)()) return 0;
+    KeyOps_setVariant(&asVariants[uVariant]);
+    return 1;
+}
@@ -0,0 +1,49 @@
+/*--------------------------------------------------------------------*/
+/* keyops.h                                                           */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef KEYOPS_INCLUDED
+#define KEYOPS_INCLUDED
+
+#include <stddef.h>
+
+/* Hashing and comparison of key strings, the inner loops of the hash
+table implementations. Each operation has a scalar variant and, where
+the compiler and processor allow, variants that examine 16 or 32
+characters at a time. The fastest variant that the processor supports
+is chosen the first time an operation is used, by any thread. Every
+variant returns the same results. */
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the hash code of pcKey, computed as uHash = uHash * 65599 +
+(size_t)c over the characters c of pcKey, starting from 0 */
+  size_t KeyOps_hash(const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if pcKey1 and pcKey2 are equal strings, and 0
+(FALSE) otherwise */
+  int KeyOps_equals(const char *pcKey1, const char *pcKey2);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of variants compiled into this module. Variant 0
+is the scalar one. */
+  size_t KeyOps_getVariantCount(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the name of variant uVariant, such as "scalar" or "avx2" */
+  const char *KeyOps_getVariantName(size_t uVariant);
+
+/*--------------------------------------------------------------------*/
+
+/* Makes KeyOps_hash and KeyOps_equals use variant uVariant from now on
+and returns 1 (TRUE), or returns 0 (FALSE) and changes nothing if the
+processor does not support that variant. Meant for tests and
+benchmarks. */
+  int KeyOps_useVariant(size_t uVariant);
+
+#endif
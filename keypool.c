@@ -0,0 +1,299 @@
+/*--------------------------------------------------------------------*/
+/* keypool.c                                                          */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "keyops.h"
+#include "keypool.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Keys are carved out of blocks of BLOCK_SIZE bytes; longer keys get
+a block of their own. The pool starts with INITIAL_BUCKET_COUNT buckets
+and doubles them whenever it holds as many keys as buckets. */
+
+enum {BLOCK_SIZE = 65536, INITIAL_BUCKET_COUNT = 1023};
+
+/*--------------------------------------------------------------------*/
+
+/* Each interned key is preceded in its block by a header. Headers are
+linked to form the chains of the pool's hash table. */
+
+struct KeyHeader {
+    /* The address of the next header in the same bucket */
+    struct KeyHeader *psNextHeader;
+
+    /* The hash code of the key */
+    size_t uHash;
+
+    /* The id of the key */
+    size_t uId;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A block of memory from which headers and keys are allocated. */
+
+struct Block {
+    /* The address of the previously allocated block */
+    struct Block *psNextBlock;
+    /* The number of bytes of the block in use */
+    size_t uUsed;
+    /* The number of bytes the block can hold */
+    size_t uCapacity;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A KeyPool is a hash table of key headers plus the blocks in which
+they reside. */
+
+struct KeyPool {
+    /* A pointer to an array of many first headers (buckets) */
+    struct KeyHeader **ppsFirstHeaders;
+    /* The number of buckets pointed to */
+    size_t bucketCount;
+    /* The number of keys interned */
+    size_t length;
+    /* The address of the block currently being filled */
+    struct Block *psBlock;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes needed for uSize bytes so that whatever
+follows them is suitably aligned for a struct KeyHeader. */
+static size_t KeyPool_align(size_t uSize) {
+    const size_t uAlignment = sizeof(struct KeyHeader*);
+
+    return (uSize + uAlignment - 1) / uAlignment * uAlignment;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of the key that follows the header psHeader. */
+static const char *KeyPool_keyOf(const struct KeyHeader *psHeader) {
+    assert(psHeader != NULL);
+
+    return (const char*)(psHeader + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the header that precedes the interned key pcInternedKey. */
+static const struct KeyHeader *KeyPool_headerOf(
+    const char *pcInternedKey) {
+    assert(pcInternedKey != NULL);
+
+    return (const struct KeyHeader*)pcInternedKey - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes of memory from oKeyPool's blocks, or NULL if
+insufficient memory is available. */
+static void *KeyPool_allocate(KeyPool_T oKeyPool, size_t uSize) {
+    struct Block *psBlock;
+    size_t uHeaderSize;
+    size_t uCapacity;
+    char *pcMemory;
+
+    assert(oKeyPool != NULL);
+
+    uHeaderSize = KeyPool_align(sizeof(struct Block));
+    uSize = KeyPool_align(uSize);
+
+    psBlock = oKeyPool->psBlock;
+    if (psBlock == NULL || psBlock->uCapacity - psBlock->uUsed < uSize) {
+        uCapacity = uSize > BLOCK_SIZE ? uSize : BLOCK_SIZE;
+        psBlock = (struct Block*)malloc(uHeaderSize + uCapacity);
+        if (psBlock == NULL) return NULL;
+        psBlock->uUsed = 0;
+        psBlock->uCapacity = uCapacity;
+
+        /* Keep filling the current block if the new one is private */
+        if (uSize > BLOCK_SIZE && oKeyPool->psBlock != NULL) {
+            psBlock->psNextBlock = oKeyPool->psBlock->psNextBlock;
+            oKeyPool->psBlock->psNextBlock = psBlock;
+        }
+        else {
+            psBlock->psNextBlock = oKeyPool->psBlock;
+            oKeyPool->psBlock = psBlock;
+        }
+    }
+
+    pcMemory = (char*)psBlock + uHeaderSize + psBlock->uUsed;
+    psBlock->uUsed += uSize;
+    return pcMemory;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Double the number of buckets of oKeyPool, plus one so that the count
+stays odd, and rehash every key. Leave oKeyPool unchanged if
+insufficient memory is available. */
+static void KeyPool_expand(KeyPool_T oKeyPool) {
+    struct KeyHeader **ppsNewFirstHeaders;
+    struct KeyHeader *psHeader;
+    struct KeyHeader *psNextHeader;
+    size_t newBucketCount;
+    size_t i;
+    size_t j;
+
+    assert(oKeyPool != NULL);
+
+    newBucketCount = 2 * oKeyPool->bucketCount + 1;
+    ppsNewFirstHeaders = (struct KeyHeader**)
+        malloc(newBucketCount * sizeof(struct KeyHeader*));
+    if (ppsNewFirstHeaders == NULL) return;
+
+    for (i = 0; i < newBucketCount; i++)
+        ppsNewFirstHeaders[i] = NULL;
+
+    for (i = 0; i < oKeyPool->bucketCount; i++) {
+        for (psHeader = oKeyPool->ppsFirstHeaders[i]; psHeader != NULL;
+             psHeader = psNextHeader) {
+            psNextHeader = psHeader->psNextHeader;
+            j = psHeader->uHash % newBucketCount;
+            psHeader->psNextHeader = ppsNewFirstHeaders[j];
+            ppsNewFirstHeaders[j] = psHeader;
+        }
+    }
+
+    free(oKeyPool->ppsFirstHeaders);
+    oKeyPool->ppsFirstHeaders = ppsNewFirstHeaders;
+    oKeyPool->bucketCount = newBucketCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+KeyPool_T KeyPool_new(void) {
+    KeyPool_T oKeyPool;
+    size_t i;
+
+    oKeyPool = (KeyPool_T)malloc(sizeof(struct KeyPool));
+    if (oKeyPool == NULL) return NULL;
+
+    oKeyPool->ppsFirstHeaders = (struct KeyHeader**)
+        malloc(INITIAL_BUCKET_COUNT * sizeof(struct KeyHeader*));
+    if (oKeyPool->ppsFirstHeaders == NULL) {
+        free(oKeyPool);
+        return NULL;
+    }
+
+    /* Initialize all buckets to NULL */
+    for (i = 0; i < INITIAL_BUCKET_COUNT; i++)
+        oKeyPool->ppsFirstHeaders[i] = NULL;
+
+    oKeyPool->bucketCount = INITIAL_BUCKET_COUNT;
+    oKeyPool->length = 0;
+    oKeyPool->psBlock = NULL;
+
+    return oKeyPool;
+}
+
+/*--------------------------------------------------------------------*/
+
+void KeyPool_free(KeyPool_T oKeyPool) {
+    struct Block *psBlock;
+    struct Block *psNextBlock;
+
+    assert(oKeyPool != NULL);
+
+    /* The headers and keys reside in the blocks */
+    for (psBlock = oKeyPool->psBlock; psBlock != NULL;
+         psBlock = psNextBlock) {
+        psNextBlock = psBlock->psNextBlock;
+        free(psBlock);
+    }
+
+    free(oKeyPool->ppsFirstHeaders);
+    free(oKeyPool);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t KeyPool_getLength(KeyPool_T oKeyPool) {
+    assert(oKeyPool != NULL);
+
+    return oKeyPool->length;
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *KeyPool_intern(KeyPool_T oKeyPool, const char *pcKey) {
+    struct KeyHeader *psHeader;
+    const char *pcInternedKey;
+    size_t uLength;
+    size_t uHash;
+    size_t i;
+
+    assert(oKeyPool != NULL);
+    assert(pcKey != NULL);
+
+    pcInternedKey = KeyPool_find(oKeyPool, pcKey);
+    if (pcInternedKey != NULL) return pcInternedKey;
+
+    /* Expand the hash table if necessary */
+    if (oKeyPool->length == oKeyPool->bucketCount)
+        KeyPool_expand(oKeyPool);
+
+    uLength = strlen(pcKey);
+    psHeader = (struct KeyHeader*)
+        KeyPool_allocate(oKeyPool, sizeof(struct KeyHeader) + uLength + 1);
+    if (psHeader == NULL) return NULL;
+
+    uHash = KeyOps_hash(pcKey);
+    psHeader->uHash = uHash;
+    psHeader->uId = oKeyPool->length;
+    memcpy((char*)KeyPool_keyOf(psHeader), pcKey, uLength + 1);
+
+    i = uHash % oKeyPool->bucketCount;
+    psHeader->psNextHeader = oKeyPool->ppsFirstHeaders[i];
+    oKeyPool->ppsFirstHeaders[i] = psHeader;
+
+    oKeyPool->length++;
+
+    return KeyPool_keyOf(psHeader);
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *KeyPool_find(KeyPool_T oKeyPool, const char *pcKey) {
+    struct KeyHeader *psHeader;
+    size_t uHash;
+
+    assert(oKeyPool != NULL);
+    assert(pcKey != NULL);
+
+    uHash = KeyOps_hash(pcKey);
+    for (psHeader = oKeyPool->ppsFirstHeaders[uHash
+                                              % oKeyPool->bucketCount];
+         psHeader != NULL;
+         psHeader = psHeader->psNextHeader) {
+        if (psHeader->uHash == uHash &&
+            KeyOps_equals(KeyPool_keyOf(psHeader), pcKey))
+            return KeyPool_keyOf(psHeader);
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t KeyPool_getId(const char *pcInternedKey) {
+    assert(pcInternedKey != NULL);
+
+    return KeyPool_headerOf(pcInternedKey)->uId;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t KeyPool_getHash(const char *pcInternedKey) {
+    assert(pcInternedKey != NULL);
+
+    return KeyPool_headerOf(pcInternedKey)->uHash;
+}
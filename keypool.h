@@ -0,0 +1,59 @@
+/*--------------------------------------------------------------------*/
+/* keypool.h                                                          */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef KEYPOOL_INCLUDED
+#define KEYPOOL_INCLUDED
+
+#include <stddef.h>
+
+/* A KeyPool_T holds one copy of each distinct key string interned in
+it. Interned keys stay at the same address until the pool is freed, so
+two interned keys are equal exactly when their addresses are equal.
+Many SymTable objects can share one pool, whether a single global pool
+or one pool per compilation context. */
+typedef struct KeyPool *KeyPool_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new KeyPool object that contains no keys, or NULL if
+insufficient memory is available */
+  KeyPool_T KeyPool_new(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Frees all memory occupied by oKeyPool, including every interned key.
+The keys must no longer be in use. */
+  void KeyPool_free(KeyPool_T oKeyPool);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of distinct keys interned in oKeyPool */
+  size_t KeyPool_getLength(KeyPool_T oKeyPool);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the interned copy of pcKey, adding a copy to oKeyPool if it
+has none yet, or NULL if insufficient memory is available */
+  const char *KeyPool_intern(KeyPool_T oKeyPool, const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the interned copy of pcKey, or NULL if pcKey has never been
+interned in oKeyPool */
+  const char *KeyPool_find(KeyPool_T oKeyPool, const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the id of the interned key pcInternedKey. Ids are assigned
+in interning order, starting at 0. */
+  size_t KeyPool_getId(const char *pcInternedKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the hash code of the interned key pcInternedKey, computed
+once when it was interned with the hash function of symtablehash.c */
+  size_t KeyPool_getHash(const char *pcInternedKey);
+
+#endif
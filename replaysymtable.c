@@ -0,0 +1,585 @@
+/*--------------------------------------------------------------------*/
+/* replaysymtable.c                                                   */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+/* Replay a trace of SymTable operations that symtabletrace.c recorded
+   from a real program, and report the throughput, the distribution of
+   the latency of each kind of operation, and the peak memory. Link it
+   with each implementation (make replay) and compare them on the
+   workload that matters instead of on synthetic keys. The trace is
+   decoded, and hashed keys are turned back into distinct keys of the
+   same lengths, before anything is timed. */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#define SYMTABLETRACE_NO_RENAME
+
+#include "symtable.h"
+#include "symtabletrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define REPLAY_HAVE_MALLINFO2
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* The number of operations between samples of the heap, and the
+   number of runs of which the fastest gives the throughput by
+   default. */
+
+enum {HEAP_SAMPLE_INTERVAL = 1024, DEFAULT_RUNS = 3};
+
+/* One decoded operation: a SymTableTrace_Op other than
+   SYMTABLETRACE_KEY, its SymTableTrace_Result, and the numbers of its
+   table and key. */
+
+struct Op
+{
+   unsigned char ucOp;
+   unsigned char ucResult;
+   uint32_t uTable;
+   uint32_t uKey;
+};
+
+/* The decoded trace. */
+
+static struct Op *psOps;
+static size_t uOpCount;
+static char **ppcKeys;
+static size_t uKeyCount;
+static size_t uTableCount;
+static int iHashedKeys;
+
+/* The tables of a run, by number. */
+
+static SymTable_T *poTables;
+
+/* The latency of each operation of the measured run, in nanoseconds,
+   and the peak number of bytes of the heap in use during it, less
+   those in use before it. */
+
+static uint32_t *puNanos;
+static size_t uPeakHeap;
+
+/* The number of bindings that SymTable_map visited and
+   SymTable_getLength counted. */
+
+static size_t uMapped;
+
+/*--------------------------------------------------------------------*/
+
+/* Return the current time in nanoseconds. */
+
+static uint64_t now(void)
+{
+   struct timespec sTime;
+
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (uint64_t)sTime.tv_sec * 1000000000u
+      + (uint64_t)sTime.tv_nsec;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of the heap in use, or 0 if it cannot be
+   measured here. */
+
+static size_t getHeapBytes(void)
+{
+#ifdef REPLAY_HAVE_MALLINFO2
+   return mallinfo2().uordblks;
+#else
+   return 0;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Report that the trace is malformed, and exit. */
+
+static void malformed(const char *pcFileName)
+{
+   fprintf(stderr, "replaysymtable: %s is not a valid trace\n",
+      pcFileName);
+   exit(EXIT_FAILURE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Report that insufficient memory is available if pv is NULL, and
+   exit. Otherwise return pv. */
+
+static void *checked(void *pv)
+{
+   if (pv == NULL)
+   {
+      fprintf(stderr, "Insufficient memory\n");
+      exit(EXIT_FAILURE);
+   }
+   return pv;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read a LEB128 number at *ppucNext, which must come before pucEnd,
+   into *puValue and advance *ppucNext past it. Return 0 (FALSE) if
+   the bytes end first or the number does not fit in 32 bits. */
+
+static int readNumber(const unsigned char **ppucNext,
+   const unsigned char *pucEnd, uint32_t *puValue)
+{
+   uint64_t uValue = 0;
+   int iShift = 0;
+   unsigned char uc;
+
+   do
+   {
+      if (*ppucNext == pucEnd || iShift > 28)
+         return 0;
+      uc = *(*ppucNext)++;
+      uValue |= (uint64_t)(uc & 0x7F) << iShift;
+      iShift += 7;
+   } while (uc & 0x80);
+
+   if (uValue > UINT32_MAX)
+      return 0;
+   *puValue = (uint32_t)uValue;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the next pseudo-random number of the sequence at *puState
+   (splitmix64). */
+
+static uint64_t nextRandom(uint64_t *puState)
+{
+   uint64_t u;
+
+   *puState += UINT64_C(0x9E3779B97F4A7C15);
+   u = *puState;
+   u = (u ^ (u >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+   u = (u ^ (u >> 27)) * UINT64_C(0x94D049BB133111EB);
+   return u ^ (u >> 31);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make a key of uLength bytes from the 8-byte hash at pucHash, other
+   than the keys that oMade holds, and add it to oMade. The bytes are
+   drawn from 1 to 255, so there are always as many keys of each
+   length as there were original keys. */
+
+static char *makeKey(size_t uLength, const unsigned char *pucHash,
+   SymTable_T oMade)
+{
+   char *pcKey = (char*)checked(malloc(uLength + 1));
+   uint64_t uState = 0;
+   size_t u;
+
+   for (u = 0; u < 8; u++)
+      uState |= (uint64_t)pucHash[u] << (8 * u);
+   do
+   {
+      for (u = 0; u < uLength; u++)
+         pcKey[u] = (char)(1 + nextRandom(&uState) % 255);
+      pcKey[uLength] = '\0';
+   } while (SymTable_contains(oMade, pcKey));
+   if (! SymTable_put(oMade, pcKey, NULL))
+      checked(NULL);
+   return pcKey;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read and decode the trace in the file named pcFileName, exiting if
+   it cannot be read or is malformed. */
+
+static void readTrace(const char *pcFileName)
+{
+   FILE *psFile;
+   unsigned char *pucTrace = NULL;
+   const unsigned char *pucNext;
+   const unsigned char *pucEnd;
+   size_t uSize = 0;
+   size_t uCapacity = 0;
+   size_t uOpCapacity = 0;
+   size_t uKeyCapacity = 0;
+   SymTable_T oMade;
+   uint32_t uLength;
+   struct Op sOp;
+
+   psFile = fopen(pcFileName, "rb");
+   if (psFile == NULL)
+   {
+      fprintf(stderr, "replaysymtable: cannot read %s\n", pcFileName);
+      exit(EXIT_FAILURE);
+   }
+   do
+   {
+      if (uSize == uCapacity)
+      {
+         uCapacity = uCapacity == 0 ? 65536 : 2 * uCapacity;
+         pucTrace = (unsigned char*)
+            checked(realloc(pucTrace, uCapacity));
+      }
+      uSize += fread(pucTrace + uSize, 1, uCapacity - uSize, psFile);
+   } while (uSize == uCapacity);
+   fclose(psFile);
+
+   if (uSize < 6 || memcmp(pucTrace, "SymT", 4) != 0
+       || pucTrace[4] != SYMTABLETRACE_VERSION
+       || pucTrace[5] > SYMTABLETRACE_HASHED_KEYS)
+      malformed(pcFileName);
+   iHashedKeys = pucTrace[5] == SYMTABLETRACE_HASHED_KEYS;
+   oMade = (SymTable_T)checked(SymTable_new());
+
+   pucNext = pucTrace + 6;
+   pucEnd = pucTrace + uSize;
+   while (pucNext != pucEnd)
+   {
+      sOp.ucOp = (unsigned char)(*pucNext & 0x0F);
+      sOp.ucResult = (unsigned char)((*pucNext >> 4) & 0x03);
+      sOp.uTable = 0;
+      sOp.uKey = 0;
+      pucNext++;
+
+      if (sOp.ucOp == SYMTABLETRACE_KEY)
+      {
+         if (! readNumber(&pucNext, pucEnd, &uLength)
+             || (size_t)(pucEnd - pucNext) < (iHashedKeys ? 8 : uLength))
+            malformed(pcFileName);
+         if (uKeyCount == uKeyCapacity)
+         {
+            uKeyCapacity = uKeyCapacity == 0 ? 1024 : 2 * uKeyCapacity;
+            ppcKeys = (char**)checked(realloc(ppcKeys,
+               uKeyCapacity * sizeof(char*)));
+         }
+         if (iHashedKeys)
+         {
+            ppcKeys[uKeyCount] = makeKey(uLength, pucNext, oMade);
+            pucNext += 8;
+         }
+         else
+         {
+            ppcKeys[uKeyCount] = (char*)checked(malloc(uLength + 1));
+            memcpy(ppcKeys[uKeyCount], pucNext, uLength);
+            ppcKeys[uKeyCount][uLength] = '\0';
+            pucNext += uLength;
+         }
+         uKeyCount++;
+         continue;
+      }
+
+      if (sOp.ucOp == SYMTABLETRACE_NEW)
+         sOp.uTable = (uint32_t)uTableCount++;
+      else if (sOp.ucOp < SYMTABLETRACE_NEW
+               || sOp.ucOp > SYMTABLETRACE_GETLENGTH
+               || ! readNumber(&pucNext, pucEnd, &sOp.uTable)
+               || sOp.uTable >= uTableCount)
+         malformed(pcFileName);
+      if (sOp.ucOp >= SYMTABLETRACE_PUT
+          && sOp.ucOp <= SYMTABLETRACE_REMOVE
+          && (! readNumber(&pucNext, pucEnd, &sOp.uKey)
+              || sOp.uKey >= uKeyCount))
+         malformed(pcFileName);
+
+      if (uOpCount == uOpCapacity)
+      {
+         uOpCapacity = uOpCapacity == 0 ? 65536 : 2 * uOpCapacity;
+         psOps = (struct Op*)checked(realloc(psOps,
+            uOpCapacity * sizeof(struct Op)));
+      }
+      psOps[uOpCount++] = sOp;
+   }
+
+   SymTable_free(oMade);
+   free(pucTrace);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count a binding that SymTable_map visited. */
+
+static void countBinding(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   (void)pcKey;
+   (void)pvValue;
+   (void)pvExtra;
+   uMapped++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply operation psOp, binding each key to itself. Return 0 (FALSE)
+   if the result is known to differ from the one in the trace, and 1
+   (TRUE) otherwise. */
+
+static int apply(const struct Op *psOp)
+{
+   SymTable_T oSymTable = poTables[psOp->uTable];
+   const char *pcKey = NULL;
+   int iFound;
+
+   /* The trace has a table for every operation, but the replay may not
+      if the program ran out of memory */
+   if (oSymTable == NULL && psOp->ucOp != SYMTABLETRACE_NEW)
+      return 0;
+   if (psOp->ucOp >= SYMTABLETRACE_PUT
+       && psOp->ucOp <= SYMTABLETRACE_REMOVE)
+      pcKey = ppcKeys[psOp->uKey];
+
+   switch (psOp->ucOp)
+   {
+      case SYMTABLETRACE_NEW:
+         poTables[psOp->uTable] = SymTable_new();
+         return poTables[psOp->uTable] != NULL;
+      case SYMTABLETRACE_FREE:
+         SymTable_free(oSymTable);
+         poTables[psOp->uTable] = NULL;
+         return 1;
+      case SYMTABLETRACE_PUT:
+         iFound = SymTable_put(oSymTable, pcKey, pcKey);
+         break;
+      case SYMTABLETRACE_REPLACE:
+         iFound = SymTable_replace(oSymTable, pcKey, pcKey) != NULL;
+         break;
+      case SYMTABLETRACE_CONTAINS:
+         iFound = SymTable_contains(oSymTable, pcKey);
+         break;
+      case SYMTABLETRACE_GET:
+         iFound = SymTable_get(oSymTable, pcKey) != NULL;
+         break;
+      case SYMTABLETRACE_REMOVE:
+         iFound = SymTable_remove(oSymTable, pcKey) != NULL;
+         break;
+      case SYMTABLETRACE_MAP:
+         SymTable_map(oSymTable, countBinding, NULL);
+         return 1;
+      default:
+         uMapped += SymTable_getLength(oSymTable);
+         return 1;
+   }
+
+   /* A binding to NULL makes the program's lookups return NULL where
+      the replay's do not */
+   if (psOp->ucResult == SYMTABLETRACE_TRUE)
+      return iFound;
+   if (psOp->ucResult == SYMTABLETRACE_FALSE)
+      return ! iFound;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the tables that the trace did not free. */
+
+static void freeTables(void)
+{
+   size_t u;
+
+   for (u = 0; u < uTableCount; u++)
+      if (poTables[u] != NULL)
+      {
+         SymTable_free(poTables[u]);
+         poTables[u] = NULL;
+      }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Replay the trace once, as fast as possible, and return the time that
+   it took in nanoseconds. Store in *puDiffering the number of results
+   that differ from those of the trace. */
+
+static uint64_t runFast(size_t *puDiffering)
+{
+   uint64_t uStart;
+   uint64_t uTime;
+   size_t uDiffering = 0;
+   size_t u;
+
+   uStart = now();
+   for (u = 0; u < uOpCount; u++)
+      uDiffering += (size_t)! apply(&psOps[u]);
+   uTime = now() - uStart;
+   freeTables();
+   *puDiffering = uDiffering;
+   return uTime;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Replay the trace once, timing each operation into puNanos and
+   sampling the heap into uPeakHeap. */
+
+static void runMeasured(void)
+{
+   uint64_t uStart;
+   uint64_t uEnd;
+   size_t uHeapBefore;
+   size_t uHeap;
+   size_t u;
+
+   uHeapBefore = getHeapBytes();
+   uPeakHeap = 0;
+   for (u = 0; u < uOpCount; u++)
+   {
+      uStart = now();
+      (void)apply(&psOps[u]);
+      uEnd = now();
+      puNanos[u] = uEnd - uStart > UINT32_MAX ? UINT32_MAX
+         : (uint32_t)(uEnd - uStart);
+      if (u % HEAP_SAMPLE_INTERVAL == HEAP_SAMPLE_INTERVAL - 1
+          || u == uOpCount - 1)
+      {
+         uHeap = getHeapBytes();
+         if (uHeap > uHeapBefore && uHeap - uHeapBefore > uPeakHeap)
+            uPeakHeap = uHeap - uHeapBefore;
+      }
+   }
+   freeTables();
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the latencies at pvLeft and pvRight for qsort. */
+
+static int compareNanos(const void *pvLeft, const void *pvRight)
+{
+   uint32_t uLeft = *(const uint32_t*)pvLeft;
+   uint32_t uRight = *(const uint32_t*)pvRight;
+
+   return (uLeft > uRight) - (uLeft < uRight);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Print the count and the latency percentiles of the operations of
+   kind ucOp, named pcName, if there are any. puSorted has room for
+   all operations. */
+
+static void printLatencies(unsigned char ucOp, const char *pcName,
+   uint32_t *puSorted)
+{
+   static const double adPercentiles[] = {0.5, 0.9, 0.99, 0.999};
+   size_t uCount = 0;
+   size_t u;
+
+   for (u = 0; u < uOpCount; u++)
+      if (psOps[u].ucOp == ucOp)
+         puSorted[uCount++] = puNanos[u];
+   if (uCount == 0)
+      return;
+   qsort(puSorted, uCount, sizeof(uint32_t), compareNanos);
+
+   printf("%-10s %10lu", pcName, (unsigned long)uCount);
+   for (u = 0; u < sizeof(adPercentiles) / sizeof(adPercentiles[0]);
+        u++)
+      printf(" %9lu", (unsigned long)
+         puSorted[(size_t)(adPercentiles[u] * (double)(uCount - 1))]);
+   printf(" %9lu\n", (unsigned long)puSorted[uCount - 1]);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Replay the trace in the file named argv[1] against the linked
+   implementation argv[2] times (by default DEFAULT_RUNS), and print
+   the throughput of the fastest run. Then replay it once more, timing
+   each operation, and print the latency percentiles and the peak
+   heap. Return 0, or EXIT_FAILURE if the arguments are bad. */
+
+int main(int argc, char *argv[])
+{
+   static const char *const apcNames[] =
+   {
+      "", "new", "free", "put", "replace", "contains", "get", "remove",
+      "map", "getLength"
+   };
+   struct rusage sUsage;
+   uint32_t *puSorted;
+   uint64_t uBest = 0;
+   uint64_t uTime;
+   uint64_t uTimer = 0;
+   size_t uDiffering = 0;
+   int iRuns = DEFAULT_RUNS;
+   int iRun;
+   unsigned char ucOp;
+
+   if (argc < 2 || argc > 3
+       || (argc == 3 && (sscanf(argv[2], "%d", &iRuns) != 1
+                         || iRuns < 1)))
+   {
+      fprintf(stderr, "Usage: %s tracefile [runs]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   readTrace(argv[1]);
+   poTables = (SymTable_T*)
+      checked(calloc(uTableCount + 1, sizeof(SymTable_T)));
+   puNanos = (uint32_t*)
+      checked(malloc((uOpCount + 1) * sizeof(uint32_t)));
+   puSorted = (uint32_t*)
+      checked(malloc((uOpCount + 1) * sizeof(uint32_t)));
+
+   for (iRun = 0; iRun < iRuns; iRun++)
+   {
+      uTime = runFast(&uDiffering);
+      if (iRun == 0 || uTime < uBest)
+         uBest = uTime;
+   }
+   runMeasured();
+
+   /* The cost of reading the clock is part of every latency */
+   for (iRun = 0; iRun < 1000; iRun++)
+   {
+      uTime = now();
+      uTime = now() - uTime;
+      if (iRun == 0 || uTime < uTimer)
+         uTimer = uTime;
+   }
+
+   printf("%s: %s\n", argv[0], argv[1]);
+   printf("%lu operations on %lu tables with %lu %s keys\n",
+      (unsigned long)uOpCount, (unsigned long)uTableCount,
+      (unsigned long)uKeyCount, iHashedKeys ? "anonymized" : "raw");
+   printf("results that differ from the trace: %lu\n",
+      (unsigned long)uDiffering);
+   printf("throughput: %.2f million operations per second "
+      "(fastest of %d runs)\n",
+      uBest == 0 ? 0.0 : (double)uOpCount * 1000.0 / (double)uBest,
+      iRuns);
+#ifdef REPLAY_HAVE_MALLINFO2
+   printf("peak heap: %lu bytes (sampled every %d operations)\n",
+      (unsigned long)uPeakHeap, HEAP_SAMPLE_INTERVAL);
+#endif
+   if (getrusage(RUSAGE_SELF, &sUsage) == 0)
+      printf("peak resident set: %ld KB (including the trace)\n",
+         (long)sUsage.ru_maxrss);
+   printf("latency in ns, including about %lu ns to read the clock:\n",
+      (unsigned long)uTimer);
+   printf("%-10s %10s %9s %9s %9s %9s %9s\n", "operation", "count",
+      "p50", "p90", "p99", "p99.9", "max");
+   for (ucOp = SYMTABLETRACE_NEW; ucOp <= SYMTABLETRACE_GETLENGTH; ucOp++)
+      printLatencies(ucOp, apcNames[ucOp], puSorted);
+
+   free(puSorted);
+   free(puNanos);
+   free(poTables);
+   while (uKeyCount > 0)
+      free(ppcKeys[--uKeyCount]);
+   free(ppcKeys);
+   free(psOps);
+   return 0;
+}
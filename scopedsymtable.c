@@ -0,0 +1,319 @@
+/*--------------------------------------------------------------------*/
+/* scopedsymtable.c                                                   */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include "scopedsymtable.h"
+#include "symtablehash.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The number of log entries and scopes for which space is first
+allocated */
+
+enum {INITIAL_CAPACITY = 64};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in a shadow. The shadows of one key are
+linked from the innermost scope outward, and the hash table maps the
+key to the innermost one. */
+
+struct Shadow {
+    /* The interned key */
+    const char *pcKey;
+
+    /* The associated data */
+    const void *pvValue;
+
+    /* The depth of the scope that made the binding */
+    size_t uDepth;
+
+    /* The address of the shadow of the same key in the nearest
+    enclosing scope, or NULL if there is none */
+    struct Shadow *psShadowed;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A ScopedSymTable is one hash table from keys to their innermost
+shadows, plus an undo log that records the shadows in the order they
+were made. Scope i made the log entries from auScopeStarts[i-1] up to
+the start of the next scope or the end of the log. */
+
+struct ScopedSymTable {
+    /* The table from interned keys to innermost shadows */
+    SymTable_T oSymTable;
+    /* The pool in which keys are interned */
+    KeyPool_T oKeyPool;
+
+    /* The address of the undo log */
+    struct Shadow **ppsLog;
+    /* The number of entries in the undo log */
+    size_t uLogLength;
+    /* The number of entries the undo log can hold */
+    size_t uLogCapacity;
+
+    /* The address of the array of log positions at which each entered
+    scope starts */
+    size_t *auScopeStarts;
+    /* The number of scopes entered */
+    size_t uDepth;
+    /* The number of scopes the array can hold */
+    size_t uScopeCapacity;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the bindings made since the undo log of oScopedSymTable was
+uLogLength entries long, most recent first, uncovering the shadows
+they covered. */
+static void ScopedSymTable_undo(ScopedSymTable_T oScopedSymTable,
+                                size_t uLogLength) {
+    struct Shadow *psShadow;
+
+    assert(oScopedSymTable != NULL);
+    assert(uLogLength <= oScopedSymTable->uLogLength);
+
+    while (oScopedSymTable->uLogLength > uLogLength) {
+        psShadow = oScopedSymTable->ppsLog[--oScopedSymTable->uLogLength];
+        if (psShadow->psShadowed != NULL)
+            (void)SymTable_replace(oScopedSymTable->oSymTable,
+                                   psShadow->pcKey, psShadow->psShadowed);
+        else (void)SymTable_remove(oScopedSymTable->oSymTable,
+                                   psShadow->pcKey);
+        free(psShadow);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the innermost shadow of pcKey in oScopedSymTable, or NULL if
+pcKey is bound in no scope. */
+static struct Shadow *ScopedSymTable_find(
+    ScopedSymTable_T oScopedSymTable, const char *pcKey) {
+    const char *pcInternedKey;
+
+    assert(oScopedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pcInternedKey = KeyPool_find(oScopedSymTable->oKeyPool, pcKey);
+    if (pcInternedKey == NULL) return NULL;
+
+    return (struct Shadow*)
+        SymTable_getInterned(oScopedSymTable->oSymTable, pcInternedKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+ScopedSymTable_T ScopedSymTable_new(void) {
+    ScopedSymTable_T oScopedSymTable;
+
+    oScopedSymTable = (ScopedSymTable_T)
+        malloc(sizeof(struct ScopedSymTable));
+    if (oScopedSymTable == NULL) return NULL;
+
+    oScopedSymTable->oKeyPool = KeyPool_new();
+    oScopedSymTable->oSymTable = NULL;
+    oScopedSymTable->ppsLog = (struct Shadow**)
+        malloc(INITIAL_CAPACITY * sizeof(struct Shadow*));
+    oScopedSymTable->auScopeStarts = (size_t*)
+        malloc(INITIAL_CAPACITY * sizeof(size_t));
+    if (oScopedSymTable->oKeyPool != NULL)
+        oScopedSymTable->oSymTable =
+            SymTable_newInterned(oScopedSymTable->oKeyPool);
+
+    if (oScopedSymTable->oSymTable == NULL ||
+        oScopedSymTable->ppsLog == NULL ||
+        oScopedSymTable->auScopeStarts == NULL) {
+        if (oScopedSymTable->oSymTable != NULL)
+            SymTable_free(oScopedSymTable->oSymTable);
+        if (oScopedSymTable->oKeyPool != NULL)
+            KeyPool_free(oScopedSymTable->oKeyPool);
+        free(oScopedSymTable->ppsLog);
+        free(oScopedSymTable->auScopeStarts);
+        free(oScopedSymTable);
+        return NULL;
+    }
+
+    oScopedSymTable->uLogLength = 0;
+    oScopedSymTable->uLogCapacity = INITIAL_CAPACITY;
+    oScopedSymTable->uDepth = 0;
+    oScopedSymTable->uScopeCapacity = INITIAL_CAPACITY;
+
+    return oScopedSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ScopedSymTable_free(ScopedSymTable_T oScopedSymTable) {
+    size_t i;
+
+    assert(oScopedSymTable != NULL);
+
+    /* Free the shadows without restoring what they shadowed */
+    for (i = 0; i < oScopedSymTable->uLogLength; i++)
+        free(oScopedSymTable->ppsLog[i]);
+
+    SymTable_free(oScopedSymTable->oSymTable);
+    KeyPool_free(oScopedSymTable->oKeyPool);
+    free(oScopedSymTable->ppsLog);
+    free(oScopedSymTable->auScopeStarts);
+    free(oScopedSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ScopedSymTable_getDepth(ScopedSymTable_T oScopedSymTable) {
+    assert(oScopedSymTable != NULL);
+
+    return oScopedSymTable->uDepth;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ScopedSymTable_enterScope(ScopedSymTable_T oScopedSymTable) {
+    size_t *auNewScopeStarts;
+
+    assert(oScopedSymTable != NULL);
+
+    /* Grow the array of scopes if it is full */
+    if (oScopedSymTable->uDepth == oScopedSymTable->uScopeCapacity) {
+        auNewScopeStarts = (size_t*)realloc(
+            oScopedSymTable->auScopeStarts,
+            2 * oScopedSymTable->uScopeCapacity * sizeof(size_t));
+        if (auNewScopeStarts == NULL) return 0;
+        oScopedSymTable->auScopeStarts = auNewScopeStarts;
+        oScopedSymTable->uScopeCapacity *= 2;
+    }
+
+    oScopedSymTable->auScopeStarts[oScopedSymTable->uDepth++] =
+        oScopedSymTable->uLogLength;
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ScopedSymTable_exitScope(ScopedSymTable_T oScopedSymTable) {
+    assert(oScopedSymTable != NULL);
+    assert(oScopedSymTable->uDepth > 0);
+
+    ScopedSymTable_undo(oScopedSymTable,
+        oScopedSymTable->auScopeStarts[--oScopedSymTable->uDepth]);
+}
+
+/*--------------------------------------------------------------------*/
+
+int ScopedSymTable_put(ScopedSymTable_T oScopedSymTable,
+                       const char *pcKey, const void *pvValue) {
+    struct Shadow **ppsNewLog;
+    struct Shadow *psInnermost;
+    struct Shadow *psNewShadow;
+    const char *pcInternedKey;
+
+    assert(oScopedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pcInternedKey = KeyPool_intern(oScopedSymTable->oKeyPool, pcKey);
+    if (pcInternedKey == NULL) return 0;
+
+    /* Check if the innermost scope already binds pcKey */
+    psInnermost = (struct Shadow*)
+        SymTable_getInterned(oScopedSymTable->oSymTable, pcInternedKey);
+    if (psInnermost != NULL &&
+        psInnermost->uDepth == oScopedSymTable->uDepth)
+        return 0;
+
+    /* Grow the undo log if it is full */
+    if (oScopedSymTable->uLogLength == oScopedSymTable->uLogCapacity) {
+        ppsNewLog = (struct Shadow**)realloc(oScopedSymTable->ppsLog,
+            2 * oScopedSymTable->uLogCapacity * sizeof(struct Shadow*));
+        if (ppsNewLog == NULL) return 0;
+        oScopedSymTable->ppsLog = ppsNewLog;
+        oScopedSymTable->uLogCapacity *= 2;
+    }
+
+    psNewShadow = (struct Shadow*)malloc(sizeof(struct Shadow));
+    if (psNewShadow == NULL) return 0;
+    psNewShadow->pcKey = pcInternedKey;
+    psNewShadow->pvValue = pvValue;
+    psNewShadow->uDepth = oScopedSymTable->uDepth;
+    psNewShadow->psShadowed = psInnermost;
+
+    /* Make the new shadow the innermost one */
+    if (psInnermost != NULL)
+        (void)SymTable_replace(oScopedSymTable->oSymTable, pcInternedKey,
+                               psNewShadow);
+    else if (!SymTable_put(oScopedSymTable->oSymTable, pcInternedKey,
+                           psNewShadow)) {
+        free(psNewShadow);
+        return 0;
+    }
+
+    oScopedSymTable->ppsLog[oScopedSymTable->uLogLength++] = psNewShadow;
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ScopedSymTable_replace(ScopedSymTable_T oScopedSymTable,
+                             const char *pcKey, const void *pvValue) {
+    struct Shadow *psInnermost;
+    void *oldValue;
+
+    assert(oScopedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psInnermost = ScopedSymTable_find(oScopedSymTable, pcKey);
+    if (psInnermost == NULL) return NULL;
+
+    oldValue = (void*)psInnermost->pvValue;
+    psInnermost->pvValue = pvValue;
+    return oldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ScopedSymTable_contains(ScopedSymTable_T oScopedSymTable,
+                            const char *pcKey) {
+    assert(oScopedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return ScopedSymTable_find(oScopedSymTable, pcKey) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ScopedSymTable_get(ScopedSymTable_T oScopedSymTable,
+                         const char *pcKey) {
+    struct Shadow *psInnermost;
+
+    assert(oScopedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psInnermost = ScopedSymTable_find(oScopedSymTable, pcKey);
+    if (psInnermost == NULL) return NULL;
+
+    return (void*)psInnermost->pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ScopedSymTable_getScopeOf(ScopedSymTable_T oScopedSymTable,
+                                 const char *pcKey, int *piFound) {
+    struct Shadow *psInnermost;
+
+    assert(oScopedSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(piFound != NULL);
+
+    psInnermost = ScopedSymTable_find(oScopedSymTable, pcKey);
+    *piFound = psInnermost != NULL;
+    if (psInnermost == NULL) return 0;
+
+    return psInnermost->uDepth;
+}
@@ -0,0 +1,93 @@
+/*--------------------------------------------------------------------*/
+/* scopedsymtable.h                                                   */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SCOPEDSYMTABLE_INCLUDED
+#define SCOPEDSYMTABLE_INCLUDED
+
+#include <stddef.h>
+
+/* A ScopedSymTable_T is a stack of nested lexical scopes, each an
+unordered collection of key and value bindings. A binding in an inner
+scope shadows bindings of the same key in outer scopes. Lookups cost
+one hash table probe however deeply the scopes are nested, and leaving
+a scope costs time proportional to the number of bindings it made. */
+typedef struct ScopedSymTable *ScopedSymTable_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new ScopedSymTable object that contains only an empty
+outermost scope, or NULL if insufficient memory is available */
+  ScopedSymTable_T ScopedSymTable_new(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Frees all memory occupied by oScopedSymTable */
+  void ScopedSymTable_free(ScopedSymTable_T oScopedSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of scopes entered and not yet exited, which is 0
+while only the outermost scope is in effect */
+  size_t ScopedSymTable_getDepth(ScopedSymTable_T oScopedSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Enters a new, empty innermost scope and returns 1 (TRUE), or returns
+0 (FALSE) and leaves oScopedSymTable unchanged if insufficient memory
+is available */
+  int ScopedSymTable_enterScope(ScopedSymTable_T oScopedSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Exits the innermost scope, removing its bindings so that the
+bindings they shadowed become visible again. The outermost scope
+cannot be exited. */
+  void ScopedSymTable_exitScope(ScopedSymTable_T oScopedSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* If the innermost scope of oScopedSymTable does not contain a binding
+with key pcKey, then ScopedSymTable_put must add a new binding to that
+scope consisting of key pcKey and value pvValue and return 1 (TRUE).
+Otherwise the function must leave oScopedSymTable unchanged and return
+0 (FALSE). If insufficient memory is available, then the function must
+leave oScopedSymTable unchanged and return 0 (FALSE). */
+  int ScopedSymTable_put(ScopedSymTable_T oScopedSymTable,
+     const char *pcKey, const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* If a binding with key pcKey is visible in oScopedSymTable, then
+ScopedSymTable_replace must replace the value of the innermost such
+binding with pvValue and return the old value. Otherwise it must leave
+oScopedSymTable unchanged and return NULL. */
+  void *ScopedSymTable_replace(ScopedSymTable_T oScopedSymTable,
+     const char *pcKey, const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if a binding whose key is pcKey is visible in
+oScopedSymTable, and 0 (FALSE) otherwise */
+  int ScopedSymTable_contains(ScopedSymTable_T oScopedSymTable,
+     const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the value of the innermost visible binding within
+oScopedSymTable whose key is pcKey, or NULL if no such binding
+exists */
+  void *ScopedSymTable_get(ScopedSymTable_T oScopedSymTable,
+     const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the depth of the scope that holds the innermost visible
+binding whose key is pcKey, as ScopedSymTable_getDepth numbers scopes,
+and stores 1 (TRUE) in *piFound. If no such binding exists, returns 0
+and stores 0 (FALSE) in *piFound. */
+  size_t ScopedSymTable_getScopeOf(ScopedSymTable_T oScopedSymTable,
+     const char *pcKey, int *piFound);
+
+#endif
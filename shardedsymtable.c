@@ -0,0 +1,309 @@
+/*--------------------------------------------------------------------*/
+/* shardedsymtable.c                                                  */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "keyops.h"
+#include "shardedsymtable.h"
+#include "symtablehash.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The size of a cache line on the processors of interest, and the
+most shards a table may have */
+
+enum {CACHE_LINE = 64, MAX_SHARDS = 256};
+
+/*--------------------------------------------------------------------*/
+
+/* The state of one shard. */
+
+struct ShardState {
+    /* The lock that every operation on the shard holds */
+    pthread_mutex_t sMutex;
+    /* The hash table that holds the shard's bindings */
+    SymTable_T oSymTable;
+    /* The number of bindings in oSymTable, which
+    ShardedSymTable_getLength reads without the lock */
+    size_t uLength;
+};
+
+/* A shard fills whole cache lines, so that threads that use adjacent
+shards do not steal each other's lines. */
+
+union Shard {
+    /* The state */
+    struct ShardState sState;
+    /* The padding */
+    char acLines[((sizeof(struct ShardState) + CACHE_LINE - 1)
+                  / CACHE_LINE) * CACHE_LINE];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A ShardedSymTable is an array of shards that starts on a cache line
+boundary. */
+
+struct ShardedSymTable {
+    /* The address of the first shard */
+    union Shard *psShards;
+    /* The number of shards, a power of 2 */
+    size_t uShardCount;
+    /* The number of bits of a hash code that select a shard */
+    unsigned int uShardBits;
+    /* The address of the memory block that holds the shards, which
+    may start before psShards */
+    void *pvBlock;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the shard of oShardedSymTable that holds pcKey. The top bits
+of the mixed hash code choose it, so that the low bits that each
+shard's buckets depend on stay evenly spread within every shard. */
+static struct ShardState *ShardedSymTable_shardOf(
+    ShardedSymTable_T oShardedSymTable, const char *pcKey) {
+    uint64_t uHash;
+
+    assert(oShardedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    if (oShardedSymTable->uShardBits == 0)
+        return &oShardedSymTable->psShards[0].sState;
+    uHash = (uint64_t)KeyOps_hash(pcKey) * UINT64_C(0x9E3779B97F4A7C15);
+    return &oShardedSymTable->psShards[
+        uHash >> (64 - oShardedSymTable->uShardBits)].sState;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bindings of psShard as of its last change,
+without its lock. */
+static size_t ShardedSymTable_loadLength(struct ShardState *psShard) {
+    assert(psShard != NULL);
+
+#ifdef __GNUC__
+    return __atomic_load_n(&psShard->uLength, __ATOMIC_RELAXED);
+#else
+    return psShard->uLength;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Record the number of bindings of psShard, whose lock is held. */
+static void ShardedSymTable_storeLength(struct ShardState *psShard) {
+    assert(psShard != NULL);
+
+#ifdef __GNUC__
+    __atomic_store_n(&psShard->uLength,
+                     SymTable_getLength(psShard->oSymTable),
+                     __ATOMIC_RELAXED);
+#else
+    psShard->uLength = SymTable_getLength(psShard->oSymTable);
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+ShardedSymTable_T ShardedSymTable_new(size_t uShardCount) {
+    ShardedSymTable_T oShardedSymTable;
+    struct ShardState *psShard;
+    size_t u;
+
+    oShardedSymTable = (ShardedSymTable_T)
+        malloc(sizeof(struct ShardedSymTable));
+    if (oShardedSymTable == NULL) return NULL;
+
+    oShardedSymTable->uShardCount = 1;
+    oShardedSymTable->uShardBits = 0;
+    while (oShardedSymTable->uShardCount < uShardCount &&
+           oShardedSymTable->uShardCount < MAX_SHARDS) {
+        oShardedSymTable->uShardCount *= 2;
+        oShardedSymTable->uShardBits++;
+    }
+
+    /* Allocate one spare line, and start the shards at the first line
+    boundary within the block */
+    oShardedSymTable->pvBlock = malloc(
+        (oShardedSymTable->uShardCount + 1) * sizeof(union Shard));
+    if (oShardedSymTable->pvBlock == NULL) {
+        free(oShardedSymTable);
+        return NULL;
+    }
+    oShardedSymTable->psShards = (union Shard*)
+        (((uintptr_t)oShardedSymTable->pvBlock + CACHE_LINE - 1)
+         & ~(uintptr_t)(CACHE_LINE - 1));
+
+    for (u = 0; u < oShardedSymTable->uShardCount; u++) {
+        psShard = &oShardedSymTable->psShards[u].sState;
+        psShard->uLength = 0;
+        psShard->oSymTable = SymTable_new();
+        if (psShard->oSymTable == NULL ||
+            pthread_mutex_init(&psShard->sMutex, NULL) != 0) {
+            if (psShard->oSymTable != NULL)
+                SymTable_free(psShard->oSymTable);
+            oShardedSymTable->uShardCount = u;
+            ShardedSymTable_free(oShardedSymTable);
+            return NULL;
+        }
+    }
+
+    return oShardedSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ShardedSymTable_free(ShardedSymTable_T oShardedSymTable) {
+    struct ShardState *psShard;
+    size_t u;
+
+    assert(oShardedSymTable != NULL);
+
+    for (u = 0; u < oShardedSymTable->uShardCount; u++) {
+        psShard = &oShardedSymTable->psShards[u].sState;
+        SymTable_free(psShard->oSymTable);
+        (void)pthread_mutex_destroy(&psShard->sMutex);
+    }
+    free(oShardedSymTable->pvBlock);
+    free(oShardedSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ShardedSymTable_getShardCount(
+    ShardedSymTable_T oShardedSymTable) {
+    assert(oShardedSymTable != NULL);
+
+    return oShardedSymTable->uShardCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ShardedSymTable_getLength(ShardedSymTable_T oShardedSymTable) {
+    size_t uLength = 0;
+    size_t u;
+
+    assert(oShardedSymTable != NULL);
+
+    for (u = 0; u < oShardedSymTable->uShardCount; u++)
+        uLength += ShardedSymTable_loadLength(
+            &oShardedSymTable->psShards[u].sState);
+
+    return uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShardedSymTable_put(ShardedSymTable_T oShardedSymTable,
+                        const char *pcKey, const void *pvValue) {
+    struct ShardState *psShard;
+    int iSuccessful;
+
+    assert(oShardedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psShard = ShardedSymTable_shardOf(oShardedSymTable, pcKey);
+    pthread_mutex_lock(&psShard->sMutex);
+    iSuccessful = SymTable_put(psShard->oSymTable, pcKey, pvValue);
+    if (iSuccessful) ShardedSymTable_storeLength(psShard);
+    pthread_mutex_unlock(&psShard->sMutex);
+
+    return iSuccessful;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ShardedSymTable_replace(ShardedSymTable_T oShardedSymTable,
+                              const char *pcKey, const void *pvValue) {
+    struct ShardState *psShard;
+    void *pvOldValue;
+
+    assert(oShardedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psShard = ShardedSymTable_shardOf(oShardedSymTable, pcKey);
+    pthread_mutex_lock(&psShard->sMutex);
+    pvOldValue = SymTable_replace(psShard->oSymTable, pcKey, pvValue);
+    pthread_mutex_unlock(&psShard->sMutex);
+
+    return pvOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShardedSymTable_contains(ShardedSymTable_T oShardedSymTable,
+                             const char *pcKey) {
+    struct ShardState *psShard;
+    int iFound;
+
+    assert(oShardedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psShard = ShardedSymTable_shardOf(oShardedSymTable, pcKey);
+    pthread_mutex_lock(&psShard->sMutex);
+    iFound = SymTable_contains(psShard->oSymTable, pcKey);
+    pthread_mutex_unlock(&psShard->sMutex);
+
+    return iFound;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ShardedSymTable_get(ShardedSymTable_T oShardedSymTable,
+                          const char *pcKey) {
+    struct ShardState *psShard;
+    void *pvValue;
+
+    assert(oShardedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psShard = ShardedSymTable_shardOf(oShardedSymTable, pcKey);
+    pthread_mutex_lock(&psShard->sMutex);
+    pvValue = SymTable_get(psShard->oSymTable, pcKey);
+    pthread_mutex_unlock(&psShard->sMutex);
+
+    return pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ShardedSymTable_remove(ShardedSymTable_T oShardedSymTable,
+                             const char *pcKey) {
+    struct ShardState *psShard;
+    void *pvValue;
+
+    assert(oShardedSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psShard = ShardedSymTable_shardOf(oShardedSymTable, pcKey);
+    pthread_mutex_lock(&psShard->sMutex);
+    pvValue = SymTable_remove(psShard->oSymTable, pcKey);
+    ShardedSymTable_storeLength(psShard);
+    pthread_mutex_unlock(&psShard->sMutex);
+
+    return pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ShardedSymTable_map(ShardedSymTable_T oShardedSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra) {
+    struct ShardState *psShard;
+    size_t u;
+
+    assert(oShardedSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for (u = 0; u < oShardedSymTable->uShardCount; u++) {
+        psShard = &oShardedSymTable->psShards[u].sState;
+        pthread_mutex_lock(&psShard->sMutex);
+        SymTable_map(psShard->oSymTable, pfApply, pvExtra);
+        pthread_mutex_unlock(&psShard->sMutex);
+    }
+}
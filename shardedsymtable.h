@@ -0,0 +1,100 @@
+/*--------------------------------------------------------------------*/
+/* shardedsymtable.h                                                  */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SHARDEDSYMTABLE_INCLUDED
+#define SHARDEDSYMTABLE_INCLUDED
+
+#include <stddef.h>
+
+/* A ShardedSymTable_T is an unordered collection of key and value
+bindings that many threads may use at once. Keys are routed by hash
+code to independent hash tables (shards), each with its own lock, its
+own length and its own expansion, so threads that touch different
+shards never wait for one another. */
+typedef struct ShardedSymTable *ShardedSymTable_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new ShardedSymTable object that contains no bindings and
+has at least uShardCount shards (rounded up to a power of 2, at most
+256), or NULL if insufficient memory is available. A few shards per
+thread that writes keep waiting rare. */
+  ShardedSymTable_T ShardedSymTable_new(size_t uShardCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Frees all memory occupied by oShardedSymTable. No other thread may
+be using it. */
+  void ShardedSymTable_free(ShardedSymTable_T oShardedSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of shards of oShardedSymTable */
+  size_t ShardedSymTable_getShardCount(
+     ShardedSymTable_T oShardedSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bindings in oShardedSymTable, summed over the
+shards without locking them. While other threads change the table,
+the sum may miss changes that are still in progress. */
+  size_t ShardedSymTable_getLength(ShardedSymTable_T oShardedSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* If oShardedSymTable does not contain a binding with key pcKey, then
+ShardedSymTable_put must add a new binding to oShardedSymTable
+consisting of key pcKey and value pvValue and return 1 (TRUE).
+Otherwise the function must leave oShardedSymTable unchanged and
+return 0 (FALSE). If insufficient memory is available, then the
+function must leave oShardedSymTable unchanged and return 0 (FALSE). */
+  int ShardedSymTable_put(ShardedSymTable_T oShardedSymTable,
+     const char *pcKey, const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* If oShardedSymTable contains a binding with key pcKey, then
+ShardedSymTable_replace must replace the binding's value with pvValue
+and return the old value. Otherwise it must leave oShardedSymTable
+unchanged and return NULL. */
+  void *ShardedSymTable_replace(ShardedSymTable_T oShardedSymTable,
+     const char *pcKey, const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if oShardedSymTable contains a binding whose key is
+pcKey, and 0 (FALSE) otherwise */
+  int ShardedSymTable_contains(ShardedSymTable_T oShardedSymTable,
+     const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the value of the binding within oShardedSymTable whose key
+is pcKey, or NULL if no such binding exists */
+  void *ShardedSymTable_get(ShardedSymTable_T oShardedSymTable,
+     const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* If oShardedSymTable contains a binding with key pcKey, then
+ShardedSymTable_remove must remove that binding from oShardedSymTable
+and return the binding's value. Otherwise the function must not
+change oShardedSymTable and return NULL. */
+  void *ShardedSymTable_remove(ShardedSymTable_T oShardedSymTable,
+     const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Applies function *pfApply to each binding in oShardedSymTable,
+passing pvExtra as an extra parameter. The shards are visited one at a
+time, and only the shard being visited is locked, so other threads
+may keep changing the rest. Each binding present for the whole call
+is visited once. *pfApply must not call functions of
+oShardedSymTable. */
+  void ShardedSymTable_map(ShardedSymTable_T oShardedSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra);
+
+#endif
@@ -0,0 +1,903 @@
+/*--------------------------------------------------------------------*/
+/* shmsymtable.c                                                      */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "keyops.h"
+#include "shmsymtable.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The alignment and size granularity of the blocks of a region, the
+largest block size that has a free list of its own (larger blocks are
+rounded to powers of 2), the number of free lists, and the fewest
+buckets a table has */
+
+enum {BLOCK_ALIGNMENT = 16, SMALL_BLOCK_LIMIT = 1024,
+      FREE_LIST_COUNT = 128, MIN_BUCKETS = 512};
+
+/* The number of times a reader yields while a writer changes the
+table before it waits on the writers' lock instead, which also
+recovers the table if the writer died */
+
+enum {READ_SPIN_LIMIT = 1000};
+
+/* Whether the writers' lock is robust, so that the next process to
+take it learns that its owner died while holding it */
+
+#if defined(__linux__)
+#define SHM_ROBUST_LOCK
+#endif
+
+/* The first word of every region that holds a table */
+
+#define SHM_MAGIC UINT64_C(0x53796D5461626C31)
+
+/*--------------------------------------------------------------------*/
+
+/* The header at the start of a region. Every position within the
+region is an offset from its start; 0 means none. */
+
+struct ShmHeader {
+    /* SHM_MAGIC, once the table is ready */
+    uint64_t uMagic;
+    /* The number of bytes of the region */
+    uint64_t uRegionSize;
+    /* The lock that writers hold, shared by all processes */
+    pthread_mutex_t sWriteMutex;
+    /* The sequence lock: odd while a writer changes the table, and
+    advanced by 2 with each change */
+    uint64_t uSequence;
+    /* The number of bindings stored */
+    uint64_t uLength;
+    /* The number of buckets, a power of 2, and its base 2 logarithm */
+    uint64_t uBucketCount;
+    uint64_t uBucketBits;
+    /* The offset of the array of buckets, each the offset of the first
+    node of its chain */
+    uint64_t uBucketsOffset;
+    /* The offset of the first node, and of the first byte never yet
+    allocated */
+    uint64_t uArenaStart;
+    uint64_t uArenaNext;
+    /* The offset of the first free block of each size class */
+    uint64_t auFreeLists[FREE_LIST_COUNT];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in one block, a node followed by the key,
+its terminating null character and the bytes of the value. */
+
+struct ShmNode {
+    /* The offset of the next node of the chain, or of the next block
+    of the free list once the block is freed */
+    uint64_t uNext;
+    /* The hash code of the key */
+    uint64_t uHash;
+    /* The number of bytes of the block */
+    uint64_t uBlockSize;
+    /* The number of characters of the key */
+    uint32_t uKeyLength;
+    /* The number of bytes of the value */
+    uint32_t uValueSize;
+    /* The key, then the value */
+    char acBytes[1];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A ShmSymTable is one process's view of a region. */
+
+struct ShmSymTable {
+    /* The address at which the region is mapped, which is also the
+    address of its header */
+    struct ShmHeader *psHeader;
+    /* The number of bytes mapped */
+    size_t uRegionSize;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the word at puWord, atomically where the compiler allows. */
+static uint64_t ShmSymTable_load(const uint64_t *puWord) {
+    assert(puWord != NULL);
+
+#ifdef __GNUC__
+    return __atomic_load_n(puWord, __ATOMIC_RELAXED);
+#else
+    return *(const volatile uint64_t*)puWord;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store uValue in the word at puWord, atomically where the compiler
+allows. */
+static void ShmSymTable_store(uint64_t *puWord, uint64_t uValue) {
+    assert(puWord != NULL);
+
+#ifdef __GNUC__
+    __atomic_store_n(puWord, uValue, __ATOMIC_RELAXED);
+#else
+    *(volatile uint64_t*)puWord = uValue;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of the node at uOffset within the region of
+oShmSymTable, or NULL if no node could be there. A reader may follow
+an offset that a writer is changing, so every offset is checked before
+it is used. */
+static struct ShmNode *ShmSymTable_nodeAt(ShmSymTable_T oShmSymTable,
+                                          uint64_t uOffset) {
+    struct ShmHeader *psHeader;
+
+    assert(oShmSymTable != NULL);
+
+    psHeader = oShmSymTable->psHeader;
+    if (uOffset < psHeader->uArenaStart ||
+        uOffset % BLOCK_ALIGNMENT != 0 ||
+        uOffset > oShmSymTable->uRegionSize
+                  - offsetof(struct ShmNode, acBytes))
+        return NULL;
+    return (struct ShmNode*)((char*)psHeader + uOffset);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count the bindings of oShmSymTable, and mark its table as
+consistent, after a writer died while changing it. Each change links
+or unlinks a node with one store, so the chains are whole, but the
+count may be off by one, and a value that was being overwritten in
+place may be part old and part new. The writers' lock must be held. */
+static void ShmSymTable_recover(ShmSymTable_T oShmSymTable) {
+    struct ShmHeader *psHeader;
+    struct ShmNode *psNode;
+    uint64_t *puBuckets;
+    uint64_t uOffset;
+    uint64_t uLength = 0;
+    size_t u;
+
+    assert(oShmSymTable != NULL);
+
+    psHeader = oShmSymTable->psHeader;
+    puBuckets = (uint64_t*)((char*)psHeader + psHeader->uBucketsOffset);
+    for (u = 0; u < psHeader->uBucketCount; u++)
+        for (uOffset = puBuckets[u]; uOffset != 0;
+             uOffset = psNode->uNext) {
+            psNode = ShmSymTable_nodeAt(oShmSymTable, uOffset);
+            assert(psNode != NULL);
+            uLength++;
+        }
+    ShmSymTable_store(&psHeader->uLength, uLength);
+
+    if (psHeader->uSequence % 2 != 0) {
+#ifdef __GNUC__
+        __atomic_store_n(&psHeader->uSequence, psHeader->uSequence + 1,
+                         __ATOMIC_RELEASE);
+#else
+        ShmSymTable_store(&psHeader->uSequence,
+                          psHeader->uSequence + 1);
+#endif
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Take the writers' lock of oShmSymTable, recovering the table if the
+process that held the lock died. */
+static void ShmSymTable_lock(ShmSymTable_T oShmSymTable) {
+    struct ShmHeader *psHeader;
+
+    assert(oShmSymTable != NULL);
+
+    psHeader = oShmSymTable->psHeader;
+#ifdef SHM_ROBUST_LOCK
+    if (pthread_mutex_lock(&psHeader->sWriteMutex) == EOWNERDEAD) {
+        ShmSymTable_recover(oShmSymTable);
+        (void)pthread_mutex_consistent(&psHeader->sWriteMutex);
+    }
+#else
+    pthread_mutex_lock(&psHeader->sWriteMutex);
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Release the writers' lock of oShmSymTable. */
+static void ShmSymTable_unlock(ShmSymTable_T oShmSymTable) {
+    assert(oShmSymTable != NULL);
+
+    pthread_mutex_unlock(&oShmSymTable->psHeader->sWriteMutex);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the sequence number of oShmSymTable once no writer is
+changing the table, to start a read. A reader that has yielded
+READ_SPIN_LIMIT times waits for the writers' lock instead, so that a
+writer that died is recovered from rather than waited for forever. */
+static uint64_t ShmSymTable_beginRead(ShmSymTable_T oShmSymTable) {
+    struct ShmHeader *psHeader;
+    uint64_t uSequence;
+    size_t uSpins = 0;
+
+    assert(oShmSymTable != NULL);
+
+    psHeader = oShmSymTable->psHeader;
+    for (;;) {
+#ifdef __GNUC__
+        uSequence = __atomic_load_n(&psHeader->uSequence,
+                                    __ATOMIC_ACQUIRE);
+#else
+        uSequence = ShmSymTable_load(&psHeader->uSequence);
+#endif
+        if (uSequence % 2 == 0) return uSequence;
+        if (++uSpins < READ_SPIN_LIMIT)
+            /* The writer may be waiting for this processor */
+            (void)sched_yield();
+        else {
+            ShmSymTable_lock(oShmSymTable);
+            ShmSymTable_unlock(oShmSymTable);
+            uSpins = 0;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if no writer changed the table of psHeader since
+ShmSymTable_beginRead returned uSequence, so that what was read in
+between is consistent, and 0 (FALSE) otherwise. */
+static int ShmSymTable_endRead(struct ShmHeader *psHeader,
+                               uint64_t uSequence) {
+    assert(psHeader != NULL);
+
+#ifdef __GNUC__
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+    return ShmSymTable_load(&psHeader->uSequence) == uSequence;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Mark the table of psHeader as changing, so that readers retry. The
+writers' lock must be held. */
+static void ShmSymTable_beginWrite(struct ShmHeader *psHeader) {
+    assert(psHeader != NULL);
+
+    ShmSymTable_store(&psHeader->uSequence, psHeader->uSequence + 1);
+#ifdef __GNUC__
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Mark the table of psHeader as consistent again. The writers' lock
+must be held. */
+static void ShmSymTable_endWrite(struct ShmHeader *psHeader) {
+    assert(psHeader != NULL);
+
+#ifdef __GNUC__
+    __atomic_store_n(&psHeader->uSequence, psHeader->uSequence + 1,
+                     __ATOMIC_RELEASE);
+#else
+    ShmSymTable_store(&psHeader->uSequence, psHeader->uSequence + 1);
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of the bucket of oShmSymTable that heads the
+chain of keys whose hash code is uHash. The top bits of the mixed hash
+code choose it. */
+static uint64_t *ShmSymTable_bucketOf(ShmSymTable_T oShmSymTable,
+                                      uint64_t uHash) {
+    struct ShmHeader *psHeader;
+
+    assert(oShmSymTable != NULL);
+
+    psHeader = oShmSymTable->psHeader;
+    return (uint64_t*)((char*)psHeader + psHeader->uBucketsOffset) +
+        ((uHash * UINT64_C(0x9E3779B97F4A7C15))
+         >> (64 - psHeader->uBucketBits));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if psNode, within a region of uRegionSize bytes at
+psHeader, holds pcKey, of uKeyLength characters and hash code uHash,
+and 0 (FALSE) otherwise. */
+static int ShmSymTable_holds(const struct ShmHeader *psHeader,
+                             size_t uRegionSize,
+                             const struct ShmNode *psNode,
+                             const char *pcKey, size_t uKeyLength,
+                             uint64_t uHash) {
+    size_t uRoom;
+
+    assert(psHeader != NULL);
+    assert(psNode != NULL);
+    assert(pcKey != NULL);
+
+    if (psNode->uHash != uHash || psNode->uKeyLength != uKeyLength)
+        return 0;
+    uRoom = uRegionSize - (size_t)((const char*)psNode->acBytes
+                                   - (const char*)psHeader);
+    if (uKeyLength >= uRoom) return 0;
+    return memcmp(psNode->acBytes, pcKey, uKeyLength) == 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Search oShmSymTable for pcKey without the writers' lock. Return 1
+(TRUE) if it was found, after copying the first uRoom bytes (at most)
+of its value to pvValue and storing the size of the value in *puSize;
+0 (FALSE) if it was not; or -1 if the chain was found to be changing.
+Only a result confirmed by ShmSymTable_endRead may be trusted. */
+static int ShmSymTable_search(ShmSymTable_T oShmSymTable,
+                              const char *pcKey, size_t uKeyLength,
+                              uint64_t uHash, void *pvValue,
+                              size_t uRoom, size_t *puSize) {
+    struct ShmNode *psNode;
+    uint64_t uOffset;
+    size_t uSteps = 0;
+    size_t uMaxSteps;
+    size_t uValueSize;
+
+    assert(oShmSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uMaxSteps = oShmSymTable->uRegionSize / sizeof(struct ShmNode);
+    uOffset = ShmSymTable_load(ShmSymTable_bucketOf(oShmSymTable,
+                                                    uHash));
+    while (uOffset != 0) {
+        psNode = ShmSymTable_nodeAt(oShmSymTable, uOffset);
+        if (psNode == NULL || ++uSteps > uMaxSteps) return -1;
+        if (ShmSymTable_holds(oShmSymTable->psHeader,
+                              oShmSymTable->uRegionSize, psNode,
+                              pcKey, uKeyLength, uHash)) {
+            /* Check the size again, since a writer may have changed
+            it since ShmSymTable_holds did */
+            uValueSize = psNode->uValueSize;
+            if (uValueSize > oShmSymTable->uRegionSize - uOffset
+                - offsetof(struct ShmNode, acBytes) - (uKeyLength + 1))
+                return -1;
+            if (pvValue != NULL)
+                memcpy(pvValue, &psNode->acBytes[uKeyLength + 1],
+                       uValueSize < uRoom ? uValueSize : uRoom);
+            if (puSize != NULL) *puSize = uValueSize;
+            return 1;
+        }
+        uOffset = ShmSymTable_load(&psNode->uNext);
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the node of oShmSymTable that holds pcKey, or NULL if there
+is none, and store in *ppuLink the address of the word that links to
+that node, or to the end of the chain. The writers' lock must be
+held. */
+static struct ShmNode *ShmSymTable_find(ShmSymTable_T oShmSymTable,
+                                        const char *pcKey,
+                                        uint64_t **ppuLink) {
+    struct ShmNode *psNode;
+    uint64_t *puLink;
+    uint64_t uHash;
+    size_t uKeyLength;
+
+    assert(oShmSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(ppuLink != NULL);
+
+    uHash = (uint64_t)KeyOps_hash(pcKey);
+    uKeyLength = strlen(pcKey);
+    for (puLink = ShmSymTable_bucketOf(oShmSymTable, uHash);
+         *puLink != 0;
+         puLink = &psNode->uNext) {
+        psNode = ShmSymTable_nodeAt(oShmSymTable, *puLink);
+        assert(psNode != NULL);
+        if (ShmSymTable_holds(oShmSymTable->psHeader,
+                              oShmSymTable->uRegionSize, psNode,
+                              pcKey, uKeyLength, uHash)) {
+            *ppuLink = puLink;
+            return psNode;
+        }
+    }
+    *ppuLink = puLink;
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the size of the block that holds a node whose key and value
+have uBytes bytes in all. Larger blocks are powers of 2, so that any
+block of a free list fits any request of its size class. */
+static uint64_t ShmSymTable_blockSize(size_t uBytes) {
+    uint64_t uBlockSize;
+    uint64_t uPower;
+
+    uBlockSize = (offsetof(struct ShmNode, acBytes) + uBytes
+                  + BLOCK_ALIGNMENT - 1)
+        & ~(uint64_t)(BLOCK_ALIGNMENT - 1);
+    if (uBlockSize <= SMALL_BLOCK_LIMIT) return uBlockSize;
+
+    for (uPower = 2 * SMALL_BLOCK_LIMIT; uPower < uBlockSize;
+         uPower *= 2);
+    return uPower;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the free list of blocks of uBlockSize bytes, a size that
+ShmSymTable_blockSize returned. */
+static size_t ShmSymTable_classOf(uint64_t uBlockSize) {
+    uint64_t uPower;
+    size_t uClass;
+
+    if (uBlockSize <= SMALL_BLOCK_LIMIT)
+        return (size_t)(uBlockSize / BLOCK_ALIGNMENT) - 1;
+
+    uClass = SMALL_BLOCK_LIMIT / BLOCK_ALIGNMENT;
+    for (uPower = 2 * SMALL_BLOCK_LIMIT; uPower < uBlockSize;
+         uPower *= 2)
+        uClass++;
+    return uClass;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a node of oShmSymTable that holds pcKey, of uKeyLength
+characters, and the uSize bytes of pvValue, or NULL if the region is
+full. The caller links it. */
+static struct ShmNode *ShmSymTable_newNode(ShmSymTable_T oShmSymTable,
+                                           const char *pcKey,
+                                           size_t uKeyLength,
+                                           const void *pvValue,
+                                           size_t uSize) {
+    struct ShmHeader *psHeader;
+    struct ShmNode *psNode;
+    uint64_t uBlockSize;
+    uint64_t uOffset;
+    size_t uClass;
+
+    assert(oShmSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(pvValue != NULL || uSize == 0);
+
+    psHeader = oShmSymTable->psHeader;
+    if (uKeyLength > UINT32_MAX || uSize > UINT32_MAX ||
+        uKeyLength + uSize >= oShmSymTable->uRegionSize)
+        return NULL;
+    uBlockSize = ShmSymTable_blockSize(uKeyLength + 1 + uSize);
+    uClass = ShmSymTable_classOf(uBlockSize);
+    if (uClass >= FREE_LIST_COUNT) return NULL;
+
+    /* Reuse a freed block of the same class, or take a new one */
+    uOffset = psHeader->auFreeLists[uClass];
+    if (uOffset != 0) {
+        psNode = ShmSymTable_nodeAt(oShmSymTable, uOffset);
+        assert(psNode != NULL);
+        psHeader->auFreeLists[uClass] = psNode->uNext;
+    }
+    else {
+        uOffset = psHeader->uArenaNext;
+        if (uBlockSize > oShmSymTable->uRegionSize - uOffset)
+            return NULL;
+        psNode = (struct ShmNode*)((char*)psHeader + uOffset);
+        ShmSymTable_store(&psHeader->uArenaNext,
+                          psHeader->uArenaNext + uBlockSize);
+    }
+
+    psNode->uHash = (uint64_t)KeyOps_hash(pcKey);
+    psNode->uBlockSize = uBlockSize;
+    psNode->uKeyLength = (uint32_t)uKeyLength;
+    psNode->uValueSize = (uint32_t)uSize;
+    memcpy(psNode->acBytes, pcKey, uKeyLength + 1);
+    if (uSize > 0)
+        memcpy(&psNode->acBytes[uKeyLength + 1], pvValue, uSize);
+    return psNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put the block of psNode, which no chain links to, on its free
+list in oShmSymTable. */
+static void ShmSymTable_freeNode(ShmSymTable_T oShmSymTable,
+                                 struct ShmNode *psNode) {
+    struct ShmHeader *psHeader;
+    size_t uClass;
+
+    assert(oShmSymTable != NULL);
+    assert(psNode != NULL);
+
+    psHeader = oShmSymTable->psHeader;
+    uClass = ShmSymTable_classOf(psNode->uBlockSize);
+    ShmSymTable_store(&psNode->uNext, psHeader->auFreeLists[uClass]);
+    psHeader->auFreeLists[uClass] =
+        (uint64_t)((char*)psNode - (char*)psHeader);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the offset of psNode within the region of oShmSymTable. */
+static uint64_t ShmSymTable_offsetOf(ShmSymTable_T oShmSymTable,
+                                     const struct ShmNode *psNode) {
+    assert(oShmSymTable != NULL);
+    assert(psNode != NULL);
+
+    return (uint64_t)((const char*)psNode
+                      - (const char*)oShmSymTable->psHeader);
+}
+
+/*--------------------------------------------------------------------*/
+
+ShmSymTable_T ShmSymTable_create(const char *pcName,
+                                 size_t uRegionSize,
+                                 size_t uExpectedCount) {
+    ShmSymTable_T oShmSymTable;
+    struct ShmHeader *psHeader;
+    pthread_mutexattr_t sAttributes;
+    uint64_t uBucketCount = MIN_BUCKETS;
+    uint64_t uBucketBits = 9;
+    uint64_t uBucketsOffset;
+    void *pvRegion;
+    int iFd = -1;
+
+    /* Size the buckets for the expected bindings */
+    while (uBucketCount < uExpectedCount) {
+        uBucketCount *= 2;
+        uBucketBits++;
+    }
+    uBucketsOffset = (sizeof(struct ShmHeader) + BLOCK_ALIGNMENT - 1)
+        & ~(uint64_t)(BLOCK_ALIGNMENT - 1);
+    if (uRegionSize < uBucketsOffset ||
+        (uRegionSize - uBucketsOffset) / sizeof(uint64_t) <= uBucketCount)
+        return NULL;
+
+    oShmSymTable = (ShmSymTable_T)malloc(sizeof(struct ShmSymTable));
+    if (oShmSymTable == NULL) return NULL;
+
+    /* Both kinds of region start out zeroed: every bucket is empty */
+    if (pcName != NULL) {
+        iFd = shm_open(pcName, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (iFd < 0) {
+            free(oShmSymTable);
+            return NULL;
+        }
+        if (ftruncate(iFd, (off_t)uRegionSize) != 0)
+            pvRegion = MAP_FAILED;
+        else
+            pvRegion = mmap(NULL, uRegionSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, iFd, 0);
+        (void)close(iFd);
+    }
+    else
+        pvRegion = mmap(NULL, uRegionSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (pvRegion == MAP_FAILED) {
+        if (pcName != NULL) (void)shm_unlink(pcName);
+        free(oShmSymTable);
+        return NULL;
+    }
+
+    psHeader = (struct ShmHeader*)pvRegion;
+    if (pthread_mutexattr_init(&sAttributes) != 0 ||
+        pthread_mutexattr_setpshared(&sAttributes,
+                                     PTHREAD_PROCESS_SHARED) != 0 ||
+#ifdef SHM_ROBUST_LOCK
+        pthread_mutexattr_setrobust(&sAttributes,
+                                    PTHREAD_MUTEX_ROBUST) != 0 ||
+#endif
+        pthread_mutex_init(&psHeader->sWriteMutex, &sAttributes) != 0) {
+        (void)munmap(pvRegion, uRegionSize);
+        if (pcName != NULL) (void)shm_unlink(pcName);
+        free(oShmSymTable);
+        return NULL;
+    }
+    (void)pthread_mutexattr_destroy(&sAttributes);
+
+    psHeader->uRegionSize = uRegionSize;
+    psHeader->uSequence = 0;
+    psHeader->uLength = 0;
+    psHeader->uBucketCount = uBucketCount;
+    psHeader->uBucketBits = uBucketBits;
+    psHeader->uBucketsOffset = uBucketsOffset;
+    psHeader->uArenaStart = uBucketsOffset +
+        uBucketCount * sizeof(uint64_t);
+    psHeader->uArenaNext = psHeader->uArenaStart;
+#ifdef __GNUC__
+    __atomic_store_n(&psHeader->uMagic, SHM_MAGIC, __ATOMIC_RELEASE);
+#else
+    psHeader->uMagic = SHM_MAGIC;
+#endif
+
+    oShmSymTable->psHeader = psHeader;
+    oShmSymTable->uRegionSize = uRegionSize;
+    return oShmSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+ShmSymTable_T ShmSymTable_open(const char *pcName) {
+    ShmSymTable_T oShmSymTable;
+    struct ShmHeader *psHeader;
+    struct stat sStat;
+    void *pvRegion;
+    int iFd;
+
+    assert(pcName != NULL);
+
+    iFd = shm_open(pcName, O_RDWR, 0);
+    if (iFd < 0) return NULL;
+    if (fstat(iFd, &sStat) != 0 ||
+        (size_t)sStat.st_size < sizeof(struct ShmHeader)) {
+        (void)close(iFd);
+        return NULL;
+    }
+    pvRegion = mmap(NULL, (size_t)sStat.st_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, iFd, 0);
+    (void)close(iFd);
+    if (pvRegion == MAP_FAILED) return NULL;
+
+    psHeader = (struct ShmHeader*)pvRegion;
+    if (ShmSymTable_load(&psHeader->uMagic) != SHM_MAGIC ||
+        psHeader->uRegionSize != (uint64_t)sStat.st_size) {
+        (void)munmap(pvRegion, (size_t)sStat.st_size);
+        return NULL;
+    }
+#ifdef __GNUC__
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+
+    oShmSymTable = (ShmSymTable_T)malloc(sizeof(struct ShmSymTable));
+    if (oShmSymTable == NULL) {
+        (void)munmap(pvRegion, (size_t)sStat.st_size);
+        return NULL;
+    }
+    oShmSymTable->psHeader = psHeader;
+    oShmSymTable->uRegionSize = (size_t)sStat.st_size;
+    return oShmSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ShmSymTable_close(ShmSymTable_T oShmSymTable) {
+    assert(oShmSymTable != NULL);
+
+    (void)munmap(oShmSymTable->psHeader, oShmSymTable->uRegionSize);
+    free(oShmSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShmSymTable_unlink(const char *pcName) {
+    assert(pcName != NULL);
+
+    return shm_unlink(pcName) == 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ShmSymTable_getLength(ShmSymTable_T oShmSymTable) {
+    assert(oShmSymTable != NULL);
+
+    return (size_t)ShmSymTable_load(&oShmSymTable->psHeader->uLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ShmSymTable_getFreeBytes(ShmSymTable_T oShmSymTable) {
+    assert(oShmSymTable != NULL);
+
+    return oShmSymTable->uRegionSize - (size_t)ShmSymTable_load(
+        &oShmSymTable->psHeader->uArenaNext);
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShmSymTable_put(ShmSymTable_T oShmSymTable, const char *pcKey,
+                    const void *pvValue, size_t uSize) {
+    struct ShmHeader *psHeader;
+    struct ShmNode *psNode;
+    uint64_t *puLink;
+
+    assert(oShmSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(pvValue != NULL || uSize == 0);
+
+    psHeader = oShmSymTable->psHeader;
+    ShmSymTable_lock(oShmSymTable);
+    if (ShmSymTable_find(oShmSymTable, pcKey, &puLink) != NULL) {
+        ShmSymTable_unlock(oShmSymTable);
+        return 0;
+    }
+
+    /* No chain links the new node yet, so readers cannot see it
+    being filled in */
+    psNode = ShmSymTable_newNode(oShmSymTable, pcKey, strlen(pcKey),
+                                 pvValue, uSize);
+    if (psNode == NULL) {
+        ShmSymTable_unlock(oShmSymTable);
+        return 0;
+    }
+    ShmSymTable_store(&psNode->uNext, 0);
+
+    /* Link the node at the end of its chain, where puLink points */
+    ShmSymTable_beginWrite(psHeader);
+    ShmSymTable_store(puLink, ShmSymTable_offsetOf(oShmSymTable,
+                                                   psNode));
+    ShmSymTable_store(&psHeader->uLength, psHeader->uLength + 1);
+    ShmSymTable_endWrite(psHeader);
+    ShmSymTable_unlock(oShmSymTable);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShmSymTable_replace(ShmSymTable_T oShmSymTable, const char *pcKey,
+                        const void *pvValue, size_t uSize) {
+    struct ShmHeader *psHeader;
+    struct ShmNode *psNode;
+    struct ShmNode *psNewNode;
+    uint64_t *puLink;
+    size_t uKeyLength;
+
+    assert(oShmSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(pvValue != NULL || uSize == 0);
+
+    psHeader = oShmSymTable->psHeader;
+    ShmSymTable_lock(oShmSymTable);
+    psNode = ShmSymTable_find(oShmSymTable, pcKey, &puLink);
+    if (psNode == NULL) {
+        ShmSymTable_unlock(oShmSymTable);
+        return 0;
+    }
+
+    /* A value that fits the same size of block is overwritten in
+    place; otherwise a new node, filled in before any chain links it,
+    takes the old one's place */
+    uKeyLength = psNode->uKeyLength;
+    if (ShmSymTable_blockSize(uKeyLength + 1 + uSize)
+        == psNode->uBlockSize) {
+        ShmSymTable_beginWrite(psHeader);
+        psNode->uValueSize = (uint32_t)uSize;
+        if (uSize > 0)
+            memcpy(&psNode->acBytes[uKeyLength + 1], pvValue, uSize);
+    }
+    else {
+        psNewNode = ShmSymTable_newNode(oShmSymTable, pcKey, uKeyLength,
+                                        pvValue, uSize);
+        if (psNewNode == NULL) {
+            ShmSymTable_unlock(oShmSymTable);
+            return 0;
+        }
+        ShmSymTable_store(&psNewNode->uNext, psNode->uNext);
+        ShmSymTable_beginWrite(psHeader);
+        ShmSymTable_store(puLink, ShmSymTable_offsetOf(oShmSymTable,
+                                                       psNewNode));
+        ShmSymTable_freeNode(oShmSymTable, psNode);
+    }
+
+    ShmSymTable_endWrite(psHeader);
+    ShmSymTable_unlock(oShmSymTable);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShmSymTable_contains(ShmSymTable_T oShmSymTable,
+                         const char *pcKey) {
+    assert(oShmSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return ShmSymTable_get(oShmSymTable, pcKey, NULL, 0, NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShmSymTable_get(ShmSymTable_T oShmSymTable, const char *pcKey,
+                    void *pvValue, size_t uRoom, size_t *puSize) {
+    uint64_t uSequence;
+    uint64_t uHash;
+    size_t uKeyLength;
+    size_t uSize = 0;
+    int iFound;
+
+    assert(oShmSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(pvValue != NULL || uRoom == 0);
+
+    uHash = (uint64_t)KeyOps_hash(pcKey);
+    uKeyLength = strlen(pcKey);
+
+    /* Read until no writer interferes */
+    do {
+        uSequence = ShmSymTable_beginRead(oShmSymTable);
+        iFound = ShmSymTable_search(oShmSymTable, pcKey, uKeyLength,
+                                    uHash, pvValue, uRoom, &uSize);
+    } while (iFound < 0 ||
+             !ShmSymTable_endRead(oShmSymTable->psHeader, uSequence));
+
+    if (iFound && puSize != NULL) *puSize = uSize;
+    return iFound;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShmSymTable_remove(ShmSymTable_T oShmSymTable, const char *pcKey) {
+    struct ShmHeader *psHeader;
+    struct ShmNode *psNode;
+    uint64_t *puLink;
+
+    assert(oShmSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psHeader = oShmSymTable->psHeader;
+    ShmSymTable_lock(oShmSymTable);
+    psNode = ShmSymTable_find(oShmSymTable, pcKey, &puLink);
+    if (psNode == NULL) {
+        ShmSymTable_unlock(oShmSymTable);
+        return 0;
+    }
+
+    ShmSymTable_beginWrite(psHeader);
+    ShmSymTable_store(puLink, psNode->uNext);
+    ShmSymTable_freeNode(oShmSymTable, psNode);
+    ShmSymTable_store(&psHeader->uLength, psHeader->uLength - 1);
+    ShmSymTable_endWrite(psHeader);
+    ShmSymTable_unlock(oShmSymTable);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ShmSymTable_map(ShmSymTable_T oShmSymTable,
+                     void (*pfApply)(const char *pcKey,
+                                     const void *pvValue,
+                                     size_t uSize, void *pvExtra),
+                     const void *pvExtra) {
+    struct ShmHeader *psHeader;
+    struct ShmNode *psNode;
+    uint64_t *puBuckets;
+    uint64_t uOffset;
+    size_t u;
+
+    assert(oShmSymTable != NULL);
+    assert(pfApply != NULL);
+
+    psHeader = oShmSymTable->psHeader;
+    puBuckets = (uint64_t*)((char*)psHeader + psHeader->uBucketsOffset);
+    ShmSymTable_lock(oShmSymTable);
+    for (u = 0; u < psHeader->uBucketCount; u++)
+        for (uOffset = puBuckets[u]; uOffset != 0;
+             uOffset = psNode->uNext) {
+            psNode = ShmSymTable_nodeAt(oShmSymTable, uOffset);
+            assert(psNode != NULL);
+            (*pfApply)(psNode->acBytes,
+                       &psNode->acBytes[psNode->uKeyLength + 1],
+                       psNode->uValueSize, (void*)pvExtra);
+        }
+    ShmSymTable_unlock(oShmSymTable);
+}
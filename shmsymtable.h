@@ -0,0 +1,136 @@
+/*--------------------------------------------------------------------*/
+/* shmsymtable.h                                                      */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SHMSYMTABLE_INCLUDED
+#define SHMSYMTABLE_INCLUDED
+
+#include <stddef.h>
+
+/* A ShmSymTable_T is an unordered collection of key and value
+bindings that lives in one shared memory region, so that many
+processes can use the same table without each building a copy. The
+buckets, keys and values are stored in the region and linked by
+offsets within it, not addresses, so every process may map it
+anywhere. Since an address means nothing to another process, each
+value is a block of bytes that the table copies in and out.
+
+Writers take a lock in the region, so they change the table one at a
+time. Readers take no lock: each lookup reads optimistically and
+retries if a writer changed the table meanwhile (a sequence lock), so
+readers never delay the writer or one another. A write that changes
+nothing, such as a put of a bound key, does not make readers retry.
+The region has a fixed size, chosen when it is created.
+
+On Linux the lock is robust: if a process dies while it holds the
+lock, the next process to take it makes the table usable again, and a
+reader that finds a write taking long takes the lock to find out. The
+binding being changed may then have been changed or not, and a value
+that was being replaced in place may be left part old and part new.
+Elsewhere, a process that dies while it writes leaves the table locked
+for good. */
+typedef struct ShmSymTable *ShmSymTable_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new ShmSymTable object that contains no bindings, in a new
+region of uRegionSize bytes with buckets for about uExpectedCount
+bindings, or NULL if the region cannot be created or is too small for
+the buckets. If pcName is not NULL, the region is a POSIX shared
+memory object of that name (such as "/symbols"), which must not
+already exist, and other processes may attach to it with
+ShmSymTable_open. Otherwise the region is anonymous, and is shared
+only with the processes that this one forks after the call. */
+  ShmSymTable_T ShmSymTable_create(const char *pcName,
+     size_t uRegionSize, size_t uExpectedCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a ShmSymTable object for the table in the shared memory
+object named pcName, which ShmSymTable_create made, or NULL if it
+does not exist, cannot be mapped or does not hold a table. */
+  ShmSymTable_T ShmSymTable_open(const char *pcName);
+
+/*--------------------------------------------------------------------*/
+
+/* Unmaps the region of oShmSymTable from this process and frees the
+object. The table itself lasts until every process has closed it and,
+if it is named, its name is removed with ShmSymTable_unlink. */
+  void ShmSymTable_close(ShmSymTable_T oShmSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Removes the name pcName of a shared memory object, so that no
+process can open it again. Returns 1 (TRUE) on success, and 0 (FALSE)
+if there is no such object. */
+  int ShmSymTable_unlink(const char *pcName);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bindings in oShmSymTable */
+  size_t ShmSymTable_getLength(ShmSymTable_T oShmSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bytes of the region of oShmSymTable that are
+not yet allocated. Blocks freed by ShmSymTable_replace and
+ShmSymTable_remove are reused by later bindings of similar size, but
+are not counted. */
+  size_t ShmSymTable_getFreeBytes(ShmSymTable_T oShmSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* If oShmSymTable does not contain a binding with key pcKey, then
+ShmSymTable_put adds a new binding of pcKey to a copy of the uSize
+bytes of pvValue and returns 1 (TRUE). Otherwise, or if the region is
+full, it leaves oShmSymTable unchanged and returns 0 (FALSE). */
+  int ShmSymTable_put(ShmSymTable_T oShmSymTable, const char *pcKey,
+     const void *pvValue, size_t uSize);
+
+/*--------------------------------------------------------------------*/
+
+/* If oShmSymTable contains a binding with key pcKey, then
+ShmSymTable_replace binds it to a copy of the uSize bytes of pvValue
+instead and returns 1 (TRUE). Otherwise, or if the region is full, it
+leaves oShmSymTable unchanged and returns 0 (FALSE). */
+  int ShmSymTable_replace(ShmSymTable_T oShmSymTable,
+     const char *pcKey, const void *pvValue, size_t uSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if oShmSymTable contains a binding whose key is
+pcKey, and 0 (FALSE) otherwise */
+  int ShmSymTable_contains(ShmSymTable_T oShmSymTable,
+     const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* If oShmSymTable contains a binding whose key is pcKey, then
+ShmSymTable_get copies the first uRoom bytes (at most) of its value
+to pvValue, stores the number of bytes of the value in *puSize unless
+puSize is NULL, and returns 1 (TRUE). Otherwise it returns 0 (FALSE).
+The bytes copied are those of one value, never a mixture of the old
+and new values of a concurrent change. */
+  int ShmSymTable_get(ShmSymTable_T oShmSymTable, const char *pcKey,
+     void *pvValue, size_t uRoom, size_t *puSize);
+
+/*--------------------------------------------------------------------*/
+
+/* If oShmSymTable contains a binding with key pcKey, then
+ShmSymTable_remove removes it and returns 1 (TRUE). Otherwise it
+leaves oShmSymTable unchanged and returns 0 (FALSE). */
+  int ShmSymTable_remove(ShmSymTable_T oShmSymTable, const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Applies function *pfApply to each binding in oShmSymTable, passing
+the address and number of bytes of its value, and pvExtra. The
+writers' lock is held throughout, so the bindings do not change, and
+*pfApply must not call functions of oShmSymTable that change it. */
+  void ShmSymTable_map(ShmSymTable_T oShmSymTable,
+     void (*pfApply)(const char *pcKey, const void *pvValue,
+                     size_t uSize, void *pvExtra),
+     const void *pvExtra);
+
+#endif
@@ -0,0 +1,422 @@
+/*--------------------------------------------------------------------*/
+/* symtable.hpp                                                       */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLE_HPP_INCLUDED
+#define SYMTABLE_HPP_INCLUDED
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/* The chained hash table of symtablehash.c as a C++17 template. The
+hash function, the key comparison, the allocator and the rule for
+growing the buckets are template parameters, so that the compiler can
+inline them, and map takes any callable, which it can inline too.
+Values need only be movable. symtablecpp.cpp implements symtable.h
+with it. */
+
+namespace symtable {
+
+/*--------------------------------------------------------------------*/
+
+/* Hashes a string as KeyOps_hash does: uHash = uHash * 65599 + c for
+each character c. */
+
+struct StringHash {
+    constexpr std::size_t operator()(std::string_view oKey)
+        const noexcept {
+        std::size_t uHash = 0;
+
+        for (char c : oKey)
+            uHash = uHash * 65599 + (std::size_t)c;
+        return uHash;
+    }
+};
+
+/* Compares strings by their characters. */
+
+struct StringEqual {
+    constexpr bool operator()(std::string_view oKey1,
+                              std::string_view oKey2) const noexcept {
+        return oKey1 == oKey2;
+    }
+};
+
+/* The hash and comparison policies a table uses unless told
+otherwise: the string policies for keys that are strings, and the
+standard ones for other keys. */
+
+template <class Key>
+using DefaultHash = std::conditional_t<
+    std::is_convertible_v<const Key&, std::string_view>,
+    StringHash, std::hash<Key>>;
+
+template <class Key>
+using DefaultEqual = std::conditional_t<
+    std::is_convertible_v<const Key&, std::string_view>,
+    StringEqual, std::equal_to<Key>>;
+
+/*--------------------------------------------------------------------*/
+
+/* Grows the buckets through the primes of symtablehash.c and indexes
+them by the remainder of the hash code. */
+
+struct PrimeGrowth {
+    static constexpr bool bPowerOfTwo = false;
+
+    static constexpr std::size_t auCounts[] = {
+        509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071,
+        262139, 524287, 1048573, 2097143, 4194301, 8388593, 16777213,
+        33554393, 67108859, 134217689, 268435399, 536870909,
+        1073741789, 2147483647
+    };
+
+    /* Returns the smallest bucket count that is at least uMinimum, or
+    the largest one if none is */
+    static constexpr std::size_t bucketCountFor(std::size_t uMinimum)
+        noexcept {
+        for (std::size_t uCount : auCounts)
+            if (uCount >= uMinimum) return uCount;
+        return auCounts[sizeof(auCounts) / sizeof(auCounts[0]) - 1];
+    }
+
+    /* Returns the bucket of uHash among uCount buckets */
+    static constexpr std::size_t bucketOf(std::size_t uHash,
+                                          std::size_t uCount) noexcept {
+        return uHash % uCount;
+    }
+};
+
+/* Grows the buckets through the powers of 2 and indexes them by the
+mixed hash code, trading the division of PrimeGrowth for a multiply
+that spreads hash codes whose low bits vary little. */
+
+struct PowerOfTwoGrowth {
+    static constexpr bool bPowerOfTwo = true;
+
+    /* Returns the smallest power of 2 that is at least uMinimum and at
+    least 512 */
+    static constexpr std::size_t bucketCountFor(std::size_t uMinimum)
+        noexcept {
+        std::size_t uCount = 512;
+
+        while (uCount < uMinimum && uCount <= SIZE_MAX / 4)
+            uCount *= 2;
+        return uCount;
+    }
+
+    /* Returns the bucket of uHash among uCount buckets */
+    static constexpr std::size_t bucketOf(std::size_t uHash,
+                                          std::size_t uCount) noexcept {
+        std::uint64_t uMixed =
+            (std::uint64_t)uHash * UINT64_C(0x9E3779B97F4A7C15);
+
+        return (std::size_t)(uMixed ^ (uMixed >> 29)) & (uCount - 1);
+    }
+};
+
+/*--------------------------------------------------------------------*/
+
+/* An unordered collection of bindings of keys of type Key to values
+of type Value. Lookups take any key type that Hash and Equal accept,
+so that a Table<std::string, ...> can be searched with a const char *
+without building a string. Tables can be moved but not copied; a
+moved-from table is empty. */
+
+template <class Key, class Value,
+          class Hash = DefaultHash<Key>,
+          class Equal = DefaultEqual<Key>,
+          class Allocator = std::allocator<std::pair<const Key, Value>>,
+          class Growth = PrimeGrowth>
+class Table {
+public:
+    Table() noexcept(std::is_nothrow_default_constructible_v<Hash> &&
+                     std::is_nothrow_default_constructible_v<Equal> &&
+                     std::is_nothrow_default_constructible_v<Allocator>)
+        : Table(Hash(), Equal(), Allocator()) {}
+
+    explicit Table(const Hash &oHash_, const Equal &oEqual_ = Equal(),
+                   const Allocator &oAllocator = Allocator())
+        : oHash(oHash_), oEqual(oEqual_), oNodeAllocator(oAllocator),
+          oBucketAllocator(oAllocator) {}
+
+    Table(Table &&oOther) noexcept
+        : ppsBuckets(std::exchange(oOther.ppsBuckets, nullptr)),
+          uBucketCount(std::exchange(oOther.uBucketCount, 0)),
+          uLength(std::exchange(oOther.uLength, 0)),
+          oHash(std::move(oOther.oHash)),
+          oEqual(std::move(oOther.oEqual)),
+          oNodeAllocator(std::move(oOther.oNodeAllocator)),
+          oBucketAllocator(std::move(oOther.oBucketAllocator)) {}
+
+    Table &operator=(Table &&oOther) noexcept {
+        if (this != &oOther) {
+            destroy();
+            ppsBuckets = std::exchange(oOther.ppsBuckets, nullptr);
+            uBucketCount = std::exchange(oOther.uBucketCount, 0);
+            uLength = std::exchange(oOther.uLength, 0);
+            oHash = std::move(oOther.oHash);
+            oEqual = std::move(oOther.oEqual);
+            oNodeAllocator = std::move(oOther.oNodeAllocator);
+            oBucketAllocator = std::move(oOther.oBucketAllocator);
+        }
+        return *this;
+    }
+
+    Table(const Table &) = delete;
+    Table &operator=(const Table &) = delete;
+
+    ~Table() { destroy(); }
+
+    /* Returns the number of bindings */
+    std::size_t getLength() const noexcept { return uLength; }
+
+    /* If the table has no binding whose key equals oKey, adds one whose
+    key is built from oKey and whose value is built from oValueArgs,
+    and returns true. Otherwise returns false and builds nothing. If
+    building the binding throws, leaves the table unchanged. */
+    template <class K, class... Args>
+    bool put(K &&oKey, Args &&...oValueArgs) {
+        Node **ppsLink;
+        Node *psNode;
+        std::size_t uHash = oHash(oKey);
+
+        ppsLink = findLink(oKey, uHash);
+        if (*ppsLink != nullptr) return false;
+
+        /* Growing moves the nodes, so find the link again */
+        if (uLength >= uBucketCount) {
+            grow(Growth::bucketCountFor(uLength + 1));
+            ppsLink = findLink(oKey, uHash);
+        }
+
+        psNode = newNode(uHash, std::forward<K>(oKey),
+                         std::forward<Args>(oValueArgs)...);
+        *ppsLink = psNode;
+        uLength++;
+        return true;
+    }
+
+    /* If the table has a binding whose key equals oKey, replaces its
+    value with oValue and returns the old value. Otherwise returns no
+    value and leaves the table unchanged. */
+    template <class K, class V>
+    std::optional<Value> replace(const K &oKey, V &&oValue) {
+        Node *psNode = *findLink(oKey, oHash(oKey));
+
+        if (psNode == nullptr) return std::nullopt;
+
+        std::optional<Value> oOldValue(std::move(psNode->oValue));
+        psNode->oValue = std::forward<V>(oValue);
+        return oOldValue;
+    }
+
+    /* Returns true if the table has a binding whose key equals oKey */
+    template <class K>
+    bool contains(const K &oKey) const {
+        return *findLink(oKey, oHash(oKey)) != nullptr;
+    }
+
+    /* Returns the address of the value of the binding whose key equals
+    oKey, which stays valid until the binding is removed, or nullptr
+    if there is none */
+    template <class K>
+    Value *get(const K &oKey) {
+        Node *psNode = *findLink(oKey, oHash(oKey));
+
+        return psNode == nullptr ? nullptr : &psNode->oValue;
+    }
+
+    template <class K>
+    const Value *get(const K &oKey) const {
+        Node *psNode = *findLink(oKey, oHash(oKey));
+
+        return psNode == nullptr ? nullptr : &psNode->oValue;
+    }
+
+    /* If the table has a binding whose key equals oKey, removes it and
+    returns its value. Otherwise returns no value and leaves the table
+    unchanged. */
+    template <class K>
+    std::optional<Value> remove(const K &oKey) {
+        Node **ppsLink = findLink(oKey, oHash(oKey));
+        Node *psNode = *ppsLink;
+
+        if (psNode == nullptr) return std::nullopt;
+
+        std::optional<Value> oValue(std::move(psNode->oValue));
+        *ppsLink = psNode->psNextNode;
+        deleteNode(psNode);
+        uLength--;
+        return oValue;
+    }
+
+    /* Calls fApply(oKey, oValue) for each binding, where oKey is a
+    const Key & and oValue a Value & */
+    template <class F>
+    void map(F &&fApply) {
+        for (std::size_t u = 0; u < uBucketCount; u++)
+            for (Node *psNode = ppsBuckets[u]; psNode != nullptr;
+                 psNode = psNode->psNextNode)
+                fApply(std::as_const(psNode->oKey), psNode->oValue);
+    }
+
+    /* Calls fApply(oKey, oValue) for each binding, where oKey is a
+    const Key & and oValue a const Value & */
+    template <class F>
+    void map(F &&fApply) const {
+        for (std::size_t u = 0; u < uBucketCount; u++)
+            for (const Node *psNode = ppsBuckets[u]; psNode != nullptr;
+                 psNode = psNode->psNextNode)
+                fApply(psNode->oKey, psNode->oValue);
+    }
+
+private:
+    /* Each binding is a node in the chain of its bucket. */
+    struct Node {
+        /* The address of the next node in the bucket */
+        Node *psNextNode;
+        /* The hash code of the key */
+        std::size_t uHash;
+        /* The key */
+        Key oKey;
+        /* The value */
+        Value oValue;
+
+        template <class K, class... Args>
+        Node(std::size_t uHash_, K &&oKey_, Args &&...oValueArgs)
+            : psNextNode(nullptr), uHash(uHash_),
+              oKey(std::forward<K>(oKey_)),
+              oValue(std::forward<Args>(oValueArgs)...) {}
+    };
+
+    using NodeAllocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<Node>;
+    using NodeTraits = std::allocator_traits<NodeAllocator>;
+    using BucketAllocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<Node*>;
+    using BucketTraits = std::allocator_traits<BucketAllocator>;
+
+    /* The address of the array of first nodes, or nullptr before the
+    first put */
+    Node **ppsBuckets = nullptr;
+    /* The number of buckets */
+    std::size_t uBucketCount = 0;
+    /* The number of bindings */
+    std::size_t uLength = 0;
+    /* The hash policy */
+    Hash oHash;
+    /* The key comparison policy */
+    Equal oEqual;
+    /* The allocators of nodes and of bucket arrays */
+    NodeAllocator oNodeAllocator;
+    BucketAllocator oBucketAllocator;
+
+    /* Returns the address of the pointer to the node whose key equals
+    oKey, whose hash code is uHash, or of the null pointer that ends
+    its bucket */
+    template <class K>
+    Node **findLink(const K &oKey, std::size_t uHash) const {
+        Node **ppsLink;
+
+        if (uBucketCount == 0) {
+            static Node *psNoNode = nullptr;
+            return &psNoNode;
+        }
+
+        ppsLink = &ppsBuckets[Growth::bucketOf(uHash, uBucketCount)];
+        while (*ppsLink != nullptr &&
+               ((*ppsLink)->uHash != uHash ||
+                !oEqual((*ppsLink)->oKey, oKey)))
+            ppsLink = &(*ppsLink)->psNextNode;
+        return ppsLink;
+    }
+
+    /* Moves the nodes into uNewCount new buckets. If allocating them
+    fails the table keeps its buckets, unless it has none. */
+    void grow(std::size_t uNewCount) {
+        Node **ppsNewBuckets;
+        Node *psNextNode;
+        std::size_t uBucket;
+
+        if (uNewCount <= uBucketCount) return;
+
+        try {
+            ppsNewBuckets =
+                BucketTraits::allocate(oBucketAllocator, uNewCount);
+        } catch (const std::bad_alloc &) {
+            if (uBucketCount == 0) throw;
+            return;
+        }
+        for (std::size_t u = 0; u < uNewCount; u++)
+            ppsNewBuckets[u] = nullptr;
+
+        for (std::size_t u = 0; u < uBucketCount; u++)
+            for (Node *psNode = ppsBuckets[u]; psNode != nullptr;
+                 psNode = psNextNode) {
+                psNextNode = psNode->psNextNode;
+                uBucket = Growth::bucketOf(psNode->uHash, uNewCount);
+                psNode->psNextNode = ppsNewBuckets[uBucket];
+                ppsNewBuckets[uBucket] = psNode;
+            }
+
+        if (ppsBuckets != nullptr)
+            BucketTraits::deallocate(oBucketAllocator, ppsBuckets,
+                                     uBucketCount);
+        ppsBuckets = ppsNewBuckets;
+        uBucketCount = uNewCount;
+    }
+
+    /* Returns a new node built from uHash, oKey and oValueArgs */
+    template <class K, class... Args>
+    Node *newNode(std::size_t uHash, K &&oKey, Args &&...oValueArgs) {
+        Node *psNode = NodeTraits::allocate(oNodeAllocator, 1);
+
+        try {
+            NodeTraits::construct(oNodeAllocator, psNode, uHash,
+                                  std::forward<K>(oKey),
+                                  std::forward<Args>(oValueArgs)...);
+        } catch (...) {
+            NodeTraits::deallocate(oNodeAllocator, psNode, 1);
+            throw;
+        }
+        return psNode;
+    }
+
+    /* Destroys and frees psNode */
+    void deleteNode(Node *psNode) noexcept {
+        NodeTraits::destroy(oNodeAllocator, psNode);
+        NodeTraits::deallocate(oNodeAllocator, psNode, 1);
+    }
+
+    /* Frees every node and the buckets */
+    void destroy() noexcept {
+        Node *psNextNode;
+
+        for (std::size_t u = 0; u < uBucketCount; u++)
+            for (Node *psNode = ppsBuckets[u]; psNode != nullptr;
+                 psNode = psNextNode) {
+                psNextNode = psNode->psNextNode;
+                deleteNode(psNode);
+            }
+        if (ppsBuckets != nullptr)
+            BucketTraits::deallocate(oBucketAllocator, ppsBuckets,
+                                     uBucketCount);
+        ppsBuckets = nullptr;
+        uBucketCount = 0;
+        uLength = 0;
+    }
+};
+
+} /* namespace symtable */
+
+#endif
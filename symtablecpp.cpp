@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------------*/
+/* symtablecpp.cpp                                                    */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include <cassert>
+#include <new>
+#include <string>
+#include "symtable.hpp"
+
+extern "C" {
+#include "symtable.h"
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable is a symtable::Table of string keys and void * values.
+The functions below adapt its interface to symtable.h, turning
+allocation failures into the return values that symtable.h
+specifies. */
+
+struct SymTable {
+    /* The bindings */
+    symtable::Table<std::string, void*> oTable;
+};
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+    return new (std::nothrow) SymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    delete oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    return oSymTable->oTable.getLength();
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+                 const char *pcKey, const void *pvValue) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    try {
+        return oSymTable->oTable.put(pcKey, const_cast<void*>(pvValue));
+    } catch (const std::bad_alloc &) {
+        return 0;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+                       const char *pcKey, const void *pvValue) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return oSymTable->oTable.replace(pcKey, const_cast<void*>(pvValue))
+        .value_or(nullptr);
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return oSymTable->oTable.contains(pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    void **ppvValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    ppvValue = oSymTable->oTable.get(pcKey);
+    return ppvValue == nullptr ? nullptr : *ppvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return oSymTable->oTable.remove(pcKey).value_or(nullptr);
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra) {
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    oSymTable->oTable.map(
+        [pfApply, pvExtra](const std::string &oKey, void *pvValue) {
+            (*pfApply)(oKey.c_str(), pvValue, const_cast<void*>(pvExtra));
+        });
+}
@@ -0,0 +1,520 @@
+/*--------------------------------------------------------------------*/
+/* symtablegen.c                                                      */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+/* Generate a perfect-hash lookup table for a fixed set of keys, such
+   as the reserved words of a lexer, as C source that needs no
+   initialization at run time. "symtablegen Name keyfile" reads
+   keyfile and writes Name.h and Name.c, which define
+
+      void *Name_get(const char *pcKey);
+      int Name_contains(const char *pcKey);
+
+   with the meanings of SymTable_get and SymTable_contains for a table
+   that holds the bindings of keyfile. Each line of keyfile is either
+   a key, optionally followed by white space and a C constant
+   expression that is its value; or a line that starts with '#',
+   which is copied to Name.c, to include or define what the values
+   need; or blank. A key without a value is bound to itself.
+
+   The table is built by hash and displace: the keys are hashed into
+   buckets of about four, and each bucket, largest first, is given the
+   smallest seed that sends all of its keys to free slots. A lookup
+   then hashes its key once, reads the seed of its bucket, and
+   compares the key with the one key in its slot. */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_LINE_LENGTH = 1024, KEYS_PER_BUCKET = 4,
+   MAX_SEED = 1 << 16};
+
+/* One binding read from the key file. */
+
+struct Binding {
+   /* The key */
+   char *pcKey;
+   /* The C expression of the value, or NULL if the key is its own
+      value */
+   char *pcValue;
+   /* The hash code of the key */
+   uint64_t uHash;
+   /* The bucket of the key */
+   size_t uBucket;
+};
+
+/* The bindings read so far, and the passthrough lines. */
+
+static struct Binding *psBindings = NULL;
+static size_t uBindingCount = 0;
+static char **ppcDirectives = NULL;
+static size_t uDirectiveCount = 0;
+
+/* The name of this program, for messages. */
+
+static const char *pcProgramName;
+
+/*--------------------------------------------------------------------*/
+
+/* The hash functions, which are also written to the generated file
+   (see writeSource). They must stay identical to that text. */
+
+#define HASH_SOURCE \
+"static uint64_t %s_hash(const char *pcKey) {\n" \
+"    uint64_t uHash = 0;\n" \
+"\n" \
+"    while (*pcKey != '\\0')\n" \
+"        uHash = uHash * 65599 + (unsigned char)*pcKey++;\n" \
+"    return uHash;\n" \
+"}\n" \
+"\n" \
+"static uint64_t %s_mix(uint64_t uHash) {\n" \
+"    uHash ^= uHash >> 33;\n" \
+"    uHash *= UINT64_C(0xFF51AFD7ED558CCD);\n" \
+"    uHash ^= uHash >> 33;\n" \
+"    return uHash;\n" \
+"}\n"
+
+/* Return the hash code of pcKey. */
+
+static uint64_t hash(const char *pcKey)
+{
+   uint64_t uHash = 0;
+
+   while (*pcKey != '\0')
+      uHash = uHash * 65599 + (unsigned char)*pcKey++;
+   return uHash;
+}
+
+/* Return uHash with its bits mixed. */
+
+static uint64_t mix(uint64_t uHash)
+{
+   uHash ^= uHash >> 33;
+   uHash *= UINT64_C(0xFF51AFD7ED558CCD);
+   uHash ^= uHash >> 33;
+   return uHash;
+}
+
+/* Return the slot, among uSlotCount, of a key whose hash code is
+   uHash, in a bucket whose seed is uSeed. */
+
+static size_t slotOf(uint64_t uHash, unsigned long uSeed,
+   size_t uSlotCount)
+{
+   return (size_t)(mix(uHash + uSeed * UINT64_C(0x9E3779B97F4A7C15))
+      % uSlotCount);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write a message made of pcMessage and pcDetail to stderr, and
+   exit with EXIT_FAILURE. */
+
+static void fail(const char *pcMessage, const char *pcDetail)
+{
+   fprintf(stderr, "%s: %s%s\n", pcProgramName, pcMessage, pcDetail);
+   exit(EXIT_FAILURE);
+}
+
+/* Return the address of a new copy of the uLength characters at pc,
+   followed by a null character. */
+
+static char *copy(const char *pc, size_t uLength)
+{
+   char *pcCopy = (char*)malloc(uLength + 1);
+
+   if (pcCopy == NULL) fail("insufficient memory", "");
+   memcpy(pcCopy, pc, uLength);
+   pcCopy[uLength] = '\0';
+   return pcCopy;
+}
+
+/* Return whether c is white space. */
+
+static int isBlank(char c)
+{
+   return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read the bindings and the passthrough lines of the file named
+   pcFileName. */
+
+static void readKeys(const char *pcFileName)
+{
+   FILE *psFile;
+   char acLine[MAX_LINE_LENGTH];
+   size_t uCapacity = 0;
+   size_t uStart;
+   size_t uEnd;
+   size_t u;
+
+   psFile = fopen(pcFileName, "r");
+   if (psFile == NULL) fail("cannot open ", pcFileName);
+
+   while (fgets(acLine, sizeof(acLine), psFile) != NULL)
+   {
+      if (strchr(acLine, '\n') == NULL && ! feof(psFile))
+         fail("line too long in ", pcFileName);
+
+      for (uEnd = strlen(acLine); uEnd > 0 && isBlank(acLine[uEnd - 1]);
+           uEnd--)
+         ;
+      acLine[uEnd] = '\0';
+
+      if (acLine[0] == '#')
+      {
+         ppcDirectives = (char**)realloc(ppcDirectives,
+            (uDirectiveCount + 1) * sizeof(char*));
+         if (ppcDirectives == NULL) fail("insufficient memory", "");
+         ppcDirectives[uDirectiveCount++] = copy(acLine, uEnd);
+         continue;
+      }
+
+      for (uStart = 0; isBlank(acLine[uStart]); uStart++)
+         ;
+      if (acLine[uStart] == '\0') continue;
+
+      if (uBindingCount == uCapacity)
+      {
+         uCapacity = uCapacity == 0 ? 64 : 2 * uCapacity;
+         psBindings = (struct Binding*)realloc(psBindings,
+            uCapacity * sizeof(struct Binding));
+         if (psBindings == NULL) fail("insufficient memory", "");
+      }
+
+      for (u = uStart; acLine[u] != '\0' && ! isBlank(acLine[u]); u++)
+         ;
+      psBindings[uBindingCount].pcKey = copy(&acLine[uStart],
+         u - uStart);
+      while (isBlank(acLine[u])) u++;
+      psBindings[uBindingCount].pcValue = acLine[u] == '\0' ? NULL
+         : copy(&acLine[u], strlen(&acLine[u]));
+      psBindings[uBindingCount].uHash =
+         hash(psBindings[uBindingCount].pcKey);
+
+      for (u = 0; u < uBindingCount; u++)
+         if (strcmp(psBindings[u].pcKey,
+                    psBindings[uBindingCount].pcKey) == 0)
+            fail("duplicate key ", psBindings[u].pcKey);
+      uBindingCount++;
+   }
+
+   fclose(psFile);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A bucket of keys. */
+
+struct Bucket {
+   /* The number of keys in the bucket */
+   size_t uSize;
+   /* The number of the bucket */
+   size_t uBucket;
+   /* The index of the bucket's first binding in the array of
+      bindings grouped by bucket */
+   size_t uFirst;
+};
+
+/* Return the order of the buckets to which pv1 and pv2 point: larger
+   first, then by number. */
+
+static int compareBuckets(const void *pv1, const void *pv2)
+{
+   const struct Bucket *psBucket1 = (const struct Bucket*)pv1;
+   const struct Bucket *psBucket2 = (const struct Bucket*)pv2;
+
+   if (psBucket1->uSize != psBucket2->uSize)
+      return psBucket1->uSize > psBucket2->uSize ? -1 : 1;
+   if (psBucket1->uBucket != psBucket2->uBucket)
+      return psBucket1->uBucket < psBucket2->uBucket ? -1 : 1;
+   return 0;
+}
+
+/* Try to give each of the uBucketCount buckets a seed, storing it in
+   auSeeds, such that the bindings go to distinct slots among
+   uSlotCount, storing in auSlots the binding in each slot or
+   uBindingCount for none. Return 1 (TRUE) if that succeeds, or 0
+   (FALSE) if some bucket has no seed below MAX_SEED. */
+
+static int placeKeys(size_t uBucketCount, size_t uSlotCount,
+   unsigned long auSeeds[], size_t auSlots[])
+{
+   struct Bucket *psBuckets;
+   size_t *auMembers;
+   size_t *auTrial;
+   size_t *puMembers;
+   size_t uMemberCount;
+   size_t uEnd = 0;
+   unsigned long uSeed;
+   size_t uBucket;
+   size_t u;
+   size_t v;
+   int iPlaced = 1;
+
+   psBuckets = (struct Bucket*)calloc(uBucketCount,
+      sizeof(struct Bucket));
+   auMembers = (size_t*)malloc((uBindingCount + 1) * sizeof(size_t));
+   auTrial = (size_t*)malloc((uBindingCount + 1) * sizeof(size_t));
+   if (psBuckets == NULL || auMembers == NULL || auTrial == NULL)
+      fail("insufficient memory", "");
+
+   for (u = 0; u < uBucketCount; u++) psBuckets[u].uBucket = u;
+   for (u = 0; u < uBindingCount; u++)
+   {
+      psBindings[u].uBucket = (size_t)(mix(psBindings[u].uHash)
+         % uBucketCount);
+      psBuckets[psBindings[u].uBucket].uSize++;
+   }
+
+   /* Group the bindings by bucket, in auMembers */
+   for (u = 0; u < uBucketCount; u++)
+   {
+      uEnd += psBuckets[u].uSize;
+      psBuckets[u].uFirst = uEnd;
+   }
+   for (u = 0; u < uBindingCount; u++)
+      auMembers[--psBuckets[psBindings[u].uBucket].uFirst] = u;
+
+   qsort(psBuckets, uBucketCount, sizeof(struct Bucket),
+      compareBuckets);
+
+   for (u = 0; u < uSlotCount; u++) auSlots[u] = uBindingCount;
+   for (u = 0; u < uBucketCount; u++) auSeeds[u] = 0;
+
+   for (uBucket = 0; uBucket < uBucketCount && iPlaced; uBucket++)
+   {
+      if (psBuckets[uBucket].uSize == 0) break;
+
+      puMembers = &auMembers[psBuckets[uBucket].uFirst];
+      uMemberCount = psBuckets[uBucket].uSize;
+
+      iPlaced = 0;
+      for (uSeed = 0; uSeed < MAX_SEED && ! iPlaced; uSeed++)
+      {
+         iPlaced = 1;
+         for (u = 0; u < uMemberCount && iPlaced; u++)
+         {
+            auTrial[u] = slotOf(psBindings[puMembers[u]].uHash, uSeed,
+               uSlotCount);
+            if (auSlots[auTrial[u]] != uBindingCount) iPlaced = 0;
+            for (v = 0; v < u && iPlaced; v++)
+               if (auTrial[v] == auTrial[u]) iPlaced = 0;
+         }
+         if (iPlaced)
+         {
+            auSeeds[psBuckets[uBucket].uBucket] = uSeed;
+            for (u = 0; u < uMemberCount; u++)
+               auSlots[auTrial[u]] = puMembers[u];
+         }
+      }
+   }
+
+   free(psBuckets);
+   free(auMembers);
+   free(auTrial);
+   return iPlaced;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write pcString to psFile as a C string literal. */
+
+static void writeLiteral(FILE *psFile, const char *pcString)
+{
+   putc('"', psFile);
+   for (; *pcString != '\0'; pcString++)
+   {
+      if (*pcString == '"' || *pcString == '\\') putc('\\', psFile);
+      putc(*pcString, psFile);
+   }
+   putc('"', psFile);
+}
+
+/* Open the file whose name is pcName followed by pcSuffix for
+   writing, and return it. */
+
+static FILE *openOutput(const char *pcName, const char *pcSuffix)
+{
+   FILE *psFile;
+   char *pcFileName;
+
+   pcFileName = (char*)malloc(strlen(pcName) + strlen(pcSuffix) + 1);
+   if (pcFileName == NULL) fail("insufficient memory", "");
+   strcpy(pcFileName, pcName);
+   strcat(pcFileName, pcSuffix);
+   psFile = fopen(pcFileName, "w");
+   if (psFile == NULL) fail("cannot create ", pcFileName);
+   free(pcFileName);
+   return psFile;
+}
+
+/* Write the header file of the table named pcName. */
+
+static void writeHeader(const char *pcName)
+{
+   FILE *psFile = openOutput(pcName, ".h");
+
+   fprintf(psFile, "/* Generated by symtablegen; do not edit. */\n\n");
+   fprintf(psFile, "#ifndef %s_INCLUDED\n#define %s_INCLUDED\n\n",
+      pcName, pcName);
+   fprintf(psFile, "/* Returns the value of the binding whose key is "
+      "pcKey, or NULL if\nno such binding exists */\n\n");
+   fprintf(psFile, "  void *%s_get(const char *pcKey);\n\n", pcName);
+   fprintf(psFile, "/* Returns 1 (TRUE) if a binding's key is pcKey, and "
+      "0 (FALSE)\notherwise */\n\n");
+   fprintf(psFile, "  int %s_contains(const char *pcKey);\n\n", pcName);
+   fprintf(psFile, "#endif\n");
+   if (fclose(psFile) != 0) fail("cannot write ", pcName);
+}
+
+/* Write the source file of the table named pcName, whose
+   uBucketCount buckets have seeds auSeeds and whose uSlotCount slots
+   hold bindings auSlots. */
+
+static void writeSource(const char *pcName, size_t uBucketCount,
+   const unsigned long auSeeds[], size_t uSlotCount,
+   const size_t auSlots[])
+{
+   FILE *psFile = openOutput(pcName, ".c");
+   size_t u;
+
+   fprintf(psFile, "/* Generated by symtablegen; do not edit. */\n\n");
+   fprintf(psFile, "#include <assert.h>\n#include <stddef.h>\n"
+      "#include <stdint.h>\n#include <string.h>\n");
+   fprintf(psFile, "#include \"%s.h\"\n", pcName);
+   for (u = 0; u < uDirectiveCount; u++)
+      fprintf(psFile, "%s\n", ppcDirectives[u]);
+
+   fprintf(psFile, "\n/* The keys, each also the value of a key that "
+      "has none. */\n\n");
+   for (u = 0; u < uBindingCount; u++)
+   {
+      fprintf(psFile, "static const char acKey%lu[] = ",
+         (unsigned long)u);
+      writeLiteral(psFile, psBindings[u].pcKey);
+      fprintf(psFile, ";\n");
+   }
+
+   fprintf(psFile, "\n/* The binding in each slot, or NULL and NULL. */"
+      "\n\n");
+   fprintf(psFile, "static const struct {\n    const char *pcKey;\n"
+      "    const void *pvValue;\n} asSlots[%lu] = {\n",
+      (unsigned long)uSlotCount);
+   for (u = 0; u < uSlotCount; u++)
+   {
+      if (auSlots[u] == uBindingCount)
+         fprintf(psFile, "    {NULL, NULL}");
+      else if (psBindings[auSlots[u]].pcValue == NULL)
+         fprintf(psFile, "    {acKey%lu, acKey%lu}",
+            (unsigned long)auSlots[u], (unsigned long)auSlots[u]);
+      else
+         fprintf(psFile, "    {acKey%lu, (const void*)(%s)}",
+            (unsigned long)auSlots[u], psBindings[auSlots[u]].pcValue);
+      fprintf(psFile, u + 1 < uSlotCount ? ",\n" : "\n");
+   }
+   fprintf(psFile, "};\n");
+
+   fprintf(psFile, "\n/* The seed of each bucket. */\n\n");
+   fprintf(psFile, "static const uint32_t auSeeds[%lu] = {",
+      (unsigned long)uBucketCount);
+   for (u = 0; u < uBucketCount; u++)
+      fprintf(psFile, "%s%lu%s", u % 10 == 0 ? "\n    " : " ",
+         auSeeds[u], u + 1 < uBucketCount ? "," : "");
+   fprintf(psFile, "\n};\n\n");
+
+   fprintf(psFile, HASH_SOURCE, pcName, pcName);
+
+   fprintf(psFile, "\n/* Return the slot in which pcKey would be. */\n"
+      "\n");
+   fprintf(psFile, "static size_t %s_slotOf(const char *pcKey) {\n",
+      pcName);
+   fprintf(psFile, "    uint64_t uHash = %s_hash(pcKey);\n", pcName);
+   fprintf(psFile, "    uint64_t uSeed = "
+      "auSeeds[%s_mix(uHash) %% %lu];\n",
+      pcName, (unsigned long)uBucketCount);
+   fprintf(psFile, "\n    return (size_t)(%s_mix(uHash + uSeed *\n"
+      "        UINT64_C(0x9E3779B97F4A7C15)) %% %lu);\n}\n\n", pcName,
+      (unsigned long)uSlotCount);
+
+   fprintf(psFile, "void *%s_get(const char *pcKey) {\n", pcName);
+   fprintf(psFile, "    size_t uSlot;\n\n    assert(pcKey != NULL);\n\n");
+   fprintf(psFile, "    uSlot = %s_slotOf(pcKey);\n", pcName);
+   fprintf(psFile, "    if (asSlots[uSlot].pcKey == NULL ||\n"
+      "        strcmp(asSlots[uSlot].pcKey, pcKey) != 0)\n"
+      "        return NULL;\n");
+   fprintf(psFile, "    return (void*)asSlots[uSlot].pvValue;\n}\n\n");
+
+   fprintf(psFile, "int %s_contains(const char *pcKey) {\n", pcName);
+   fprintf(psFile, "    size_t uSlot;\n\n    assert(pcKey != NULL);\n\n");
+   fprintf(psFile, "    uSlot = %s_slotOf(pcKey);\n", pcName);
+   fprintf(psFile, "    return asSlots[uSlot].pcKey != NULL &&\n"
+      "           strcmp(asSlots[uSlot].pcKey, pcKey) == 0;\n}\n");
+
+   if (fclose(psFile) != 0) fail("cannot write ", pcName);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Generate a perfect-hash table. argv[1] is the name of the table and
+   argv[2] the name of the key file. Exit with EXIT_FAILURE if the
+   arguments are wrong or a file cannot be read or written. Otherwise
+   return 0. */
+
+int main(int argc, char *argv[])
+{
+   unsigned long *auSeeds;
+   size_t *auSlots;
+   size_t uBucketCount;
+   size_t uSlotCount;
+   size_t u;
+
+   pcProgramName = argv[0];
+   if (argc != 3)
+   {
+      fprintf(stderr, "Usage: %s name keyfile\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   for (u = 0; argv[1][u] != '\0'; u++)
+      if (! (isalpha((unsigned char)argv[1][u]) || argv[1][u] == '_'
+             || (u > 0 && isdigit((unsigned char)argv[1][u]))))
+         fail("name must be a C identifier: ", argv[1]);
+   if (u == 0) fail("name must be a C identifier: ", argv[1]);
+
+   readKeys(argv[2]);
+
+   /* Start with one slot per key, and add slots until every bucket
+      finds a seed */
+   uBucketCount = (uBindingCount + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+   if (uBucketCount == 0) uBucketCount = 1;
+   uSlotCount = uBindingCount == 0 ? 1 : uBindingCount;
+   for (;;)
+   {
+      auSeeds = (unsigned long*)malloc(uBucketCount
+         * sizeof(unsigned long));
+      auSlots = (size_t*)malloc(uSlotCount * sizeof(size_t));
+      if (auSeeds == NULL || auSlots == NULL)
+         fail("insufficient memory", "");
+      if (placeKeys(uBucketCount, uSlotCount, auSeeds, auSlots)) break;
+      free(auSeeds);
+      free(auSlots);
+      uSlotCount++;
+   }
+
+   writeHeader(argv[1]);
+   writeSource(argv[1], uBucketCount, auSeeds, uSlotCount, auSlots);
+
+   free(auSeeds);
+   free(auSlots);
+   return 0;
+}
@@ -0,0 +1,731 @@
+/*--------------------------------------------------------------------*/
+/* symtablehamt.c                                                     */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtablehamt.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Each level of the trie consumes BITS_PER_LEVEL bits of a key's hash
+code. Below the last level that has bits left, keys whose hash codes
+are equal share a collision node. MAX_LEVELS bounds the depth of the
+trie, collision nodes included. */
+
+enum {BITS_PER_LEVEL = 5,
+      LEVEL_MASK = (1 << BITS_PER_LEVEL) - 1,
+      HASH_BITS = sizeof(size_t) * 8,
+      MAX_LEVELS = (HASH_BITS + BITS_PER_LEVEL - 1) / BITS_PER_LEVEL + 1};
+
+/*--------------------------------------------------------------------*/
+
+/* A key is shared by every node that refers to it. */
+
+struct Key {
+    /* The number of entries that refer to the key */
+    size_t uRefs;
+
+    /* The hash code of the key */
+    size_t uHash;
+
+    /* The identifying characters */
+    char acChars[1];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* An entry of a trie node is either a binding or a child node. */
+
+struct Entry {
+    /* The key of the binding, or NULL if the entry is a child node */
+    struct Key *psKey;
+
+    union {
+        /* The associated data, if the entry is a binding */
+        const void *pvValue;
+        /* The address of the child node, if the entry is one */
+        struct TrieNode *psChild;
+    } u;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A trie node holds one entry for each set bit of its bitmap, in bit
+order. A collision node holds entries for keys whose hash codes are
+equal, in no particular order, and leaves its bitmap 0. */
+
+struct TrieNode {
+    /* The number of tables and entries that refer to the node. A node
+    may be changed in place only while this is 1. */
+    size_t uRefs;
+
+    /* Bit b is set if the node has an entry for hash bits b */
+    uint32_t uBitmap;
+
+    /* The number of entries */
+    uint32_t uCount;
+
+    /* The entries */
+    struct Entry asEntries[1];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable is a "dummy" node that points to the root of a trie. */
+
+struct SymTable {
+    /* The address of the root node, or NULL if the table is empty */
+    struct TrieNode *psRoot;
+    /* The number of bindings stored */
+    size_t length;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Add one to the reference count *puRefs. Counts are updated
+atomically, since a table and its snapshots may be used by different
+threads. */
+static void SymTable_retain(size_t *puRefs) {
+    assert(puRefs != NULL);
+
+#ifdef __GNUC__
+    (void)__atomic_fetch_add(puRefs, 1, __ATOMIC_RELAXED);
+#else
+    (*puRefs)++;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Subtract one from the reference count *puRefs. Return 1 (TRUE) if
+that was the last reference, and 0 (FALSE) otherwise. */
+static int SymTable_release(size_t *puRefs) {
+    assert(puRefs != NULL);
+
+#ifdef __GNUC__
+    return __atomic_sub_fetch(puRefs, 1, __ATOMIC_ACQ_REL) == 0;
+#else
+    return --*puRefs == 0;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if the reference count *puRefs shows that something
+else refers to the same object, and 0 (FALSE) otherwise. */
+static int SymTable_isShared(size_t *puRefs) {
+    assert(puRefs != NULL);
+
+#ifdef __GNUC__
+    return __atomic_load_n(puRefs, __ATOMIC_ACQUIRE) > 1;
+#else
+    return *puRefs > 1;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of set bits of uBits. */
+static unsigned int SymTable_popCount(uint32_t uBits) {
+#ifdef __GNUC__
+    return (unsigned int)__builtin_popcount(uBits);
+#else
+    unsigned int uCount = 0;
+
+    for (; uBits != 0; uBits &= uBits - 1)
+        uCount++;
+    return uCount;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a hash code for pcKey whose bits are spread evenly enough to
+be consumed a few at a time. */
+static size_t SymTable_hash(const char *pcKey) {
+      const size_t HASH_MULTIPLIER = 65599;
+      size_t u;
+      uint64_t uHash = 0;
+
+      assert(pcKey != NULL);
+
+      for (u = 0; pcKey[u] != '\0'; u++)
+         uHash = uHash * HASH_MULTIPLIER + (uint64_t)pcKey[u];
+
+      uHash ^= uHash >> 33;
+      uHash *= UINT64_C(0xFF51AFD7ED558CCD);
+      uHash ^= uHash >> 33;
+
+      return (size_t)uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index into psNode->asEntries of the entry for hash bits
+uBit, which may or may not be present. */
+static unsigned int SymTable_indexOf(const struct TrieNode *psNode,
+                                     unsigned int uBit) {
+    assert(psNode != NULL);
+
+    return SymTable_popCount(psNode->uBitmap &
+                             (((uint32_t)1 << uBit) - 1));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes occupied by a node of uCount entries. */
+static size_t SymTable_nodeSize(size_t uCount) {
+    return offsetof(struct TrieNode, asEntries)
+           + (uCount > 0 ? uCount : 1) * sizeof(struct Entry);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new node of uCount entries that only its caller refers to,
+or NULL if insufficient memory is available. */
+static struct TrieNode *SymTable_newNode(size_t uCount) {
+    struct TrieNode *psNode;
+
+    psNode = (struct TrieNode*)malloc(SymTable_nodeSize(uCount));
+    if (psNode == NULL) return NULL;
+
+    psNode->uRefs = 1;
+    psNode->uBitmap = 0;
+    psNode->uCount = (uint32_t)uCount;
+    return psNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Drop one reference to psNode, freeing it and dropping its references
+to its keys and children if that was the last one. */
+static void SymTable_releaseNode(struct TrieNode *psNode) {
+    struct Entry *psEntry;
+    uint32_t i;
+
+    assert(psNode != NULL);
+
+    if (!SymTable_release(&psNode->uRefs)) return;
+
+    for (i = 0; i < psNode->uCount; i++) {
+        psEntry = &psNode->asEntries[i];
+        if (psEntry->psKey == NULL)
+            SymTable_releaseNode(psEntry->u.psChild);
+        else if (SymTable_release(&psEntry->psKey->uRefs))
+            free(psEntry->psKey);
+    }
+    free(psNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make the node at *ppsSlot one that may be changed in place, copying
+it if it is shared. Return that node, or NULL and leave *ppsSlot
+unchanged if insufficient memory is available. */
+static struct TrieNode *SymTable_own(struct TrieNode **ppsSlot) {
+    struct TrieNode *psNode;
+    struct TrieNode *psCopy;
+    uint32_t i;
+
+    assert(ppsSlot != NULL);
+    assert(*ppsSlot != NULL);
+
+    psNode = *ppsSlot;
+    if (!SymTable_isShared(&psNode->uRefs)) return psNode;
+
+    psCopy = SymTable_newNode(psNode->uCount);
+    if (psCopy == NULL) return NULL;
+
+    psCopy->uBitmap = psNode->uBitmap;
+    memcpy(psCopy->asEntries, psNode->asEntries,
+           psNode->uCount * sizeof(struct Entry));
+    for (i = 0; i < psCopy->uCount; i++) {
+        if (psCopy->asEntries[i].psKey == NULL)
+            SymTable_retain(&psCopy->asEntries[i].u.psChild->uRefs);
+        else SymTable_retain(&psCopy->asEntries[i].psKey->uRefs);
+    }
+
+    SymTable_releaseNode(psNode);
+    *ppsSlot = psCopy;
+    return psCopy;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Insert the entry *psEntry at index uIndex of the unshared node at
+*ppsSlot, setting bit uBit of its bitmap unless it is a collision node.
+Return 1 (TRUE) if successful, or 0 (FALSE) and leave the node
+unchanged if insufficient memory is available. */
+static int SymTable_insertEntry(struct TrieNode **ppsSlot,
+                                unsigned int uIndex, unsigned int uBit,
+                                int iIsCollision,
+                                const struct Entry *psEntry) {
+    struct TrieNode *psNode;
+
+    assert(ppsSlot != NULL);
+    assert(psEntry != NULL);
+
+    psNode = (struct TrieNode*)
+        realloc(*ppsSlot, SymTable_nodeSize((*ppsSlot)->uCount + 1));
+    if (psNode == NULL) return 0;
+    *ppsSlot = psNode;
+
+    memmove(&psNode->asEntries[uIndex + 1], &psNode->asEntries[uIndex],
+            (psNode->uCount - uIndex) * sizeof(struct Entry));
+    psNode->asEntries[uIndex] = *psEntry;
+    psNode->uCount++;
+    if (!iIsCollision) psNode->uBitmap |= (uint32_t)1 << uBit;
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Delete the entry at index uIndex of the unshared node psNode,
+clearing bit uBit of its bitmap unless it is a collision node. The
+node keeps its allocation. */
+static void SymTable_deleteEntry(struct TrieNode *psNode,
+                                 unsigned int uIndex, unsigned int uBit,
+                                 int iIsCollision) {
+    assert(psNode != NULL);
+    assert(uIndex < psNode->uCount);
+
+    memmove(&psNode->asEntries[uIndex], &psNode->asEntries[uIndex + 1],
+            (psNode->uCount - uIndex - 1) * sizeof(struct Entry));
+    psNode->uCount--;
+    if (!iIsCollision) psNode->uBitmap &= ~((uint32_t)1 << uBit);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new subtrie, rooted at a node of the level whose hash bits
+start at uShift, that holds the two bindings *psFirst and *psSecond.
+The bindings' key references move into the subtrie. Return NULL if
+insufficient memory is available. */
+static struct TrieNode *SymTable_pair(unsigned int uShift,
+                                      const struct Entry *psFirst,
+                                      const struct Entry *psSecond) {
+    struct TrieNode *psNode;
+    unsigned int uFirstBit;
+    unsigned int uSecondBit;
+
+    assert(psFirst != NULL);
+    assert(psSecond != NULL);
+
+    if (uShift >= HASH_BITS) {
+        psNode = SymTable_newNode(2);
+        if (psNode == NULL) return NULL;
+        psNode->asEntries[0] = *psFirst;
+        psNode->asEntries[1] = *psSecond;
+        return psNode;
+    }
+
+    uFirstBit = (unsigned int)(psFirst->psKey->uHash >> uShift)
+                & LEVEL_MASK;
+    uSecondBit = (unsigned int)(psSecond->psKey->uHash >> uShift)
+                 & LEVEL_MASK;
+
+    if (uFirstBit != uSecondBit) {
+        psNode = SymTable_newNode(2);
+        if (psNode == NULL) return NULL;
+        psNode->uBitmap = ((uint32_t)1 << uFirstBit)
+                          | ((uint32_t)1 << uSecondBit);
+        psNode->asEntries[uFirstBit < uSecondBit ? 0 : 1] = *psFirst;
+        psNode->asEntries[uFirstBit < uSecondBit ? 1 : 0] = *psSecond;
+        return psNode;
+    }
+
+    /* Both bindings need the same entry, so push them a level down */
+    psNode = SymTable_newNode(1);
+    if (psNode == NULL) return NULL;
+    psNode->uBitmap = (uint32_t)1 << uFirstBit;
+    psNode->asEntries[0].psKey = NULL;
+    psNode->asEntries[0].u.psChild =
+        SymTable_pair(uShift + BITS_PER_LEVEL, psFirst, psSecond);
+    if (psNode->asEntries[0].u.psChild == NULL) {
+        free(psNode);
+        return NULL;
+    }
+    return psNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the entry of oSymTable that binds pcKey, whose hash code is
+uHash, or NULL if no such binding exists. */
+static struct Entry *SymTable_find(SymTable_T oSymTable,
+                                   const char *pcKey, size_t uHash) {
+    struct TrieNode *psNode;
+    struct Entry *psEntry;
+    unsigned int uShift;
+    unsigned int uBit;
+    uint32_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psNode = oSymTable->psRoot;
+    for (uShift = 0; psNode != NULL; uShift += BITS_PER_LEVEL) {
+        if (uShift >= HASH_BITS) {
+            for (i = 0; i < psNode->uCount; i++) {
+                psEntry = &psNode->asEntries[i];
+                if (strcmp(psEntry->psKey->acChars, pcKey) == 0)
+                    return psEntry;
+            }
+            return NULL;
+        }
+
+        uBit = (unsigned int)(uHash >> uShift) & LEVEL_MASK;
+        if ((psNode->uBitmap & ((uint32_t)1 << uBit)) == 0) return NULL;
+        psEntry = &psNode->asEntries[SymTable_indexOf(psNode, uBit)];
+        if (psEntry->psKey == NULL) {
+            psNode = psEntry->u.psChild;
+            continue;
+        }
+        if (psEntry->psKey->uHash == uHash &&
+            strcmp(psEntry->psKey->acChars, pcKey) == 0)
+            return psEntry;
+        return NULL;
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make every node on the path from the root of oSymTable to the
+binding of pcKey, whose hash code is uHash, unshared. Store the address
+of each node's slot in ppsSlots[0..], and the index and hash bits of
+the entry followed at each node in auIndexes[0..] and auBits[0..].
+Return the number of nodes on the path, or 0 if insufficient memory is
+available. The binding must exist. */
+static unsigned int SymTable_ownPath(SymTable_T oSymTable,
+                                     const char *pcKey, size_t uHash,
+                                     struct TrieNode ***pppsSlots,
+                                     unsigned int *auIndexes,
+                                     unsigned int *auBits) {
+    struct TrieNode **ppsSlot;
+    struct TrieNode *psNode;
+    struct Entry *psEntry;
+    unsigned int uLevel;
+    unsigned int uShift;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    ppsSlot = &oSymTable->psRoot;
+    for (uLevel = 0, uShift = 0; ; uLevel++, uShift += BITS_PER_LEVEL) {
+        assert(uLevel < MAX_LEVELS);
+        psNode = SymTable_own(ppsSlot);
+        if (psNode == NULL) return 0;
+        pppsSlots[uLevel] = ppsSlot;
+
+        if (uShift >= HASH_BITS) {
+            auBits[uLevel] = 0;
+            for (auIndexes[uLevel] = 0;
+                 strcmp(psNode->asEntries[auIndexes[uLevel]].psKey
+                        ->acChars, pcKey) != 0;
+                 auIndexes[uLevel]++)
+                ;
+            return uLevel + 1;
+        }
+
+        auBits[uLevel] = (unsigned int)(uHash >> uShift) & LEVEL_MASK;
+        auIndexes[uLevel] = SymTable_indexOf(psNode, auBits[uLevel]);
+        psEntry = &psNode->asEntries[auIndexes[uLevel]];
+        if (psEntry->psKey != NULL) return uLevel + 1;
+        ppsSlot = &psEntry->u.psChild;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply *pfApply to each binding of the subtrie rooted at psNode,
+passing pvExtra as an extra parameter. */
+static void SymTable_mapNode(struct TrieNode *psNode,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    void *pvExtra) {
+    struct Entry *psEntry;
+    uint32_t i;
+
+    assert(psNode != NULL);
+    assert(pfApply != NULL);
+
+    for (i = 0; i < psNode->uCount; i++) {
+        psEntry = &psNode->asEntries[i];
+        if (psEntry->psKey == NULL)
+            SymTable_mapNode(psEntry->u.psChild, pfApply, pvExtra);
+        else (*pfApply)(psEntry->psKey->acChars,
+                        (void*)psEntry->u.pvValue, pvExtra);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+    SymTable_T oSymTable;
+
+    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+    if (oSymTable == NULL) return NULL;
+
+    oSymTable->psRoot = NULL;
+    oSymTable->length = 0;
+
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_snapshot(SymTable_T oSymTable) {
+    SymTable_T oSnapshot;
+
+    assert(oSymTable != NULL);
+
+    oSnapshot = SymTable_new();
+    if (oSnapshot == NULL) return NULL;
+
+    /* Share the whole trie */
+    if (oSymTable->psRoot != NULL)
+        SymTable_retain(&oSymTable->psRoot->uRefs);
+    oSnapshot->psRoot = oSymTable->psRoot;
+    oSnapshot->length = oSymTable->length;
+
+    return oSnapshot;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    if (oSymTable->psRoot != NULL) SymTable_releaseNode(oSymTable->psRoot);
+    free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    return oSymTable->length;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+                 const char *pcKey,
+                 const void *pvValue) {
+    struct TrieNode **ppsSlot;
+    struct TrieNode *psNode;
+    struct TrieNode *psChild;
+    struct Entry sNew;
+    struct Entry *psEntry;
+    size_t uHash;
+    size_t uLength;
+    unsigned int uShift;
+    unsigned int uBit;
+    unsigned int uIndex;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* Check if oSymTable already contains pcKey */
+    uHash = SymTable_hash(pcKey);
+    if (SymTable_find(oSymTable, pcKey, uHash) != NULL) return 0;
+
+    /* Create a defensive copy of the string to which pcKey points */
+    uLength = strlen(pcKey);
+    sNew.psKey = (struct Key*)
+        malloc(offsetof(struct Key, acChars) + uLength + 1);
+    if (sNew.psKey == NULL) return 0;
+    sNew.psKey->uRefs = 1;
+    sNew.psKey->uHash = uHash;
+    memcpy(sNew.psKey->acChars, pcKey, uLength + 1);
+    sNew.u.pvValue = pvValue;
+
+    if (oSymTable->psRoot == NULL) {
+        oSymTable->psRoot = SymTable_newNode(0);
+        if (oSymTable->psRoot == NULL) {
+            free(sNew.psKey);
+            return 0;
+        }
+    }
+
+    /* Copy the shared nodes on the way down to where the key goes */
+    ppsSlot = &oSymTable->psRoot;
+    for (uShift = 0; ; uShift += BITS_PER_LEVEL) {
+        psNode = SymTable_own(ppsSlot);
+        if (psNode == NULL) break;
+
+        if (uShift >= HASH_BITS) {
+            if (!SymTable_insertEntry(ppsSlot, psNode->uCount, 0, 1,
+                                      &sNew))
+                break;
+            oSymTable->length++;
+            return 1;
+        }
+
+        uBit = (unsigned int)(uHash >> uShift) & LEVEL_MASK;
+        uIndex = SymTable_indexOf(psNode, uBit);
+        if ((psNode->uBitmap & ((uint32_t)1 << uBit)) == 0) {
+            if (!SymTable_insertEntry(ppsSlot, uIndex, uBit, 0, &sNew))
+                break;
+            oSymTable->length++;
+            return 1;
+        }
+
+        psEntry = &psNode->asEntries[uIndex];
+        if (psEntry->psKey != NULL) {
+            /* Replace the binding there with a subtrie of both */
+            psChild = SymTable_pair(uShift + BITS_PER_LEVEL, psEntry,
+                                    &sNew);
+            if (psChild == NULL) break;
+            psEntry->psKey = NULL;
+            psEntry->u.psChild = psChild;
+            oSymTable->length++;
+            return 1;
+        }
+        ppsSlot = &psEntry->u.psChild;
+    }
+
+    /* Any nodes copied so far hold the same bindings as before */
+    free(sNew.psKey);
+    if (oSymTable->psRoot->uCount == 0) {
+        free(oSymTable->psRoot);
+        oSymTable->psRoot = NULL;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+                       const char *pcKey,
+                       const void *pvValue) {
+    struct TrieNode **apsSlots[MAX_LEVELS];
+    unsigned int auIndexes[MAX_LEVELS];
+    unsigned int auBits[MAX_LEVELS];
+    struct Entry *psEntry;
+    unsigned int uDepth;
+    size_t uHash;
+    void *oldValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    psEntry = SymTable_find(oSymTable, pcKey, uHash);
+    if (psEntry == NULL) return NULL;
+    oldValue = (void*)psEntry->u.pvValue;
+
+    /* The binding's node may be shared, so make it unshared first */
+    uDepth = SymTable_ownPath(oSymTable, pcKey, uHash, apsSlots,
+                              auIndexes, auBits);
+    if (uDepth == 0) return NULL;
+
+    psEntry = &(*apsSlots[uDepth - 1])->asEntries[auIndexes[uDepth - 1]];
+    psEntry->u.pvValue = pvValue;
+    return oldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey)) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    struct Entry *psEntry;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psEntry = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if (psEntry == NULL) return NULL;
+
+    return (void*)psEntry->u.pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    struct TrieNode **apsSlots[MAX_LEVELS];
+    unsigned int auIndexes[MAX_LEVELS];
+    unsigned int auBits[MAX_LEVELS];
+    struct TrieNode *psNode;
+    struct Entry *psEntry;
+    unsigned int uLevel;
+    size_t uHash;
+    void *value;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    if (SymTable_find(oSymTable, pcKey, uHash) == NULL) return NULL;
+
+    uLevel = SymTable_ownPath(oSymTable, pcKey, uHash, apsSlots,
+                              auIndexes, auBits);
+    if (uLevel == 0) return NULL;
+    uLevel--;
+
+    /* Remove the binding and drop this table's reference to its key */
+    psNode = *apsSlots[uLevel];
+    psEntry = &psNode->asEntries[auIndexes[uLevel]];
+    value = (void*)psEntry->u.pvValue;
+    if (SymTable_release(&psEntry->psKey->uRefs)) free(psEntry->psKey);
+    SymTable_deleteEntry(psNode, auIndexes[uLevel], auBits[uLevel],
+                         uLevel * BITS_PER_LEVEL >= HASH_BITS);
+
+    /* Remove emptied nodes, and pull lone bindings up a level */
+    for (; uLevel > 0; uLevel--) {
+        psNode = *apsSlots[uLevel];
+        if (psNode->uCount == 0) {
+            free(psNode);
+            SymTable_deleteEntry(*apsSlots[uLevel - 1],
+                                 auIndexes[uLevel - 1],
+                                 auBits[uLevel - 1],
+                                 (uLevel - 1) * BITS_PER_LEVEL
+                                 >= HASH_BITS);
+            continue;
+        }
+        if (psNode->uCount == 1 && psNode->asEntries[0].psKey != NULL) {
+            (*apsSlots[uLevel - 1])->asEntries[auIndexes[uLevel - 1]] =
+                psNode->asEntries[0];
+            free(psNode);
+            continue;
+        }
+        break;
+    }
+
+    if (oSymTable->psRoot->uCount == 0) {
+        free(oSymTable->psRoot);
+        oSymTable->psRoot = NULL;
+    }
+
+    oSymTable->length--;
+
+    return value;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    if (oSymTable->psRoot != NULL)
+        SymTable_mapNode(oSymTable->psRoot, pfApply, (void*)pvExtra);
+}
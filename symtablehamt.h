@@ -0,0 +1,31 @@
+/*--------------------------------------------------------------------*/
+/* symtablehamt.h                                                     */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEHAMT_INCLUDED
+#define SYMTABLEHAMT_INCLUDED
+
+#include "symtable.h"
+
+/* Snapshots provided by the persistent hash array mapped trie
+implementation of the SymTable ADT (symtablehamt.c). A table and its
+snapshots share their trie nodes and keys until one of them changes.
+A change then copies only the nodes on the path to the changed binding,
+O(log n) of them, so neither side ever sees the other's changes.
+
+A SymTable object must not be used by two threads at once, but a table
+and its snapshots may be used by different threads. SymTable_put and
+SymTable_remove can run out of memory whenever they change a path that
+is still shared, in which case they leave the table unchanged and
+return 0 (FALSE) and NULL respectively. */
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new SymTable object that holds the same bindings as
+oSymTable and is independent of it from then on, or NULL if
+insufficient memory is available. Takes O(1) time. The snapshot must
+be freed with SymTable_free like any other SymTable object. */
+  SymTable_T SymTable_snapshot(SymTable_T oSymTable);
+
+#endif
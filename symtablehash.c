@@ -4,53 +4,1248 @@
 /*--------------------------------------------------------------------*/
 
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include "symtable.h"
+#include "keyops.h"
+#include "symtablehash.h"
 
 /*--------------------------------------------------------------------*/
 
-/* Each binding is stored in a node. Nodes are linked to form a list. */
+/* Each binding is stored in a node. Nodes are linked to form a list.
+The fields that walking a chain reads come first. */
 
 struct Node {
+    /* The address of the next node */
+    struct Node *psNextNode;
+
+    /* The hash code of the key, so that chains can be walked and
+    rehashed without reading keys */
+    size_t uHash;
+
     /* The identifying key */
     char *pcKey;
 
-    /* The associated data */
-    const void *pvValue;
+    /* The associated data */
+    const void *pvValue;
+};
+
+/* The node of a binding of a table that evicts (see
+SymTable_Options), which is also on the table's recency list. */
+
+struct CacheNode {
+    /* The node proper, first so that the two may be converted */
+    struct Node sNode;
+    /* The node used just before this one, or NULL if it is the least
+    recently used */
+    struct CacheNode *psOlder;
+    /* The node used just after this one, or NULL if it is the most
+    recently used */
+    struct CacheNode *psNewer;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The number of nodes of a chain whose tags its bucket holds */
+
+enum {BUCKET_TAGS = 7};
+
+/* A bucket heads a chain of nodes and describes its first few, so
+that most lookups of absent keys are settled by the bucket array
+alone, without touching a node or a key. */
+
+struct Bucket {
+    /* The address of the first node of the chain */
+    struct Node *psFirstNode;
+    /* The tags (see SymTable_tagOf) of the first BUCKET_TAGS nodes of
+    the chain, in chain order */
+    unsigned char aucTags[BUCKET_TAGS];
+    /* The number of nodes in the chain, or UCHAR_MAX if it is at least
+    UCHAR_MAX */
+    unsigned char ucLength;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The kinds of change that an undo log records */
+
+enum UndoKind {UNDO_PUT, UNDO_REPLACE, UNDO_REMOVE};
+
+/* An entry of the undo log of a transaction, which says how to reverse
+one change. */
+
+struct Undo {
+    /* The kind of change */
+    enum UndoKind eKind;
+    /* The node that was put, replaced or removed. A removed node stays
+    allocated, with its key, until the transaction ends. */
+    struct Node *psNode;
+    /* The value that a replace overwrote */
+    const void *pvOldValue;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable is a "dummy" node that points to the first node. */
+
+struct SymTable {
+    /* A pointer to an array of many buckets */
+    struct Bucket *psBuckets;
+    /* The number of buckets pointed to */
+    size_t bucketCount;
+    /* The number of bindings stored */
+    size_t length;
+    /* The pool in which keys are interned, or NULL if each node owns a
+    copy of its key or borrows the caller's */
+    KeyPool_T oKeyPool;
+    /* The choices made when the table was created */
+    struct SymTable_Options sOptions;
+    /* The number of bytes the table holds allocated, including its
+    own */
+    size_t uBytes;
+    /* The undo log of the open transaction, or NULL if none is open */
+    struct Undo *psUndos;
+    /* The number of entries for which psUndos has room */
+    size_t uUndoCapacity;
+    /* The number of entries of psUndos in use */
+    size_t uUndoCount;
+    /* The value of uSequence when the open transaction began */
+    size_t uUndoSequence;
+    /* The number of changes made since the table was created */
+    size_t uSequence;
+    /* The change log, which holds the records (see
+    SymTable_exportChanges) of changes uLogBase + 1 through uSequence,
+    or NULL if the table keeps no log or has logged nothing */
+    unsigned char *pucLog;
+    /* The number of bytes of pucLog in use, and for which it has room */
+    size_t uLogSize;
+    size_t uLogCapacity;
+    /* The offset within pucLog of the record of each change, and the
+    number of offsets for which puLogOffsets has room */
+    size_t *puLogOffsets;
+    size_t uLogOffsetCapacity;
+    /* The number of the last change whose record was trimmed */
+    size_t uLogBase;
+    /* The blocked Bloom filter of the keys (see SymTable_buildFilter),
+    or NULL if the table keeps none */
+    uint64_t *puFilter;
+    /* The number of blocks of puFilter */
+    size_t uFilterBlocks;
+    /* The number of keys removed since puFilter was built, whose bits
+    it still sets */
+    size_t uFilterStale;
+    /* The least and the most recently used nodes of a table that
+    evicts, or NULL if it is empty or does not evict */
+    struct CacheNode *psOldest;
+    struct CacheNode *psNewest;
+    /* The numbers of lookups of a table that evicts that found their
+    keys and that did not, and of the bindings it has evicted */
+    size_t uHits;
+    size_t uMisses;
+    size_t uEvictions;
+    /* The tables created just before and just after this one that
+    still exist, or NULL if there are none */
+    SymTable_T oPrevTable;
+    SymTable_T oNextTable;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The most recently created table that still exists, or NULL if none
+does, and the lock that guards the list of tables it heads. The list
+is changed only when a table is created or freed, and read only by
+SymTable_getTotalBytes, so puts and removes never share it. */
+
+static SymTable_T oLastTable = NULL;
+static pthread_mutex_t sTablesLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*--------------------------------------------------------------------*/
+
+/* The bucket counts through which a table grows, each a prime near a
+power of 2. A table expands to the next count when its length reaches
+its bucket count. */
+
+static const size_t auBucketCounts[] = {
+    509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071, 262139,
+    524287, 1048573, 2097143, 4194301, 8388593, 16777213, 33554393,
+    67108859, 134217689, 268435399, 536870909, 1073741789, 2147483647
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the smallest bucket count in auBucketCounts that is at least
+uMinimum, or the largest one if none is. */
+static size_t SymTable_bucketCountFor(size_t uMinimum) {
+    size_t u;
+
+    for (u = 0; u < sizeof(auBucketCounts) / sizeof(auBucketCounts[0]);
+         u++)
+        if (auBucketCounts[u] >= uMinimum) return auBucketCounts[u];
+
+    return auBucketCounts[u - 1];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the tag of a key whose hash code is uHash: 8 of its bits,
+mixed so that they do not follow the key's bucket index. */
+static unsigned char SymTable_tagOf(size_t uHash) {
+    return (unsigned char)
+        ((uHash * (size_t)UINT64_C(0x9E3779B97F4A7C15))
+         >> (sizeof(size_t) * CHAR_BIT - 8));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 0 (FALSE) if the tags of psBucket show that no node of its
+chain has tag ucTag, and 1 (TRUE) otherwise. */
+static int SymTable_mayHold(const struct Bucket *psBucket,
+                            unsigned char ucTag) {
+    size_t u;
+
+    assert(psBucket != NULL);
+
+    if (psBucket->ucLength > BUCKET_TAGS) return 1;
+    for (u = 0; u < psBucket->ucLength; u++)
+        if (psBucket->aucTags[u] == ucTag) return 1;
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make psNode the first node of the chain of psBucket. */
+static void SymTable_linkFirst(struct Bucket *psBucket,
+                               struct Node *psNode) {
+    assert(psBucket != NULL);
+    assert(psNode != NULL);
+
+    psNode->psNextNode = psBucket->psFirstNode;
+    psBucket->psFirstNode = psNode;
+    memmove(&psBucket->aucTags[1], &psBucket->aucTags[0],
+            BUCKET_TAGS - 1);
+    psBucket->aucTags[0] = SymTable_tagOf(psNode->uHash);
+    if (psBucket->ucLength < UCHAR_MAX) psBucket->ucLength++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove psNode from the chain of psBucket, in which it follows
+psPrevNode, or is first if psPrevNode is NULL. A chain length that
+reached UCHAR_MAX stays there until the table expands. */
+static void SymTable_unlink(struct Bucket *psBucket,
+                            struct Node *psNode,
+                            struct Node *psPrevNode) {
+    struct Node *psCurrentNode;
+    size_t u;
+
+    assert(psBucket != NULL);
+    assert(psNode != NULL);
+
+    if (psPrevNode == NULL) psBucket->psFirstNode = psNode->psNextNode;
+    else psPrevNode->psNextNode = psNode->psNextNode;
+    if (psBucket->ucLength < UCHAR_MAX) psBucket->ucLength--;
+
+    /* Retag the nodes that moved up */
+    for (psCurrentNode = psBucket->psFirstNode, u = 0;
+         psCurrentNode != NULL && u < BUCKET_TAGS;
+         psCurrentNode = psCurrentNode->psNextNode, u++)
+        psBucket->aucTags[u] = SymTable_tagOf(psCurrentNode->uHash);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count uSize more bytes as held by oSymTable and return 1 (TRUE), or
+return 0 (FALSE) and count nothing if that would take oSymTable past
+its limit. Threads of SymTable_newBulk may call it at once. */
+static int SymTable_charge(SymTable_T oSymTable, size_t uSize) {
+    size_t uLimit;
+    size_t uBytes;
+
+    assert(oSymTable != NULL);
+
+    uLimit = oSymTable->sOptions.uMaxBytes;
+#ifdef __GNUC__
+    uBytes = __atomic_load_n(&oSymTable->uBytes, __ATOMIC_RELAXED);
+    do {
+        if (uLimit != 0 && uSize > uLimit - uBytes) return 0;
+    } while (!__atomic_compare_exchange_n(&oSymTable->uBytes, &uBytes,
+                                          uBytes + uSize, 1,
+                                          __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+#else
+    uBytes = oSymTable->uBytes;
+    if (uLimit != 0 && uSize > uLimit - uBytes) return 0;
+    oSymTable->uBytes = uBytes + uSize;
+#endif
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count uSize fewer bytes as held by oSymTable. */
+static void SymTable_credit(SymTable_T oSymTable, size_t uSize) {
+    assert(oSymTable != NULL);
+
+#ifdef __GNUC__
+    (void)__atomic_sub_fetch(&oSymTable->uBytes, uSize,
+                             __ATOMIC_RELAXED);
+#else
+    oSymTable->uBytes -= uSize;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count uSize more bytes as held by oSymTable, whatever its limit. */
+static void SymTable_recharge(SymTable_T oSymTable, size_t uSize) {
+    assert(oSymTable != NULL);
+
+#ifdef __GNUC__
+    (void)__atomic_add_fetch(&oSymTable->uBytes, uSize,
+                             __ATOMIC_RELAXED);
+#else
+    oSymTable->uBytes += uSize;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a block of uSize bytes from the allocator of *psOptions, or
+NULL if insufficient memory is available. */
+static void *SymTable_allocate(const struct SymTable_Options *psOptions,
+                               size_t uSize) {
+    assert(psOptions != NULL);
+
+    if (psOptions->pfMalloc != NULL)
+        return (*psOptions->pfMalloc)(uSize, psOptions->pvAllocator);
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return pv, a block of uSize bytes from SymTable_allocate, to the
+allocator of *psOptions. */
+static void SymTable_deallocate(
+    const struct SymTable_Options *psOptions, void *pv, size_t uSize) {
+    assert(psOptions != NULL);
+    assert(pv != NULL);
+
+    if (psOptions->pfFree != NULL)
+        (*psOptions->pfFree)(pv, uSize, psOptions->pvAllocator);
+    else free(pv);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a block of uSize bytes for oSymTable, counted against its
+limit, or NULL if the limit or the memory is exhausted. */
+static void *SymTable_alloc(SymTable_T oSymTable, size_t uSize) {
+    void *pv;
+
+    assert(oSymTable != NULL);
+
+    if (!SymTable_charge(oSymTable, uSize)) return NULL;
+    pv = SymTable_allocate(&oSymTable->sOptions, uSize);
+    if (pv == NULL) SymTable_credit(oSymTable, uSize);
+
+    return pv;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pv, a block of uSize bytes from SymTable_alloc for
+oSymTable. */
+static void SymTable_release(SymTable_T oSymTable, void *pv,
+                             size_t uSize) {
+    assert(oSymTable != NULL);
+    assert(pv != NULL);
+
+    SymTable_deallocate(&oSymTable->sOptions, pv, uSize);
+    SymTable_credit(oSymTable, uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add oSymTable to the list of tables that exist. */
+static void SymTable_enlist(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    pthread_mutex_lock(&sTablesLock);
+    oSymTable->oPrevTable = oLastTable;
+    oSymTable->oNextTable = NULL;
+    if (oLastTable != NULL) oLastTable->oNextTable = oSymTable;
+    oLastTable = oSymTable;
+    pthread_mutex_unlock(&sTablesLock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove oSymTable from the list of tables that exist. */
+static void SymTable_delist(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    pthread_mutex_lock(&sTablesLock);
+    if (oSymTable->oPrevTable != NULL)
+        oSymTable->oPrevTable->oNextTable = oSymTable->oNextTable;
+    if (oSymTable->oNextTable != NULL)
+        oSymTable->oNextTable->oPrevTable = oSymTable->oPrevTable;
+    else oLastTable = oSymTable->oPrevTable;
+    pthread_mutex_unlock(&sTablesLock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free oSymTable itself, which holds no other memory. */
+static void SymTable_destroy(SymTable_T oSymTable) {
+    struct SymTable_Options sOptions;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->uBytes == sizeof(struct SymTable));
+
+    /* The allocator outlives the memory it is given back */
+    sOptions = oSymTable->sOptions;
+    SymTable_credit(oSymTable, sizeof(struct SymTable));
+    SymTable_deallocate(&sOptions, oSymTable, sizeof(struct SymTable));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new array of uBucketCount empty buckets for oSymTable, or
+NULL if its limit or the memory is exhausted. */
+static struct Bucket *SymTable_newBuckets(SymTable_T oSymTable,
+                                          size_t uBucketCount) {
+    struct Bucket *psBuckets;
+    size_t i;
+
+    assert(oSymTable != NULL);
+
+    psBuckets = (struct Bucket*)
+        SymTable_alloc(oSymTable, uBucketCount * sizeof(struct Bucket));
+    if (psBuckets == NULL) return NULL;
+
+    for (i = 0; i < uBucketCount; i++) {
+        psBuckets[i].psFirstNode = NULL;
+        memset(psBuckets[i].aucTags, 0, BUCKET_TAGS);
+        psBuckets[i].ucLength = 0;
+    }
+
+    return psBuckets;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The number of 64-bit words of a block of the filter, one cache line,
+and the most bits that a key sets in its block */
+
+enum {FILTER_BLOCK_WORDS = 8, FILTER_MAX_PROBES = 7};
+
+/* Return the number of bits that a key sets in the filter of
+oSymTable: about 0.7 per bit per key, which makes false positives
+rarest. */
+static size_t SymTable_filterProbes(SymTable_T oSymTable) {
+    size_t uProbes;
+
+    assert(oSymTable != NULL);
+
+    uProbes = oSymTable->sOptions.uFilterBitsPerKey * 7 / 10;
+    if (uProbes < 1) uProbes = 1;
+    if (uProbes > FILTER_MAX_PROBES) uProbes = FILTER_MAX_PROBES;
+    return uProbes;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of the block of the uBlockCount blocks at
+puFilter in which the bits of a key whose hash code is uHash lie, and
+store in *puProbes the bits from which their positions are drawn. */
+static uint64_t *SymTable_filterBlock(uint64_t *puFilter,
+                                      size_t uBlockCount,
+                                      size_t uHash,
+                                      uint64_t *puProbes) {
+    uint64_t uMixed;
+
+    assert(puFilter != NULL);
+    assert(puProbes != NULL);
+
+    /* The block and the bits come from independent mixes, neither of
+    which follows the key's bucket index */
+    uMixed = (uint64_t)uHash * UINT64_C(0x9E3779B97F4A7C15);
+    *puProbes = (uint64_t)uHash * UINT64_C(0xC2B2AE3D27D4EB4F);
+    *puProbes ^= *puProbes >> 29;
+    return &puFilter[((uMixed >> 32) % uBlockCount)
+                     * FILTER_BLOCK_WORDS];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Set the bits of a key whose hash code is uHash in the uBlockCount
+blocks of filter at puFilter, of a table whose keys set uProbes bits
+each. */
+static void SymTable_filterAdd(uint64_t *puFilter, size_t uBlockCount,
+                               size_t uProbes, size_t uHash) {
+    uint64_t *puBlock;
+    uint64_t uBits;
+    size_t u;
+
+    assert(puFilter != NULL);
+
+    puBlock = SymTable_filterBlock(puFilter, uBlockCount, uHash, &uBits);
+    for (u = 0; u < uProbes; u++) {
+        puBlock[(uBits >> 6) & (FILTER_BLOCK_WORDS - 1)] |=
+            (uint64_t)1 << (uBits & 63);
+        uBits >>= 9;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 0 (FALSE) if the filter of oSymTable shows that it holds no
+key whose hash code is uHash, and 1 (TRUE) if it may, or it has no
+filter. */
+static int SymTable_filterMayHold(SymTable_T oSymTable, size_t uHash) {
+    const uint64_t *puBlock;
+    uint64_t uBits;
+    size_t uProbes;
+    size_t u;
+
+    assert(oSymTable != NULL);
+
+    if (oSymTable->puFilter == NULL) return 1;
+
+    puBlock = SymTable_filterBlock(oSymTable->puFilter,
+                                   oSymTable->uFilterBlocks, uHash,
+                                   &uBits);
+    uProbes = SymTable_filterProbes(oSymTable);
+    for (u = 0; u < uProbes; u++) {
+        if ((puBlock[(uBits >> 6) & (FILTER_BLOCK_WORDS - 1)]
+             & ((uint64_t)1 << (uBits & 63))) == 0)
+            return 0;
+        uBits >>= 9;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Release the filter of oSymTable, if it has one, so that it has
+none. */
+static void SymTable_dropFilter(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    if (oSymTable->puFilter != NULL)
+        SymTable_release(oSymTable, oSymTable->puFilter,
+                         oSymTable->uFilterBlocks * FILTER_BLOCK_WORDS
+                         * sizeof(uint64_t));
+    oSymTable->puFilter = NULL;
+    oSymTable->uFilterBlocks = 0;
+    oSymTable->uFilterStale = 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Replace the filter of oSymTable, if it keeps one, with one sized for
+its bucket count that holds every key of the table, and of the nodes
+that its open transaction removed but may yet link again. Return 1
+(TRUE) on success, and 0 (FALSE), keeping the old filter, if the limit
+or the memory of the table is exhausted. */
+static int SymTable_buildFilter(SymTable_T oSymTable) {
+    uint64_t *puFilter;
+    struct Node *psCurrentNode;
+    size_t uBlockCount;
+    size_t uProbes;
+    size_t u;
+
+    assert(oSymTable != NULL);
+
+    if (oSymTable->sOptions.uFilterBitsPerKey == 0) return 1;
+
+    uBlockCount = (oSymTable->bucketCount
+                   * oSymTable->sOptions.uFilterBitsPerKey
+                   + FILTER_BLOCK_WORDS * 64 - 1)
+        / (FILTER_BLOCK_WORDS * 64);
+    puFilter = (uint64_t*)SymTable_alloc(oSymTable,
+        uBlockCount * FILTER_BLOCK_WORDS * sizeof(uint64_t));
+    if (puFilter == NULL) return 0;
+    memset(puFilter, 0,
+           uBlockCount * FILTER_BLOCK_WORDS * sizeof(uint64_t));
+
+    uProbes = SymTable_filterProbes(oSymTable);
+    for (u = 0; u < oSymTable->bucketCount; u++)
+        for (psCurrentNode = oSymTable->psBuckets[u].psFirstNode;
+             psCurrentNode != NULL;
+             psCurrentNode = psCurrentNode->psNextNode)
+            SymTable_filterAdd(puFilter, uBlockCount, uProbes,
+                               psCurrentNode->uHash);
+    for (u = 0; u < oSymTable->uUndoCount; u++)
+        if (oSymTable->psUndos[u].eKind == UNDO_REMOVE)
+            SymTable_filterAdd(puFilter, uBlockCount, uProbes,
+                               oSymTable->psUndos[u].psNode->uHash);
+
+    SymTable_dropFilter(oSymTable);
+    oSymTable->puFilter = puFilter;
+    oSymTable->uFilterBlocks = uBlockCount;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of a node of oSymTable. */
+static size_t SymTable_nodeSize(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    return oSymTable->sOptions.iEvict ? sizeof(struct CacheNode)
+                                      : sizeof(struct Node);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make psNode, which is not on the recency list of oSymTable, its most
+recently used node, if the table evicts. */
+static void SymTable_addRecent(SymTable_T oSymTable,
+                               struct Node *psNode) {
+    struct CacheNode *psCacheNode = (struct CacheNode*)psNode;
+
+    assert(oSymTable != NULL);
+    assert(psNode != NULL);
+
+    if (!oSymTable->sOptions.iEvict) return;
+
+    psCacheNode->psOlder = oSymTable->psNewest;
+    psCacheNode->psNewer = NULL;
+    if (oSymTable->psNewest != NULL)
+        oSymTable->psNewest->psNewer = psCacheNode;
+    else oSymTable->psOldest = psCacheNode;
+    oSymTable->psNewest = psCacheNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Take psNode off the recency list of oSymTable, if the table
+evicts. */
+static void SymTable_forget(SymTable_T oSymTable, struct Node *psNode) {
+    struct CacheNode *psCacheNode = (struct CacheNode*)psNode;
+
+    assert(oSymTable != NULL);
+    assert(psNode != NULL);
+
+    if (!oSymTable->sOptions.iEvict) return;
+
+    if (psCacheNode->psOlder != NULL)
+        psCacheNode->psOlder->psNewer = psCacheNode->psNewer;
+    else oSymTable->psOldest = psCacheNode->psNewer;
+    if (psCacheNode->psNewer != NULL)
+        psCacheNode->psNewer->psOlder = psCacheNode->psOlder;
+    else oSymTable->psNewest = psCacheNode->psOlder;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make psNode of oSymTable the most recently used, if the table
+evicts. */
+static void SymTable_refresh(SymTable_T oSymTable, struct Node *psNode) {
+    assert(oSymTable != NULL);
+    assert(psNode != NULL);
+
+    if (oSymTable->sOptions.iEvict &&
+        (struct CacheNode*)psNode != oSymTable->psNewest) {
+        SymTable_forget(oSymTable, psNode);
+        SymTable_addRecent(oSymTable, psNode);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count a lookup of oSymTable as a hit that found psNode, or as a miss
+if psNode is NULL, and make psNode the most recently used, if the
+table evicts. */
+static void SymTable_touch(SymTable_T oSymTable, struct Node *psNode) {
+    assert(oSymTable != NULL);
+
+    if (!oSymTable->sOptions.iEvict) return;
+
+    if (psNode == NULL) {
+        oSymTable->uMisses++;
+        return;
+    }
+    oSymTable->uHits++;
+    SymTable_refresh(oSymTable, psNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the node of oSymTable, which interns its keys, whose key is
+pcInternedKey, comparing key addresses only. Store the node's bucket
+index in *pi and the address of the node before it in that bucket, or
+NULL if it is first, in *ppsPrevNode. Return NULL if no such node
+exists. */
+static struct Node *SymTable_findInterned(SymTable_T oSymTable,
+                                          const char *pcInternedKey,
+                                          size_t *pi,
+                                          struct Node **ppsPrevNode) {
+    struct Node *psCurrentNode;
+    size_t uHash;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->oKeyPool != NULL);
+    assert(pcInternedKey != NULL);
+    assert(pi != NULL);
+    assert(ppsPrevNode != NULL);
+
+    uHash = KeyPool_getHash(pcInternedKey);
+    *pi = uHash % oSymTable->bucketCount;
+    *ppsPrevNode = NULL;
+    if (!SymTable_mayHold(&oSymTable->psBuckets[*pi],
+                          SymTable_tagOf(uHash)))
+        return NULL;
+    for (psCurrentNode = oSymTable->psBuckets[*pi].psFirstNode;
+         psCurrentNode != NULL;
+         psCurrentNode = psCurrentNode->psNextNode) {
+        if (psCurrentNode->pcKey == pcInternedKey) return psCurrentNode;
+        *ppsPrevNode = psCurrentNode;
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the node of oSymTable whose key is pcKey. Store the node's
+bucket index in *pi and the address of the node before it in that
+bucket, or NULL if it is first, in *ppsPrevNode. Return NULL if no
+such node exists. */
+static struct Node *SymTable_find(SymTable_T oSymTable,
+                                  const char *pcKey, size_t *pi,
+                                  struct Node **ppsPrevNode) {
+    struct Node *psCurrentNode;
+    size_t uHash;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(pi != NULL);
+    assert(ppsPrevNode != NULL);
+
+    /* A key that was never interned cannot be in the table */
+    if (oSymTable->oKeyPool != NULL) {
+        pcKey = KeyPool_find(oSymTable->oKeyPool, pcKey);
+        if (pcKey == NULL) return NULL;
+        return SymTable_findInterned(oSymTable, pcKey, pi, ppsPrevNode);
+    }
+
+    /* Hash the key */
+    uHash = KeyOps_hash(pcKey);
+    *pi = uHash % oSymTable->bucketCount;
+
+    /* Check the corresponding bucket for the key, reading the keys of
+    only the nodes whose hash codes match */
+    *ppsPrevNode = NULL;
+    if (!SymTable_filterMayHold(oSymTable, uHash) ||
+        !SymTable_mayHold(&oSymTable->psBuckets[*pi],
+                          SymTable_tagOf(uHash)))
+        return NULL;
+    for (psCurrentNode = oSymTable->psBuckets[*pi].psFirstNode;
+         psCurrentNode != NULL;
+         psCurrentNode = psCurrentNode->psNextNode) {
+        if (psCurrentNode->uHash == uHash &&
+            KeyOps_equals(psCurrentNode->pcKey, pcKey))
+            return psCurrentNode;
+        *ppsPrevNode = psCurrentNode;
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Release pcKey, the key of a binding of oSymTable that is going away,
+in whatever way the table's key ownership requires. */
+static void SymTable_releaseKey(SymTable_T oSymTable, char *pcKey) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    if (oSymTable->oKeyPool != NULL) return;
+    if (!oSymTable->sOptions.iBorrowKeys)
+        SymTable_release(oSymTable, pcKey, strlen(pcKey) + 1);
+    else if (oSymTable->sOptions.pfFreeKey != NULL)
+        (*oSymTable->sOptions.pfFreeKey)(pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if oSymTable may make another change: it has no
+open transaction, or the undo log of its transaction has room for one
+more entry. Return 0 (FALSE) otherwise. */
+static int SymTable_canChange(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    return oSymTable->psUndos == NULL ||
+        oSymTable->uUndoCount < oSymTable->uUndoCapacity;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* If oSymTable has an open transaction, record in its undo log that
+psNode was changed as eKind says, overwriting pvOldValue. */
+static void SymTable_logChange(SymTable_T oSymTable,
+                               enum UndoKind eKind,
+                               struct Node *psNode,
+                               const void *pvOldValue) {
+    struct Undo *psUndo;
+
+    assert(oSymTable != NULL);
+    assert(psNode != NULL);
+
+    if (oSymTable->psUndos == NULL) return;
+    assert(oSymTable->uUndoCount < oSymTable->uUndoCapacity);
+
+    psUndo = &oSymTable->psUndos[oSymTable->uUndoCount++];
+    psUndo->eKind = eKind;
+    psUndo->psNode = psNode;
+    psUndo->pvOldValue = pvOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The kinds of record in a change log, numbered as in a delta */
+
+enum RecordKind {RECORD_PUT = 1, RECORD_REPLACE = 2, RECORD_REMOVE = 3};
+
+/* The kinds of delta, and the number of bytes of a delta's header */
+
+enum {DELTA_CHANGES = 0, DELTA_SNAPSHOT = 1, DELTA_HEADER_SIZE = 21};
+
+/* The most bytes that the key or the value of a record may have */
+
+#define MAX_RECORD_FIELD ((size_t)UINT32_C(0xFFFFFFFF))
+
+/* The first bytes of every delta */
+
+static const unsigned char aucDeltaMagic[4] = {'S', 'y', 'm', 'D'};
+
+/*--------------------------------------------------------------------*/
+
+/* Store uValue at pucBytes in uCount bytes, least significant
+first. */
+static void SymTable_storeBytes(unsigned char *pucBytes,
+                                uint64_t uValue, size_t uCount) {
+    size_t u;
+
+    assert(pucBytes != NULL);
+
+    for (u = 0; u < uCount; u++) {
+        pucBytes[u] = (unsigned char)(uValue & 0xFF);
+        uValue >>= 8;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number stored at pucBytes in uCount bytes, least
+significant first. */
+static uint64_t SymTable_loadBytes(const unsigned char *pucBytes,
+                                   size_t uCount) {
+    uint64_t uValue = 0;
+
+    assert(pucBytes != NULL);
+
+    while (uCount > 0)
+        uValue = (uValue << 8) | pucBytes[--uCount];
+    return uValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of the record of a change of kind eKind
+to a key of uKeyLength characters whose value encodes in uValueSize
+bytes. */
+static size_t SymTable_recordSize(enum RecordKind eKind,
+                                  size_t uKeyLength,
+                                  size_t uValueSize) {
+    if (eKind == RECORD_REMOVE) return 1 + 4 + uKeyLength;
+    return 1 + 4 + uKeyLength + 4 + uValueSize;
+}
+
+/*--------------------------------------------------------------------*/
 
-    /* The address of the next node */
+/* Write at pucRecord the record of a change of kind eKind to pcKey,
+of uKeyLength characters, whose value pvValue encodes in uValueSize
+bytes by the encoder of oSymTable. Return the number of bytes
+written. */
+static size_t SymTable_writeRecord(SymTable_T oSymTable,
+                                   unsigned char *pucRecord,
+                                   enum RecordKind eKind,
+                                   const char *pcKey,
+                                   size_t uKeyLength,
+                                   const void *pvValue,
+                                   size_t uValueSize) {
+    unsigned char *pucValue;
+
+    assert(oSymTable != NULL);
+    assert(pucRecord != NULL);
+    assert(pcKey != NULL);
+
+    pucRecord[0] = (unsigned char)eKind;
+    SymTable_storeBytes(&pucRecord[1], uKeyLength, 4);
+    memcpy(&pucRecord[5], pcKey, uKeyLength);
+
+    if (eKind != RECORD_REMOVE) {
+        pucValue = &pucRecord[5 + uKeyLength];
+        SymTable_storeBytes(pucValue, uValueSize, 4);
+        (void)(*oSymTable->sOptions.pfEncodeValue)(
+            pvValue, &pucValue[4], uValueSize,
+            oSymTable->sOptions.pvCodec);
+    }
+
+    return SymTable_recordSize(eKind, uKeyLength, uValueSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of a block of uNewCapacity bytes, obtained for
+oSymTable, that begins with the first uSize bytes of pvOld, a block of
+uOldCapacity bytes (or NULL) that is released. Return NULL, keeping
+pvOld, if the limit or the memory of the table is exhausted. */
+static void *SymTable_regrow(SymTable_T oSymTable, void *pvOld,
+                             size_t uSize, size_t uOldCapacity,
+                             size_t uNewCapacity) {
+    void *pvNew;
+
+    assert(oSymTable != NULL);
+    assert(uSize <= uOldCapacity);
+
+    pvNew = SymTable_alloc(oSymTable, uNewCapacity);
+    if (pvNew == NULL) return NULL;
+    if (pvOld != NULL) {
+        memcpy(pvNew, pvOld, uSize);
+        SymTable_release(oSymTable, pvOld, uOldCapacity);
+    }
+    return pvNew;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make room in the change log of oSymTable for the record of a change
+of kind eKind to pcKey that binds it to pvValue, and store in
+*puValueSize the number of bytes in which pvValue encodes. Return 1
+(TRUE) if the log has room, or the table keeps none, and 0 (FALSE) if
+the limit or the memory of the table is exhausted or the key or value
+is too long. */
+static int SymTable_prepareRecord(SymTable_T oSymTable,
+                                  enum RecordKind eKind,
+                                  const char *pcKey,
+                                  const void *pvValue,
+                                  size_t *puValueSize) {
+    size_t uKeyLength;
+    size_t uNeeded;
+    size_t uCapacity;
+    void *pvGrown;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(puValueSize != NULL);
+
+    *puValueSize = 0;
+    if (oSymTable->sOptions.pfEncodeValue == NULL) return 1;
+
+    uKeyLength = strlen(pcKey);
+    if (eKind != RECORD_REMOVE)
+        *puValueSize = (*oSymTable->sOptions.pfEncodeValue)(
+            pvValue, NULL, 0, oSymTable->sOptions.pvCodec);
+    if (uKeyLength > MAX_RECORD_FIELD || *puValueSize > MAX_RECORD_FIELD)
+        return 0;
+
+    /* The records and their offsets grow by doubling */
+    uNeeded = oSymTable->uLogSize +
+        SymTable_recordSize(eKind, uKeyLength, *puValueSize);
+    if (uNeeded > oSymTable->uLogCapacity) {
+        uCapacity = oSymTable->uLogCapacity == 0 ? 256
+            : 2 * oSymTable->uLogCapacity;
+        if (uCapacity < uNeeded) uCapacity = uNeeded;
+        pvGrown = SymTable_regrow(oSymTable, oSymTable->pucLog,
+                                  oSymTable->uLogSize,
+                                  oSymTable->uLogCapacity, uCapacity);
+        if (pvGrown == NULL) return 0;
+        oSymTable->pucLog = (unsigned char*)pvGrown;
+        oSymTable->uLogCapacity = uCapacity;
+    }
+
+    uNeeded = oSymTable->uSequence - oSymTable->uLogBase + 1;
+    if (uNeeded > oSymTable->uLogOffsetCapacity) {
+        uCapacity = oSymTable->uLogOffsetCapacity == 0 ? 32
+            : 2 * oSymTable->uLogOffsetCapacity;
+        pvGrown = SymTable_regrow(oSymTable, oSymTable->puLogOffsets,
+            (uNeeded - 1) * sizeof(size_t),
+            oSymTable->uLogOffsetCapacity * sizeof(size_t),
+            uCapacity * sizeof(size_t));
+        if (pvGrown == NULL) return 0;
+        oSymTable->puLogOffsets = (size_t*)pvGrown;
+        oSymTable->uLogOffsetCapacity = uCapacity;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count a change of kind eKind to pcKey, which binds it to pvValue,
+and append its record to the change log of oSymTable if the table
+keeps one. SymTable_prepareRecord must have made room for the record
+and found that pvValue encodes in uValueSize bytes. */
+static void SymTable_appendRecord(SymTable_T oSymTable,
+                                  enum RecordKind eKind,
+                                  const char *pcKey,
+                                  const void *pvValue,
+                                  size_t uValueSize) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    oSymTable->uSequence++;
+    if (oSymTable->sOptions.pfEncodeValue == NULL) return;
+
+    oSymTable->puLogOffsets[oSymTable->uSequence - 1 -
+                            oSymTable->uLogBase] = oSymTable->uLogSize;
+    oSymTable->uLogSize += SymTable_writeRecord(oSymTable,
+        &oSymTable->pucLog[oSymTable->uLogSize], eKind, pcKey,
+        strlen(pcKey), pvValue, uValueSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the offset within the change log of oSymTable of the record
+of change uChange + 1, or the size of the log if uChange is the last
+change. */
+static size_t SymTable_logOffset(SymTable_T oSymTable, size_t uChange) {
+    assert(oSymTable != NULL);
+    assert(uChange >= oSymTable->uLogBase);
+    assert(uChange <= oSymTable->uSequence);
+
+    if (uChange == oSymTable->uSequence) return oSymTable->uLogSize;
+    return oSymTable->puLogOffsets[uChange - oSymTable->uLogBase];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new delta of uBodySize more bytes than its header, as
+malloc returns it, with its header written for changes uBase + 1
+through uEnd, or NULL if insufficient memory is available. */
+static unsigned char *SymTable_newDelta(int iKind, size_t uBase,
+                                        size_t uEnd,
+                                        size_t uBodySize) {
+    unsigned char *pucDelta;
+
+    pucDelta = (unsigned char*)malloc(DELTA_HEADER_SIZE + uBodySize);
+    if (pucDelta == NULL) return NULL;
+
+    memcpy(pucDelta, aucDeltaMagic, sizeof(aucDeltaMagic));
+    pucDelta[4] = (unsigned char)iKind;
+    SymTable_storeBytes(&pucDelta[5], uBase, 8);
+    SymTable_storeBytes(&pucDelta[13], uEnd, 8);
+    return pucDelta;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes of oSymTable that psNode holds: its own,
+and its key's if the node owns a copy of it. */
+static size_t SymTable_bindingBytes(SymTable_T oSymTable,
+                                    const struct Node *psNode) {
+    assert(oSymTable != NULL);
+    assert(psNode != NULL);
+
+    if (oSymTable->oKeyPool != NULL || oSymTable->sOptions.iBorrowKeys)
+        return SymTable_nodeSize(oSymTable);
+    return SymTable_nodeSize(oSymTable) + strlen(psNode->pcKey) + 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Take the least recently used binding of oSymTable, which evicts, out
+of the table, and push its node onto the list *ppsVictims, linked
+through psNextNode. Count its bytes as given back, but keep them and
+its value, so that SymTable_restore can bind it again and only
+SymTable_evictVictims disposes of it. Return 1 (TRUE) on success, and
+0 (FALSE) if the table is empty. */
+static int SymTable_setAside(SymTable_T oSymTable,
+                             struct Node **ppsVictims) {
+    struct Node *psNode;
+    struct Node *psPrevNode = NULL;
+    struct Node *psCurrentNode;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->sOptions.iEvict);
+    assert(oSymTable->psUndos == NULL);
+    assert(ppsVictims != NULL);
+
+    if (oSymTable->psOldest == NULL) return 0;
+    psNode = &oSymTable->psOldest->sNode;
+
+    i = psNode->uHash % oSymTable->bucketCount;
+    for (psCurrentNode = oSymTable->psBuckets[i].psFirstNode;
+         psCurrentNode != psNode;
+         psCurrentNode = psCurrentNode->psNextNode)
+        psPrevNode = psCurrentNode;
+    SymTable_unlink(&oSymTable->psBuckets[i], psNode, psPrevNode);
+    SymTable_forget(oSymTable, psNode);
+    oSymTable->length--;
+    SymTable_credit(oSymTable, SymTable_bindingBytes(oSymTable, psNode));
+
+    psNode->psNextNode = *ppsVictims;
+    *ppsVictims = psNode;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Bind again the nodes of psVictims, which SymTable_setAside took out
+of oSymTable, as its least recently used bindings, in their order
+before. */
+static void SymTable_restore(SymTable_T oSymTable,
+                             struct Node *psVictims) {
+    struct CacheNode *psCacheNode;
     struct Node *psNextNode;
-};
+
+    assert(oSymTable != NULL);
+
+    /* The list holds the most recently used victim first */
+    for (; psVictims != NULL; psVictims = psNextNode) {
+        psNextNode = psVictims->psNextNode;
+        SymTable_recharge(oSymTable,
+                          SymTable_bindingBytes(oSymTable, psVictims));
+        SymTable_linkFirst(&oSymTable->psBuckets[psVictims->uHash
+                                                 % oSymTable->bucketCount],
+                           psVictims);
+        psCacheNode = (struct CacheNode*)psVictims;
+        psCacheNode->psOlder = NULL;
+        psCacheNode->psNewer = oSymTable->psOldest;
+        if (oSymTable->psOldest != NULL)
+            oSymTable->psOldest->psOlder = psCacheNode;
+        else oSymTable->psNewest = psCacheNode;
+        oSymTable->psOldest = psCacheNode;
+        oSymTable->length++;
+    }
+}
 
 /*--------------------------------------------------------------------*/
 
-/* A SymTable is a "dummy" node that points to the first node. */
+/* Append the records of the removals of the nodes of psVictims to the
+change log of oSymTable. Return 1 (TRUE) on success, and 0 (FALSE),
+leaving the log as it was, if the log has no room for them. */
+static int SymTable_logVictims(SymTable_T oSymTable,
+                               const struct Node *psVictims) {
+    size_t uLogSize;
+    size_t uSequence;
+    size_t uValueSize;
 
-struct SymTable {
-    /* A pointer to an array of many first nodes (buckets) */
-    struct Node **ppsFirstNodes;
-    /* The number of buckets pointed to */
-    size_t bucketCount;
-    /* The number of bindings stored */
-    size_t length;
-};
+    assert(oSymTable != NULL);
+
+    uLogSize = oSymTable->uLogSize;
+    uSequence = oSymTable->uSequence;
+    for (; psVictims != NULL; psVictims = psVictims->psNextNode) {
+        if (!SymTable_prepareRecord(oSymTable, RECORD_REMOVE,
+                                    psVictims->pcKey, NULL,
+                                    &uValueSize)) {
+            oSymTable->uLogSize = uLogSize;
+            oSymTable->uSequence = uSequence;
+            return 0;
+        }
+        SymTable_appendRecord(oSymTable, RECORD_REMOVE,
+                              psVictims->pcKey, NULL, 0);
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Dispose of the nodes of psVictims, which SymTable_setAside took out
+of oSymTable for good: pass each value to the eviction function, or
+release it, as the options say, least recently used first, and free
+the node and its key. */
+static void SymTable_evictVictims(SymTable_T oSymTable,
+                                  struct Node *psVictims) {
+    struct Node *psOldest = NULL;
+    struct Node *psNextNode;
+
+    assert(oSymTable != NULL);
+
+    /* The list holds the most recently used victim first */
+    for (; psVictims != NULL; psVictims = psNextNode) {
+        psNextNode = psVictims->psNextNode;
+        psVictims->psNextNode = psOldest;
+        psOldest = psVictims;
+    }
+
+    for (; psOldest != NULL; psOldest = psNextNode) {
+        psNextNode = psOldest->psNextNode;
+        if (oSymTable->sOptions.pfEvict != NULL)
+            (*oSymTable->sOptions.pfEvict)(psOldest->pcKey,
+                (void*)psOldest->pvValue,
+                oSymTable->sOptions.pvEvictExtra);
+        else if (oSymTable->sOptions.pfFreeValue != NULL)
+            (*oSymTable->sOptions.pfFreeValue)((void*)psOldest->pvValue);
+
+        /* SymTable_setAside counted the bytes as given back already */
+        if (oSymTable->oKeyPool == NULL) {
+            if (!oSymTable->sOptions.iBorrowKeys)
+                SymTable_deallocate(&oSymTable->sOptions,
+                                    psOldest->pcKey,
+                                    strlen(psOldest->pcKey) + 1);
+            else if (oSymTable->sOptions.pfFreeKey != NULL)
+                (*oSymTable->sOptions.pfFreeKey)(psOldest->pcKey);
+        }
+        SymTable_deallocate(&oSymTable->sOptions, psOldest,
+                            SymTable_nodeSize(oSymTable));
+        oSymTable->uEvictions++;
+
+        /* Rebuild the filter as SymTable_remove would */
+        if (oSymTable->puFilter != NULL &&
+            ++oSymTable->uFilterStale > oSymTable->length &&
+            oSymTable->uFilterStale >= oSymTable->bucketCount / 4)
+            (void)SymTable_buildFilter(oSymTable);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Evict the least recently used binding of oSymTable, which evicts,
+passing its value to the eviction function, or releasing it, as the
+options say. Return 1 (TRUE) on success, and 0 (FALSE) if the table
+is empty or the change log has no room for the removal. */
+static int SymTable_evictOldest(SymTable_T oSymTable) {
+    struct Node *psVictims = NULL;
+
+    assert(oSymTable != NULL);
+
+    if (!SymTable_setAside(oSymTable, &psVictims)) return 0;
+    if (!SymTable_logVictims(oSymTable, psVictims)) {
+        SymTable_restore(oSymTable, psVictims);
+        return 0;
+    }
+    SymTable_evictVictims(oSymTable, psVictims);
+    return 1;
+}
 
 /*--------------------------------------------------------------------*/
 
-/* Return a hash code for pcKey that is between 0 and uBucketCount-1,
-inclusive. */
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount) {
-      const size_t HASH_MULTIPLIER = 65599;
-      size_t u;
-      size_t uHash = 0;
-   
-      assert(pcKey != NULL);
-   
-      for (u = 0; pcKey[u] != '\0'; u++)
-         uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
-   
-      return uHash % uBucketCount;
+/* Return a block of uSize bytes for oSymTable, setting aside (see
+SymTable_setAside) the least recently used bindings of a table that
+evicts onto *ppsVictims until the limit allows it, or NULL if the
+limit or the memory of the table is exhausted. */
+static void *SymTable_allocEvicting(SymTable_T oSymTable, size_t uSize,
+                                    struct Node **ppsVictims) {
+    void *pv;
+
+    assert(oSymTable != NULL);
+    assert(ppsVictims != NULL);
+
+    while ((pv = SymTable_alloc(oSymTable, uSize)) == NULL)
+        if (!oSymTable->sOptions.iEvict ||
+            !SymTable_setAside(oSymTable, ppsVictims))
+            return NULL;
+    return pv;
 }
 
 /*--------------------------------------------------------------------*/
@@ -60,48 +1255,48 @@ repositions all bindings whenever a call of SymTable_put causes the
 number of bindings in oSymTable to become too large */
 static void SymTable_expand(SymTable_T oSymTable, 
                             size_t newBucketCount) {
-    struct Node **ppsOldFirstNodes;
+    struct Bucket *psOldBuckets;
     size_t oldBucketCount;
     struct Node *psCurrentNode;
     struct Node *psNextNode;
     size_t i;
-    size_t newHash;
 
     assert(oSymTable != NULL);
 
-    ppsOldFirstNodes = oSymTable->ppsFirstNodes;
+    psOldBuckets = oSymTable->psBuckets;
     oldBucketCount = oSymTable->bucketCount;
 
-    /* Allocate memory for the new array of many first nodes */
-    oSymTable->ppsFirstNodes = 
-    (struct Node**)malloc(newBucketCount * sizeof(struct Node*));
-    if (oSymTable->ppsFirstNodes == NULL) {
-        oSymTable->ppsFirstNodes = ppsOldFirstNodes;
+    /* Allocate memory for the new array of many buckets. A table at
+    its memory limit keeps its buckets and longer chains. */
+    oSymTable->psBuckets =
+        SymTable_newBuckets(oSymTable, newBucketCount);
+    if (oSymTable->psBuckets == NULL) {
+        oSymTable->psBuckets = psOldBuckets;
         return;
     }
 
-    /* Initialize all buckets to NULL */
-    for (i = 0; i < newBucketCount; i++) {
-        oSymTable->ppsFirstNodes[i] = NULL;
-    }
-
-    /* Hash all old bindings into new buckets */
+    /* Move all old bindings into new buckets, by their stored hash
+    codes */
     for (i = 0; i < oldBucketCount; i++) {
-        for (psCurrentNode = ppsOldFirstNodes[i];
+        for (psCurrentNode = psOldBuckets[i].psFirstNode;
              psCurrentNode != NULL;
              psCurrentNode = psNextNode) {
         psNextNode = psCurrentNode->psNextNode;
-        newHash = SymTable_hash(psCurrentNode->pcKey, newBucketCount);
-        psCurrentNode->psNextNode = oSymTable->ppsFirstNodes[newHash];
-        oSymTable->ppsFirstNodes[newHash] = psCurrentNode;
+        SymTable_linkFirst(&oSymTable->psBuckets[
+                               psCurrentNode->uHash % newBucketCount],
+                           psCurrentNode);
         }
     }
 
     oSymTable->bucketCount = newBucketCount;
 
-    /* Free the memory in which the old array of many first nodes 
-    resides */
-    free(ppsOldFirstNodes);
+    /* Free the memory in which the old array of many buckets resides */
+    SymTable_release(oSymTable, psOldBuckets,
+                     oldBucketCount * sizeof(struct Bucket));
+
+    /* Size the filter for the new load. The old one, which holds every
+    key, serves if there is no memory for another. */
+    (void)SymTable_buildFilter(oSymTable);
 
     return;
 }
@@ -109,29 +1304,514 @@ static void SymTable_expand(SymTable_T oSymTable,
 /*--------------------------------------------------------------------*/
 
 SymTable_T SymTable_new(void) {
+    struct SymTable_Options sOptions;
+
+    SymTable_initOptions(&sOptions);
+    return SymTable_newEx(&sOptions);
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_initOptions(struct SymTable_Options *psOptions) {
+    assert(psOptions != NULL);
+
+    psOptions->pfFreeValue = NULL;
+    psOptions->iBorrowKeys = 0;
+    psOptions->pfFreeKey = NULL;
+    psOptions->pfMalloc = NULL;
+    psOptions->pfFree = NULL;
+    psOptions->pvAllocator = NULL;
+    psOptions->uMaxBytes = 0;
+    psOptions->pfEncodeValue = NULL;
+    psOptions->pvCodec = NULL;
+    psOptions->uFilterBitsPerKey = 0;
+    psOptions->uMaxBindings = 0;
+    psOptions->iEvict = 0;
+    psOptions->pfEvict = NULL;
+    psOptions->pvEvictExtra = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newEx(const struct SymTable_Options *psOptions) {
     SymTable_T oSymTable;
     size_t initialBucketCount = 509;
-    size_t i;
 
-    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+    assert(psOptions != NULL);
+
+    /* The table holds its own bytes, which must fit its limit */
+    if (psOptions->uMaxBytes != 0 &&
+        psOptions->uMaxBytes < sizeof(struct SymTable))
+        return NULL;
+    oSymTable = (SymTable_T)
+        SymTable_allocate(psOptions, sizeof(struct SymTable));
     if (oSymTable == NULL) return NULL;
 
-    oSymTable->ppsFirstNodes = 
-    (struct Node**)malloc(initialBucketCount * sizeof(struct Node*));
-    if (oSymTable->ppsFirstNodes == NULL) {
-        free(oSymTable);
+    oSymTable->sOptions = *psOptions;
+    oSymTable->uBytes = 0;
+    if (!SymTable_charge(oSymTable, sizeof(struct SymTable))) {
+        SymTable_deallocate(psOptions, oSymTable,
+                            sizeof(struct SymTable));
         return NULL;
     }
-    
-    /* Initialize all buckets to NULL */
-    for (i = 0; i < initialBucketCount; i++) {
-        oSymTable->ppsFirstNodes[i] = NULL;
+
+    oSymTable->psBuckets = SymTable_newBuckets(oSymTable,
+                                               initialBucketCount);
+    if (oSymTable->psBuckets == NULL) {
+        SymTable_destroy(oSymTable);
+        return NULL;
+    }
+
+    oSymTable->bucketCount = initialBucketCount;
+    oSymTable->length = 0;
+    oSymTable->oKeyPool = NULL;
+    oSymTable->psUndos = NULL;
+    oSymTable->uUndoCapacity = 0;
+    oSymTable->uUndoCount = 0;
+    oSymTable->uUndoSequence = 0;
+    oSymTable->uSequence = 0;
+    oSymTable->pucLog = NULL;
+    oSymTable->uLogSize = 0;
+    oSymTable->uLogCapacity = 0;
+    oSymTable->puLogOffsets = NULL;
+    oSymTable->uLogOffsetCapacity = 0;
+    oSymTable->uLogBase = 0;
+    oSymTable->puFilter = NULL;
+    oSymTable->uFilterBlocks = 0;
+    oSymTable->uFilterStale = 0;
+    oSymTable->psOldest = NULL;
+    oSymTable->psNewest = NULL;
+    oSymTable->uHits = 0;
+    oSymTable->uMisses = 0;
+    oSymTable->uEvictions = 0;
+
+    if (!SymTable_buildFilter(oSymTable)) {
+        SymTable_release(oSymTable, oSymTable->psBuckets,
+                         initialBucketCount * sizeof(struct Bucket));
+        SymTable_destroy(oSymTable);
+        return NULL;
+    }
+
+    SymTable_enlist(oSymTable);
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newInterned(KeyPool_T oKeyPool) {
+    SymTable_T oSymTable;
+
+    assert(oKeyPool != NULL);
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) return NULL;
+
+    oSymTable->oKeyPool = oKeyPool;
+
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The most threads that SymTable_newBulk uses. */
+
+enum {MAX_BULK_THREADS = 256};
+
+/* The state that the threads of one call of SymTable_newBulk share.
+Shard s is the range of buckets [s * uShardWidth, (s+1) * uShardWidth),
+and only thread s links nodes into it, so no locks are needed. */
+
+struct BulkBuild {
+    /* The table being built, whose buckets are final */
+    SymTable_T oSymTable;
+    /* The keys and values to bind */
+    const char *const *apcKeys;
+    const void *const *apvValues;
+    /* The number of keys and values */
+    size_t uCount;
+    /* The number of threads, which is also the number of shards */
+    size_t uThreadCount;
+    /* The number of buckets in each shard */
+    size_t uShardWidth;
+    /* The hash code of each key */
+    size_t *auHashes;
+    /* The indices of the keys, grouped by shard and, within each
+    shard, in their original order */
+    size_t *auOrder;
+    /* For each thread t and shard s, element t * uThreadCount + s is
+    first the number of keys of thread t that fall in shard s, and
+    then the position in auOrder of the next one */
+    size_t *auOffsets;
+    /* The first position in auOrder of each shard, and uCount */
+    size_t *auShardStarts;
+    /* The number of bindings made, and of duplicate keys skipped, in
+    each shard */
+    size_t *auLengths;
+    size_t *auDuplicates;
+    /* 1 (TRUE) for each shard that ran out of memory */
+    int *aiFailed;
+};
+
+/* One thread's part of one phase of a bulk build. */
+
+struct BulkTask {
+    /* The shared state */
+    struct BulkBuild *psBuild;
+    /* The phase to run */
+    void (*pfPhase)(struct BulkBuild *psBuild, size_t uThread);
+    /* The number of the thread */
+    size_t uThread;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the first of the keys that thread uThread of
+psBuild hashes and scatters. The threads take equal slices, in
+order. */
+static size_t SymTable_sliceStart(struct BulkBuild *psBuild,
+                                  size_t uThread) {
+    size_t uSize;
+    size_t uExtra;
+
+    assert(psBuild != NULL);
+
+    uSize = psBuild->uCount / psBuild->uThreadCount;
+    uExtra = psBuild->uCount % psBuild->uThreadCount;
+    return uSize * uThread + (uThread < uExtra ? uThread : uExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compute the hash code of each key in the slice of thread uThread,
+and count how many keys fall in each shard. */
+static void SymTable_bulkHash(struct BulkBuild *psBuild,
+                              size_t uThread) {
+    size_t *auCounts;
+    size_t uBucket;
+    size_t uEnd;
+    size_t i;
+
+    assert(psBuild != NULL);
+
+    auCounts = &psBuild->auOffsets[uThread * psBuild->uThreadCount];
+    uEnd = SymTable_sliceStart(psBuild, uThread + 1);
+    for (i = SymTable_sliceStart(psBuild, uThread); i < uEnd; i++) {
+        psBuild->auHashes[i] = KeyOps_hash(psBuild->apcKeys[i]);
+        uBucket = psBuild->auHashes[i] % psBuild->oSymTable->bucketCount;
+        auCounts[uBucket / psBuild->uShardWidth]++;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Copy the index of each key in the slice of thread uThread to the
+part of auOrder that belongs to its shard. */
+static void SymTable_bulkScatter(struct BulkBuild *psBuild,
+                                 size_t uThread) {
+    size_t *auNext;
+    size_t uBucket;
+    size_t uEnd;
+    size_t i;
+
+    assert(psBuild != NULL);
+
+    auNext = &psBuild->auOffsets[uThread * psBuild->uThreadCount];
+    uEnd = SymTable_sliceStart(psBuild, uThread + 1);
+    for (i = SymTable_sliceStart(psBuild, uThread); i < uEnd; i++) {
+        uBucket = psBuild->auHashes[i] % psBuild->oSymTable->bucketCount;
+        psBuild->auOrder[auNext[uBucket / psBuild->uShardWidth]++] = i;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Bind the keys of shard uThread in their original order, skipping
+each key that is already bound, as SymTable_put would. Stop at the
+first allocation that fails. */
+static void SymTable_bulkLink(struct BulkBuild *psBuild,
+                              size_t uThread) {
+    SymTable_T oSymTable;
+    struct Node *psNewNode;
+    struct Node *psCurrentNode;
+    struct Bucket *psBucket;
+    const char *pcKey;
+    size_t uLength = 0;
+    size_t uDuplicates = 0;
+    size_t uPosition;
+    size_t uHash;
+    size_t i;
+
+    assert(psBuild != NULL);
+
+    oSymTable = psBuild->oSymTable;
+    for (uPosition = psBuild->auShardStarts[uThread];
+         uPosition < psBuild->auShardStarts[uThread + 1];
+         uPosition++) {
+        i = psBuild->auOrder[uPosition];
+        pcKey = psBuild->apcKeys[i];
+        uHash = psBuild->auHashes[i];
+        psBucket = &oSymTable->psBuckets[uHash % oSymTable->bucketCount];
+
+        /* Check the bucket for an earlier binding of the key */
+        for (psCurrentNode = psBucket->psFirstNode;
+             psCurrentNode != NULL;
+             psCurrentNode = psCurrentNode->psNextNode)
+            if (psCurrentNode->uHash == uHash &&
+                KeyOps_equals(psCurrentNode->pcKey, pcKey))
+                break;
+        if (psCurrentNode != NULL) {
+            uDuplicates++;
+            continue;
+        }
+
+        psNewNode = (struct Node*)
+            SymTable_alloc(oSymTable, SymTable_nodeSize(oSymTable));
+        if (psNewNode == NULL) {
+            psBuild->aiFailed[uThread] = 1;
+            break;
+        }
+        if (oSymTable->sOptions.iBorrowKeys)
+            psNewNode->pcKey = (char*)pcKey;
+        else {
+            psNewNode->pcKey =
+                (char*)SymTable_alloc(oSymTable, strlen(pcKey) + 1);
+            if (psNewNode->pcKey == NULL) {
+                SymTable_release(oSymTable, psNewNode,
+                                 SymTable_nodeSize(oSymTable));
+                psBuild->aiFailed[uThread] = 1;
+                break;
+            }
+            strcpy(psNewNode->pcKey, pcKey);
+        }
+        psNewNode->uHash = uHash;
+        psNewNode->pvValue =
+            psBuild->apvValues == NULL ? NULL : psBuild->apvValues[i];
+        SymTable_linkFirst(psBucket, psNewNode);
+        uLength++;
+    }
+
+    psBuild->auLengths[uThread] = uLength;
+    psBuild->auDuplicates[uThread] = uDuplicates;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run the part of a bulk build phase that pvTask, a struct BulkTask,
+describes. Return NULL. */
+static void *SymTable_bulkThread(void *pvTask) {
+    struct BulkTask *psTask = (struct BulkTask*)pvTask;
+
+    assert(psTask != NULL);
+
+    (*psTask->pfPhase)(psTask->psBuild, psTask->uThread);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run phase pfPhase of psBuild on every thread, and return when all
+have finished. The calling thread is thread 0. A thread that cannot
+be created has its part run by the calling thread instead. */
+static void SymTable_bulkRun(struct BulkBuild *psBuild,
+                             void (*pfPhase)(struct BulkBuild *psBuild,
+                                             size_t uThread)) {
+    pthread_t aiThreads[MAX_BULK_THREADS];
+    struct BulkTask asTasks[MAX_BULK_THREADS];
+    int aiStarted[MAX_BULK_THREADS];
+    size_t t;
+
+    assert(psBuild != NULL);
+    assert(pfPhase != NULL);
+
+    for (t = 1; t < psBuild->uThreadCount; t++) {
+        asTasks[t].psBuild = psBuild;
+        asTasks[t].pfPhase = pfPhase;
+        asTasks[t].uThread = t;
+        aiStarted[t] = pthread_create(&aiThreads[t], NULL,
+            SymTable_bulkThread, &asTasks[t]) == 0;
+    }
+    (*pfPhase)(psBuild, 0);
+    for (t = 1; t < psBuild->uThreadCount; t++) {
+        if (aiStarted[t]) pthread_join(aiThreads[t], NULL);
+        else (*pfPhase)(psBuild, t);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free oSymTable, a build that failed, leaving the keys and values
+that it holds to the caller. */
+static void SymTable_freeBuild(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    oSymTable->sOptions.pfFreeValue = NULL;
+    oSymTable->sOptions.pfFreeKey = NULL;
+    SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newBulk(const char *const *apcKeys,
+                            const void *const *apvValues,
+                            size_t uCount, size_t uThreadCount,
+                            const struct SymTable_Options *psOptions,
+                            size_t *puDuplicates) {
+    struct SymTable_Options sDefaults;
+    struct BulkBuild sBuild;
+    struct Node *psNode;
+    size_t bucketCount;
+    size_t uThreads2;
+    size_t uPosition;
+    size_t uMax;
+    size_t s;
+    size_t t;
+    int iFailed = 0;
+
+    assert(apcKeys != NULL || uCount == 0);
+    assert(uThreadCount > 0);
+
+    if (psOptions == NULL) {
+        SymTable_initOptions(&sDefaults);
+        psOptions = &sDefaults;
+    }
+    if (uThreadCount > MAX_BULK_THREADS)
+        uThreadCount = MAX_BULK_THREADS;
+
+    /* Size the buckets for all the keys at once, so that the shards
+    are final and need no stitching */
+    sBuild.oSymTable = SymTable_newEx(psOptions);
+    if (sBuild.oSymTable == NULL) return NULL;
+    bucketCount = SymTable_bucketCountFor(uCount);
+    if (bucketCount > sBuild.oSymTable->bucketCount) {
+        SymTable_expand(sBuild.oSymTable, bucketCount);
+        if (sBuild.oSymTable->bucketCount != bucketCount) {
+            SymTable_free(sBuild.oSymTable);
+            return NULL;
+        }
+    }
+
+    sBuild.apcKeys = apcKeys;
+    sBuild.apvValues = apvValues;
+    sBuild.uCount = uCount;
+    sBuild.uThreadCount = uThreadCount;
+    sBuild.uShardWidth =
+        (sBuild.oSymTable->bucketCount + uThreadCount - 1) / uThreadCount;
+    uThreads2 = uThreadCount * uThreadCount;
+    sBuild.auHashes = (size_t*)malloc((uCount + 1) * sizeof(size_t));
+    sBuild.auOrder = (size_t*)malloc((uCount + 1) * sizeof(size_t));
+    sBuild.auOffsets = (size_t*)calloc(uThreads2, sizeof(size_t));
+    sBuild.auShardStarts =
+        (size_t*)malloc((uThreadCount + 1) * sizeof(size_t));
+    sBuild.auLengths = (size_t*)calloc(uThreadCount, sizeof(size_t));
+    sBuild.auDuplicates = (size_t*)calloc(uThreadCount, sizeof(size_t));
+    sBuild.aiFailed = (int*)calloc(uThreadCount, sizeof(int));
+    if (sBuild.auHashes == NULL || sBuild.auOrder == NULL ||
+        sBuild.auOffsets == NULL || sBuild.auShardStarts == NULL ||
+        sBuild.auLengths == NULL || sBuild.auDuplicates == NULL ||
+        sBuild.aiFailed == NULL)
+        iFailed = 1;
+    else {
+        SymTable_bulkRun(&sBuild, SymTable_bulkHash);
+
+        /* Turn the counts into positions in auOrder, shard by shard
+        and, within a shard, thread by thread */
+        uPosition = 0;
+        for (s = 0; s < uThreadCount; s++) {
+            sBuild.auShardStarts[s] = uPosition;
+            for (t = 0; t < uThreadCount; t++) {
+                size_t uKeys = sBuild.auOffsets[t * uThreadCount + s];
+                sBuild.auOffsets[t * uThreadCount + s] = uPosition;
+                uPosition += uKeys;
+            }
+        }
+        sBuild.auShardStarts[uThreadCount] = uPosition;
+
+        SymTable_bulkRun(&sBuild, SymTable_bulkScatter);
+        SymTable_bulkRun(&sBuild, SymTable_bulkLink);
+
+        if (puDuplicates != NULL) *puDuplicates = 0;
+        for (s = 0; s < uThreadCount; s++) {
+            if (sBuild.aiFailed[s]) iFailed = 1;
+            sBuild.oSymTable->length += sBuild.auLengths[s];
+            if (puDuplicates != NULL)
+                *puDuplicates += sBuild.auDuplicates[s];
+        }
+    }
+
+    free(sBuild.auHashes);
+    free(sBuild.auOrder);
+    free(sBuild.auOffsets);
+    free(sBuild.auShardStarts);
+    free(sBuild.auLengths);
+    free(sBuild.auDuplicates);
+    free(sBuild.aiFailed);
+
+    if (iFailed) {
+        SymTable_freeBuild(sBuild.oSymTable);
+        return NULL;
+    }
+
+    /* The threads linked the nodes without adding them to the filter,
+    and a table that cannot build one must do without */
+    if (!SymTable_buildFilter(sBuild.oSymTable))
+        SymTable_dropFilter(sBuild.oSymTable);
+
+    /* A table that evicts lists its nodes in bucket order, as if they
+    had been put in that order, and keeps the last of them that fit.
+    One that does not cannot hold more than its limit. */
+    uMax = sBuild.oSymTable->sOptions.uMaxBindings;
+    if (sBuild.oSymTable->sOptions.iEvict) {
+        for (s = 0; s < sBuild.oSymTable->bucketCount; s++)
+            for (psNode = sBuild.oSymTable->psBuckets[s].psFirstNode;
+                 psNode != NULL; psNode = psNode->psNextNode)
+                SymTable_addRecent(sBuild.oSymTable, psNode);
+        while (!iFailed && uMax != 0 && sBuild.oSymTable->length > uMax)
+            iFailed = !SymTable_evictOldest(sBuild.oSymTable);
+    }
+    else if (uMax != 0 && sBuild.oSymTable->length > uMax)
+        iFailed = 1;
+
+    if (iFailed) {
+        SymTable_freeBuild(sBuild.oSymTable);
+        return NULL;
     }
 
-    oSymTable->bucketCount = initialBucketCount;
-    oSymTable->length = 0;
+    return sBuild.oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Ask the processor to start loading the cache line at address pv. */
+
+#ifdef __GNUC__
+#define SymTable_prefetch(pv) __builtin_prefetch(pv)
+#else
+#define SymTable_prefetch(pv) ((void)(pv))
+#endif
+
+/* The distance, in buckets, at which a walk of every bucket prefetches
+the first nodes. A walk that waited for each node in turn would spend
+most of its time waiting on memory in tables larger than the cache.
+Keys are not prefetched: the address of a key is in its node, so
+would have to be waited for. Whether a copied key then shares a cache
+line with its node depends on the allocator, which often, but not
+always, places a key just after the node allocated before it. */
+
+enum {WALK_AHEAD = 16};
+
+/*--------------------------------------------------------------------*/
 
-    return oSymTable;
+/* Prefetch for a walk of the buckets of oSymTable that has reached
+bucket i: the first node of the bucket WALK_AHEAD further on. */
+static void SymTable_prefetchWalk(SymTable_T oSymTable, size_t i) {
+    struct Node *psNode;
+
+    assert(oSymTable != NULL);
+
+    if (i + WALK_AHEAD < oSymTable->bucketCount) {
+        psNode = oSymTable->psBuckets[i + WALK_AHEAD].psFirstNode;
+        if (psNode != NULL) SymTable_prefetch(psNode);
+    }
 }
 
 /*--------------------------------------------------------------------*/
@@ -143,22 +1823,40 @@ void SymTable_free(SymTable_T oSymTable) {
 
     assert(oSymTable != NULL);
 
+    if (oSymTable->psUndos != NULL) SymTable_commit(oSymTable);
+
     /* Iterate through the buckets */
     for (i = 0; i < oSymTable->bucketCount; i++) {
+        SymTable_prefetchWalk(oSymTable, i);
         /* Walk through the list at each bucket */
-        for (psCurrentNode = oSymTable->ppsFirstNodes[i];
+        for (psCurrentNode = oSymTable->psBuckets[i].psFirstNode;
              psCurrentNode != NULL;
              psCurrentNode = psNextNode) {
           psNextNode = psCurrentNode->psNextNode;
-          /* Free the memory in which the keys reside*/
-          free((char*)psCurrentNode->pcKey);
-          free(psCurrentNode);
+          if (psNextNode != NULL) SymTable_prefetch(psNextNode);
+          /* Release the value and key along with the node, so that
+          clients need not map over the table first */
+          if (oSymTable->sOptions.pfFreeValue != NULL)
+              (*oSymTable->sOptions.pfFreeValue)(
+                  (void*)psCurrentNode->pvValue);
+          SymTable_releaseKey(oSymTable, psCurrentNode->pcKey);
+          SymTable_release(oSymTable, psCurrentNode,
+                           SymTable_nodeSize(oSymTable));
         }
     }
 
-    /* Free the memory in which the array of many first nodes resides */
-    free(oSymTable->ppsFirstNodes);
-    free(oSymTable);
+    /* Free the memory in which the array of many buckets resides */
+    SymTable_release(oSymTable, oSymTable->psBuckets,
+                     oSymTable->bucketCount * sizeof(struct Bucket));
+    if (oSymTable->pucLog != NULL)
+        SymTable_release(oSymTable, oSymTable->pucLog,
+                         oSymTable->uLogCapacity);
+    if (oSymTable->puLogOffsets != NULL)
+        SymTable_release(oSymTable, oSymTable->puLogOffsets,
+                         oSymTable->uLogOffsetCapacity * sizeof(size_t));
+    SymTable_dropFilter(oSymTable);
+    SymTable_delist(oSymTable);
+    SymTable_destroy(oSymTable);
 }
 
 /*--------------------------------------------------------------------*/
@@ -175,44 +1873,107 @@ int SymTable_put(SymTable_T oSymTable,
                  const char *pcKey, 
                  const void *pvValue) {          
     struct Node *psNewNode;
+    struct Node *psPrevNode;
+    struct Node *psVictims = NULL;
+    size_t newBucketCount;
+    size_t uValueSize;
+    size_t uLogSize;
+    size_t uSequence;
     size_t i;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    /* Expand hash table if necessary */
-    if (oSymTable->length == 509) SymTable_expand(oSymTable, 1021);
-    if (oSymTable->length == 1021) SymTable_expand(oSymTable, 2039);
-    if (oSymTable->length == 2039) SymTable_expand(oSymTable, 4093);    
-    if (oSymTable->length == 4093) SymTable_expand(oSymTable, 8191);
-    if (oSymTable->length == 8191) SymTable_expand(oSymTable, 16381);
-    if (oSymTable->length == 16381) SymTable_expand(oSymTable, 32749);
-    if (oSymTable->length == 32749) SymTable_expand(oSymTable, 65521);
+    if (!SymTable_canChange(oSymTable)) return 0;
+
+    /* Expand hash table if necessary. A table whose expansion failed
+    for lack of memory tries again on the next call. */
+    if (oSymTable->length >= oSymTable->bucketCount) {
+        newBucketCount = SymTable_bucketCountFor(oSymTable->length + 1);
+        if (newBucketCount > oSymTable->bucketCount)
+            SymTable_expand(oSymTable, newBucketCount);
+    }
         
     /* Check if oSymTable already contains pcKey */
-    if (SymTable_contains(oSymTable, pcKey)) return 0;
-    
+    if (SymTable_find(oSymTable, pcKey, &i, &psPrevNode) != NULL)
+        return 0;
+
+    /* Make room for the binding. A table that evicts sets its least
+    recently used bindings aside, and binds them again if the put
+    fails, so that it loses them only to a put that succeeds. */
+    if (oSymTable->sOptions.uMaxBindings != 0 &&
+        oSymTable->length >= oSymTable->sOptions.uMaxBindings &&
+        (!oSymTable->sOptions.iEvict ||
+         !SymTable_setAside(oSymTable, &psVictims)))
+        return 0;
+
     /* Allocate memory for the new node */
-    psNewNode = (struct Node*)malloc(sizeof(struct Node));
-    if (psNewNode == NULL) return 0;
+    psNewNode = (struct Node*)SymTable_allocEvicting(oSymTable,
+        SymTable_nodeSize(oSymTable), &psVictims);
+    if (psNewNode == NULL) {
+        SymTable_restore(oSymTable, psVictims);
+        return 0;
+    }
 
-    /* Create a defensive copy of the string to which pcKey points */
-    psNewNode->pcKey = (char*)malloc(strlen(pcKey) + 1);
+    /* Share the pool's copy of the key, borrow the caller's, or create
+    a defensive copy of the string to which pcKey points */
+    if (oSymTable->sOptions.iBorrowKeys)
+        psNewNode->pcKey = (char*)pcKey;
+    else if (oSymTable->oKeyPool != NULL)
+        psNewNode->pcKey =
+            (char*)KeyPool_intern(oSymTable->oKeyPool, pcKey);
+    else {
+        psNewNode->pcKey = (char*)SymTable_allocEvicting(oSymTable,
+            strlen(pcKey) + 1, &psVictims);
+        if (psNewNode->pcKey != NULL) strcpy(psNewNode->pcKey, pcKey);
+    }
     if (psNewNode->pcKey == NULL) {
-        free(psNewNode);
+        SymTable_release(oSymTable, psNewNode,
+                         SymTable_nodeSize(oSymTable));
+        SymTable_restore(oSymTable, psVictims);
+        return 0;
+    }
+
+    /* Record the evictions, then reserve the record of the put */
+    uLogSize = oSymTable->uLogSize;
+    uSequence = oSymTable->uSequence;
+    if (!SymTable_logVictims(oSymTable, psVictims) ||
+        !SymTable_prepareRecord(oSymTable, RECORD_PUT, pcKey, pvValue,
+                                &uValueSize)) {
+        oSymTable->uLogSize = uLogSize;
+        oSymTable->uSequence = uSequence;
+        if (oSymTable->oKeyPool == NULL &&
+            !oSymTable->sOptions.iBorrowKeys)
+            SymTable_release(oSymTable, psNewNode->pcKey,
+                             strlen(pcKey) + 1);
+        SymTable_release(oSymTable, psNewNode,
+                         SymTable_nodeSize(oSymTable));
+        SymTable_restore(oSymTable, psVictims);
         return 0;
-    } 
-    strcpy(psNewNode->pcKey, pcKey);
+    }
+    SymTable_evictVictims(oSymTable, psVictims);
 
-    /* Hash the key */
-    i = SymTable_hash(psNewNode->pcKey, oSymTable->bucketCount);
+    /* Hash the key, reusing the pool's hash code of an interned key */
+    if (oSymTable->oKeyPool != NULL)
+        psNewNode->uHash = KeyPool_getHash(psNewNode->pcKey);
+    else psNewNode->uHash = KeyOps_hash(pcKey);
 
     psNewNode->pvValue = pvValue;
     /* Put the node in the appropriate bucket */
-    psNewNode->psNextNode = oSymTable->ppsFirstNodes[i];
-    oSymTable->ppsFirstNodes[i] = psNewNode;
+    SymTable_linkFirst(&oSymTable->psBuckets[psNewNode->uHash
+                                             % oSymTable->bucketCount],
+                       psNewNode);
+    if (oSymTable->puFilter != NULL)
+        SymTable_filterAdd(oSymTable->puFilter, oSymTable->uFilterBlocks,
+                           SymTable_filterProbes(oSymTable),
+                           psNewNode->uHash);
+
+    SymTable_addRecent(oSymTable, psNewNode);
 
     oSymTable->length++;
+    SymTable_logChange(oSymTable, UNDO_PUT, psNewNode, NULL);
+    SymTable_appendRecord(oSymTable, RECORD_PUT, pcKey, pvValue,
+                          uValueSize);
     
     return 1;
 }
@@ -223,122 +1984,290 @@ void *SymTable_replace(SymTable_T oSymTable,
                        const char *pcKey, 
                        const void *pvValue) {
     struct Node *psCurrentNode;
-    struct Node *psNextNode;
+    struct Node *psPrevNode;
+    void *oldValue;
+    size_t uValueSize;
     size_t i;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    /* Hash the key */
-    i = SymTable_hash(pcKey, oSymTable->bucketCount);
+    /* Find the key and replace its value if found */
+    psCurrentNode = SymTable_find(oSymTable, pcKey, &i, &psPrevNode);
+    if (psCurrentNode == NULL || !SymTable_canChange(oSymTable) ||
+        !SymTable_prepareRecord(oSymTable, RECORD_REPLACE, pcKey,
+                                pvValue, &uValueSize))
+        return NULL;
 
-    /* Check the corresponding bucket for the key and replace if 
-    found */
-    for (psCurrentNode = oSymTable->ppsFirstNodes[i];
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-    psNextNode = psCurrentNode->psNextNode;
-    if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-           void *oldValue = (void*)psCurrentNode->pvValue;
-           psCurrentNode->pvValue = pvValue;
-           return oldValue;
-       }
-    }
-    
-    return NULL;
+    oldValue = (void*)psCurrentNode->pvValue;
+    psCurrentNode->pvValue = pvValue;
+    SymTable_refresh(oSymTable, psCurrentNode);
+    SymTable_logChange(oSymTable, UNDO_REPLACE, psCurrentNode, oldValue);
+    SymTable_appendRecord(oSymTable, RECORD_REPLACE, pcKey, pvValue,
+                          uValueSize);
+    return oldValue;
 }
 
 /*--------------------------------------------------------------------*/
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
     struct Node *psCurrentNode;
-    struct Node *psNextNode;
+    struct Node *psPrevNode;
     size_t i;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    /* Hash the key */
-    i = SymTable_hash(pcKey, oSymTable->bucketCount);
-
-    /* Check the corresponding bucket for the key */
-    for (psCurrentNode = oSymTable->ppsFirstNodes[i];
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-      psNextNode = psCurrentNode->psNextNode;
-      if (strcmp(psCurrentNode->pcKey, pcKey) == 0) return 1;
-    }
-
-    return 0;
+    psCurrentNode = SymTable_find(oSymTable, pcKey, &i, &psPrevNode);
+    SymTable_touch(oSymTable, psCurrentNode);
+    return psCurrentNode != NULL;
 }
 
 /*--------------------------------------------------------------------*/
 
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
     struct Node *psCurrentNode;
-    struct Node *psNextNode;
+    struct Node *psPrevNode;
     size_t i;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    /* Hash the key */
-    i = SymTable_hash(pcKey, oSymTable->bucketCount);
+    /* Find the key and return its value */
+    psCurrentNode = SymTable_find(oSymTable, pcKey, &i, &psPrevNode);
+    SymTable_touch(oSymTable, psCurrentNode);
+    if (psCurrentNode == NULL) return NULL;
 
-    /* Check the corresponding bucket for the key and return its 
-    value */
-    for (psCurrentNode = oSymTable->ppsFirstNodes[i];
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-      psNextNode = psCurrentNode->psNextNode;
-      if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-            return (void*)psCurrentNode->pvValue;
+    return (void*)psCurrentNode->pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The number of lookups that SymTable_getBatch keeps in flight, enough
+to cover a memory access with the work of the others, and the fewest
+bindings for which it interleaves them. Smaller tables stay in cache,
+where plain lookups are faster. */
+
+enum {BATCH_WIDTH = 16, BATCH_MIN_LENGTH = 16384};
+
+/* What a lookup of SymTable_getBatch waits for next */
+
+enum LookupStage {LOOKUP_BUCKET, LOOKUP_NODE, LOOKUP_KEY, LOOKUP_DONE};
+
+/* One lookup in flight, a small state machine that advances one
+memory access at a time. */
+
+struct Lookup {
+    /* The index of the key in the batch */
+    size_t uIndex;
+    /* The hash code of the key */
+    size_t uHash;
+    /* The bucket of the key */
+    const struct Bucket *psBucket;
+    /* The node being examined, which is the node found once the lookup
+    is done, or NULL if it found none */
+    struct Node *psNode;
+    /* What the lookup waits for, whose address has been prefetched */
+    enum LookupStage eStage;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Start psLookup on key uIndex of the uCount keys in apcKeys,
+prefetching its bucket and the key that will be started BATCH_WIDTH
+keys later. */
+static void SymTable_startLookup(SymTable_T oSymTable,
+                                 struct Lookup *psLookup,
+                                 const char *const *apcKeys,
+                                 size_t uCount, size_t uIndex) {
+    assert(oSymTable != NULL);
+    assert(psLookup != NULL);
+    assert(apcKeys != NULL);
+
+    psLookup->uIndex = uIndex;
+    if (uIndex + BATCH_WIDTH < uCount)
+        SymTable_prefetch(apcKeys[uIndex + BATCH_WIDTH]);
+    psLookup->uHash = KeyOps_hash(apcKeys[uIndex]);
+    psLookup->psBucket =
+        &oSymTable->psBuckets[psLookup->uHash % oSymTable->bucketCount];
+    SymTable_prefetch(psLookup->psBucket);
+    psLookup->eStage = LOOKUP_BUCKET;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move psLookup to node psNode, prefetching it, or finish it with no
+value if psNode is NULL. Return 1 (TRUE) if psLookup is finished, and
+0 (FALSE) otherwise. */
+static int SymTable_visitNode(struct Lookup *psLookup,
+                              struct Node *psNode,
+                              void **apvValues) {
+    assert(psLookup != NULL);
+    assert(apvValues != NULL);
+
+    if (psNode == NULL) {
+        apvValues[psLookup->uIndex] = NULL;
+        psLookup->psNode = NULL;
+        return 1;
+    }
+    SymTable_prefetch(psNode);
+    psLookup->psNode = psNode;
+    psLookup->eStage = LOOKUP_NODE;
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Advance psLookup by the one step whose data it has prefetched, and
+prefetch what the next step needs. Return 1 (TRUE) if psLookup is
+finished and its value stored in apvValues, and 0 (FALSE) otherwise. */
+static int SymTable_stepLookup(struct Lookup *psLookup,
+                               const char *const *apcKeys,
+                               void **apvValues) {
+    const struct Node *psNode;
+
+    assert(psLookup != NULL);
+    assert(apcKeys != NULL);
+    assert(apvValues != NULL);
+
+    switch (psLookup->eStage) {
+        case LOOKUP_BUCKET:
+            if (!SymTable_mayHold(psLookup->psBucket,
+                                  SymTable_tagOf(psLookup->uHash)))
+                return SymTable_visitNode(psLookup, NULL, apvValues);
+            return SymTable_visitNode(psLookup,
+                                      psLookup->psBucket->psFirstNode,
+                                      apvValues);
+        case LOOKUP_NODE:
+            psNode = psLookup->psNode;
+            if (psNode->uHash != psLookup->uHash)
+                return SymTable_visitNode(psLookup, psNode->psNextNode,
+                                          apvValues);
+            SymTable_prefetch(psNode->pcKey);
+            psLookup->eStage = LOOKUP_KEY;
+            return 0;
+        case LOOKUP_KEY:
+            psNode = psLookup->psNode;
+            if (!KeyOps_equals(psNode->pcKey,
+                               apcKeys[psLookup->uIndex]))
+                return SymTable_visitNode(psLookup, psNode->psNextNode,
+                                          apvValues);
+            apvValues[psLookup->uIndex] = (void*)psNode->pvValue;
+            return 1;
+        default:
+            assert(0);
+            return 1;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_getBatch(SymTable_T oSymTable,
+                       const char *const *apcKeys, size_t uCount,
+                       void **apvValues) {
+    struct Lookup asLookups[BATCH_WIDTH];
+    size_t uNext = 0;
+    size_t uActive = 0;
+    size_t u;
+
+    assert(oSymTable != NULL);
+    assert(apcKeys != NULL || uCount == 0);
+    assert(apvValues != NULL || uCount == 0);
+
+    /* Keys of an interned table must first be found in the pool */
+    if (oSymTable->oKeyPool != NULL ||
+        oSymTable->length < BATCH_MIN_LENGTH) {
+        for (u = 0; u < uCount; u++)
+            apvValues[u] = SymTable_get(oSymTable, apcKeys[u]);
+        return;
+    }
+
+    for (u = 0; u < BATCH_WIDTH; u++) {
+        if (uNext < uCount) {
+            SymTable_startLookup(oSymTable, &asLookups[u], apcKeys,
+                                 uCount, uNext++);
+            uActive++;
         }
+        else asLookups[u].eStage = LOOKUP_DONE;
     }
 
-    return NULL;
+    /* Step each lookup in turn, so that its prefetch has had the
+    others' steps to complete, and give each finished lookup's place
+    to the next key. A table that evicts counts each finished lookup
+    and makes the node it found the most recently used. */
+    while (uActive > 0) {
+        for (u = 0; u < BATCH_WIDTH; u++) {
+            if (asLookups[u].eStage == LOOKUP_DONE) continue;
+            if (!SymTable_stepLookup(&asLookups[u], apcKeys, apvValues))
+                continue;
+            SymTable_touch(oSymTable, asLookups[u].psNode);
+            if (uNext < uCount)
+                SymTable_startLookup(oSymTable, &asLookups[u], apcKeys,
+                                     uCount, uNext++);
+            else {
+                asLookups[u].eStage = LOOKUP_DONE;
+                uActive--;
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_getCacheStats(SymTable_T oSymTable, size_t *puHits,
+                            size_t *puMisses, size_t *puEvictions) {
+    assert(oSymTable != NULL);
+
+    if (puHits != NULL) *puHits = oSymTable->uHits;
+    if (puMisses != NULL) *puMisses = oSymTable->uMisses;
+    if (puEvictions != NULL) *puEvictions = oSymTable->uEvictions;
 }
 
 /*--------------------------------------------------------------------*/
 
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
     struct Node *psCurrentNode;
-    struct Node *psNextNode;
-    struct Node *psPrevNode = NULL;
+    struct Node *psPrevNode;
+    void *value;
+    size_t uValueSize;
     size_t i;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
-    
-    /* Hash the key */
-    i = SymTable_hash(pcKey, oSymTable->bucketCount);
-
-    /* Check the corresponding bucket for the key, remove it, and return
-    its value */
-    for (psCurrentNode = oSymTable->ppsFirstNodes[i];
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-      psNextNode = psCurrentNode->psNextNode;
-      if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-            void *value = (void*)psCurrentNode->pvValue;
 
-            if (psPrevNode == NULL) {
-                oSymTable->ppsFirstNodes[i] = psNextNode;
-            }
-            else psPrevNode->psNextNode = psNextNode;
+    /* Find the key, remove it, and return its value */
+    psCurrentNode = SymTable_find(oSymTable, pcKey, &i, &psPrevNode);
+    if (psCurrentNode == NULL || !SymTable_canChange(oSymTable) ||
+        !SymTable_prepareRecord(oSymTable, RECORD_REMOVE, pcKey, NULL,
+                                &uValueSize))
+        return NULL;
 
-            /* Free the memory in which the key resides */
-            free((char*)psCurrentNode->pcKey);
-            free(psCurrentNode);
+    value = (void*)psCurrentNode->pvValue;
+    SymTable_appendRecord(oSymTable, RECORD_REMOVE, pcKey, NULL, 0);
 
-            oSymTable->length--;
+    SymTable_unlink(&oSymTable->psBuckets[i], psCurrentNode, psPrevNode);
+    SymTable_forget(oSymTable, psCurrentNode);
 
-            return value;
-        }
-      psPrevNode = psCurrentNode;
+    /* A transaction keeps the node until it ends, so that an abort can
+    link it again */
+    if (oSymTable->psUndos != NULL)
+        SymTable_logChange(oSymTable, UNDO_REMOVE, psCurrentNode, NULL);
+    else {
+        SymTable_releaseKey(oSymTable, psCurrentNode->pcKey);
+        SymTable_release(oSymTable, psCurrentNode,
+                         SymTable_nodeSize(oSymTable));
     }
 
-    return NULL;
+    oSymTable->length--;
+
+    /* Rebuild the filter once it holds as many removed keys as live
+    ones, and enough to pay for visiting every bucket */
+    if (oSymTable->puFilter != NULL &&
+        ++oSymTable->uFilterStale > oSymTable->length &&
+        oSymTable->uFilterStale >= oSymTable->bucketCount / 4)
+        (void)SymTable_buildFilter(oSymTable);
+
+    return value;
 }
 
 /*--------------------------------------------------------------------*/
@@ -355,11 +2284,13 @@ void SymTable_map(SymTable_T oSymTable,
 
     /* Iterate through the buckets */
     for (i = 0; i < oSymTable->bucketCount; i++){
+        SymTable_prefetchWalk(oSymTable, i);
         /* Walk through the list at each bucket */
-        for (psCurrentNode = oSymTable->ppsFirstNodes[i];
+        for (psCurrentNode = oSymTable->psBuckets[i].psFirstNode;
              psCurrentNode != NULL;
              psCurrentNode = psNextNode) {
          psNextNode = psCurrentNode->psNextNode;
+         if (psNextNode != NULL) SymTable_prefetch(psNextNode);
 
          (*pfApply)(psCurrentNode->pcKey,
                     (void*)psCurrentNode->pvValue,
@@ -370,4 +2301,513 @@ void SymTable_map(SymTable_T oSymTable,
    return;
 }
 
+/*--------------------------------------------------------------------*/
+
+int SymTable_begin(SymTable_T oSymTable, size_t uMaxChanges) {
+    assert(oSymTable != NULL);
+
+    if (oSymTable->psUndos != NULL || uMaxChanges == 0 ||
+        oSymTable->sOptions.iEvict)
+        return 0;
+
+    oSymTable->psUndos = (struct Undo*)
+        SymTable_alloc(oSymTable, uMaxChanges * sizeof(struct Undo));
+    if (oSymTable->psUndos == NULL) return 0;
+
+    oSymTable->uUndoCapacity = uMaxChanges;
+    oSymTable->uUndoCount = 0;
+    oSymTable->uUndoSequence = oSymTable->uSequence;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the undo log of oSymTable, closing its transaction. */
+static void SymTable_endTransaction(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    assert(oSymTable->psUndos != NULL);
+
+    SymTable_release(oSymTable, oSymTable->psUndos,
+                     oSymTable->uUndoCapacity * sizeof(struct Undo));
+    oSymTable->psUndos = NULL;
+    oSymTable->uUndoCapacity = 0;
+    oSymTable->uUndoCount = 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_commit(SymTable_T oSymTable) {
+    struct Undo *psUndo;
+    size_t u;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->psUndos != NULL);
+
+    /* Only the removed nodes, kept for an abort, remain to be freed */
+    for (u = 0; u < oSymTable->uUndoCount; u++) {
+        psUndo = &oSymTable->psUndos[u];
+        if (psUndo->eKind != UNDO_REMOVE) continue;
+        SymTable_releaseKey(oSymTable, psUndo->psNode->pcKey);
+        SymTable_release(oSymTable, psUndo->psNode,
+                         SymTable_nodeSize(oSymTable));
+    }
+
+    SymTable_endTransaction(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_abort(SymTable_T oSymTable) {
+    struct Undo *psUndo;
+    struct Bucket *psBucket;
+    struct Node *psCurrentNode;
+    struct Node *psPrevNode;
+    size_t u;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->psUndos != NULL);
+
+    /* Reverse the changes, latest first. Nodes are found by their
+    stored hash codes, since an expansion may have moved them. */
+    for (u = oSymTable->uUndoCount; u > 0; u--) {
+        psUndo = &oSymTable->psUndos[u - 1];
+        psBucket = &oSymTable->psBuckets[psUndo->psNode->uHash
+                                         % oSymTable->bucketCount];
+        switch (psUndo->eKind) {
+        case UNDO_PUT:
+            psPrevNode = NULL;
+            for (psCurrentNode = psBucket->psFirstNode;
+                 psCurrentNode != psUndo->psNode;
+                 psCurrentNode = psCurrentNode->psNextNode)
+                psPrevNode = psCurrentNode;
+            SymTable_unlink(psBucket, psUndo->psNode, psPrevNode);
+            /* A borrowed key goes back to the caller unfreed */
+            if (oSymTable->oKeyPool == NULL &&
+                !oSymTable->sOptions.iBorrowKeys)
+                SymTable_release(oSymTable, psUndo->psNode->pcKey,
+                                 strlen(psUndo->psNode->pcKey) + 1);
+            SymTable_release(oSymTable, psUndo->psNode,
+                             SymTable_nodeSize(oSymTable));
+            oSymTable->length--;
+            oSymTable->uFilterStale++;
+            break;
+        case UNDO_REPLACE:
+            psUndo->psNode->pvValue = psUndo->pvOldValue;
+            break;
+        case UNDO_REMOVE:
+            SymTable_linkFirst(psBucket, psUndo->psNode);
+            oSymTable->length++;
+            break;
+        }
+    }
+
+    /* Forget the records of the changes, as if they never happened */
+    if (oSymTable->sOptions.pfEncodeValue != NULL)
+        oSymTable->uLogSize =
+            SymTable_logOffset(oSymTable, oSymTable->uUndoSequence);
+    oSymTable->uSequence = oSymTable->uUndoSequence;
+
+    SymTable_endTransaction(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getSequence(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    return oSymTable->uSequence;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_exportChanges(SymTable_T oSymTable, size_t uSince,
+                           void **ppvDelta, size_t *puSize) {
+    unsigned char *pucDelta;
+    size_t uStart;
+    size_t uBodySize;
+
+    assert(oSymTable != NULL);
+    assert(ppvDelta != NULL);
+    assert(puSize != NULL);
+
+    if (oSymTable->sOptions.pfEncodeValue == NULL ||
+        oSymTable->psUndos != NULL ||
+        uSince < oSymTable->uLogBase || uSince > oSymTable->uSequence)
+        return 0;
+
+    /* The records of the changes are already in delta format */
+    uStart = SymTable_logOffset(oSymTable, uSince);
+    uBodySize = oSymTable->uLogSize - uStart;
+    pucDelta = SymTable_newDelta(DELTA_CHANGES, uSince,
+                                 oSymTable->uSequence, uBodySize);
+    if (pucDelta == NULL) return 0;
+    if (uBodySize > 0)
+        memcpy(&pucDelta[DELTA_HEADER_SIZE],
+               &oSymTable->pucLog[uStart], uBodySize);
+
+    *ppvDelta = pucDelta;
+    *puSize = DELTA_HEADER_SIZE + uBodySize;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_exportTable(SymTable_T oSymTable, void **ppvSnapshot,
+                         size_t *puSize) {
+    struct Node *psCurrentNode;
+    unsigned char *pucSnapshot;
+    size_t uBodySize = 0;
+    size_t uPosition;
+    size_t uKeyLength;
+    size_t uValueSize;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(ppvSnapshot != NULL);
+    assert(puSize != NULL);
+
+    if (oSymTable->sOptions.pfEncodeValue == NULL ||
+        oSymTable->psUndos != NULL)
+        return 0;
+
+    /* Size the records of a put of each binding, then write them */
+    for (i = 0; i < oSymTable->bucketCount; i++)
+        for (psCurrentNode = oSymTable->psBuckets[i].psFirstNode;
+             psCurrentNode != NULL;
+             psCurrentNode = psCurrentNode->psNextNode) {
+            uKeyLength = strlen(psCurrentNode->pcKey);
+            uValueSize = (*oSymTable->sOptions.pfEncodeValue)(
+                psCurrentNode->pvValue, NULL, 0,
+                oSymTable->sOptions.pvCodec);
+            if (uKeyLength > MAX_RECORD_FIELD ||
+                uValueSize > MAX_RECORD_FIELD)
+                return 0;
+            uBodySize += SymTable_recordSize(RECORD_PUT, uKeyLength,
+                                             uValueSize);
+        }
+
+    pucSnapshot = SymTable_newDelta(DELTA_SNAPSHOT, 0,
+                                    oSymTable->uSequence, uBodySize);
+    if (pucSnapshot == NULL) return 0;
+
+    uPosition = DELTA_HEADER_SIZE;
+    for (i = 0; i < oSymTable->bucketCount; i++)
+        for (psCurrentNode = oSymTable->psBuckets[i].psFirstNode;
+             psCurrentNode != NULL;
+             psCurrentNode = psCurrentNode->psNextNode) {
+            uValueSize = (*oSymTable->sOptions.pfEncodeValue)(
+                psCurrentNode->pvValue, NULL, 0,
+                oSymTable->sOptions.pvCodec);
+            uPosition += SymTable_writeRecord(oSymTable,
+                &pucSnapshot[uPosition], RECORD_PUT,
+                psCurrentNode->pcKey, strlen(psCurrentNode->pcKey),
+                psCurrentNode->pvValue, uValueSize);
+        }
+    assert(uPosition == DELTA_HEADER_SIZE + uBodySize);
+
+    *ppvSnapshot = pucSnapshot;
+    *puSize = uPosition;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_trimChanges(SymTable_T oSymTable, size_t uThrough) {
+    size_t uStart;
+    size_t uDropped;
+    size_t u;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->psUndos == NULL);
+
+    if (uThrough > oSymTable->uSequence) uThrough = oSymTable->uSequence;
+    if (uThrough <= oSymTable->uLogBase) return;
+
+    /* Slide the records that remain, and their offsets, to the front */
+    if (oSymTable->sOptions.pfEncodeValue != NULL) {
+        uStart = SymTable_logOffset(oSymTable, uThrough);
+        uDropped = uThrough - oSymTable->uLogBase;
+        memmove(oSymTable->pucLog, &oSymTable->pucLog[uStart],
+                oSymTable->uLogSize - uStart);
+        oSymTable->uLogSize -= uStart;
+        for (u = 0; u < oSymTable->uSequence - uThrough; u++)
+            oSymTable->puLogOffsets[u] =
+                oSymTable->puLogOffsets[u + uDropped] - uStart;
+    }
+
+    oSymTable->uLogBase = uThrough;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A record of a delta, as SymTable_nextRecord reads it */
+
+struct Record {
+    /* The kind of change */
+    enum RecordKind eKind;
+    /* The bytes of the key, which are not terminated */
+    const unsigned char *pucKey;
+    /* The number of bytes of the key */
+    size_t uKeyLength;
+    /* The encoding of the value, and its number of bytes */
+    const unsigned char *pucValue;
+    size_t uValueSize;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Read into *psRecord the record at *puPosition within the uSize
+bytes of pucDelta, and advance *puPosition past it. Return 1 (TRUE)
+if the record is well formed, and 0 (FALSE) otherwise. */
+static int SymTable_nextRecord(const unsigned char *pucDelta,
+                               size_t uSize, size_t *puPosition,
+                               struct Record *psRecord) {
+    size_t uPosition;
+    size_t uRoom;
+
+    assert(pucDelta != NULL);
+    assert(puPosition != NULL);
+    assert(psRecord != NULL);
+
+    uPosition = *puPosition;
+    if (uSize - uPosition < 5) return 0;
+    if (pucDelta[uPosition] < RECORD_PUT ||
+        pucDelta[uPosition] > RECORD_REMOVE)
+        return 0;
+    psRecord->eKind = (enum RecordKind)pucDelta[uPosition];
+    psRecord->uKeyLength =
+        (size_t)SymTable_loadBytes(&pucDelta[uPosition + 1], 4);
+    uPosition += 5;
+
+    /* Keys are strings, so may not hold a null character */
+    uRoom = uSize - uPosition;
+    if (psRecord->uKeyLength > uRoom) return 0;
+    psRecord->pucKey = &pucDelta[uPosition];
+    if (memchr(psRecord->pucKey, '\0', psRecord->uKeyLength) != NULL)
+        return 0;
+    uPosition += psRecord->uKeyLength;
+
+    psRecord->pucValue = NULL;
+    psRecord->uValueSize = 0;
+    if (psRecord->eKind != RECORD_REMOVE) {
+        if (uSize - uPosition < 4) return 0;
+        psRecord->uValueSize =
+            (size_t)SymTable_loadBytes(&pucDelta[uPosition], 4);
+        uPosition += 4;
+        if (psRecord->uValueSize > uSize - uPosition) return 0;
+        psRecord->pucValue = &pucDelta[uPosition];
+        uPosition += psRecord->uValueSize;
+    }
+
+    *puPosition = uPosition;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_applyChanges(SymTable_T oSymTable, const void *pvDelta,
+    size_t uSize,
+    int (*pfDecodeValue)(const void *pvBytes, size_t uSize,
+                         void **ppvValue, void *pvCodec),
+    void *pvCodec, size_t *puSequence) {
+    const unsigned char *pucDelta = (const unsigned char*)pvDelta;
+    struct Record sRecord;
+    uint64_t uBase;
+    uint64_t uEnd;
+    size_t uRecordCount = 0;
+    size_t uMaxKeyLength = 0;
+    size_t uSkip;
+    size_t uPosition;
+    size_t uUndoCount;
+    size_t uDecoded = 0;
+    size_t u;
+    void **apvDecoded;
+    char *pcKey;
+    int iKind;
+    int iApplied = 1;
+
+    assert(oSymTable != NULL);
+    assert(pvDelta != NULL || uSize == 0);
+    assert(pfDecodeValue != NULL);
+    assert(puSequence != NULL);
+    assert(!oSymTable->sOptions.iBorrowKeys);
+
+    if (oSymTable->psUndos != NULL) return 0;
+
+    /* Check the header */
+    if (uSize < DELTA_HEADER_SIZE ||
+        memcmp(pucDelta, aucDeltaMagic, sizeof(aucDeltaMagic)) != 0)
+        return 0;
+    iKind = pucDelta[4];
+    uBase = SymTable_loadBytes(&pucDelta[5], 8);
+    uEnd = SymTable_loadBytes(&pucDelta[13], 8);
+    if ((iKind != DELTA_CHANGES && iKind != DELTA_SNAPSHOT) ||
+        uBase > uEnd || uEnd != (uint64_t)(size_t)uEnd ||
+        (iKind == DELTA_SNAPSHOT && uBase != 0))
+        return 0;
+
+    /* Check every record before changing anything */
+    for (uPosition = DELTA_HEADER_SIZE; uPosition < uSize; ) {
+        if (!SymTable_nextRecord(pucDelta, uSize, &uPosition, &sRecord))
+            return 0;
+        if (iKind == DELTA_SNAPSHOT && sRecord.eKind != RECORD_PUT)
+            return 0;
+        if (sRecord.uKeyLength > uMaxKeyLength)
+            uMaxKeyLength = sRecord.uKeyLength;
+        uRecordCount++;
+    }
+
+    /* A delta of changes must hold one record for each, and continue
+    from the replica's sequence number; a snapshot must fill an empty
+    table */
+    if (iKind == DELTA_CHANGES) {
+        if (uRecordCount != uEnd - uBase ||
+            *puSequence < uBase || *puSequence > uEnd)
+            return 0;
+        uSkip = *puSequence - (size_t)uBase;
+    }
+    else {
+        if (oSymTable->length != 0) return 0;
+        uSkip = 0;
+    }
+    if (uRecordCount == uSkip) {
+        *puSequence = (size_t)uEnd;
+        return 1;
+    }
+
+    apvDecoded = (void**)malloc((uRecordCount - uSkip) * sizeof(void*));
+    if (apvDecoded == NULL) return 0;
+    pcKey = (char*)malloc(uMaxKeyLength + 1);
+    if (pcKey == NULL) {
+        free(apvDecoded);
+        return 0;
+    }
+    if (!SymTable_begin(oSymTable, uRecordCount - uSkip)) {
+        free(pcKey);
+        free(apvDecoded);
+        return 0;
+    }
+
+    /* Apply the records within a transaction, so that a change that
+    cannot be made undoes the others */
+    uPosition = DELTA_HEADER_SIZE;
+    for (u = 0; u < uRecordCount && iApplied; u++) {
+        (void)SymTable_nextRecord(pucDelta, uSize, &uPosition, &sRecord);
+        if (u < uSkip) continue;
+
+        memcpy(pcKey, sRecord.pucKey, sRecord.uKeyLength);
+        pcKey[sRecord.uKeyLength] = '\0';
+        if (sRecord.eKind != RECORD_REMOVE) {
+            if (!(*pfDecodeValue)(sRecord.pucValue, sRecord.uValueSize,
+                                  &apvDecoded[uDecoded], pvCodec)) {
+                iApplied = 0;
+                break;
+            }
+            uDecoded++;
+        }
+
+        /* Each change that is made enters the undo log */
+        uUndoCount = oSymTable->uUndoCount;
+        switch (sRecord.eKind) {
+        case RECORD_PUT:
+            (void)SymTable_put(oSymTable, pcKey,
+                               apvDecoded[uDecoded - 1]);
+            break;
+        case RECORD_REPLACE:
+            (void)SymTable_replace(oSymTable, pcKey,
+                                   apvDecoded[uDecoded - 1]);
+            break;
+        case RECORD_REMOVE:
+            (void)SymTable_remove(oSymTable, pcKey);
+            break;
+        }
+        iApplied = oSymTable->uUndoCount > uUndoCount;
+    }
+
+    free(pcKey);
+
+    /* The table owns the values it keeps, and releases those that it
+    no longer binds */
+    if (!iApplied) {
+        SymTable_abort(oSymTable);
+        if (oSymTable->sOptions.pfFreeValue != NULL)
+            for (u = 0; u < uDecoded; u++)
+                (*oSymTable->sOptions.pfFreeValue)(apvDecoded[u]);
+        free(apvDecoded);
+        return 0;
+    }
+
+    if (oSymTable->sOptions.pfFreeValue != NULL)
+        for (u = 0; u < oSymTable->uUndoCount; u++) {
+            if (oSymTable->psUndos[u].eKind == UNDO_REPLACE)
+                (*oSymTable->sOptions.pfFreeValue)(
+                    (void*)oSymTable->psUndos[u].pvOldValue);
+            else if (oSymTable->psUndos[u].eKind == UNDO_REMOVE)
+                (*oSymTable->sOptions.pfFreeValue)(
+                    (void*)oSymTable->psUndos[u].psNode->pvValue);
+        }
+    SymTable_commit(oSymTable);
+    free(apvDecoded);
+
+    *puSequence = (size_t)uEnd;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_getInterned(SymTable_T oSymTable,
+                           const char *pcInternedKey) {
+    struct Node *psCurrentNode;
+    struct Node *psPrevNode;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcInternedKey != NULL);
+
+    psCurrentNode = SymTable_findInterned(oSymTable, pcInternedKey, &i,
+                                          &psPrevNode);
+    if (psCurrentNode == NULL) return NULL;
+
+    return (void*)psCurrentNode->pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_containsInterned(SymTable_T oSymTable,
+                              const char *pcInternedKey) {
+    struct Node *psPrevNode;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcInternedKey != NULL);
+
+    return SymTable_findInterned(oSymTable, pcInternedKey, &i,
+                                 &psPrevNode) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getBytes(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+#ifdef __GNUC__
+    return __atomic_load_n(&oSymTable->uBytes, __ATOMIC_RELAXED);
+#else
+    return oSymTable->uBytes;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getTotalBytes(void) {
+    SymTable_T oSymTable;
+    size_t uTotal = 0;
+
+    pthread_mutex_lock(&sTablesLock);
+    for (oSymTable = oLastTable; oSymTable != NULL;
+         oSymTable = oSymTable->oPrevTable)
+        uTotal += SymTable_getBytes(oSymTable);
+    pthread_mutex_unlock(&sTablesLock);
 
+    return uTotal;
+}
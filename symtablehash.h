@@ -0,0 +1,308 @@
+/*--------------------------------------------------------------------*/
+/* symtablehash.h                                                     */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEHASH_INCLUDED
+#define SYMTABLEHASH_INCLUDED
+
+#include "symtable.h"
+#include "keypool.h"
+
+/* Extensions of the SymTable ADT that only the hash table
+implementation (symtablehash.c) provides. */
+
+/*--------------------------------------------------------------------*/
+
+/* Choices made when a SymTable object is created with SymTable_newEx.
+Set every field with SymTable_initOptions before changing any, so that
+fields added later get their defaults. */
+
+struct SymTable_Options {
+    /* If not NULL, SymTable_free calls (*pfFreeValue)(pvValue) for the
+    value of each binding still in the table. Values returned by
+    SymTable_replace and SymTable_remove belong to the caller. The
+    default is NULL. */
+    void (*pfFreeValue)(void *pvValue);
+
+    /* If 1 (TRUE), the table stores the caller's key pointers instead
+    of copies, and each key must stay unchanged while it is bound. The
+    default is 0 (FALSE). */
+    int iBorrowKeys;
+
+    /* If iBorrowKeys is 1 (TRUE) and this is not NULL, the table calls
+    (*pfFreeKey)(pcKey) on a borrowed key when its binding is removed
+    or the table is freed, so that the table owns the keys it was
+    given. The default is NULL. */
+    void (*pfFreeKey)(void *pcKey);
+
+    /* If not NULL, the table gets all of its memory, including the
+    copies of its keys, from (*pfMalloc)(uSize, pvAllocator), which
+    returns NULL if it has none, and gives each block back with
+    (*pfFree)(pv, uSize, pvAllocator). Set both or neither. The
+    defaults are NULL, which mean malloc and free. */
+    void *(*pfMalloc)(size_t uSize, void *pvAllocator);
+    void (*pfFree)(void *pv, size_t uSize, void *pvAllocator);
+    void *pvAllocator;
+
+    /* If not 0, the most bytes the table may hold allocated at once,
+    as SymTable_getBytes counts them. A call of SymTable_put that
+    would pass the limit leaves the table unchanged and returns 0
+    (FALSE), unless the table evicts, and an expansion that would pass
+    it is skipped. The default is 0. */
+    size_t uMaxBytes;
+
+    /* If not NULL, the table keeps a change log (see
+    SymTable_exportChanges), in which it encodes each value that it
+    binds by calling (*pfEncodeValue)(pvValue, pvBytes, uRoom,
+    pvCodec). The call returns the number of bytes of the encoding,
+    and writes them to pvBytes only if uRoom is at least that number.
+    Values are encoded when they are bound, so may later be freed. The
+    defaults are NULL. */
+    size_t (*pfEncodeValue)(const void *pvValue, void *pvBytes,
+                            size_t uRoom, void *pvCodec);
+    void *pvCodec;
+    /* If not 0, the table keeps a Bloom filter of its keys with about
+    this many bits for each bucket, which SymTable_contains,
+    SymTable_get, SymTable_replace and SymTable_remove check before
+    the buckets. A key that is absent is then usually rejected by one
+    cache line of the filter, which is many times smaller than the
+    buckets and so more often in cache. 10 bits reject about 99% of
+    absent keys when the table is full. Removed keys stay in the
+    filter, and the filter is rebuilt when they are many. The default
+    is 0. */
+    size_t uFilterBitsPerKey;
+
+    /* If not 0, the most bindings the table may hold. A call of
+    SymTable_put that would pass the limit leaves the table unchanged
+    and returns 0 (FALSE), unless the table evicts. The default is
+    0. */
+    size_t uMaxBindings;
+
+    /* If not 0, the table is a cache: SymTable_put evicts the least
+    recently used bindings, as many as it must to stay within
+    uMaxBindings and uMaxBytes, before it would fail. A binding is
+    used when it is put, or found by SymTable_get, SymTable_contains
+    or SymTable_replace. Each evicted value is passed to
+    (*pfEvict)(pcKey, pvValue, pvEvictExtra), or released with
+    pfFreeValue if pfEvict is NULL, before its key is freed. A put
+    that fails evicts nothing. *pfEvict must not call functions of the
+    table. Each node of the table then holds two more pointers, and
+    the table refuses transactions, so cannot be the target of
+    SymTable_applyChanges. The defaults are 0 and NULL. */
+    int iEvict;
+    void (*pfEvict)(const char *pcKey, void *pvValue,
+                    void *pvEvictExtra);
+    void *pvEvictExtra;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Sets every field of *psOptions to its default. */
+  void SymTable_initOptions(struct SymTable_Options *psOptions);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new SymTable object that contains no bindings and behaves
+as *psOptions says, or NULL if insufficient memory is available.
+SymTable_newEx with default options is SymTable_new. */
+  SymTable_T SymTable_newEx(const struct SymTable_Options *psOptions);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bytes that oSymTable holds allocated: the
+table itself, its buckets, its nodes and the copies of its keys, and
+also its change log (see pfEncodeValue), its filter (see
+uFilterBitsPerKey) and the undo log of an open transaction (see
+SymTable_begin), with the nodes that the transaction removed. It
+does not count borrowed or interned keys, or values. uMaxBytes limits
+this number, so it must leave room for the logs and filter too. */
+  size_t SymTable_getBytes(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the sum of SymTable_getBytes over all hash table SymTable
+objects that exist, visiting each of them, so that puts and removes
+need update only their own table's count */
+  size_t SymTable_getTotalBytes(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new SymTable object, created with *psOptions (or the
+defaults if psOptions is NULL), that binds each of the uCount keys in
+apcKeys to the value at the same index of apvValues (or to NULL if
+apvValues is NULL), or NULL if insufficient memory is available. When
+a key occurs more than once, its first occurrence is bound, as by
+repeated calls of SymTable_put, and the number of later occurrences
+is stored in *puDuplicates unless puDuplicates is NULL. The table
+does not take ownership of duplicate keys or their values. The keys
+are hashed and bound by up to uThreadCount threads (at most 256),
+each of which owns a range of buckets, so no locks are taken. The
+result is an ordinary table. A custom allocator in *psOptions may be
+called from several threads at once. A table that does not evict is
+not built, and NULL is returned, if it would hold more bindings than
+uMaxBindings. One that evicts keeps as many of them as fit, evicting
+the rest, and is not built if its change log has no room for the
+evictions; the bindings evicted by then have been passed to the
+eviction function or released. */
+  SymTable_T SymTable_newBulk(const char *const *apcKeys,
+     const void *const *apvValues, size_t uCount, size_t uThreadCount,
+     const struct SymTable_Options *psOptions, size_t *puDuplicates);
+
+/*--------------------------------------------------------------------*/
+
+/* Stores in apvValues[i], for each i below uCount, the value of the
+binding within oSymTable whose key is apcKeys[i], or NULL if no such
+binding exists, as SymTable_get would. The lookups are interleaved:
+while one waits for a bucket, node or key to arrive from memory, the
+others proceed, so tables too large for the cache answer many
+independent lookups about twice as fast as one at a time. Tables that
+fit in the cache gain nothing. A table that evicts counts each lookup
+and makes each binding found the most recently used, in the order in
+which the lookups finish. */
+  void SymTable_getBatch(SymTable_T oSymTable,
+     const char *const *apcKeys, size_t uCount, void **apvValues);
+
+/*--------------------------------------------------------------------*/
+
+/* Stores in *puHits and *puMisses the numbers of lookups on oSymTable
+by SymTable_get, SymTable_contains and SymTable_getBatch that found
+their keys and that did not, and in *puEvictions the number of
+bindings it has evicted, unless the pointer is NULL. SymTable_replace
+makes the binding it changes the most recently used, but is not
+counted. The numbers are 0 unless oSymTable evicts (see
+SymTable_Options). */
+  void SymTable_getCacheStats(SymTable_T oSymTable, size_t *puHits,
+     size_t *puMisses, size_t *puEvictions);
+
+/*--------------------------------------------------------------------*/
+
+/* Opens a transaction on oSymTable that may make up to uMaxChanges
+calls of SymTable_put, SymTable_replace and SymTable_remove that
+change the table, and returns 1 (TRUE). Returns 0 (FALSE) and opens
+nothing if oSymTable has an open transaction or evicts, if
+uMaxChanges is 0, or if insufficient memory is available for the undo
+log, which is allocated here, once. A change beyond uMaxChanges is
+refused as if memory were short: SymTable_put returns 0 (FALSE), and
+SymTable_replace and SymTable_remove return NULL and change nothing.
+Nodes removed within the transaction, and their keys, stay allocated
+until it ends, so the values that SymTable_replace and SymTable_remove
+return must not be freed before SymTable_commit. */
+  int SymTable_begin(SymTable_T oSymTable, size_t uMaxChanges);
+
+/*--------------------------------------------------------------------*/
+
+/* Ends the open transaction of oSymTable, keeping its changes. Cannot
+fail, and takes time in proportion to the number of changes.
+SymTable_free commits an open transaction first. */
+  void SymTable_commit(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Ends the open transaction of oSymTable, reversing its changes in
+time proportional to their number, so that the table holds the
+bindings it held at SymTable_begin (though perhaps in more buckets).
+Cannot fail. Borrowed keys of reversed puts are given back to the
+caller, not freed. */
+  void SymTable_abort(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of changes that calls of SymTable_put,
+SymTable_replace and SymTable_remove have made to oSymTable, less
+those undone by SymTable_abort. Bindings made by SymTable_newBulk are
+not counted. */
+  size_t SymTable_getSequence(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Stores in *ppvDelta a delta that holds the changes made to oSymTable
+after its sequence number was uSince, and in *puSize its number of
+bytes, and returns 1 (TRUE). The delta comes from malloc, and the
+caller frees it. Returns 0 (FALSE) and stores nothing if oSymTable
+keeps no change log, has an open transaction, or has trimmed the
+change after uSince, if uSince is beyond its sequence number, or if
+insufficient memory is available.
+
+A delta is a self-contained sequence of bytes that can be written to
+a pipe, a file or shared memory: the 4 bytes "SymD", a byte that is 0
+for changes and 1 for a snapshot, then the sequence numbers before
+and after the changes in 8 bytes each, then one record for each
+change. A record is a byte that is 1 for a put, 2 for a replace or 3
+for a remove, the length of the key in 4 bytes and its characters,
+and, unless it is a remove, the length of the value's encoding in 4
+bytes and its bytes. All numbers are stored least significant byte
+first. */
+  int SymTable_exportChanges(SymTable_T oSymTable, size_t uSince,
+     void **ppvDelta, size_t *puSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Stores in *ppvSnapshot a delta, like those of
+SymTable_exportChanges, that puts every binding of oSymTable into an
+empty table and brings its sequence number to that of oSymTable, and
+in *puSize its number of bytes, and returns 1 (TRUE). Returns 0
+(FALSE) and stores nothing if oSymTable keeps no change log, has an
+open transaction, or insufficient memory is available. A replica
+starts from a snapshot, and from then on can be kept up to date with
+SymTable_exportChanges, whose log may be trimmed. */
+  int SymTable_exportTable(SymTable_T oSymTable, void **ppvSnapshot,
+     size_t *puSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Discards the change log of oSymTable through the change after which
+its sequence number was uThrough, once every replica has applied it.
+oSymTable must not have an open transaction. */
+  void SymTable_trimChanges(SymTable_T oSymTable, size_t uThrough);
+
+/*--------------------------------------------------------------------*/
+
+/* Applies to oSymTable the uSize bytes of pvDelta, a delta that
+SymTable_exportChanges or SymTable_exportTable made of another table,
+decoding each value with (*pfDecodeValue)(pvBytes, uSize, &pvValue,
+pvCodec), which returns 1 (TRUE) on success. *puSequence is the
+sequence number of the other table that oSymTable has caught up to,
+and is advanced to the end of the delta. Changes that oSymTable has
+already applied are skipped. Returns 1 (TRUE) on success. Returns 0
+(FALSE) and leaves oSymTable and *puSequence unchanged if the delta is
+malformed or begins after *puSequence, if a snapshot is applied to a
+table that is not empty, if a change cannot be made, or if a value
+cannot be decoded or insufficient memory is available. The decoded
+values belong to oSymTable, which releases those that it displaces or
+does not keep with its pfFreeValue option. oSymTable must not borrow
+keys or have an open transaction. */
+  int SymTable_applyChanges(SymTable_T oSymTable, const void *pvDelta,
+     size_t uSize,
+     int (*pfDecodeValue)(const void *pvBytes, size_t uSize,
+                          void **ppvValue, void *pvCodec),
+     void *pvCodec, size_t *puSequence);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new SymTable object that contains no bindings and whose
+keys are interned in oKeyPool instead of being copied, or NULL if
+insufficient memory is available. Tables that share oKeyPool share
+the bytes of their keys, and compare keys by address. oKeyPool must
+outlive the SymTable object. */
+  SymTable_T SymTable_newInterned(KeyPool_T oKeyPool);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the value of the binding within oSymTable whose key is
+pcInternedKey, or NULL if no such binding exists. oSymTable must have
+been created by SymTable_newInterned, and pcInternedKey must have been
+returned by KeyPool_intern or KeyPool_find for the same pool. Only
+key addresses are compared. */
+  void *SymTable_getInterned(SymTable_T oSymTable,
+     const char *pcInternedKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if oSymTable contains a binding whose key is
+pcInternedKey, and 0 (FALSE) otherwise. The requirements of
+SymTable_getInterned apply. */
+  int SymTable_containsInterned(SymTable_T oSymTable,
+     const char *pcInternedKey);
+
+#endif
@@ -0,0 +1,762 @@
+/*--------------------------------------------------------------------*/
+/* symtablehybrid.c                                                   */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtablehybrid.h"
+
+/*--------------------------------------------------------------------*/
+
+/* INLINE_CAPACITY is the number of bindings held inside the SymTable
+object itself. MIN_SLOT_COUNT is the smallest hash table, which must be
+a power of 2. A frozen table has about KEYS_PER_SEED keys per seed, and
+tries MAX_SEED seeds for each group of keys before giving up. */
+
+enum {INLINE_CAPACITY = 8, MIN_SLOT_COUNT = 16, KEYS_PER_SEED = 4,
+      MAX_SEED = 65536};
+
+/*--------------------------------------------------------------------*/
+
+/* The representations that a SymTable can take. */
+
+enum Form {
+    /* Up to INLINE_CAPACITY bindings in asInline[0..length-1] */
+    FORM_INLINE,
+    /* An open-addressing hash table with linear probing */
+    FORM_HASH,
+    /* A read-mostly perfect hash table */
+    FORM_FROZEN
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in an element of an array. In the hash table
+forms, an element whose pcKey is NULL is an empty slot. */
+
+struct Binding {
+    /* The full hash code of the key, compared before the key itself */
+    size_t uHash;
+
+    /* The identifying key */
+    char *pcKey;
+
+    /* The associated data */
+    const void *pvValue;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* An open-addressing hash table. Each binding lives in the first
+empty slot at or after its home slot, and no more than three quarters
+of the slots are ever full. */
+
+struct HashForm {
+    /* The address of the array of slots */
+    struct Binding *psSlots;
+    /* The number of slots, a power of 2 */
+    size_t uSlotCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A perfect hash table. The key whose hash code is uHash can only be
+in slot SymTable_mix(uHash, puSeeds[b]) % uSlotCount, where b is
+SymTable_mix(uHash, 0) % uSeedCount. */
+
+struct FrozenForm {
+    /* The address of the array of slots */
+    struct Binding *psSlots;
+    /* The number of slots */
+    size_t uSlotCount;
+    /* The address of the array of seeds */
+    unsigned int *puSeeds;
+    /* The number of seeds */
+    size_t uSeedCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable is a "dummy" node that holds its bindings directly while
+it is small, and the address of a hash table once it is not. */
+
+struct SymTable {
+    /* The current representation */
+    enum Form eForm;
+    /* The number of bindings stored */
+    size_t length;
+    /* The representation-specific data */
+    union {
+        struct Binding asInline[INLINE_CAPACITY];
+        struct HashForm sHash;
+        struct FrozenForm sFrozen;
+    } u;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return a hash code for pcKey. */
+static size_t SymTable_hash(const char *pcKey) {
+      const size_t HASH_MULTIPLIER = 65599;
+      size_t u;
+      size_t uHash = 0;
+
+      assert(pcKey != NULL);
+
+      for (u = 0; pcKey[u] != '\0'; u++)
+         uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+      return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return uHash scrambled under uSeed, so that every bit of the result
+depends on every bit of uHash. Different seeds give independent
+results. */
+static size_t SymTable_mix(size_t uHash, size_t uSeed) {
+    uint64_t x;
+
+    x = (uint64_t)uHash ^ ((uint64_t)uSeed * UINT64_C(0x9E3779B97F4A7C15));
+    x ^= x >> 33;
+    x *= UINT64_C(0xFF51AFD7ED558CCD);
+    x ^= x >> 33;
+    x *= UINT64_C(0xC4CEB9FE1A85EC53);
+    x ^= x >> 33;
+
+    return (size_t)x;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new array of uSlotCount empty slots, or NULL if
+insufficient memory is available. */
+static struct Binding *SymTable_newSlots(size_t uSlotCount) {
+    struct Binding *psSlots;
+    size_t i;
+
+    psSlots = (struct Binding*)malloc(uSlotCount * sizeof(struct Binding));
+    if (psSlots == NULL) return NULL;
+
+    for (i = 0; i < uSlotCount; i++)
+        psSlots[i].pcKey = NULL;
+
+    return psSlots;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the slot of psHash that holds the binding whose
+key is pcKey and whose hash code is uHash, or of the empty slot at
+which that binding would be put if no such binding exists. */
+static size_t SymTable_probe(const struct HashForm *psHash, size_t uHash,
+                             const char *pcKey) {
+    size_t uMask;
+    size_t i;
+
+    assert(psHash != NULL);
+    assert(pcKey != NULL);
+
+    uMask = psHash->uSlotCount - 1;
+    for (i = SymTable_mix(uHash, 0) & uMask;
+         psHash->psSlots[i].pcKey != NULL;
+         i = (i + 1) & uMask) {
+        if (psHash->psSlots[i].uHash == uHash &&
+            strcmp(psHash->psSlots[i].pcKey, pcKey) == 0)
+            break;
+    }
+
+    return i;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put a copy of the binding *psBinding into the first empty slot at or
+after its home slot in psSlots, an array of uSlotCount slots. */
+static void SymTable_place(struct Binding *psSlots, size_t uSlotCount,
+                           const struct Binding *psBinding) {
+    size_t uMask;
+    size_t i;
+
+    assert(psSlots != NULL);
+    assert(psBinding != NULL);
+
+    uMask = uSlotCount - 1;
+    for (i = SymTable_mix(psBinding->uHash, 0) & uMask;
+         psSlots[i].pcKey != NULL;
+         i = (i + 1) & uMask)
+        ;
+    psSlots[i] = *psBinding;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Copy the uCount bindings in psBindings into the array psAll, which
+must have room for them, skipping empty slots. Return the number of
+bindings copied. */
+static size_t SymTable_gather(const struct Binding *psBindings,
+                              size_t uCount, struct Binding *psAll) {
+    size_t uCopied = 0;
+    size_t i;
+
+    assert(psBindings != NULL);
+    assert(psAll != NULL);
+
+    for (i = 0; i < uCount; i++) {
+        if (psBindings[i].pcKey != NULL)
+            psAll[uCopied++] = psBindings[i];
+    }
+
+    return uCopied;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Rebuild oSymTable as a hash table of uSlotCount slots holding the
+uCount bindings of psBindings, whose empty slots are skipped. The
+caller frees the memory of the previous representation. Return 1
+(TRUE) if successful, or 0 (FALSE) and leave oSymTable unchanged if
+insufficient memory is available. */
+static int SymTable_toHash(SymTable_T oSymTable,
+                           const struct Binding *psBindings,
+                           size_t uCount, size_t uSlotCount) {
+    struct Binding *psSlots;
+    size_t i;
+
+    assert(oSymTable != NULL);
+
+    psSlots = SymTable_newSlots(uSlotCount);
+    if (psSlots == NULL) return 0;
+
+    for (i = 0; i < uCount; i++) {
+        if (psBindings[i].pcKey != NULL)
+            SymTable_place(psSlots, uSlotCount, &psBindings[i]);
+    }
+
+    oSymTable->eForm = FORM_HASH;
+    oSymTable->u.sHash.psSlots = psSlots;
+    oSymTable->u.sHash.uSlotCount = uSlotCount;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the smallest hash table size that holds uCount bindings
+without exceeding the maximum load. */
+static size_t SymTable_slotCountFor(size_t uCount) {
+    size_t uSlotCount = MIN_SLOT_COUNT;
+
+    while (uCount * 4 > uSlotCount * 3)
+        uSlotCount *= 2;
+
+    return uSlotCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Rebuild the frozen oSymTable as a hash table with room for at least
+one more binding. Return 1 (TRUE) if successful, or 0 (FALSE) and
+leave oSymTable unchanged if insufficient memory is available. */
+static int SymTable_thaw(SymTable_T oSymTable) {
+    struct FrozenForm sFrozen;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->eForm == FORM_FROZEN);
+
+    sFrozen = oSymTable->u.sFrozen;
+    if (!SymTable_toHash(oSymTable, sFrozen.psSlots, sFrozen.uSlotCount,
+                         SymTable_slotCountFor(oSymTable->length + 1)))
+        return 0;
+
+    free(sFrozen.psSlots);
+    free(sFrozen.puSeeds);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Find a seed under which the uCount bindings psMembers[0..uCount-1]
+hash to distinct empty slots of psSlots, an array of uSlotCount slots,
+and put them there. puTried must have room for uCount slot indices.
+Return the seed, or 0 if no seed up to MAX_SEED works. */
+static unsigned int SymTable_seed(struct Binding *psSlots,
+                                  size_t uSlotCount,
+                                  struct Binding **psMembers,
+                                  size_t uCount, size_t *puTried) {
+    unsigned int uSeed;
+    size_t i;
+    size_t j;
+
+    assert(psSlots != NULL);
+    assert(psMembers != NULL);
+    assert(puTried != NULL);
+
+    for (uSeed = 1; uSeed <= MAX_SEED; uSeed++) {
+        for (i = 0; i < uCount; i++) {
+            puTried[i] = SymTable_mix(psMembers[i]->uHash, uSeed)
+                         % uSlotCount;
+            if (psSlots[puTried[i]].pcKey != NULL) break;
+            for (j = 0; j < i && puTried[j] != puTried[i]; j++)
+                ;
+            if (j < i) break;
+        }
+        if (i == uCount) {
+            for (i = 0; i < uCount; i++)
+                psSlots[puTried[i]] = *psMembers[i];
+            return uSeed;
+        }
+    }
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Seed the groups of keys of psFrozen, the largest groups first while
+the table is still mostly empty. Group b consists of the bindings
+ppsMembers[puStarts[b]..puStarts[b+1]-1], and no group is larger than
+uMaxSize. puTried must have room for uMaxSize slot indices. Return 1
+(TRUE) if successful, or 0 (FALSE) if some group cannot be seeded. */
+static int SymTable_seedGroups(struct FrozenForm *psFrozen,
+                               struct Binding **ppsMembers,
+                               const size_t *puStarts, size_t uMaxSize,
+                               size_t *puTried) {
+    size_t uSize;
+    size_t b;
+
+    assert(psFrozen != NULL);
+    assert(ppsMembers != NULL);
+    assert(puStarts != NULL);
+    assert(puTried != NULL);
+
+    for (uSize = uMaxSize; uSize > 0; uSize--) {
+        for (b = 0; b < psFrozen->uSeedCount; b++) {
+            if (puStarts[b + 1] - puStarts[b] != uSize) continue;
+            psFrozen->puSeeds[b] =
+                SymTable_seed(psFrozen->psSlots, psFrozen->uSlotCount,
+                              &ppsMembers[puStarts[b]], uSize, puTried);
+            if (psFrozen->puSeeds[b] == 0) return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Build the perfect hash table psFrozen from the uCount bindings of
+psAll. Return 1 (TRUE) if successful, or 0 (FALSE) if insufficient
+memory is available or no perfect hash function was found. */
+static int SymTable_buildFrozen(struct FrozenForm *psFrozen,
+                                struct Binding *psAll, size_t uCount) {
+    size_t *puStarts;
+    size_t *puTried;
+    struct Binding **ppsMembers;
+    size_t uMaxSize = 0;
+    size_t b;
+    size_t i;
+    int iSuccessful = 0;
+
+    assert(psFrozen != NULL);
+    assert(psAll != NULL);
+
+    psFrozen->uSlotCount = uCount + uCount / 4 + 1;
+    psFrozen->uSeedCount = (uCount + KEYS_PER_SEED - 1) / KEYS_PER_SEED
+                           + 1;
+    psFrozen->psSlots = SymTable_newSlots(psFrozen->uSlotCount);
+    psFrozen->puSeeds = (unsigned int*)
+        calloc(psFrozen->uSeedCount, sizeof(unsigned int));
+    puStarts = (size_t*)calloc(psFrozen->uSeedCount + 1, sizeof(size_t));
+    ppsMembers = (struct Binding**)malloc(uCount * sizeof(struct Binding*));
+    puTried = (size_t*)malloc(uCount * sizeof(size_t));
+
+    if (psFrozen->psSlots != NULL && psFrozen->puSeeds != NULL &&
+        puStarts != NULL && ppsMembers != NULL && puTried != NULL) {
+        /* Group the bindings by seed, as a counting sort would */
+        for (i = 0; i < uCount; i++)
+            puStarts[SymTable_mix(psAll[i].uHash, 0)
+                     % psFrozen->uSeedCount + 1]++;
+        for (b = 0; b < psFrozen->uSeedCount; b++) {
+            if (puStarts[b + 1] > uMaxSize) uMaxSize = puStarts[b + 1];
+            puStarts[b + 1] += puStarts[b];
+        }
+        for (i = 0; i < uCount; i++) {
+            b = SymTable_mix(psAll[i].uHash, 0) % psFrozen->uSeedCount;
+            ppsMembers[puStarts[b]++] = &psAll[i];
+        }
+        /* Each puStarts[b] now holds the end of group b */
+        for (b = psFrozen->uSeedCount; b > 0; b--)
+            puStarts[b] = puStarts[b - 1];
+        puStarts[0] = 0;
+
+        iSuccessful = SymTable_seedGroups(psFrozen, ppsMembers, puStarts,
+                                          uMaxSize, puTried);
+    }
+
+    free(puStarts);
+    free(ppsMembers);
+    free(puTried);
+    if (!iSuccessful) {
+        free(psFrozen->psSlots);
+        free(psFrozen->puSeeds);
+    }
+    return iSuccessful;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of the binding in oSymTable whose key is pcKey
+and whose hash code is uHash, or NULL if no such binding exists. */
+static struct Binding *SymTable_lookup(SymTable_T oSymTable,
+                                       const char *pcKey, size_t uHash) {
+    struct Binding *psBinding;
+    const struct FrozenForm *psFrozen;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    switch (oSymTable->eForm) {
+    case FORM_INLINE:
+        for (i = 0; i < oSymTable->length; i++) {
+            psBinding = &oSymTable->u.asInline[i];
+            if (psBinding->uHash == uHash &&
+                strcmp(psBinding->pcKey, pcKey) == 0)
+                return psBinding;
+        }
+        return NULL;
+
+    case FORM_HASH:
+        psBinding = &oSymTable->u.sHash.psSlots[
+            SymTable_probe(&oSymTable->u.sHash, uHash, pcKey)];
+        return psBinding->pcKey == NULL ? NULL : psBinding;
+
+    case FORM_FROZEN:
+        psFrozen = &oSymTable->u.sFrozen;
+        i = SymTable_mix(uHash, 0) % psFrozen->uSeedCount;
+        psBinding = &psFrozen->psSlots[
+            SymTable_mix(uHash, psFrozen->puSeeds[i])
+            % psFrozen->uSlotCount];
+        if (psBinding->pcKey != NULL && psBinding->uHash == uHash &&
+            strcmp(psBinding->pcKey, pcKey) == 0)
+            return psBinding;
+        return NULL;
+    }
+
+    assert(0);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the binding in slot i of the hash table psHash, moving later
+bindings of the same probe sequence back so that no probe sequence is
+broken by the new empty slot. */
+static void SymTable_deleteSlot(struct HashForm *psHash, size_t i) {
+    struct Binding *psSlots;
+    size_t uMask;
+    size_t j;
+    size_t uHome;
+
+    assert(psHash != NULL);
+
+    psSlots = psHash->psSlots;
+    uMask = psHash->uSlotCount - 1;
+    for (j = (i + 1) & uMask; psSlots[j].pcKey != NULL;
+         j = (j + 1) & uMask) {
+        uHome = SymTable_mix(psSlots[j].uHash, 0) & uMask;
+        /* The binding in slot j may move to slot i only if its home
+        slot is not cyclically in (i, j] */
+        if (((j - uHome) & uMask) >= ((j - i) & uMask)) {
+            psSlots[i] = psSlots[j];
+            i = j;
+        }
+    }
+    psSlots[i].pcKey = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+    SymTable_T oSymTable;
+
+    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+    if (oSymTable == NULL) return NULL;
+
+    oSymTable->eForm = FORM_INLINE;
+    oSymTable->length = 0;
+
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+    size_t i;
+
+    assert(oSymTable != NULL);
+
+    /* Free the memory in which the keys and the hash tables reside */
+    switch (oSymTable->eForm) {
+    case FORM_INLINE:
+        for (i = 0; i < oSymTable->length; i++)
+            free(oSymTable->u.asInline[i].pcKey);
+        break;
+
+    case FORM_HASH:
+        for (i = 0; i < oSymTable->u.sHash.uSlotCount; i++)
+            free(oSymTable->u.sHash.psSlots[i].pcKey);
+        free(oSymTable->u.sHash.psSlots);
+        break;
+
+    case FORM_FROZEN:
+        for (i = 0; i < oSymTable->u.sFrozen.uSlotCount; i++)
+            free(oSymTable->u.sFrozen.psSlots[i].pcKey);
+        free(oSymTable->u.sFrozen.psSlots);
+        free(oSymTable->u.sFrozen.puSeeds);
+        break;
+    }
+
+    free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    return oSymTable->length;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+                 const char *pcKey,
+                 const void *pvValue) {
+    struct Binding asOld[INLINE_CAPACITY];
+    struct HashForm sOld;
+    struct Binding sNew;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* Check if oSymTable already contains pcKey */
+    sNew.uHash = SymTable_hash(pcKey);
+    if (SymTable_lookup(oSymTable, pcKey, sNew.uHash) != NULL) return 0;
+
+    /* Make room for the new binding, changing form if necessary */
+    if (oSymTable->eForm == FORM_FROZEN && !SymTable_thaw(oSymTable))
+        return 0;
+    if (oSymTable->eForm == FORM_INLINE &&
+        oSymTable->length == INLINE_CAPACITY) {
+        memcpy(asOld, oSymTable->u.asInline, sizeof(asOld));
+        if (!SymTable_toHash(oSymTable, asOld, INLINE_CAPACITY,
+                             MIN_SLOT_COUNT))
+            return 0;
+    }
+    if (oSymTable->eForm == FORM_HASH &&
+        (oSymTable->length + 1) * 4 > oSymTable->u.sHash.uSlotCount * 3) {
+        sOld = oSymTable->u.sHash;
+        if (!SymTable_toHash(oSymTable, sOld.psSlots, sOld.uSlotCount,
+                             2 * sOld.uSlotCount))
+            return 0;
+        free(sOld.psSlots);
+    }
+
+    /* Create a defensive copy of the string to which pcKey points */
+    sNew.pcKey = (char*)malloc(strlen(pcKey) + 1);
+    if (sNew.pcKey == NULL) return 0;
+    strcpy(sNew.pcKey, pcKey);
+    sNew.pvValue = pvValue;
+
+    if (oSymTable->eForm == FORM_INLINE) {
+        oSymTable->u.asInline[oSymTable->length] = sNew;
+    }
+    else {
+        i = SymTable_probe(&oSymTable->u.sHash, sNew.uHash, pcKey);
+        oSymTable->u.sHash.psSlots[i] = sNew;
+    }
+
+    oSymTable->length++;
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+                       const char *pcKey,
+                       const void *pvValue) {
+    struct Binding *psBinding;
+    void *oldValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psBinding = SymTable_lookup(oSymTable, pcKey, SymTable_hash(pcKey));
+    if (psBinding == NULL) return NULL;
+
+    oldValue = (void*)psBinding->pvValue;
+    psBinding->pvValue = pvValue;
+    return oldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_lookup(oSymTable, pcKey, SymTable_hash(pcKey))
+           != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    struct Binding *psBinding;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psBinding = SymTable_lookup(oSymTable, pcKey, SymTable_hash(pcKey));
+    if (psBinding == NULL) return NULL;
+
+    return (void*)psBinding->pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    struct Binding asAll[INLINE_CAPACITY];
+    struct Binding *psBinding;
+    struct HashForm sOld;
+    struct FrozenForm sFrozen;
+    void *value;
+    size_t uCount;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psBinding = SymTable_lookup(oSymTable, pcKey, SymTable_hash(pcKey));
+    if (psBinding == NULL) return NULL;
+
+    value = (void*)psBinding->pvValue;
+
+    /* Free the memory in which the key resides */
+    free(psBinding->pcKey);
+    oSymTable->length--;
+
+    switch (oSymTable->eForm) {
+    case FORM_INLINE:
+        *psBinding = oSymTable->u.asInline[oSymTable->length];
+        break;
+
+    case FORM_HASH:
+        SymTable_deleteSlot(&oSymTable->u.sHash,
+                            (size_t)(psBinding
+                                     - oSymTable->u.sHash.psSlots));
+
+        /* Move back inline once the table is small again */
+        if (oSymTable->length <= INLINE_CAPACITY / 2) {
+            sOld = oSymTable->u.sHash;
+            uCount = SymTable_gather(sOld.psSlots, sOld.uSlotCount, asAll);
+            free(sOld.psSlots);
+            oSymTable->eForm = FORM_INLINE;
+            memcpy(oSymTable->u.asInline, asAll,
+                   uCount * sizeof(struct Binding));
+        }
+        break;
+
+    case FORM_FROZEN:
+        /* Emptying a slot leaves every other key where it was */
+        psBinding->pcKey = NULL;
+
+        /* Move back inline once the table is small again, as a hash
+        table would */
+        if (oSymTable->length <= INLINE_CAPACITY / 2) {
+            sFrozen = oSymTable->u.sFrozen;
+            uCount = SymTable_gather(sFrozen.psSlots, sFrozen.uSlotCount,
+                                     asAll);
+            free(sFrozen.psSlots);
+            free(sFrozen.puSeeds);
+            oSymTable->eForm = FORM_INLINE;
+            memcpy(oSymTable->u.asInline, asAll,
+                   uCount * sizeof(struct Binding));
+        }
+        break;
+    }
+
+    return value;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    struct Binding *psBindings;
+    size_t uCount;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    switch (oSymTable->eForm) {
+    case FORM_INLINE:
+        psBindings = oSymTable->u.asInline;
+        uCount = oSymTable->length;
+        break;
+    case FORM_HASH:
+        psBindings = oSymTable->u.sHash.psSlots;
+        uCount = oSymTable->u.sHash.uSlotCount;
+        break;
+    default:
+        psBindings = oSymTable->u.sFrozen.psSlots;
+        uCount = oSymTable->u.sFrozen.uSlotCount;
+        break;
+    }
+
+    for (i = 0; i < uCount; i++) {
+        if (psBindings[i].pcKey != NULL)
+            (*pfApply)(psBindings[i].pcKey,
+                       (void*)psBindings[i].pvValue,
+                       (void*)pvExtra);
+    }
+
+    return;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_freeze(SymTable_T oSymTable) {
+    struct FrozenForm sFrozen;
+    struct Binding *psAll;
+    size_t uCount;
+
+    assert(oSymTable != NULL);
+
+    /* Inline tables are already as compact as they can be */
+    if (oSymTable->eForm != FORM_HASH) return 1;
+
+    psAll = (struct Binding*)
+        malloc(oSymTable->length * sizeof(struct Binding));
+    if (psAll == NULL) return 0;
+    uCount = SymTable_gather(oSymTable->u.sHash.psSlots,
+                             oSymTable->u.sHash.uSlotCount, psAll);
+
+    if (!SymTable_buildFrozen(&sFrozen, psAll, uCount)) {
+        free(psAll);
+        return 0;
+    }
+    free(psAll);
+
+    free(oSymTable->u.sHash.psSlots);
+    oSymTable->eForm = FORM_FROZEN;
+    oSymTable->u.sFrozen = sFrozen;
+    return 1;
+}
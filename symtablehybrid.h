@@ -0,0 +1,29 @@
+/*--------------------------------------------------------------------*/
+/* symtablehybrid.h                                                   */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEHYBRID_INCLUDED
+#define SYMTABLEHYBRID_INCLUDED
+
+#include "symtable.h"
+
+/* The adaptive implementation of the SymTable ADT (symtablehybrid.c)
+holds small tables in an array inside the SymTable object itself and
+switches to an open-addressing hash table once they outgrow it. A
+table that will no longer gain or lose bindings can be frozen into a
+perfect hash table, which finds any key with a single comparison. */
+
+/*--------------------------------------------------------------------*/
+
+/* Marks oSymTable as read-mostly and rebuilds it as a perfect hash
+table if it is too large to be held inline. SymTable_get,
+SymTable_contains, and SymTable_replace then compare at most one key.
+A later SymTable_put thaws oSymTable back into an ordinary hash table
+first. SymTable_remove empties slots of the frozen table in place, and
+moves the bindings back inline once few remain. Returns 1 (TRUE) if successful, or 0 (FALSE)
+and leaves oSymTable unchanged if insufficient memory is available or
+no perfect hash function was found for its keys. */
+  int SymTable_freeze(SymTable_T oSymTable);
+
+#endif
@@ -10,40 +10,142 @@
 
 /*--------------------------------------------------------------------*/
 
-/* Each binding is stored in a node. Nodes are linked to form a list. */
+/* The number of bindings for which space is first allocated */
+
+enum {INITIAL_CAPACITY = 4};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in an element of a contiguous array. Every
+successful lookup swaps its binding with the one before it, so that
+frequently used keys drift to the front of the array and are found
+after one or two comparisons. */
+
+struct Binding {
+    /* The full hash code of the key, compared before the key itself */
+    size_t uHash;
 
-struct Node {
     /* The identifying key */
     char *pcKey;
 
     /* The associated data */
     const void *pvValue;
-
-    /* The address of the next node */
-    struct Node *psNextNode;
 };
 
 /*--------------------------------------------------------------------*/
 
-/* A SymTable is a "dummy" node that points to the first node. */
+/* A SymTable is a "dummy" node that points to the array of bindings. */
 
 struct SymTable {
-    /* The address of the first node */
-    struct Node *psFirstNode;
-    /* The number of nodes linked */
+    /* The address of the array of bindings, or NULL if no space has
+    been allocated yet */
+    struct Binding *psBindings;
+    /* The number of bindings the array can hold */
+    size_t capacity;
+    /* The number of bindings stored */
     size_t length;
+    /* The number of calls of SymTable_map in progress, during which
+    lookups leave the bindings where they are */
+    size_t mapDepth;
 };
 
 /*--------------------------------------------------------------------*/
 
+/* Return a hash code for pcKey. */
+static size_t SymTable_hash(const char *pcKey) {
+      const size_t HASH_MULTIPLIER = 65599;
+      size_t u;
+      size_t uHash = 0;
+
+      assert(pcKey != NULL);
+
+      for (u = 0; pcKey[u] != '\0'; u++)
+         uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+      return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the binding in oSymTable whose key is pcKey and
+whose key hashes to uHash, or oSymTable->length if no such binding
+exists. Keys are only compared when their hash codes match. */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+                            size_t uHash) {
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    for (i = 0; i < oSymTable->length; i++) {
+        if (oSymTable->psBindings[i].uHash == uHash &&
+            strcmp(oSymTable->psBindings[i].pcKey, pcKey) == 0)
+            break;
+    }
+
+    return i;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Find the binding in oSymTable whose key is pcKey and swap it with
+the binding before it, unless a SymTable_map of oSymTable is in
+progress, whose index the swap would disturb. Return the address of
+the binding, or NULL if no such binding exists. */
+static struct Binding *SymTable_findPromote(SymTable_T oSymTable,
+                                            const char *pcKey) {
+    struct Binding sFound;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    i = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if (i == oSymTable->length) return NULL;
+
+    if (i > 0 && oSymTable->mapDepth == 0) {
+        sFound = oSymTable->psBindings[i];
+        oSymTable->psBindings[i] = oSymTable->psBindings[i - 1];
+        oSymTable->psBindings[i - 1] = sFound;
+        i--;
+    }
+
+    return &oSymTable->psBindings[i];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Change the capacity of the array of bindings in oSymTable to
+newCapacity, which must be at least oSymTable->length. Return 1 (TRUE)
+if successful, or 0 (FALSE) and leave oSymTable unchanged if
+insufficient memory is available. */
+static int SymTable_resize(SymTable_T oSymTable, size_t newCapacity) {
+    struct Binding *psNewBindings;
+
+    assert(oSymTable != NULL);
+    assert(newCapacity >= oSymTable->length);
+
+    psNewBindings = (struct Binding*)realloc(oSymTable->psBindings,
+        newCapacity * sizeof(struct Binding));
+    if (psNewBindings == NULL) return 0;
+
+    oSymTable->psBindings = psNewBindings;
+    oSymTable->capacity = newCapacity;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
 SymTable_T SymTable_new(void) {
     SymTable_T oSymTable;
 
     oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
     if (oSymTable == NULL) return NULL;
 
-    oSymTable->psFirstNode = NULL;
+    oSymTable->psBindings = NULL;
+    oSymTable->capacity = 0;
     oSymTable->length = 0;
+    oSymTable->mapDepth = 0;
 
     return oSymTable;
 }
@@ -51,21 +153,15 @@ SymTable_T SymTable_new(void) {
 /*--------------------------------------------------------------------*/
 
 void SymTable_free(SymTable_T oSymTable) {
-    struct Node *psCurrentNode;
-    struct Node *psNextNode;
+    size_t i;
 
     assert(oSymTable != NULL);
 
-    /* Walk through the list */
-    for (psCurrentNode = oSymTable->psFirstNode;
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-      psNextNode = psCurrentNode->psNextNode;
-      /* Free the memory in which the keys reside*/
-      free((char*)psCurrentNode->pcKey);
-      free(psCurrentNode);
-    }
+    /* Free the memory in which the keys reside */
+    for (i = 0; i < oSymTable->length; i++)
+        free(oSymTable->psBindings[i].pcKey);
 
+    free(oSymTable->psBindings);
     free(oSymTable);
 }
 
@@ -79,32 +175,36 @@ size_t SymTable_getLength(SymTable_T oSymTable) {
 
 /*--------------------------------------------------------------------*/
 
-int SymTable_put(SymTable_T oSymTable, 
-                 const char *pcKey, 
-                 const void *pvValue) {          
-    struct Node *psNewNode;
+int SymTable_put(SymTable_T oSymTable,
+                 const char *pcKey,
+                 const void *pvValue) {
+    struct Binding sNew;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
     /* Check if oSymTable already contains pcKey */
-    if (SymTable_contains(oSymTable, pcKey)) return 0;
-   
-    psNewNode = (struct Node*)malloc(sizeof(struct Node));
-    if (psNewNode == NULL) return 0;
-
-    /* Create a defensive copy of the string to which pcKey points */
-    psNewNode->pcKey = (char*)malloc(strlen(pcKey) + 1);
-    if (psNewNode->pcKey == NULL) {
-        free(psNewNode);
+    sNew.uHash = SymTable_hash(pcKey);
+    if (SymTable_find(oSymTable, pcKey, sNew.uHash) != oSymTable->length)
         return 0;
-    }
-    strcpy(psNewNode->pcKey, pcKey);
 
-    psNewNode->pvValue = pvValue;
-    psNewNode->psNextNode = oSymTable->psFirstNode;
+    /* Grow the array if it is full */
+    if (oSymTable->length == oSymTable->capacity) {
+        if (!SymTable_resize(oSymTable, oSymTable->capacity == 0 ?
+                             INITIAL_CAPACITY : 2 * oSymTable->capacity))
+            return 0;
+    }
 
-    oSymTable->psFirstNode = psNewNode;
+    /* Create a defensive copy of the string to which pcKey points */
+    sNew.pcKey = (char*)malloc(strlen(pcKey) + 1);
+    if (sNew.pcKey == NULL) return 0;
+    strcpy(sNew.pcKey, pcKey);
+    sNew.pvValue = pvValue;
+
+    /* New bindings are likely to be used soon, so put them in front */
+    memmove(&oSymTable->psBindings[1], &oSymTable->psBindings[0],
+            oSymTable->length * sizeof(struct Binding));
+    oSymTable->psBindings[0] = sNew;
     oSymTable->length++;
 
     return 1;
@@ -112,126 +212,94 @@ int SymTable_put(SymTable_T oSymTable,
 
 /*--------------------------------------------------------------------*/
 
-void *SymTable_replace(SymTable_T oSymTable, 
-                       const char *pcKey, 
+void *SymTable_replace(SymTable_T oSymTable,
+                       const char *pcKey,
                        const void *pvValue) {
-    struct Node *psCurrentNode;
-    struct Node *psNextNode;
+    struct Binding *psBinding;
+    void *oldValue;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    /* Walk through the list */
-    for (psCurrentNode = oSymTable->psFirstNode;
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-      psNextNode = psCurrentNode->psNextNode;
-      if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-            void *oldValue = (void*)psCurrentNode->pvValue;
-            psCurrentNode->pvValue = pvValue;
-            return oldValue;
-        }
-    }
+    psBinding = SymTable_findPromote(oSymTable, pcKey);
+    if (psBinding == NULL) return NULL;
 
-    return NULL;
+    oldValue = (void*)psBinding->pvValue;
+    psBinding->pvValue = pvValue;
+    return oldValue;
 }
 
 /*--------------------------------------------------------------------*/
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
-    struct Node *psCurrentNode;
-    struct Node *psNextNode;
-
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    /* Walk through the list */
-    for (psCurrentNode = oSymTable->psFirstNode;
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-      psNextNode = psCurrentNode->psNextNode;
-      if (strcmp(psCurrentNode->pcKey, pcKey) == 0) return 1;
-    }
-
-    return 0;
+    return SymTable_findPromote(oSymTable, pcKey) != NULL;
 }
 
 /*--------------------------------------------------------------------*/
 
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
-    struct Node *psCurrentNode;
-    struct Node *psNextNode;
+    struct Binding *psBinding;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    /* Walk through the list */
-    for (psCurrentNode = oSymTable->psFirstNode;
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-      psNextNode = psCurrentNode->psNextNode;
-      if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-            return (void*)psCurrentNode->pvValue;
-        }
-    }
+    psBinding = SymTable_findPromote(oSymTable, pcKey);
+    if (psBinding == NULL) return NULL;
 
-    return NULL;
+    return (void*)psBinding->pvValue;
 }
 
 /*--------------------------------------------------------------------*/
 
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
-    struct Node *psCurrentNode;
-    struct Node *psNextNode;
-    struct Node *psPrevNode = NULL;
+    void *value;
+    size_t i;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    /* Walk through the list */
-    for (psCurrentNode = oSymTable->psFirstNode;
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-      psNextNode = psCurrentNode->psNextNode;
-      if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-            void *value = (void*)psCurrentNode->pvValue;
-
-            if (psPrevNode == NULL) oSymTable->psFirstNode = psNextNode;
-            else psPrevNode->psNextNode = psNextNode;
-
-            free((char*)psCurrentNode->pcKey);
-            free(psCurrentNode);
-            
-            oSymTable->length--;
-
-            return value;
-        }
-      psPrevNode = psCurrentNode;
-    }
+    i = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if (i == oSymTable->length) return NULL;
+
+    value = (void*)oSymTable->psBindings[i].pvValue;
+    free(oSymTable->psBindings[i].pcKey);
 
-    return NULL;
+    /* Close the gap, keeping the remaining bindings in order */
+    memmove(&oSymTable->psBindings[i], &oSymTable->psBindings[i + 1],
+            (oSymTable->length - i - 1) * sizeof(struct Binding));
+    oSymTable->length--;
+
+    /* Give back space once the array is mostly empty. Failing to
+    shrink leaves the larger array in place, which is harmless. */
+    if (oSymTable->capacity > INITIAL_CAPACITY &&
+        oSymTable->length <= oSymTable->capacity / 4)
+        (void)SymTable_resize(oSymTable, oSymTable->capacity / 2);
+
+    return value;
 }
 
 /*--------------------------------------------------------------------*/
 
 void SymTable_map(SymTable_T oSymTable,
     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
-    const void *pvExtra) {     
-    struct Node *psCurrentNode;
-    struct Node *psNextNode;
+    const void *pvExtra) {
+    size_t i;
 
     assert(oSymTable != NULL);
     assert(pfApply != NULL);
 
-    /* Walk through the list */
-    for (psCurrentNode = oSymTable->psFirstNode;
-         psCurrentNode != NULL;
-         psCurrentNode = psNextNode) {
-      psNextNode = psCurrentNode->psNextNode;
-      (*pfApply)(psCurrentNode->pcKey,
-                 (void*)psCurrentNode->pvValue,
+    /* pfApply may look up keys of oSymTable, which must then leave
+    the bindings in place */
+    oSymTable->mapDepth++;
+    for (i = 0; i < oSymTable->length; i++) {
+      (*pfApply)(oSymTable->psBindings[i].pcKey,
+                 (void*)oSymTable->psBindings[i].pvValue,
                  (void*)pvExtra);
     }
+    oSymTable->mapDepth--;
 
     return;
-}
\ No newline at end of file
+}
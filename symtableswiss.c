@@ -0,0 +1,550 @@
+/*--------------------------------------------------------------------*/
+/* symtableswiss.c                                                    */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "keyops.h"
+#include "symtable.h"
+
+/* A group's control bytes are matched with one SSE2 or NEON compare
+where available, and eight at a time in ordinary 64-bit arithmetic
+otherwise. Defining SYMTABLE_PORTABLE_GROUPS forces the latter. */
+#if defined(__SSE2__) && !defined(SYMTABLE_PORTABLE_GROUPS)
+#define SYMTABLE_SSE2_GROUPS
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__) \
+    && !defined(SYMTABLE_PORTABLE_GROUPS)
+#define SYMTABLE_NEON_GROUPS
+#include <arm_neon.h>
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Slots are examined in groups of GROUP_SIZE. MIN_GROUP_COUNT is the
+number of groups of a new table, a power of 2. A table is grown or
+rebuilt before more than MAX_LOAD_NUM/MAX_LOAD_DEN of its slots are
+full or deleted. */
+
+enum {GROUP_SIZE = 16, MIN_GROUP_COUNT = 1, MAX_LOAD_NUM = 7,
+      MAX_LOAD_DEN = 8};
+
+/*--------------------------------------------------------------------*/
+
+/* Each slot has a control byte. A full slot's control byte is the low
+7 bits of its key's hash code, so its high bit is clear. The other two
+values have the high bit set. A probe stops at a group that has an
+EMPTY slot, and passes over DELETED ones. */
+
+enum {CTRL_EMPTY = 0x80, CTRL_DELETED = 0xFE};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in a slot. */
+
+struct Slot {
+    /* The identifying key */
+    char *pcKey;
+
+    /* The associated data */
+    const void *pvValue;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable is a "dummy" node that points to the arrays of control
+bytes and slots. Group g is slots GROUP_SIZE*g up to GROUP_SIZE*(g+1).
+The key whose hash code is uHash is in the first group of the sequence
+g, g+1, g+3, g+6, ..., modulo the number of groups, that has it, where
+g is uHash / 128. That sequence visits every group. */
+
+struct SymTable {
+    /* The address of the array of control bytes */
+    unsigned char *pucCtrl;
+    /* The address of the array of slots */
+    struct Slot *psSlots;
+    /* The number of groups, a power of 2 */
+    size_t uGroupCount;
+    /* The number of DELETED slots */
+    size_t uDeleted;
+    /* The number of bindings stored */
+    size_t length;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A Mask has one bit set for each slot of a group that matched a
+test. The bit of slot i is bit MASK_STRIDE*i. */
+
+#ifdef SYMTABLE_NEON_GROUPS
+typedef uint64_t Mask;
+enum {MASK_STRIDE = 4};
+#else
+typedef uint32_t Mask;
+enum {MASK_STRIDE = 1};
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index within its group of the slot of the lowest bit of
+uMask, which must not be 0. */
+static unsigned int SymTable_firstSlot(Mask uMask) {
+    unsigned int uBit = 0;
+
+    assert(uMask != 0);
+
+#ifdef __GNUC__
+    uBit = (unsigned int)__builtin_ctzll((unsigned long long)uMask);
+#else
+    for (; (uMask & 1) == 0; uMask >>= 1)
+        uBit++;
+#endif
+    return uBit / MASK_STRIDE;
+}
+
+/*--------------------------------------------------------------------*/
+
+#if defined(SYMTABLE_SSE2_GROUPS)
+
+/* Return the Mask of the slots of the group whose control bytes start
+at pucCtrl whose control byte is ucCtrl. */
+static Mask SymTable_match(const unsigned char *pucCtrl,
+                           unsigned char ucCtrl) {
+    __m128i vCtrl;
+
+    vCtrl = _mm_loadu_si128((const __m128i*)pucCtrl);
+    return (Mask)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(vCtrl, _mm_set1_epi8((char)ucCtrl)));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Mask of the slots of the group whose control bytes start
+at pucCtrl that are EMPTY or DELETED, the ones whose high bit is set. */
+static Mask SymTable_matchFree(const unsigned char *pucCtrl) {
+    return (Mask)_mm_movemask_epi8(
+        _mm_loadu_si128((const __m128i*)pucCtrl));
+}
+
+#elif defined(SYMTABLE_NEON_GROUPS)
+
+/* Return a Mask with bit 4*i set if byte i of vFlags is 0xFF. */
+static Mask SymTable_maskOf(uint8x16_t vFlags) {
+    return vget_lane_u64(vreinterpret_u64_u8(
+        vshrn_n_u16(vreinterpretq_u16_u8(vFlags), 4)), 0)
+        & UINT64_C(0x1111111111111111);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Mask of the slots of the group whose control bytes start
+at pucCtrl whose control byte is ucCtrl. */
+static Mask SymTable_match(const unsigned char *pucCtrl,
+                           unsigned char ucCtrl) {
+    return SymTable_maskOf(vceqq_u8(vld1q_u8(pucCtrl),
+                                    vdupq_n_u8(ucCtrl)));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Mask of the slots of the group whose control bytes start
+at pucCtrl that are EMPTY or DELETED, the ones whose high bit is set. */
+static Mask SymTable_matchFree(const unsigned char *pucCtrl) {
+    return SymTable_maskOf(vcltq_s8(vreinterpretq_s8_u8(
+        vld1q_u8(pucCtrl)), vdupq_n_s8(0)));
+}
+
+#else
+
+/* Return the eight control bytes starting at pucCtrl as a word whose
+byte i is control byte i. */
+static uint64_t SymTable_loadWord(const unsigned char *pucCtrl) {
+    uint64_t uWord = 0;
+    int i;
+
+    for (i = 7; i >= 0; i--)
+        uWord = (uWord << 8) | pucCtrl[i];
+    return uWord;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return an 8-bit mask with bit i set if the high bit of byte i of
+uFlags is set. The other bits of uFlags must be clear. */
+static Mask SymTable_packWord(uint64_t uFlags) {
+    return (Mask)(((uFlags >> 7) * UINT64_C(0x0102040810204080)) >> 56);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Mask of the slots of the group whose control bytes start
+at pucCtrl whose control byte is ucCtrl. A byte just above one that
+matches may match falsely, which costs the caller one key comparison
+but is never wrong. */
+static Mask SymTable_match(const unsigned char *pucCtrl,
+                           unsigned char ucCtrl) {
+    const uint64_t LOW_BITS = UINT64_C(0x0101010101010101);
+    const uint64_t HIGH_BITS = UINT64_C(0x8080808080808080);
+    uint64_t uWord;
+    Mask uMask = 0;
+    int i;
+
+    for (i = 1; i >= 0; i--) {
+        uWord = SymTable_loadWord(pucCtrl + 8 * i) ^ (LOW_BITS * ucCtrl);
+        uMask = (uMask << 8)
+                | SymTable_packWord((uWord - LOW_BITS) & ~uWord & HIGH_BITS);
+    }
+    return uMask;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Mask of the slots of the group whose control bytes start
+at pucCtrl that are EMPTY or DELETED, the ones whose high bit is set. */
+static Mask SymTable_matchFree(const unsigned char *pucCtrl) {
+    const uint64_t HIGH_BITS = UINT64_C(0x8080808080808080);
+    Mask uMask;
+
+    uMask = SymTable_packWord(SymTable_loadWord(pucCtrl + 8) & HIGH_BITS);
+    return (uMask << 8)
+           | SymTable_packWord(SymTable_loadWord(pucCtrl) & HIGH_BITS);
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Return the Mask of the EMPTY slots of the group whose control bytes
+start at pucCtrl. */
+static Mask SymTable_matchEmpty(const unsigned char *pucCtrl) {
+    return SymTable_match(pucCtrl, CTRL_EMPTY);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a hash code for pcKey whose low 7 bits and the bits above
+them are both well mixed. */
+static size_t SymTable_hash(const char *pcKey) {
+    uint64_t uHash;
+
+    assert(pcKey != NULL);
+
+    uHash = (uint64_t)KeyOps_hash(pcKey);
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xFF51AFD7ED558CCD);
+    uHash ^= uHash >> 33;
+    return (size_t)uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the slot of oSymTable that holds pcKey, whose
+hash code is uHash, or the number of slots if there is none. */
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+                            size_t uHash) {
+    const unsigned char *pucGroup;
+    struct Slot *psSlot;
+    size_t uGroupMask;
+    size_t uGroup;
+    size_t uStep;
+    Mask uMask;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uGroupMask = oSymTable->uGroupCount - 1;
+    uGroup = (uHash >> 7) & uGroupMask;
+    for (uStep = 1; uStep <= oSymTable->uGroupCount; uStep++) {
+        pucGroup = oSymTable->pucCtrl + uGroup * GROUP_SIZE;
+
+        /* Compare keys only where the control byte matches */
+        for (uMask = SymTable_match(pucGroup,
+                                    (unsigned char)(uHash & 0x7F));
+             uMask != 0; uMask &= uMask - 1) {
+            psSlot = &oSymTable->psSlots[uGroup * GROUP_SIZE
+                                         + SymTable_firstSlot(uMask)];
+            if (KeyOps_equals(psSlot->pcKey, pcKey))
+                return (size_t)(psSlot - oSymTable->psSlots);
+        }
+
+        if (SymTable_matchEmpty(pucGroup) != 0) break;
+        uGroup = (uGroup + uStep) & uGroupMask;
+    }
+
+    return oSymTable->uGroupCount * GROUP_SIZE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the first EMPTY or DELETED slot of oSymTable
+along the probe sequence of hash code uHash. The table must have
+one. */
+static size_t SymTable_findFree(SymTable_T oSymTable, size_t uHash) {
+    size_t uGroupMask;
+    size_t uGroup;
+    size_t uStep;
+    Mask uMask;
+
+    assert(oSymTable != NULL);
+
+    uGroupMask = oSymTable->uGroupCount - 1;
+    uGroup = (uHash >> 7) & uGroupMask;
+    for (uStep = 1; ; uStep++) {
+        uMask = SymTable_matchFree(oSymTable->pucCtrl
+                                   + uGroup * GROUP_SIZE);
+        if (uMask != 0)
+            return uGroup * GROUP_SIZE + SymTable_firstSlot(uMask);
+        uGroup = (uGroup + uStep) & uGroupMask;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Allocate control bytes and slots for uGroupCount groups, all EMPTY,
+in *ppucCtrl and *ppsSlots. Return 1 (TRUE) if successful, or 0
+(FALSE) if insufficient memory is available. */
+static int SymTable_allocate(size_t uGroupCount, unsigned char **ppucCtrl,
+                             struct Slot **ppsSlots) {
+    assert(ppucCtrl != NULL);
+    assert(ppsSlots != NULL);
+
+    *ppucCtrl = (unsigned char*)malloc(uGroupCount * GROUP_SIZE);
+    *ppsSlots = (struct Slot*)
+        malloc(uGroupCount * GROUP_SIZE * sizeof(struct Slot));
+    if (*ppucCtrl == NULL || *ppsSlots == NULL) {
+        free(*ppucCtrl);
+        free(*ppsSlots);
+        return 0;
+    }
+
+    memset(*ppucCtrl, CTRL_EMPTY, uGroupCount * GROUP_SIZE);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move every binding of oSymTable into new arrays of uGroupCount
+groups, which drops the DELETED slots. Return 1 (TRUE) if successful,
+or 0 (FALSE) and leave oSymTable unchanged if insufficient memory is
+available. */
+static int SymTable_rehash(SymTable_T oSymTable, size_t uGroupCount) {
+    unsigned char *pucOldCtrl;
+    struct Slot *psOldSlots;
+    size_t uOldSlotCount;
+    size_t uHash;
+    size_t u;
+    size_t v;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->length * MAX_LOAD_DEN
+           < uGroupCount * GROUP_SIZE * MAX_LOAD_NUM);
+
+    pucOldCtrl = oSymTable->pucCtrl;
+    psOldSlots = oSymTable->psSlots;
+    uOldSlotCount = oSymTable->uGroupCount * GROUP_SIZE;
+
+    if (!SymTable_allocate(uGroupCount, &oSymTable->pucCtrl,
+                           &oSymTable->psSlots)) {
+        oSymTable->pucCtrl = pucOldCtrl;
+        oSymTable->psSlots = psOldSlots;
+        return 0;
+    }
+    oSymTable->uGroupCount = uGroupCount;
+    oSymTable->uDeleted = 0;
+
+    for (u = 0; u < uOldSlotCount; u++) {
+        if (pucOldCtrl[u] & CTRL_EMPTY) continue;
+        uHash = SymTable_hash(psOldSlots[u].pcKey);
+        v = SymTable_findFree(oSymTable, uHash);
+        oSymTable->pucCtrl[v] = (unsigned char)(uHash & 0x7F);
+        oSymTable->psSlots[v] = psOldSlots[u];
+    }
+
+    free(pucOldCtrl);
+    free(psOldSlots);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+    SymTable_T oSymTable;
+
+    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+    if (oSymTable == NULL) return NULL;
+
+    if (!SymTable_allocate(MIN_GROUP_COUNT, &oSymTable->pucCtrl,
+                           &oSymTable->psSlots)) {
+        free(oSymTable);
+        return NULL;
+    }
+    oSymTable->uGroupCount = MIN_GROUP_COUNT;
+    oSymTable->uDeleted = 0;
+    oSymTable->length = 0;
+
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+    size_t u;
+
+    assert(oSymTable != NULL);
+
+    for (u = 0; u < oSymTable->uGroupCount * GROUP_SIZE; u++)
+        if ((oSymTable->pucCtrl[u] & CTRL_EMPTY) == 0)
+            free(oSymTable->psSlots[u].pcKey);
+
+    free(oSymTable->pucCtrl);
+    free(oSymTable->psSlots);
+    free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    return oSymTable->length;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+                 const char *pcKey,
+                 const void *pvValue) {
+    size_t uSlotCount;
+    size_t uGroupCount;
+    size_t uHash;
+    size_t u;
+    char *pcNewKey;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* Check if oSymTable already contains pcKey */
+    uHash = SymTable_hash(pcKey);
+    uSlotCount = oSymTable->uGroupCount * GROUP_SIZE;
+    if (SymTable_find(oSymTable, pcKey, uHash) != uSlotCount) return 0;
+
+    /* Make room if the new binding would overload the table. Rebuild
+    at the same size if DELETED slots are most of the load. */
+    if ((oSymTable->length + oSymTable->uDeleted + 1) * MAX_LOAD_DEN
+        > uSlotCount * MAX_LOAD_NUM) {
+        uGroupCount = oSymTable->uGroupCount;
+        if ((oSymTable->length + 1) * 2 * MAX_LOAD_DEN
+            > uSlotCount * MAX_LOAD_NUM)
+            uGroupCount *= 2;
+        if (!SymTable_rehash(oSymTable, uGroupCount)) return 0;
+    }
+
+    /* Create a defensive copy of the string to which pcKey points */
+    pcNewKey = (char*)malloc(strlen(pcKey) + 1);
+    if (pcNewKey == NULL) return 0;
+    strcpy(pcNewKey, pcKey);
+
+    u = SymTable_findFree(oSymTable, uHash);
+    if (oSymTable->pucCtrl[u] == CTRL_DELETED) oSymTable->uDeleted--;
+    oSymTable->pucCtrl[u] = (unsigned char)(uHash & 0x7F);
+    oSymTable->psSlots[u].pcKey = pcNewKey;
+    oSymTable->psSlots[u].pvValue = pvValue;
+
+    oSymTable->length++;
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+                       const char *pcKey,
+                       const void *pvValue) {
+    size_t u;
+    void *oldValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    u = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if (u == oSymTable->uGroupCount * GROUP_SIZE) return NULL;
+
+    oldValue = (void*)oSymTable->psSlots[u].pvValue;
+    oSymTable->psSlots[u].pvValue = pvValue;
+    return oldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey))
+           != oSymTable->uGroupCount * GROUP_SIZE;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    size_t u;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    u = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if (u == oSymTable->uGroupCount * GROUP_SIZE) return NULL;
+
+    return (void*)oSymTable->psSlots[u].pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    size_t u;
+    void *value;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    u = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if (u == oSymTable->uGroupCount * GROUP_SIZE) return NULL;
+
+    value = (void*)oSymTable->psSlots[u].pvValue;
+    free(oSymTable->psSlots[u].pcKey);
+
+    /* A probe that reached this group stopped here if the group has an
+    EMPTY slot, so this one may become EMPTY too. Otherwise later
+    groups may hold keys that probed past it. */
+    if (SymTable_matchEmpty(oSymTable->pucCtrl
+                            + u / GROUP_SIZE * GROUP_SIZE) != 0)
+        oSymTable->pucCtrl[u] = CTRL_EMPTY;
+    else {
+        oSymTable->pucCtrl[u] = CTRL_DELETED;
+        oSymTable->uDeleted++;
+    }
+
+    oSymTable->length--;
+
+    return value;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t u;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for (u = 0; u < oSymTable->uGroupCount * GROUP_SIZE; u++)
+        if ((oSymTable->pucCtrl[u] & CTRL_EMPTY) == 0)
+            (*pfApply)(oSymTable->psSlots[u].pcKey,
+                       (void*)oSymTable->psSlots[u].pvValue,
+                       (void*)pvExtra);
+}
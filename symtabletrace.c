@@ -0,0 +1,446 @@
+/*--------------------------------------------------------------------*/
+/* symtabletrace.c                                                    */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#define SYMTABLETRACE_NO_RENAME
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "symtabletrace.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Whether the trace is open, closed, or not yet looked for in the
+environment. */
+
+enum TraceState {TRACE_UNCHECKED, TRACE_OPEN, TRACE_CLOSED};
+
+/* The number of bytes of the buffer of the trace file */
+
+enum {TRACE_BUFFER_SIZE = 65536};
+
+/* The state of the trace. Tracing is not thread-safe, so one copy
+serves the program. */
+
+static struct {
+    /* Whether the trace is open */
+    enum TraceState eState;
+    /* The trace file, or NULL if the trace is not open */
+    FILE *psFile;
+    /* 1 (TRUE) if keys are recorded as keyed hashes */
+    int iHashKeys;
+    /* The key of the hash, chosen when the trace is opened */
+    uint64_t uSecret;
+    /* A table that binds each key recorded to its number plus 1 */
+    SymTable_T oKeyNumbers;
+    /* The number of keys recorded */
+    size_t uKeyCount;
+    /* An open addressing table of the traced tables that exist, and
+    their numbers: the slot count, a power of 2, and the numbers of
+    tables in the slots and of tables numbered */
+    SymTable_T *poTables;
+    size_t *puTableNumbers;
+    size_t uTableSlots;
+    size_t uTablesInSlots;
+    size_t uTableCount;
+    /* 1 (TRUE) once SymTableTrace_close is registered with atexit */
+    int iAtExit;
+} sTrace;
+
+/*--------------------------------------------------------------------*/
+
+/* Return uHash with its bits mixed, so that every bit of the result
+depends on every bit of uHash. */
+static uint64_t SymTableTrace_mix(uint64_t uHash) {
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xFF51AFD7ED558CCD);
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xC4CEB9FE1A85EC53);
+    uHash ^= uHash >> 33;
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write uValue to the trace in LEB128. */
+static void SymTableTrace_writeNumber(uint64_t uValue) {
+    assert(sTrace.psFile != NULL);
+
+    while (uValue >= 0x80) {
+        putc((int)((uValue & 0x7F) | 0x80), sTrace.psFile);
+        uValue >>= 7;
+    }
+    putc((int)uValue, sTrace.psFile);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot of oSymTable in the table of traced tables, or of
+the empty slot in which it would go. */
+static size_t SymTableTrace_slotOf(SymTable_T oSymTable) {
+    size_t uSlot;
+
+    assert(sTrace.uTableSlots != 0);
+
+    uSlot = (size_t)SymTableTrace_mix((uint64_t)(uintptr_t)oSymTable)
+            & (sTrace.uTableSlots - 1);
+    while (sTrace.poTables[uSlot] != NULL &&
+           sTrace.poTables[uSlot] != oSymTable)
+        uSlot = (uSlot + 1) & (sTrace.uTableSlots - 1);
+    return uSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Number oSymTable, a table not yet traced, and record that it is new.
+Return 0 (FALSE) and stop tracing if insufficient memory is
+available. */
+static int SymTableTrace_addTable(SymTable_T oSymTable) {
+    SymTable_T *poOldTables = sTrace.poTables;
+    size_t *puOldNumbers = sTrace.puTableNumbers;
+    size_t uOldSlots = sTrace.uTableSlots;
+    size_t uSlot;
+    size_t u;
+
+    assert(oSymTable != NULL);
+
+    /* Keep the slots at most half full */
+    if (2 * (sTrace.uTablesInSlots + 1) > sTrace.uTableSlots) {
+        sTrace.uTableSlots = uOldSlots == 0 ? 64 : 2 * uOldSlots;
+        sTrace.poTables = (SymTable_T*)
+            calloc(sTrace.uTableSlots, sizeof(SymTable_T));
+        sTrace.puTableNumbers = (size_t*)
+            calloc(sTrace.uTableSlots, sizeof(size_t));
+        if (sTrace.poTables == NULL || sTrace.puTableNumbers == NULL) {
+            free(sTrace.poTables);
+            free(sTrace.puTableNumbers);
+            sTrace.poTables = poOldTables;
+            sTrace.puTableNumbers = puOldNumbers;
+            sTrace.uTableSlots = uOldSlots;
+            SymTableTrace_close();
+            return 0;
+        }
+        for (u = 0; u < uOldSlots; u++) {
+            if (poOldTables[u] == NULL) continue;
+            uSlot = SymTableTrace_slotOf(poOldTables[u]);
+            sTrace.poTables[uSlot] = poOldTables[u];
+            sTrace.puTableNumbers[uSlot] = puOldNumbers[u];
+        }
+        free(poOldTables);
+        free(puOldNumbers);
+    }
+
+    uSlot = SymTableTrace_slotOf(oSymTable);
+    sTrace.poTables[uSlot] = oSymTable;
+    sTrace.puTableNumbers[uSlot] = sTrace.uTableCount++;
+    sTrace.uTablesInSlots++;
+    putc(SYMTABLETRACE_NEW, sTrace.psFile);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Forget oSymTable, which is being freed, if it is traced. */
+static void SymTableTrace_dropTable(SymTable_T oSymTable) {
+    size_t uSlot;
+    size_t uNext;
+    size_t uHome;
+
+    assert(oSymTable != NULL);
+
+    if (sTrace.uTableSlots == 0) return;
+    uSlot = SymTableTrace_slotOf(oSymTable);
+    if (sTrace.poTables[uSlot] == NULL) return;
+    sTrace.poTables[uSlot] = NULL;
+    sTrace.uTablesInSlots--;
+
+    /* Move back the tables after the slot whose probes passed it, so
+    that no probe meets an empty slot too soon */
+    uNext = (uSlot + 1) & (sTrace.uTableSlots - 1);
+    while (sTrace.poTables[uNext] != NULL) {
+        uHome = (size_t)SymTableTrace_mix(
+                    (uint64_t)(uintptr_t)sTrace.poTables[uNext])
+                & (sTrace.uTableSlots - 1);
+        if (((uNext - uHome) & (sTrace.uTableSlots - 1)) >=
+            ((uNext - uSlot) & (sTrace.uTableSlots - 1))) {
+            sTrace.poTables[uSlot] = sTrace.poTables[uNext];
+            sTrace.puTableNumbers[uSlot] = sTrace.puTableNumbers[uNext];
+            sTrace.poTables[uNext] = NULL;
+            uSlot = uNext;
+        }
+        uNext = (uNext + 1) & (sTrace.uTableSlots - 1);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if the trace is open, opening it first as the
+environment says if it has not been looked for. */
+static int SymTableTrace_isOpen(void) {
+    const char *pcFileName;
+    const char *pcKeys;
+
+    if (sTrace.eState == TRACE_UNCHECKED) {
+        sTrace.eState = TRACE_CLOSED;
+        pcFileName = getenv("SYMTABLE_TRACE");
+        pcKeys = getenv("SYMTABLE_TRACE_KEYS");
+        if (pcFileName != NULL && *pcFileName != '\0')
+            (void)SymTableTrace_open(pcFileName, pcKeys == NULL ||
+                                     strcmp(pcKeys, "raw") != 0);
+    }
+    return sTrace.eState == TRACE_OPEN;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Record operation eOp, which returned eResult, on oSymTable, and
+pcKey unless it is NULL, recording a new table or key first. */
+static void SymTableTrace_record(enum SymTableTrace_Op eOp,
+                                 enum SymTableTrace_Result eResult,
+                                 SymTable_T oSymTable,
+                                 const char *pcKey) {
+    size_t uKeyNumber = 0;
+    size_t uSlot;
+    size_t uLength;
+    uint64_t uHash;
+    void *pvNumber;
+    int i;
+
+    assert(oSymTable != NULL);
+
+    if (!SymTableTrace_isOpen()) return;
+
+    if (pcKey != NULL) {
+        pvNumber = SymTable_get(sTrace.oKeyNumbers, pcKey);
+        if (pvNumber != NULL)
+            uKeyNumber = (size_t)(uintptr_t)pvNumber - 1;
+        else {
+            uKeyNumber = sTrace.uKeyCount;
+            if (!SymTable_put(sTrace.oKeyNumbers, pcKey,
+                              (void*)(uintptr_t)(uKeyNumber + 1))) {
+                SymTableTrace_close();
+                return;
+            }
+            sTrace.uKeyCount++;
+            uLength = strlen(pcKey);
+            putc(SYMTABLETRACE_KEY, sTrace.psFile);
+            SymTableTrace_writeNumber(uLength);
+            if (!sTrace.iHashKeys)
+                fwrite(pcKey, 1, uLength, sTrace.psFile);
+            else {
+                /* FNV-1a, from the secret, then mixed */
+                uHash = sTrace.uSecret;
+                for (i = 0; pcKey[i] != '\0'; i++)
+                    uHash = (uHash ^ (unsigned char)pcKey[i])
+                            * UINT64_C(0x100000001B3);
+                uHash = SymTableTrace_mix(uHash ^ sTrace.uSecret);
+                for (i = 0; i < 8; i++)
+                    putc((int)((uHash >> (8 * i)) & 0xFF), sTrace.psFile);
+            }
+        }
+    }
+
+    if ((sTrace.uTableSlots == 0 ||
+         sTrace.poTables[SymTableTrace_slotOf(oSymTable)] == NULL) &&
+        !SymTableTrace_addTable(oSymTable))
+        return;
+    uSlot = SymTableTrace_slotOf(oSymTable);
+
+    putc((int)eOp | ((int)eResult << 4), sTrace.psFile);
+    SymTableTrace_writeNumber(sTrace.puTableNumbers[uSlot]);
+    if (pcKey != NULL) SymTableTrace_writeNumber(uKeyNumber);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the result to record of a call of SymTable_replace or
+SymTable_get that returned pvResult. */
+static enum SymTableTrace_Result SymTableTrace_found(void *pvResult) {
+    return pvResult != NULL ? SYMTABLETRACE_TRUE : SYMTABLETRACE_UNKNOWN;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableTrace_open(const char *pcFileName, int iHashKeys) {
+    char acHeader[6] = {'S', 'y', 'm', 'T', 0, 0};
+    uint64_t uSecret;
+
+    assert(pcFileName != NULL);
+
+    SymTableTrace_close();
+
+    sTrace.psFile = fopen(pcFileName, "wb");
+    if (sTrace.psFile == NULL) return 0;
+    sTrace.oKeyNumbers = SymTable_new();
+    if (sTrace.oKeyNumbers == NULL) {
+        fclose(sTrace.psFile);
+        sTrace.psFile = NULL;
+        return 0;
+    }
+    (void)setvbuf(sTrace.psFile, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+
+    /* The secret need only differ between traces; the hash hides keys
+    from casual reading, not from a determined attacker */
+    uSecret = (uint64_t)time(NULL) ^ (uint64_t)clock() << 32;
+    uSecret ^= (uint64_t)(uintptr_t)&uSecret;
+    sTrace.uSecret = SymTableTrace_mix(uSecret);
+    sTrace.iHashKeys = iHashKeys;
+    sTrace.uKeyCount = 0;
+    sTrace.uTableCount = 0;
+    sTrace.eState = TRACE_OPEN;
+
+    acHeader[4] = (char)SYMTABLETRACE_VERSION;
+    acHeader[5] = (char)(iHashKeys ? SYMTABLETRACE_HASHED_KEYS
+                                   : SYMTABLETRACE_RAW_KEYS);
+    fwrite(acHeader, 1, sizeof(acHeader), sTrace.psFile);
+
+    if (!sTrace.iAtExit && atexit(SymTableTrace_close) == 0)
+        sTrace.iAtExit = 1;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTableTrace_close(void) {
+    if (sTrace.eState != TRACE_OPEN) {
+        sTrace.eState = TRACE_CLOSED;
+        return;
+    }
+
+    fclose(sTrace.psFile);
+    sTrace.psFile = NULL;
+    SymTable_free(sTrace.oKeyNumbers);
+    sTrace.oKeyNumbers = NULL;
+    free(sTrace.poTables);
+    free(sTrace.puTableNumbers);
+    sTrace.poTables = NULL;
+    sTrace.puTableNumbers = NULL;
+    sTrace.uTableSlots = 0;
+    sTrace.uTablesInSlots = 0;
+    sTrace.eState = TRACE_CLOSED;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTableTrace_new(void) {
+    SymTable_T oSymTable;
+
+    oSymTable = SymTable_new();
+    if (oSymTable != NULL && SymTableTrace_isOpen())
+        (void)SymTableTrace_addTable(oSymTable);
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTableTrace_free(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    SymTableTrace_record(SYMTABLETRACE_FREE, SYMTABLETRACE_UNKNOWN,
+                         oSymTable, NULL);
+    if (sTrace.eState == TRACE_OPEN) SymTableTrace_dropTable(oSymTable);
+    SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTableTrace_getLength(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    SymTableTrace_record(SYMTABLETRACE_GETLENGTH, SYMTABLETRACE_UNKNOWN,
+                         oSymTable, NULL);
+    return SymTable_getLength(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableTrace_put(SymTable_T oSymTable,
+                      const char *pcKey, const void *pvValue) {
+    int iResult;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    iResult = SymTable_put(oSymTable, pcKey, pvValue);
+    SymTableTrace_record(SYMTABLETRACE_PUT, iResult ? SYMTABLETRACE_TRUE
+                                                    : SYMTABLETRACE_FALSE,
+                         oSymTable, pcKey);
+    return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTableTrace_replace(SymTable_T oSymTable,
+                            const char *pcKey, const void *pvValue) {
+    void *pvResult;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pvResult = SymTable_replace(oSymTable, pcKey, pvValue);
+    SymTableTrace_record(SYMTABLETRACE_REPLACE,
+                         SymTableTrace_found(pvResult), oSymTable, pcKey);
+    return pvResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableTrace_contains(SymTable_T oSymTable, const char *pcKey) {
+    int iResult;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    iResult = SymTable_contains(oSymTable, pcKey);
+    SymTableTrace_record(SYMTABLETRACE_CONTAINS, iResult ?
+                         SYMTABLETRACE_TRUE : SYMTABLETRACE_FALSE,
+                         oSymTable, pcKey);
+    return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTableTrace_get(SymTable_T oSymTable, const char *pcKey) {
+    void *pvResult;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pvResult = SymTable_get(oSymTable, pcKey);
+    SymTableTrace_record(SYMTABLETRACE_GET, SymTableTrace_found(pvResult),
+                         oSymTable, pcKey);
+    return pvResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTableTrace_remove(SymTable_T oSymTable, const char *pcKey) {
+    void *pvResult;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* The key is recorded first, since the call may free it */
+    SymTableTrace_record(SYMTABLETRACE_REMOVE, SYMTABLETRACE_UNKNOWN,
+                         oSymTable, pcKey);
+    pvResult = SymTable_remove(oSymTable, pcKey);
+    return pvResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTableTrace_map(SymTable_T oSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra) {
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    SymTableTrace_record(SYMTABLETRACE_MAP, SYMTABLETRACE_UNKNOWN,
+                         oSymTable, NULL);
+    SymTable_map(oSymTable, pfApply, pvExtra);
+}
@@ -0,0 +1,108 @@
+/*--------------------------------------------------------------------*/
+/* symtabletrace.h                                                    */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLETRACE_INCLUDED
+#define SYMTABLETRACE_INCLUDED
+
+#include "symtable.h"
+
+/* Records the SymTable operations of a program in a trace file, which
+replaysymtable replays against any implementation. Compile the
+program with -include symtabletrace.h, or include this header after
+symtable.h, and link it with symtabletrace.o: each SymTable function
+then becomes the SymTableTrace function of the same name, which calls
+it and records the call. Nothing is recorded until a trace is opened,
+either by SymTableTrace_open or, on the first call, from environment
+variable SYMTABLE_TRACE, which names the file. SYMTABLE_TRACE_KEYS=raw
+records the keys themselves instead of anonymizing them.
+
+Tracing is not thread-safe: every table of the program must be used
+by one thread at a time, and by one thread in all. Tables created
+before the trace was opened appear to the replay as new and empty.
+
+The trace is a byte string. It begins with the 4 bytes "SymT", a
+version byte (SYMTABLETRACE_VERSION) and a key mode byte
+(SYMTABLETRACE_RAW_KEYS or SYMTABLETRACE_HASHED_KEYS). Records follow,
+each an operation byte and then unsigned integers, each in LEB128: 7
+bits a byte, least significant first, the high bit set on all bytes
+but the last. The low 4 bits of the operation byte are a
+SymTableTrace_Op, and the next 2 bits are a SymTableTrace_Result.
+Tables and keys are numbered in the order in which they first appear,
+from 0. SYMTABLETRACE_NEW numbers a new table, and SYMTABLETRACE_KEY a
+new key: the number of bytes of the key, then either the key itself or
+an 8-byte keyed hash of it, least significant byte first, as the key
+mode says. SYMTABLETRACE_FREE, SYMTABLETRACE_MAP and
+SYMTABLETRACE_GETLENGTH have a table number, and the other operations
+a table number and a key number. Values are not recorded. Hashed keys
+keep their lengths, which the hash does not hide, and are compared
+only for equality in the replay. */
+
+enum SymTableTrace_Op {
+    SYMTABLETRACE_NEW = 1, SYMTABLETRACE_FREE, SYMTABLETRACE_PUT,
+    SYMTABLETRACE_REPLACE, SYMTABLETRACE_CONTAINS, SYMTABLETRACE_GET,
+    SYMTABLETRACE_REMOVE, SYMTABLETRACE_MAP, SYMTABLETRACE_GETLENGTH,
+    SYMTABLETRACE_KEY
+};
+
+/* What an operation returned: whether SymTable_put and
+SymTable_contains returned 1 (TRUE), and whether SymTable_replace and
+SymTable_get found the key, which is unknown when they return NULL,
+since a key may be bound to NULL. The other operations are recorded
+before they are called, so their results are unknown. */
+enum SymTableTrace_Result {
+    SYMTABLETRACE_UNKNOWN, SYMTABLETRACE_FALSE, SYMTABLETRACE_TRUE
+};
+
+enum {SYMTABLETRACE_VERSION = 1, SYMTABLETRACE_RAW_KEYS = 0,
+      SYMTABLETRACE_HASHED_KEYS = 1};
+
+/*--------------------------------------------------------------------*/
+
+/* Opens a new trace in the file named pcFileName, recording each key
+as a keyed hash if iHashKeys is 1 (TRUE), or as itself otherwise, and
+closes the trace that was open, if any. Returns 1 (TRUE) on success,
+and 0 (FALSE), recording nothing, if the file cannot be created. The
+trace is closed at exit. */
+  int SymTableTrace_open(const char *pcFileName, int iHashKeys);
+
+/*--------------------------------------------------------------------*/
+
+/* Closes the open trace, if any, writing out what it buffered. From
+then on nothing is recorded until SymTableTrace_open is called. */
+  void SymTableTrace_close(void);
+
+/*--------------------------------------------------------------------*/
+
+/* The SymTable functions, recording each call in the open trace. */
+
+  SymTable_T SymTableTrace_new(void);
+  void SymTableTrace_free(SymTable_T oSymTable);
+  size_t SymTableTrace_getLength(SymTable_T oSymTable);
+  int SymTableTrace_put(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue);
+  void *SymTableTrace_replace(SymTable_T oSymTable,
+     const char *pcKey, const void *pvValue);
+  int SymTableTrace_contains(SymTable_T oSymTable, const char *pcKey);
+  void *SymTableTrace_get(SymTable_T oSymTable, const char *pcKey);
+  void *SymTableTrace_remove(SymTable_T oSymTable, const char *pcKey);
+  void SymTableTrace_map(SymTable_T oSymTable,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra);
+
+/* symtabletrace.c itself calls the SymTable functions, and readers of
+traces need only the constants. */
+#ifndef SYMTABLETRACE_NO_RENAME
+#define SymTable_new SymTableTrace_new
+#define SymTable_free SymTableTrace_free
+#define SymTable_getLength SymTableTrace_getLength
+#define SymTable_put SymTableTrace_put
+#define SymTable_replace SymTableTrace_replace
+#define SymTable_contains SymTableTrace_contains
+#define SymTable_get SymTableTrace_get
+#define SymTable_remove SymTableTrace_remove
+#define SymTable_map SymTableTrace_map
+#endif
+
+#endif
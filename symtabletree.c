@@ -0,0 +1,752 @@
+/*--------------------------------------------------------------------*/
+/* symtabletree.c                                                     */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symtabletree.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The minimum degree of the B-tree. Every node other than the root
+holds between MIN_DEGREE-1 and MAX_KEYS keys, so a node's keys, key
+prefixes, and values each span only a couple of cache lines. */
+
+enum {MIN_DEGREE = 8, MAX_KEYS = 2 * MIN_DEGREE - 1};
+
+/*--------------------------------------------------------------------*/
+
+/* Each node holds up to MAX_KEYS bindings in ascending key order. An
+internal node also holds uCount+1 children; the subtree at
+apsChildren[i] holds the keys that fall between apcKeys[i-1] and
+apcKeys[i]. Leaves are allocated without the apsChildren array. */
+
+struct TreeNode {
+    /* The number of bindings stored in this node */
+    size_t uCount;
+
+    /* 1 (TRUE) if this node has no children, 0 (FALSE) otherwise */
+    int iIsLeaf;
+
+    /* The first bytes of each key, packed so that comparing two
+    prefixes as integers orders them like strcmp() */
+    size_t auPrefixes[MAX_KEYS];
+
+    /* The identifying keys */
+    char *apcKeys[MAX_KEYS];
+
+    /* The associated data */
+    const void *apvValues[MAX_KEYS];
+
+    /* The addresses of the children (internal nodes only) */
+    struct TreeNode *apsChildren[MAX_KEYS + 1];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable is a "dummy" node that points to the root of the tree. */
+
+struct SymTable {
+    /* The address of the root node, or NULL if the table is empty */
+    struct TreeNode *psRoot;
+    /* The number of bindings stored */
+    size_t length;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The state of an in-order traversal by SymTable_mapRange or
+SymTable_mapPrefix. */
+
+struct Visit {
+    /* The smallest key to visit, or NULL for no lower bound */
+    const char *pcLow;
+    /* The packed prefix of pcLow */
+    size_t uLowPrefix;
+    /* Stop before the first key >= pcHigh, or NULL for no bound */
+    const char *pcHigh;
+    /* Stop before the first key that does not begin with pcPrefix, or
+    NULL for no such bound */
+    const char *pcPrefix;
+    /* The length of pcPrefix */
+    size_t uPrefixLength;
+    /* The function to apply to each binding in the range */
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+    /* The extra parameter to pass to *pfApply */
+    void *pvExtra;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first sizeof(size_t) bytes of pcKey packed big-endian
+into a size_t, padded with zero bytes if pcKey is shorter. */
+static size_t SymTable_prefix(const char *pcKey) {
+    size_t uPrefix = 0;
+    size_t i;
+
+    assert(pcKey != NULL);
+
+    for (i = 0; i < sizeof(size_t); i++) {
+        uPrefix <<= 8;
+        if (*pcKey != '\0') {
+            uPrefix |= (size_t)(unsigned char)*pcKey;
+            pcKey++;
+        }
+    }
+
+    return uPrefix;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compare key pcKey, whose packed prefix is uPrefix, with the key at
+index i of psNode. Return a negative, zero, or positive number as
+strcmp() would. Only keys that share their whole prefix are read. */
+static int SymTable_compare(size_t uPrefix, const char *pcKey,
+                            const struct TreeNode *psNode, size_t i) {
+    assert(pcKey != NULL);
+    assert(psNode != NULL);
+
+    if (uPrefix != psNode->auPrefixes[i])
+        return uPrefix < psNode->auPrefixes[i] ? -1 : 1;
+
+    /* A zero last byte means both keys ended within the prefix */
+    if ((uPrefix & 0xFF) == 0) return 0;
+
+    return strcmp(pcKey + sizeof(size_t),
+                  psNode->apcKeys[i] + sizeof(size_t));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of the first key in psNode that is greater than or
+equal to pcKey, whose packed prefix is uPrefix. Set *piFound to 1
+(TRUE) if that key equals pcKey, and 0 (FALSE) otherwise. */
+static size_t SymTable_lowerBound(const struct TreeNode *psNode,
+                                  size_t uPrefix, const char *pcKey,
+                                  int *piFound) {
+    size_t uLow = 0;
+    size_t uHigh;
+    size_t uMid;
+
+    assert(psNode != NULL);
+    assert(pcKey != NULL);
+    assert(piFound != NULL);
+
+    uHigh = psNode->uCount;
+    while (uLow < uHigh) {
+        uMid = uLow + (uHigh - uLow) / 2;
+        if (SymTable_compare(uPrefix, pcKey, psNode, uMid) > 0)
+            uLow = uMid + 1;
+        else uHigh = uMid;
+    }
+
+    *piFound = (uLow < psNode->uCount &&
+                SymTable_compare(uPrefix, pcKey, psNode, uLow) == 0);
+    return uLow;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new node with no bindings, or NULL if insufficient memory
+is available. Leaves omit the trailing array of children. */
+static struct TreeNode *SymTable_newNode(int iIsLeaf) {
+    struct TreeNode *psNode;
+
+    if (iIsLeaf)
+        psNode = (struct TreeNode*)
+            malloc(offsetof(struct TreeNode, apsChildren));
+    else psNode = (struct TreeNode*)malloc(sizeof(struct TreeNode));
+    if (psNode == NULL) return NULL;
+
+    psNode->uCount = 0;
+    psNode->iIsLeaf = iIsLeaf;
+    return psNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move uCount bindings starting at index uFrom of psSource to index
+uTo of psDest. The ranges may overlap. */
+static void SymTable_moveBindings(struct TreeNode *psDest, size_t uTo,
+                                  struct TreeNode *psSource,
+                                  size_t uFrom, size_t uCount) {
+    assert(psDest != NULL);
+    assert(psSource != NULL);
+
+    memmove(&psDest->auPrefixes[uTo], &psSource->auPrefixes[uFrom],
+            uCount * sizeof(size_t));
+    memmove(&psDest->apcKeys[uTo], &psSource->apcKeys[uFrom],
+            uCount * sizeof(char*));
+    memmove(&psDest->apvValues[uTo], &psSource->apvValues[uFrom],
+            uCount * sizeof(const void*));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move uCount children starting at index uFrom of psSource to index
+uTo of psDest. The ranges may overlap. */
+static void SymTable_moveChildren(struct TreeNode *psDest, size_t uTo,
+                                  struct TreeNode *psSource,
+                                  size_t uFrom, size_t uCount) {
+    assert(psDest != NULL);
+    assert(psSource != NULL);
+
+    memmove(&psDest->apsChildren[uTo], &psSource->apsChildren[uFrom],
+            uCount * sizeof(struct TreeNode*));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Split the full child at index i of psParent into two nodes, moving
+the median binding up into psParent. psParent must not be full. Return
+1 (TRUE) if successful, or 0 (FALSE) and leave the tree unchanged if
+insufficient memory is available. */
+static int SymTable_split(struct TreeNode *psParent, size_t i) {
+    struct TreeNode *psLeft;
+    struct TreeNode *psRight;
+
+    assert(psParent != NULL);
+    assert(psParent->uCount < MAX_KEYS);
+
+    psLeft = psParent->apsChildren[i];
+    assert(psLeft->uCount == MAX_KEYS);
+
+    psRight = SymTable_newNode(psLeft->iIsLeaf);
+    if (psRight == NULL) return 0;
+
+    /* The upper half of psLeft becomes psRight */
+    SymTable_moveBindings(psRight, 0, psLeft, MIN_DEGREE,
+                          MIN_DEGREE - 1);
+    if (!psLeft->iIsLeaf)
+        SymTable_moveChildren(psRight, 0, psLeft, MIN_DEGREE,
+                              MIN_DEGREE);
+    psRight->uCount = MIN_DEGREE - 1;
+    psLeft->uCount = MIN_DEGREE - 1;
+
+    /* The median binding moves up between psLeft and psRight */
+    SymTable_moveBindings(psParent, i + 1, psParent, i,
+                          psParent->uCount - i);
+    SymTable_moveChildren(psParent, i + 2, psParent, i + 1,
+                          psParent->uCount - i);
+    SymTable_moveBindings(psParent, i, psLeft, MIN_DEGREE - 1, 1);
+    psParent->apsChildren[i + 1] = psRight;
+    psParent->uCount++;
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Merge the child at index i+1 of psParent, and the binding that
+separates it from its left sibling, into the child at index i. Both
+children must hold MIN_DEGREE-1 bindings. */
+static void SymTable_merge(struct TreeNode *psParent, size_t i) {
+    struct TreeNode *psLeft;
+    struct TreeNode *psRight;
+
+    assert(psParent != NULL);
+    assert(i < psParent->uCount);
+
+    psLeft = psParent->apsChildren[i];
+    psRight = psParent->apsChildren[i + 1];
+
+    SymTable_moveBindings(psLeft, psLeft->uCount, psParent, i, 1);
+    SymTable_moveBindings(psLeft, psLeft->uCount + 1, psRight, 0,
+                          psRight->uCount);
+    if (!psLeft->iIsLeaf)
+        SymTable_moveChildren(psLeft, psLeft->uCount + 1, psRight, 0,
+                              psRight->uCount + 1);
+    psLeft->uCount += psRight->uCount + 1;
+
+    SymTable_moveBindings(psParent, i, psParent, i + 1,
+                          psParent->uCount - i - 1);
+    SymTable_moveChildren(psParent, i + 1, psParent, i + 2,
+                          psParent->uCount - i - 1);
+    psParent->uCount--;
+
+    free(psRight);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make sure that the child at index i of psParent holds at least
+MIN_DEGREE bindings, borrowing a binding from a sibling or merging with
+a sibling. Return the index of the child that now covers the keys that
+the child at index i covered. */
+static size_t SymTable_fill(struct TreeNode *psParent, size_t i) {
+    struct TreeNode *psChild;
+    struct TreeNode *psSibling;
+
+    assert(psParent != NULL);
+    assert(!psParent->iIsLeaf);
+
+    psChild = psParent->apsChildren[i];
+    if (psChild->uCount >= MIN_DEGREE) return i;
+
+    /* Borrow the largest binding of the left sibling */
+    if (i > 0 && psParent->apsChildren[i - 1]->uCount >= MIN_DEGREE) {
+        psSibling = psParent->apsChildren[i - 1];
+        SymTable_moveBindings(psChild, 1, psChild, 0, psChild->uCount);
+        SymTable_moveBindings(psChild, 0, psParent, i - 1, 1);
+        SymTable_moveBindings(psParent, i - 1, psSibling,
+                              psSibling->uCount - 1, 1);
+        if (!psChild->iIsLeaf) {
+            SymTable_moveChildren(psChild, 1, psChild, 0,
+                                  psChild->uCount + 1);
+            SymTable_moveChildren(psChild, 0, psSibling,
+                                  psSibling->uCount, 1);
+        }
+        psSibling->uCount--;
+        psChild->uCount++;
+        return i;
+    }
+
+    /* Borrow the smallest binding of the right sibling */
+    if (i < psParent->uCount &&
+        psParent->apsChildren[i + 1]->uCount >= MIN_DEGREE) {
+        psSibling = psParent->apsChildren[i + 1];
+        SymTable_moveBindings(psChild, psChild->uCount, psParent, i, 1);
+        SymTable_moveBindings(psParent, i, psSibling, 0, 1);
+        SymTable_moveBindings(psSibling, 0, psSibling, 1,
+                              psSibling->uCount - 1);
+        if (!psChild->iIsLeaf) {
+            SymTable_moveChildren(psChild, psChild->uCount + 1,
+                                  psSibling, 0, 1);
+            SymTable_moveChildren(psSibling, 0, psSibling, 1,
+                                  psSibling->uCount);
+        }
+        psSibling->uCount--;
+        psChild->uCount++;
+        return i;
+    }
+
+    /* Both siblings are minimal, so merge with one of them */
+    if (i < psParent->uCount) {
+        SymTable_merge(psParent, i);
+        return i;
+    }
+    SymTable_merge(psParent, i - 1);
+    return i - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Detach the largest (if iLargest) or smallest binding from the
+subtree rooted at psNode, which must hold at least MIN_DEGREE bindings,
+and store it at index i of psDest. */
+static void SymTable_detachExtreme(struct TreeNode *psNode,
+                                   int iLargest,
+                                   struct TreeNode *psDest, size_t i) {
+    size_t uChild;
+
+    assert(psNode != NULL);
+    assert(psDest != NULL);
+
+    while (!psNode->iIsLeaf) {
+        uChild = iLargest ? psNode->uCount : 0;
+        uChild = SymTable_fill(psNode, uChild);
+        psNode = psNode->apsChildren[uChild];
+    }
+
+    if (iLargest) {
+        SymTable_moveBindings(psDest, i, psNode, psNode->uCount - 1, 1);
+    }
+    else {
+        SymTable_moveBindings(psDest, i, psNode, 0, 1);
+        SymTable_moveBindings(psNode, 0, psNode, 1, psNode->uCount - 1);
+    }
+    psNode->uCount--;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the binding whose key is pcKey, and whose packed prefix is
+uPrefix, from the subtree rooted at psNode. The binding must exist, and
+psNode must hold at least MIN_DEGREE bindings unless it is the root.
+Store the removed key in *ppcKey and its value in *ppvValue. */
+static void SymTable_delete(struct TreeNode *psNode, size_t uPrefix,
+                            const char *pcKey, char **ppcKey,
+                            const void **ppvValue) {
+    size_t i;
+    int iFound;
+
+    assert(psNode != NULL);
+    assert(pcKey != NULL);
+    assert(ppcKey != NULL);
+    assert(ppvValue != NULL);
+
+    for (;;) {
+        i = SymTable_lowerBound(psNode, uPrefix, pcKey, &iFound);
+
+        if (iFound && psNode->iIsLeaf) {
+            *ppcKey = psNode->apcKeys[i];
+            *ppvValue = psNode->apvValues[i];
+            SymTable_moveBindings(psNode, i, psNode, i + 1,
+                                  psNode->uCount - i - 1);
+            psNode->uCount--;
+            return;
+        }
+
+        if (iFound) {
+            /* Replace the binding with its predecessor or successor if
+            either child can spare one, otherwise merge the children */
+            if (psNode->apsChildren[i]->uCount >= MIN_DEGREE ||
+                psNode->apsChildren[i + 1]->uCount >= MIN_DEGREE) {
+                *ppcKey = psNode->apcKeys[i];
+                *ppvValue = psNode->apvValues[i];
+                if (psNode->apsChildren[i]->uCount >= MIN_DEGREE)
+                    SymTable_detachExtreme(psNode->apsChildren[i], 1,
+                                           psNode, i);
+                else SymTable_detachExtreme(psNode->apsChildren[i + 1],
+                                            0, psNode, i);
+                return;
+            }
+            SymTable_merge(psNode, i);
+            psNode = psNode->apsChildren[i];
+            continue;
+        }
+
+        assert(!psNode->iIsLeaf);
+        i = SymTable_fill(psNode, i);
+        psNode = psNode->apsChildren[i];
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the node of oSymTable that holds the binding whose key is
+pcKey, and store the binding's index within that node in *pi. Return
+NULL if no such binding exists. */
+static struct TreeNode *SymTable_find(SymTable_T oSymTable,
+                                      const char *pcKey, size_t *pi) {
+    struct TreeNode *psNode;
+    size_t uPrefix;
+    int iFound;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(pi != NULL);
+
+    uPrefix = SymTable_prefix(pcKey);
+    for (psNode = oSymTable->psRoot; psNode != NULL;
+         psNode = psNode->apsChildren[*pi]) {
+        *pi = SymTable_lowerBound(psNode, uPrefix, pcKey, &iFound);
+        if (iFound) return psNode;
+        if (psNode->iIsLeaf) return NULL;
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free psNode, all of its descendants, and the keys they hold. */
+static void SymTable_freeNode(struct TreeNode *psNode) {
+    size_t i;
+
+    assert(psNode != NULL);
+
+    for (i = 0; i < psNode->uCount; i++)
+        free(psNode->apcKeys[i]);
+    if (!psNode->iIsLeaf) {
+        for (i = 0; i <= psNode->uCount; i++)
+            SymTable_freeNode(psNode->apsChildren[i]);
+    }
+    free(psNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if pcKey lies beyond the upper end of the traversal
+psVisit, and 0 (FALSE) otherwise. */
+static int SymTable_isPastEnd(const char *pcKey,
+                              const struct Visit *psVisit) {
+    assert(pcKey != NULL);
+    assert(psVisit != NULL);
+
+    if (psVisit->pcHigh != NULL && strcmp(pcKey, psVisit->pcHigh) >= 0)
+        return 1;
+    if (psVisit->pcPrefix != NULL &&
+        strncmp(pcKey, psVisit->pcPrefix, psVisit->uPrefixLength) != 0)
+        return 1;
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply psVisit->pfApply to the bindings of the subtree rooted at
+psNode in ascending key order, skipping keys below the lower bound of
+psVisit if iBounded. Return 0 (FALSE) once a key beyond the upper end
+of psVisit is reached, and 1 (TRUE) otherwise. */
+static int SymTable_visit(struct TreeNode *psNode,
+                          const struct Visit *psVisit, int iBounded) {
+    size_t i = 0;
+    int iFound;
+
+    assert(psNode != NULL);
+    assert(psVisit != NULL);
+
+    if (iBounded && psVisit->pcLow != NULL)
+        i = SymTable_lowerBound(psNode, psVisit->uLowPrefix,
+                                psVisit->pcLow, &iFound);
+
+    /* Only the first child visited can hold keys below the bound */
+    for (;; i++) {
+        if (!psNode->iIsLeaf &&
+            !SymTable_visit(psNode->apsChildren[i], psVisit, iBounded))
+            return 0;
+        iBounded = 0;
+        if (i == psNode->uCount) return 1;
+        if (SymTable_isPastEnd(psNode->apcKeys[i], psVisit)) return 0;
+        (*psVisit->pfApply)(psNode->apcKeys[i],
+                            (void*)psNode->apvValues[i],
+                            psVisit->pvExtra);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+    SymTable_T oSymTable;
+
+    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+    if (oSymTable == NULL) return NULL;
+
+    oSymTable->psRoot = NULL;
+    oSymTable->length = 0;
+
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    if (oSymTable->psRoot != NULL) SymTable_freeNode(oSymTable->psRoot);
+    free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    return oSymTable->length;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+                 const char *pcKey,
+                 const void *pvValue) {
+    struct TreeNode *psNode;
+    struct TreeNode *psNewRoot;
+    char *pcKeyCopy;
+    size_t uPrefix;
+    size_t i;
+    int iFound;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* Check if oSymTable already contains pcKey */
+    if (SymTable_find(oSymTable, pcKey, &i) != NULL) return 0;
+
+    /* Create a defensive copy of the string to which pcKey points */
+    pcKeyCopy = (char*)malloc(strlen(pcKey) + 1);
+    if (pcKeyCopy == NULL) return 0;
+    strcpy(pcKeyCopy, pcKey);
+    uPrefix = SymTable_prefix(pcKeyCopy);
+
+    /* Grow the tree at the root if the root is full */
+    if (oSymTable->psRoot == NULL) {
+        oSymTable->psRoot = SymTable_newNode(1);
+        if (oSymTable->psRoot == NULL) {
+            free(pcKeyCopy);
+            return 0;
+        }
+    }
+    else if (oSymTable->psRoot->uCount == MAX_KEYS) {
+        psNewRoot = SymTable_newNode(0);
+        if (psNewRoot == NULL) {
+            free(pcKeyCopy);
+            return 0;
+        }
+        psNewRoot->apsChildren[0] = oSymTable->psRoot;
+        if (!SymTable_split(psNewRoot, 0)) {
+            free(psNewRoot);
+            free(pcKeyCopy);
+            return 0;
+        }
+        oSymTable->psRoot = psNewRoot;
+    }
+
+    /* Descend to a leaf, splitting full nodes on the way down */
+    psNode = oSymTable->psRoot;
+    for (;;) {
+        i = SymTable_lowerBound(psNode, uPrefix, pcKeyCopy, &iFound);
+        if (psNode->iIsLeaf) break;
+        if (psNode->apsChildren[i]->uCount == MAX_KEYS) {
+            if (!SymTable_split(psNode, i)) {
+                free(pcKeyCopy);
+                return 0;
+            }
+            if (SymTable_compare(uPrefix, pcKeyCopy, psNode, i) > 0)
+                i++;
+        }
+        psNode = psNode->apsChildren[i];
+    }
+
+    SymTable_moveBindings(psNode, i + 1, psNode, i, psNode->uCount - i);
+    psNode->auPrefixes[i] = uPrefix;
+    psNode->apcKeys[i] = pcKeyCopy;
+    psNode->apvValues[i] = pvValue;
+    psNode->uCount++;
+
+    oSymTable->length++;
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+                       const char *pcKey,
+                       const void *pvValue) {
+    struct TreeNode *psNode;
+    void *pvOldValue;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psNode = SymTable_find(oSymTable, pcKey, &i);
+    if (psNode == NULL) return NULL;
+
+    pvOldValue = (void*)psNode->apvValues[i];
+    psNode->apvValues[i] = pvValue;
+    return pvOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_find(oSymTable, pcKey, &i) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    struct TreeNode *psNode;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psNode = SymTable_find(oSymTable, pcKey, &i);
+    if (psNode == NULL) return NULL;
+
+    return (void*)psNode->apvValues[i];
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    struct TreeNode *psRoot;
+    char *pcOldKey;
+    const void *pvOldValue;
+    size_t i;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* Check for the key first so that misses leave the tree intact */
+    if (SymTable_find(oSymTable, pcKey, &i) == NULL) return NULL;
+
+    SymTable_delete(oSymTable->psRoot, SymTable_prefix(pcKey), pcKey,
+                    &pcOldKey, &pvOldValue);
+
+    /* Shrink the tree at the root if the root has emptied */
+    psRoot = oSymTable->psRoot;
+    if (psRoot->uCount == 0) {
+        if (psRoot->iIsLeaf) oSymTable->psRoot = NULL;
+        else oSymTable->psRoot = psRoot->apsChildren[0];
+        free(psRoot);
+    }
+
+    /* Free the memory in which the key resides */
+    free(pcOldKey);
+
+    oSymTable->length--;
+
+    return (void*)pvOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    SymTable_mapRange(oSymTable, NULL, NULL, pfApply, pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    struct Visit sVisit;
+
+    assert(oSymTable != NULL);
+    assert(pcPrefix != NULL);
+    assert(pfApply != NULL);
+
+    if (oSymTable->psRoot == NULL) return;
+
+    sVisit.pcLow = pcPrefix;
+    sVisit.uLowPrefix = SymTable_prefix(pcPrefix);
+    sVisit.pcHigh = NULL;
+    sVisit.pcPrefix = pcPrefix;
+    sVisit.uPrefixLength = strlen(pcPrefix);
+    sVisit.pfApply = pfApply;
+    sVisit.pvExtra = (void*)pvExtra;
+
+    (void)SymTable_visit(oSymTable->psRoot, &sVisit, 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_mapRange(SymTable_T oSymTable,
+    const char *pcLow, const char *pcHigh,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    struct Visit sVisit;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    if (oSymTable->psRoot == NULL) return;
+
+    sVisit.pcLow = pcLow;
+    sVisit.uLowPrefix = pcLow == NULL ? 0 : SymTable_prefix(pcLow);
+    sVisit.pcHigh = pcHigh;
+    sVisit.pcPrefix = NULL;
+    sVisit.uPrefixLength = 0;
+    sVisit.pfApply = pfApply;
+    sVisit.pvExtra = (void*)pvExtra;
+
+    (void)SymTable_visit(oSymTable->psRoot, &sVisit, 1);
+}
@@ -0,0 +1,37 @@
+/*--------------------------------------------------------------------*/
+/* symtabletree.h                                                     */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLETREE_INCLUDED
+#define SYMTABLETREE_INCLUDED
+
+#include "symtable.h"
+
+/* Ordered queries provided by the B-tree implementation of the SymTable
+ADT (symtabletree.c). Bindings are ordered by strcmp() of their keys,
+and SymTable_map visits them in that order. */
+
+/*--------------------------------------------------------------------*/
+
+/* Applies function *pfApply to each binding in oSymTable whose key
+begins with pcPrefix, in ascending key order, passing pvExtra as an
+extra parameter. An empty pcPrefix matches every binding. Runs in
+O(log n + k) time, where k is the number of matching bindings. */
+  void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+/* Applies function *pfApply to each binding in oSymTable whose key is
+greater than or equal to pcLow and less than pcHigh, in ascending key
+order, passing pvExtra as an extra parameter. A NULL pcLow or pcHigh
+leaves that end of the range unbounded. Runs in O(log n + k) time,
+where k is the number of bindings in the range. */
+  void SymTable_mapRange(SymTable_T oSymTable,
+     const char *pcLow, const char *pcHigh,
+     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+     const void *pvExtra);
+
+#endif
@@ -0,0 +1,344 @@
+/*--------------------------------------------------------------------*/
+/* symtabletyped.h                                                    */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLETYPED_INCLUDED
+#define SYMTABLETYPED_INCLUDED
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "keyops.h"
+
+/* Hash tables whose values are of a fixed type, stored inside the
+bindings instead of behind void pointers. Each binding is one block
+of memory that holds the value and a copy of the key, so that a put
+allocates once and a get dereferences nothing but the binding.
+
+SYMTABLE_DECLARE_TYPED(Name, Type) declares the type Name_T and these
+functions, which behave as their SymTable namesakes except as noted.
+Place it in a header, or at the top of a source file.
+
+  Name_T Name_new(void);
+  void Name_free(Name_T oTable);
+  size_t Name_getLength(Name_T oTable);
+  int Name_put(Name_T oTable, const char *pcKey, Type value);
+  int Name_contains(Name_T oTable, const char *pcKey);
+
+  int Name_get(Name_T oTable, const char *pcKey, Type *pValue);
+    Returns 1 (TRUE) and stores the value of pcKey in *pValue, or
+    returns 0 (FALSE) and leaves *pValue unchanged if pcKey is not
+    bound.
+
+  Type *Name_lookup(Name_T oTable, const char *pcKey);
+    Returns the address of the value of pcKey, through which it may be
+    changed in place until the next put or remove, or NULL if pcKey is
+    not bound.
+
+  int Name_replace(Name_T oTable, const char *pcKey, Type value,
+     Type *pOldValue);
+  int Name_remove(Name_T oTable, const char *pcKey, Type *pOldValue);
+    Return 1 (TRUE), and store the old value in *pOldValue unless
+    pOldValue is NULL, or return 0 (FALSE) and change nothing if
+    pcKey is not bound.
+
+  void Name_map(Name_T oTable,
+     void (*pfApply)(const char *pcKey, Type *pValue, void *pvExtra),
+     const void *pvExtra);
+
+SYMTABLE_DEFINE_TYPED(Name, Type) defines them. Place it in exactly one
+source file, after SYMTABLE_DECLARE_TYPED, and link that file with
+keyops.o. */
+
+/*--------------------------------------------------------------------*/
+
+#define SYMTABLE_DECLARE_TYPED(Name, Type)                              \
+                                                                        \
+typedef struct Name *Name##_T;                                          \
+                                                                        \
+Name##_T Name##_new(void);                                              \
+void Name##_free(Name##_T oTable);                                      \
+size_t Name##_getLength(Name##_T oTable);                               \
+int Name##_put(Name##_T oTable, const char *pcKey, Type value);         \
+int Name##_replace(Name##_T oTable, const char *pcKey, Type value,      \
+   Type *pOldValue);                                                    \
+int Name##_contains(Name##_T oTable, const char *pcKey);                \
+int Name##_get(Name##_T oTable, const char *pcKey, Type *pValue);       \
+Type *Name##_lookup(Name##_T oTable, const char *pcKey);                \
+int Name##_remove(Name##_T oTable, const char *pcKey, Type *pOldValue); \
+void Name##_map(Name##_T oTable,                                        \
+   void (*pfApply)(const char *pcKey, Type *pValue, void *pvExtra),     \
+   const void *pvExtra)
+
+/*--------------------------------------------------------------------*/
+
+/* The number of buckets of a new table, a power of 2. A table doubles
+its buckets when its length reaches their number. */
+
+#define SYMTABLE_TYPED_INITIAL_BUCKETS 512
+
+/* Return the bucket, among 2 to the power uBits, of hash code uHash.
+The top bits of the mixed hash code are used, since the low bits of
+the hash codes of short keys vary little. */
+
+#define SYMTABLE_TYPED_BUCKET(uHash, uBits)                             \
+   ((size_t)(((uint64_t)(uHash) * UINT64_C(0x9E3779B97F4A7C15))         \
+             >> (64 - (uBits))))
+
+/*--------------------------------------------------------------------*/
+
+#define SYMTABLE_DEFINE_TYPED(Name, Type)                               \
+                                                                        \
+/* Each binding is one block: the fields below, then its key. */        \
+                                                                        \
+struct Name##_Binding {                                                 \
+    /* The address of the next binding in the bucket */                 \
+    struct Name##_Binding *psNext;                                      \
+    /* The hash code of the key */                                      \
+    size_t uHash;                                                       \
+    /* The value */                                                     \
+    Type value;                                                         \
+    /* The key, which continues past the end of the structure */        \
+    char acKey[1];                                                      \
+};                                                                      \
+                                                                        \
+/* A table is an array of buckets, each a chain of bindings. */         \
+                                                                        \
+struct Name {                                                           \
+    /* The address of the array of first bindings */                    \
+    struct Name##_Binding **ppsBuckets;                                 \
+    /* The number of buckets is 2 to the power uBits */                 \
+    unsigned int uBits;                                                 \
+    /* The number of bindings */                                        \
+    size_t uLength;                                                     \
+};                                                                      \
+                                                                        \
+/* Return the binding of oTable whose key is pcKey, whose hash code     \
+is uHash, and store the address of the pointer to it in *pppsLink, or   \
+return NULL and store the address of the pointer that ends its          \
+bucket. */                                                              \
+                                                                        \
+static struct Name##_Binding *Name##_find(Name##_T oTable,              \
+    const char *pcKey, size_t uHash,                                    \
+    struct Name##_Binding ***pppsLink) {                                \
+    struct Name##_Binding **ppsLink;                                    \
+                                                                        \
+    assert(oTable != NULL);                                             \
+    assert(pcKey != NULL);                                              \
+                                                                        \
+    ppsLink = &oTable->ppsBuckets[                                      \
+        SYMTABLE_TYPED_BUCKET(uHash, oTable->uBits)];                   \
+    while (*ppsLink != NULL) {                                          \
+        if ((*ppsLink)->uHash == uHash &&                               \
+            KeyOps_equals((*ppsLink)->acKey, pcKey))                    \
+            break;                                                      \
+        ppsLink = &(*ppsLink)->psNext;                                  \
+    }                                                                   \
+    if (pppsLink != NULL) *pppsLink = ppsLink;                          \
+    return *ppsLink;                                                    \
+}                                                                       \
+                                                                        \
+/* Double the buckets of oTable, or leave them if insufficient memory   \
+is available. */                                                        \
+                                                                        \
+static void Name##_expand(Name##_T oTable) {                            \
+    struct Name##_Binding **ppsOldBuckets;                              \
+    struct Name##_Binding *psBinding;                                   \
+    struct Name##_Binding *psNext;                                      \
+    size_t uOldCount;                                                   \
+    size_t uBucket;                                                     \
+    size_t u;                                                           \
+                                                                        \
+    assert(oTable != NULL);                                             \
+                                                                        \
+    ppsOldBuckets = oTable->ppsBuckets;                                 \
+    uOldCount = (size_t)1 << oTable->uBits;                             \
+    oTable->ppsBuckets = (struct Name##_Binding**)                      \
+        malloc(2 * uOldCount * sizeof(struct Name##_Binding*));         \
+    if (oTable->ppsBuckets == NULL) {                                   \
+        oTable->ppsBuckets = ppsOldBuckets;                             \
+        return;                                                         \
+    }                                                                   \
+    for (u = 0; u < 2 * uOldCount; u++) oTable->ppsBuckets[u] = NULL;   \
+    oTable->uBits++;                                                    \
+                                                                        \
+    for (u = 0; u < uOldCount; u++)                                     \
+        for (psBinding = ppsOldBuckets[u]; psBinding != NULL;           \
+             psBinding = psNext) {                                      \
+            psNext = psBinding->psNext;                                 \
+            uBucket = SYMTABLE_TYPED_BUCKET(psBinding->uHash,           \
+                                            oTable->uBits);             \
+            psBinding->psNext = oTable->ppsBuckets[uBucket];            \
+            oTable->ppsBuckets[uBucket] = psBinding;                    \
+        }                                                               \
+                                                                        \
+    free(ppsOldBuckets);                                                \
+}                                                                       \
+                                                                        \
+Name##_T Name##_new(void) {                                             \
+    Name##_T oTable;                                                    \
+    size_t u;                                                           \
+                                                                        \
+    oTable = (Name##_T)malloc(sizeof(struct Name));                     \
+    if (oTable == NULL) return NULL;                                    \
+                                                                        \
+    oTable->ppsBuckets = (struct Name##_Binding**)                      \
+        malloc(SYMTABLE_TYPED_INITIAL_BUCKETS                           \
+               * sizeof(struct Name##_Binding*));                       \
+    if (oTable->ppsBuckets == NULL) {                                   \
+        free(oTable);                                                   \
+        return NULL;                                                    \
+    }                                                                   \
+    for (u = 0; u < SYMTABLE_TYPED_INITIAL_BUCKETS; u++)                \
+        oTable->ppsBuckets[u] = NULL;                                   \
+                                                                        \
+    oTable->uBits = 0;                                                  \
+    while (((size_t)1 << oTable->uBits)                                 \
+           < SYMTABLE_TYPED_INITIAL_BUCKETS)                            \
+        oTable->uBits++;                                                \
+    oTable->uLength = 0;                                                \
+                                                                        \
+    return oTable;                                                      \
+}                                                                       \
+                                                                        \
+void Name##_free(Name##_T oTable) {                                     \
+    struct Name##_Binding *psBinding;                                   \
+    struct Name##_Binding *psNext;                                      \
+    size_t u;                                                           \
+                                                                        \
+    assert(oTable != NULL);                                             \
+                                                                        \
+    for (u = 0; u < (size_t)1 << oTable->uBits; u++)                    \
+        for (psBinding = oTable->ppsBuckets[u]; psBinding != NULL;      \
+             psBinding = psNext) {                                      \
+            psNext = psBinding->psNext;                                 \
+            free(psBinding);                                            \
+        }                                                               \
+    free(oTable->ppsBuckets);                                           \
+    free(oTable);                                                       \
+}                                                                       \
+                                                                        \
+size_t Name##_getLength(Name##_T oTable) {                              \
+    assert(oTable != NULL);                                             \
+                                                                        \
+    return oTable->uLength;                                             \
+}                                                                       \
+                                                                        \
+int Name##_put(Name##_T oTable, const char *pcKey, Type value) {        \
+    struct Name##_Binding *psBinding;                                   \
+    struct Name##_Binding **ppsLink;                                    \
+    size_t uKeySize;                                                    \
+    size_t uHash;                                                       \
+                                                                        \
+    assert(oTable != NULL);                                             \
+    assert(pcKey != NULL);                                              \
+                                                                        \
+    uHash = KeyOps_hash(pcKey);                                         \
+                                                                        \
+    if (Name##_find(oTable, pcKey, uHash, &ppsLink) != NULL)            \
+        return 0;                                                       \
+                                                                        \
+    /* Grow only for a new binding, and find its bucket again */        \
+    if (oTable->uLength >= (size_t)1 << oTable->uBits) {                \
+        Name##_expand(oTable);                                          \
+        (void)Name##_find(oTable, pcKey, uHash, &ppsLink);              \
+    }                                                                   \
+                                                                        \
+    uKeySize = strlen(pcKey) + 1;                                       \
+    psBinding = (struct Name##_Binding*)                                \
+        malloc(offsetof(struct Name##_Binding, acKey) + uKeySize);      \
+    if (psBinding == NULL) return 0;                                    \
+    psBinding->uHash = uHash;                                           \
+    psBinding->value = value;                                           \
+    memcpy(psBinding->acKey, pcKey, uKeySize);                          \
+                                                                        \
+    /* Append to the bucket, whose end the search found */              \
+    psBinding->psNext = NULL;                                           \
+    *ppsLink = psBinding;                                               \
+    oTable->uLength++;                                                  \
+                                                                        \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+int Name##_replace(Name##_T oTable, const char *pcKey, Type value,      \
+                   Type *pOldValue) {                                   \
+    struct Name##_Binding *psBinding;                                   \
+                                                                        \
+    psBinding = Name##_find(oTable, pcKey, KeyOps_hash(pcKey),          \
+                            NULL);                                      \
+    if (psBinding == NULL) return 0;                                    \
+                                                                        \
+    if (pOldValue != NULL) *pOldValue = psBinding->value;               \
+    psBinding->value = value;                                           \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+int Name##_contains(Name##_T oTable, const char *pcKey) {               \
+    return Name##_find(oTable, pcKey, KeyOps_hash(pcKey),               \
+                       NULL) != NULL;                                   \
+}                                                                       \
+                                                                        \
+int Name##_get(Name##_T oTable, const char *pcKey, Type *pValue) {      \
+    struct Name##_Binding *psBinding;                                   \
+                                                                        \
+    assert(pValue != NULL);                                             \
+                                                                        \
+    psBinding = Name##_find(oTable, pcKey, KeyOps_hash(pcKey),          \
+                            NULL);                                      \
+    if (psBinding == NULL) return 0;                                    \
+                                                                        \
+    *pValue = psBinding->value;                                         \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+Type *Name##_lookup(Name##_T oTable, const char *pcKey) {               \
+    struct Name##_Binding *psBinding;                                   \
+                                                                        \
+    psBinding = Name##_find(oTable, pcKey, KeyOps_hash(pcKey),          \
+                            NULL);                                      \
+    if (psBinding == NULL) return NULL;                                 \
+                                                                        \
+    return &psBinding->value;                                           \
+}                                                                       \
+                                                                        \
+int Name##_remove(Name##_T oTable, const char *pcKey,                   \
+                  Type *pOldValue) {                                    \
+    struct Name##_Binding *psBinding;                                   \
+    struct Name##_Binding **ppsLink;                                    \
+                                                                        \
+    psBinding = Name##_find(oTable, pcKey, KeyOps_hash(pcKey),          \
+                            &ppsLink);                                  \
+    if (psBinding == NULL) return 0;                                    \
+                                                                        \
+    if (pOldValue != NULL) *pOldValue = psBinding->value;               \
+    *ppsLink = psBinding->psNext;                                       \
+    free(psBinding);                                                    \
+    oTable->uLength--;                                                  \
+    return 1;                                                           \
+}                                                                       \
+                                                                        \
+void Name##_map(Name##_T oTable,                                        \
+    void (*pfApply)(const char *pcKey, Type *pValue, void *pvExtra),    \
+    const void *pvExtra) {                                              \
+    struct Name##_Binding *psBinding;                                   \
+    struct Name##_Binding *psNext;                                      \
+    size_t u;                                                           \
+                                                                        \
+    assert(oTable != NULL);                                             \
+    assert(pfApply != NULL);                                            \
+                                                                        \
+    for (u = 0; u < (size_t)1 << oTable->uBits; u++)                    \
+        for (psBinding = oTable->ppsBuckets[u]; psBinding != NULL;      \
+             psBinding = psNext) {                                      \
+            psNext = psBinding->psNext;                                 \
+            (*pfApply)(psBinding->acKey, &psBinding->value,             \
+                       (void*)pvExtra);                                 \
+        }                                                               \
+}                                                                       \
+                                                                        \
+struct Name##_Unused
+
+#endif
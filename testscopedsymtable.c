@@ -0,0 +1,203 @@
+/*--------------------------------------------------------------------*/
+/* testscopedsymtable.c                                               */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include "scopedsymtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test shadowing and scope exit on a few nested scopes. */
+
+static void testShadowing(void)
+{
+   ScopedSymTable_T oScopedSymTable;
+   char acGlobal[] = "global";
+   char acParam[] = "param";
+   char acLocal[] = "local";
+   size_t uDepth;
+   int iFound;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing shadowing in a ScopedSymTable object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oScopedSymTable = ScopedSymTable_new();
+   ASSURE(oScopedSymTable != NULL);
+   ASSURE(ScopedSymTable_getDepth(oScopedSymTable) == 0);
+
+   ASSURE(ScopedSymTable_put(oScopedSymTable, "x", acGlobal));
+   ASSURE(! ScopedSymTable_put(oScopedSymTable, "x", acLocal));
+   ASSURE(ScopedSymTable_put(oScopedSymTable, "y", NULL));
+
+   ASSURE(ScopedSymTable_enterScope(oScopedSymTable));
+   ASSURE(ScopedSymTable_getDepth(oScopedSymTable) == 1);
+   ASSURE(ScopedSymTable_get(oScopedSymTable, "x") == acGlobal);
+   ASSURE(ScopedSymTable_put(oScopedSymTable, "x", acParam));
+   ASSURE(ScopedSymTable_get(oScopedSymTable, "x") == acParam);
+
+   ASSURE(ScopedSymTable_enterScope(oScopedSymTable));
+   ASSURE(ScopedSymTable_enterScope(oScopedSymTable));
+   ASSURE(ScopedSymTable_put(oScopedSymTable, "x", acLocal));
+   ASSURE(ScopedSymTable_put(oScopedSymTable, "z", acLocal));
+   ASSURE(ScopedSymTable_get(oScopedSymTable, "x") == acLocal);
+   uDepth = ScopedSymTable_getScopeOf(oScopedSymTable, "x", &iFound);
+   ASSURE(iFound && uDepth == 3);
+   uDepth = ScopedSymTable_getScopeOf(oScopedSymTable, "y", &iFound);
+   ASSURE(iFound && uDepth == 0);
+   ASSURE(ScopedSymTable_contains(oScopedSymTable, "y"));
+   ASSURE(ScopedSymTable_get(oScopedSymTable, "y") == NULL);
+   uDepth = ScopedSymTable_getScopeOf(oScopedSymTable, "w", &iFound);
+   ASSURE(! iFound);
+
+   /* Replace changes only the innermost binding */
+   ASSURE(ScopedSymTable_replace(oScopedSymTable, "x", acGlobal)
+      == acLocal);
+   ASSURE(ScopedSymTable_replace(oScopedSymTable, "w", acGlobal)
+      == NULL);
+
+   ScopedSymTable_exitScope(oScopedSymTable);
+   ASSURE(ScopedSymTable_get(oScopedSymTable, "x") == acParam);
+   ASSURE(! ScopedSymTable_contains(oScopedSymTable, "z"));
+
+   ScopedSymTable_exitScope(oScopedSymTable);
+   ASSURE(ScopedSymTable_get(oScopedSymTable, "x") == acParam);
+
+   ScopedSymTable_exitScope(oScopedSymTable);
+   ASSURE(ScopedSymTable_getDepth(oScopedSymTable) == 0);
+   ASSURE(ScopedSymTable_get(oScopedSymTable, "x") == acGlobal);
+
+   /* A name can be bound again after its scope has been exited */
+   ASSURE(ScopedSymTable_enterScope(oScopedSymTable));
+   ASSURE(ScopedSymTable_put(oScopedSymTable, "z", acParam));
+   ASSURE(ScopedSymTable_get(oScopedSymTable, "z") == acParam);
+
+   /* Free with scopes still entered */
+   ScopedSymTable_free(oScopedSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test iDepth nested scopes that all bind the same iBindingCount
+   names, and time the lookups in the innermost scope. */
+
+static void testDeepNesting(int iDepth, int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   ScopedSymTable_T oScopedSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   int *aiDepths;
+   size_t uScope;
+   int iScope;
+   int iFound;
+   int i;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a ScopedSymTable object with deeply nested\n");
+   printf("scopes.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   oScopedSymTable = ScopedSymTable_new();
+   ASSURE(oScopedSymTable != NULL);
+   aiDepths = (int*)malloc((size_t)iDepth * sizeof(int));
+   ASSURE(aiDepths != NULL);
+   for (iScope = 0; iScope < iDepth; iScope++)
+      aiDepths[iScope] = iScope;
+
+   iInitialClock = clock();
+
+   /* Scope iScope binds every name whose number it divides */
+   for (iScope = 1; iScope < iDepth; iScope++)
+   {
+      ASSURE(ScopedSymTable_enterScope(oScopedSymTable));
+      for (i = 0; i < iBindingCount; i += iScope)
+      {
+         sprintf(acKey, "name%d", i);
+         ASSURE(ScopedSymTable_put(oScopedSymTable, acKey,
+            &aiDepths[iScope]));
+      }
+   }
+
+   /* Unwind one scope at a time, checking every name at each level */
+   for (iScope = iDepth - 1; iScope > 0; iScope--)
+   {
+      for (i = 1; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "name%d", i);
+         uScope = ScopedSymTable_getScopeOf(oScopedSymTable, acKey,
+            &iFound);
+         ASSURE(iFound);
+         ASSURE(ScopedSymTable_get(oScopedSymTable, acKey) ==
+            &aiDepths[uScope]);
+         ASSURE(i % (int)uScope == 0 && (int)uScope <= iScope);
+      }
+      ScopedSymTable_exitScope(oScopedSymTable);
+   }
+   ASSURE(! ScopedSymTable_contains(oScopedSymTable, "name1"));
+
+   iFinalClock = clock();
+   printf("CPU time (%d scopes):  %f seconds\n", iDepth,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   fflush(stdout);
+
+   ScopedSymTable_free(oScopedSymTable);
+   free(aiDepths);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ScopedSymTable ADT. argv[1] is the number of names bound
+   in the outermost of the nested scopes. Exit with EXIT_FAILURE if
+   argv[1] is missing or not numeric. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount must be a non-negative number\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testShadowing();
+   testDeepNesting(100, iBindingCount / 10);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
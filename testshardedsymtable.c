@@ -0,0 +1,230 @@
+/*--------------------------------------------------------------------*/
+/* testshardedsymtable.c                                              */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include "shardedsymtable.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_KEY_LENGTH = 32, WRITER_COUNT = 4};
+
+/*--------------------------------------------------------------------*/
+
+/* Add 1 to the size_t to which pvExtra points. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   (void)pcKey;
+   (void)pvValue;
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable operations of a ShardedSymTable object with
+   uShardCount shards, from one thread, on iBindingCount bindings. */
+
+static void testBasics(size_t uShardCount, int iBindingCount)
+{
+   ShardedSymTable_T oShardedSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   size_t uCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a ShardedSymTable object with %lu shards.\n",
+      (unsigned long)uShardCount);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oShardedSymTable = ShardedSymTable_new(uShardCount);
+   ASSURE(oShardedSymTable != NULL);
+   ASSURE(ShardedSymTable_getShardCount(oShardedSymTable)
+      >= uShardCount);
+   ASSURE(ShardedSymTable_getLength(oShardedSymTable) == 0);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(ShardedSymTable_put(oShardedSymTable, acKey, acValue));
+   }
+   ASSURE(ShardedSymTable_getLength(oShardedSymTable)
+      == (size_t)iBindingCount);
+   ASSURE(! ShardedSymTable_put(oShardedSymTable, "0", NULL));
+   ASSURE(ShardedSymTable_contains(oShardedSymTable, "0"));
+   ASSURE(! ShardedSymTable_contains(oShardedSymTable, "x"));
+   ASSURE(ShardedSymTable_get(oShardedSymTable, "0") == acValue);
+   ASSURE(ShardedSymTable_replace(oShardedSymTable, "0", NULL)
+      == acValue);
+   ASSURE(ShardedSymTable_get(oShardedSymTable, "0") == NULL);
+   ASSURE(ShardedSymTable_replace(oShardedSymTable, "x", NULL) == NULL);
+
+   uCount = 0;
+   ShardedSymTable_map(oShardedSymTable, countBinding, &uCount);
+   ASSURE(uCount == (size_t)iBindingCount);
+
+   for (i = 1; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(ShardedSymTable_remove(oShardedSymTable, acKey)
+         == acValue);
+   }
+   ASSURE(ShardedSymTable_remove(oShardedSymTable, "x") == NULL);
+   ASSURE(ShardedSymTable_getLength(oShardedSymTable) == 1);
+
+   ShardedSymTable_free(oShardedSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The work of one writer thread. */
+
+struct Writer {
+   /* The table shared by all threads */
+   ShardedSymTable_T oShardedSymTable;
+   /* The number of the writer, which prefixes its keys */
+   int iWriter;
+   /* The number of keys the writer puts */
+   int iKeyCount;
+};
+
+/* Put the keys of the writer to which pvWriter points, then remove
+   every other one. Return NULL. */
+
+static void *runWriter(void *pvWriter)
+{
+   struct Writer *psWriter = (struct Writer*)pvWriter;
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+
+   for (i = 0; i < psWriter->iKeyCount; i++)
+   {
+      sprintf(acKey, "%d.%d", psWriter->iWriter, i);
+      ASSURE(ShardedSymTable_put(psWriter->oShardedSymTable, acKey,
+         psWriter));
+   }
+   for (i = 0; i < psWriter->iKeyCount; i += 2)
+   {
+      sprintf(acKey, "%d.%d", psWriter->iWriter, i);
+      ASSURE(ShardedSymTable_remove(psWriter->oShardedSymTable, acKey)
+         == psWriter);
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a ShardedSymTable object that WRITER_COUNT threads change at
+   once, each putting iKeyCount keys and removing half of them, while
+   the main thread reads its length and maps over it. */
+
+static void testWriters(int iKeyCount)
+{
+   ShardedSymTable_T oShardedSymTable;
+   pthread_t aiThreads[WRITER_COUNT];
+   struct Writer asWriters[WRITER_COUNT];
+   char acKey[MAX_KEY_LENGTH];
+   size_t uTotal = (size_t)WRITER_COUNT * (size_t)iKeyCount;
+   size_t uCount;
+   int iWriter;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a ShardedSymTable object with %d writers.\n",
+      WRITER_COUNT);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oShardedSymTable = ShardedSymTable_new(4 * WRITER_COUNT);
+   ASSURE(oShardedSymTable != NULL);
+
+   for (iWriter = 0; iWriter < WRITER_COUNT; iWriter++)
+   {
+      asWriters[iWriter].oShardedSymTable = oShardedSymTable;
+      asWriters[iWriter].iWriter = iWriter;
+      asWriters[iWriter].iKeyCount = iKeyCount;
+      ASSURE(pthread_create(&aiThreads[iWriter], NULL, runWriter,
+         &asWriters[iWriter]) == 0);
+   }
+
+   /* Aggregates may be read while the writers run */
+   for (i = 0; i < 100; i++)
+   {
+      ASSURE(ShardedSymTable_getLength(oShardedSymTable) <= uTotal);
+      uCount = 0;
+      ShardedSymTable_map(oShardedSymTable, countBinding, &uCount);
+      ASSURE(uCount <= uTotal);
+   }
+
+   for (iWriter = 0; iWriter < WRITER_COUNT; iWriter++)
+      pthread_join(aiThreads[iWriter], NULL);
+
+   ASSURE(ShardedSymTable_getLength(oShardedSymTable)
+      == (size_t)WRITER_COUNT * (size_t)(iKeyCount / 2));
+   for (iWriter = 0; iWriter < WRITER_COUNT; iWriter++)
+      for (i = 0; i < iKeyCount; i++)
+      {
+         sprintf(acKey, "%d.%d", iWriter, i);
+         ASSURE(ShardedSymTable_get(oShardedSymTable, acKey)
+            == (i % 2 == 0 ? NULL : &asWriters[iWriter]));
+      }
+
+   ShardedSymTable_free(oShardedSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ShardedSymTable ADT. argv[1] is the number of bindings to
+   use. Exit with EXIT_FAILURE if argv[1] is missing or not numeric.
+   Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 2)
+   {
+      fprintf(stderr, "bindingcount must be a number of at least 2\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testBasics(1, iBindingCount);
+   testBasics(5, iBindingCount);
+   testWriters(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
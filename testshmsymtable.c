@@ -0,0 +1,384 @@
+/*--------------------------------------------------------------------*/
+/* testshmsymtable.c                                                  */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "shmsymtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_KEY_LENGTH = 32, READER_COUNT = 3, LONG_VALUE = 64};
+
+/*--------------------------------------------------------------------*/
+
+/* Add the size of the value to the size_t to which pvExtra points,
+   and assure that the value repeats the key. */
+
+static void sumValue(const char *pcKey, const void *pvValue,
+   size_t uSize, void *pvExtra)
+{
+   ASSURE(uSize == strlen(pcKey) + 1);
+   ASSURE(memcmp(pcKey, pvValue, uSize) == 0);
+   *(size_t*)pvExtra += uSize;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the operations of an anonymous ShmSymTable object on
+   iBindingCount bindings, and a region that fills up. */
+
+static void testBasics(int iBindingCount)
+{
+   ShmSymTable_T oShmSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[LONG_VALUE];
+   size_t uSize;
+   size_t uSum;
+   size_t uExpected = 0;
+   int iCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing an anonymous ShmSymTable object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   ASSURE(ShmSymTable_create(NULL, 1024, 0) == NULL);
+   oShmSymTable = ShmSymTable_create(NULL,
+      (size_t)iBindingCount * 128 + 65536, (size_t)iBindingCount);
+   ASSURE(oShmSymTable != NULL);
+   ASSURE(ShmSymTable_getLength(oShmSymTable) == 0);
+
+   /* Each value is the key with its null character */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(ShmSymTable_put(oShmSymTable, acKey, acKey,
+         strlen(acKey) + 1));
+      uExpected += strlen(acKey) + 1;
+   }
+   ASSURE(ShmSymTable_getLength(oShmSymTable) == (size_t)iBindingCount);
+   ASSURE(! ShmSymTable_put(oShmSymTable, "0", "x", 2));
+   ASSURE(ShmSymTable_contains(oShmSymTable, "0"));
+   ASSURE(! ShmSymTable_contains(oShmSymTable, "x"));
+   ASSURE(ShmSymTable_get(oShmSymTable, "123", acValue, sizeof(acValue),
+      &uSize));
+   ASSURE(uSize == 4 && strcmp(acValue, "123") == 0);
+   ASSURE(! ShmSymTable_get(oShmSymTable, "x", acValue, sizeof(acValue),
+      &uSize));
+
+   /* A short buffer receives the first bytes */
+   memset(acValue, '\0', sizeof(acValue));
+   ASSURE(ShmSymTable_get(oShmSymTable, "123", acValue, 2, &uSize));
+   ASSURE(uSize == 4 && strcmp(acValue, "12") == 0);
+
+   uSum = 0;
+   ShmSymTable_map(oShmSymTable, sumValue, &uSum);
+   ASSURE(uSum == uExpected);
+
+   /* Values may shrink, grow or be empty */
+   ASSURE(ShmSymTable_replace(oShmSymTable, "1", "one", 4));
+   memset(acValue, 'v', sizeof(acValue));
+   ASSURE(ShmSymTable_replace(oShmSymTable, "2", acValue,
+      sizeof(acValue)));
+   ASSURE(ShmSymTable_replace(oShmSymTable, "3", NULL, 0));
+   ASSURE(! ShmSymTable_replace(oShmSymTable, "x", "x", 2));
+   ASSURE(ShmSymTable_get(oShmSymTable, "1", acValue, sizeof(acValue),
+      &uSize));
+   ASSURE(uSize == 4 && strcmp(acValue, "one") == 0);
+   ASSURE(ShmSymTable_get(oShmSymTable, "2", acValue, sizeof(acValue),
+      &uSize));
+   ASSURE(uSize == sizeof(acValue) && acValue[LONG_VALUE - 1] == 'v');
+   ASSURE(ShmSymTable_get(oShmSymTable, "3", NULL, 0, &uSize));
+   ASSURE(uSize == 0);
+   ASSURE(ShmSymTable_getLength(oShmSymTable) == (size_t)iBindingCount);
+
+   for (i = 1; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(ShmSymTable_remove(oShmSymTable, acKey));
+   }
+   ASSURE(! ShmSymTable_remove(oShmSymTable, "x"));
+   ASSURE(ShmSymTable_getLength(oShmSymTable) == 1);
+   ShmSymTable_close(oShmSymTable);
+
+   /* A full region refuses puts until removes free some blocks */
+   oShmSymTable = ShmSymTable_create(NULL, 65536, 0);
+   ASSURE(oShmSymTable != NULL);
+   for (iCount = 0; ; iCount++)
+   {
+      sprintf(acKey, "%d", iCount);
+      if (! ShmSymTable_put(oShmSymTable, acKey, acKey, 4)) break;
+   }
+   ASSURE(iCount > 0);
+   ASSURE(ShmSymTable_getFreeBytes(oShmSymTable) < 64);
+   ASSURE(ShmSymTable_remove(oShmSymTable, "0"));
+   ASSURE(ShmSymTable_put(oShmSymTable, acKey, acKey, 4));
+   ASSURE(ShmSymTable_getLength(oShmSymTable) == (size_t)iCount);
+   ShmSymTable_close(oShmSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a named ShmSymTable object that two handles share. */
+
+static void testNamed(void)
+{
+   ShmSymTable_T oWriter;
+   ShmSymTable_T oReader;
+   char acName[MAX_KEY_LENGTH];
+   char acValue[MAX_KEY_LENGTH];
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a named ShmSymTable object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   sprintf(acName, "/testshmsymtable.%ld", (long)getpid());
+   ASSURE(ShmSymTable_open(acName) == NULL);
+   oWriter = ShmSymTable_create(acName, 1 << 20, 1000);
+   ASSURE(oWriter != NULL);
+   if (oWriter == NULL) return;
+   ASSURE(ShmSymTable_create(acName, 1 << 20, 1000) == NULL);
+   oReader = ShmSymTable_open(acName);
+   ASSURE(oReader != NULL);
+   if (oReader == NULL) return;
+
+   /* Each handle sees the other's changes */
+   ASSURE(ShmSymTable_put(oWriter, "key", "value", 6));
+   ASSURE(ShmSymTable_get(oReader, "key", acValue, sizeof(acValue),
+      NULL));
+   ASSURE(strcmp(acValue, "value") == 0);
+   ASSURE(ShmSymTable_remove(oReader, "key"));
+   ASSURE(ShmSymTable_getLength(oWriter) == 0);
+
+   ASSURE(ShmSymTable_unlink(acName));
+   ASSURE(! ShmSymTable_unlink(acName));
+   ASSURE(ShmSymTable_open(acName) == NULL);
+   ShmSymTable_close(oReader);
+   ShmSymTable_close(oWriter);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Look up the iKeyCount keys of oShmSymTable until the key "done"
+   appears. Each value found must be a number that its key divides,
+   followed by padding that repeats its last digit. Return the number
+   of inconsistent values. */
+
+static int readUntilDone(ShmSymTable_T oShmSymTable, int iKeyCount)
+{
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[LONG_VALUE + 1];
+   size_t uSize;
+   size_t u;
+   int iErrors = 0;
+   int iValue;
+   int i;
+
+   do
+   {
+      for (i = 0; i < iKeyCount; i++)
+      {
+         sprintf(acKey, "%d", i);
+         if (! ShmSymTable_get(oShmSymTable, acKey, acValue, LONG_VALUE,
+               &uSize))
+            continue;
+         acValue[uSize < LONG_VALUE ? uSize : LONG_VALUE] = '\0';
+         if (uSize == 0 || uSize > LONG_VALUE ||
+             sscanf(acValue, "%d", &iValue) != 1 ||
+             iValue % iKeyCount != i)
+         {
+            iErrors++;
+            continue;
+         }
+         for (u = strlen(acValue); u < uSize; u++)
+            if (acValue[u] != '\0') iErrors++;
+      }
+   } while (! ShmSymTable_contains(oShmSymTable, "done"));
+
+   return iErrors;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a table that READER_COUNT forked processes read while this
+   one writes, on iBindingCount bindings whose values change size. */
+
+static void testProcesses(int iBindingCount)
+{
+   ShmSymTable_T oShmSymTable;
+   pid_t aiReaders[READER_COUNT];
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[LONG_VALUE];
+   int iStatus;
+   int iRound;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a ShmSymTable object shared by processes.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oShmSymTable = ShmSymTable_create(NULL,
+      (size_t)iBindingCount * 256 + 65536, (size_t)iBindingCount);
+   ASSURE(oShmSymTable != NULL);
+   if (oShmSymTable == NULL) return;
+
+   for (i = 0; i < READER_COUNT; i++)
+   {
+      aiReaders[i] = fork();
+      ASSURE(aiReaders[i] >= 0);
+      if (aiReaders[i] == 0)
+         _exit(readUntilDone(oShmSymTable, iBindingCount) == 0 ? 0 : 1);
+   }
+
+   /* Values alternate between short and long, so that replaces both
+      overwrite nodes and relink new ones */
+   for (iRound = 0; iRound < 4; iRound++)
+      for (i = 0; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "%d", i);
+         memset(acValue, '\0', sizeof(acValue));
+         sprintf(acValue, "%d", iRound * iBindingCount + i);
+         if (iRound == 0)
+            ASSURE(ShmSymTable_put(oShmSymTable, acKey, acValue,
+               strlen(acValue) + 1));
+         else if (i % 7 == 0)
+            ASSURE(ShmSymTable_remove(oShmSymTable, acKey) &&
+               ShmSymTable_put(oShmSymTable, acKey, acValue,
+                  strlen(acValue) + 1));
+         else
+            ASSURE(ShmSymTable_replace(oShmSymTable, acKey, acValue,
+               iRound % 2 == 1 ? sizeof(acValue) : strlen(acValue) + 1));
+      }
+   ASSURE(ShmSymTable_put(oShmSymTable, "done", NULL, 0));
+
+   for (i = 0; i < READER_COUNT; i++)
+   {
+      ASSURE(waitpid(aiReaders[i], &iStatus, 0) == aiReaders[i]);
+      ASSURE(WIFEXITED(iStatus) && WEXITSTATUS(iStatus) == 0);
+   }
+   ASSURE(ShmSymTable_getLength(oShmSymTable)
+      == (size_t)iBindingCount + 1);
+   ShmSymTable_close(oShmSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+#if defined(__linux__)
+
+/* Test that a ShmSymTable object stays usable after a process is
+   killed while it writes, which it nearly always is: it overwrites a
+   large value in place, again and again. A reader or writer that
+   waited forever would be ended by SIGALRM. */
+
+static void testWriterDeath(void)
+{
+   enum {BIG_VALUE = 1 << 20};
+
+   static char acBig[BIG_VALUE];
+   ShmSymTable_T oShmSymTable;
+   pid_t iWriter;
+   size_t uSize;
+   int iStatus;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a ShmSymTable object whose writer dies.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oShmSymTable = ShmSymTable_create(NULL, 4 * BIG_VALUE, 1000);
+   ASSURE(oShmSymTable != NULL);
+   if (oShmSymTable == NULL) return;
+   ASSURE(ShmSymTable_put(oShmSymTable, "big", acBig, BIG_VALUE));
+
+   iWriter = fork();
+   ASSURE(iWriter >= 0);
+   if (iWriter == 0)
+      for (;;)
+      {
+         acBig[0]++;
+         (void)ShmSymTable_replace(oShmSymTable, "big", acBig,
+            BIG_VALUE);
+      }
+   usleep(20000);
+   ASSURE(kill(iWriter, SIGKILL) == 0);
+   ASSURE(waitpid(iWriter, &iStatus, 0) == iWriter);
+
+   (void)alarm(60);
+   ASSURE(ShmSymTable_get(oShmSymTable, "big", NULL, 0, &uSize));
+   ASSURE(uSize == BIG_VALUE);
+   ASSURE(ShmSymTable_put(oShmSymTable, "after", "", 1));
+   ASSURE(ShmSymTable_getLength(oShmSymTable) == 2);
+   ASSURE(ShmSymTable_remove(oShmSymTable, "after"));
+   ASSURE(ShmSymTable_contains(oShmSymTable, "big"));
+   (void)alarm(0);
+   ShmSymTable_close(oShmSymTable);
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ShmSymTable ADT. argv[1] is the number of bindings to use.
+   Exit with EXIT_FAILURE if argv[1] is missing or not numeric.
+   Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 2)
+   {
+      fprintf(stderr, "bindingcount must be a number of at least 2\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testBasics(iBindingCount);
+   testNamed();
+   testProcesses(iBindingCount);
+#if defined(__linux__)
+   testWriterDeath();
+#endif
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
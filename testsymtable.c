@@ -83,6 +83,43 @@ static void printBindingSimple(const char *pcKey, void *pvValue,
 
 /*--------------------------------------------------------------------*/
 
+/* The state of a SymTable_map() whose callback looks keys up in the
+   table being mapped. */
+
+struct LookupMap
+{
+   /* The table being mapped */
+   SymTable_T oSymTable;
+
+   /* The first letters of the keys visited, in order */
+   char acVisited[8];
+
+   /* The number of keys visited */
+   size_t uVisits;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Look up pcKey and "Jeter" in the table of pvExtra, a struct
+   LookupMap, and record the visit of pcKey, whose value is pvValue. */
+
+static void lookUpBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct LookupMap *psMap = (struct LookupMap*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(psMap != NULL);
+
+   ASSURE(SymTable_get(psMap->oSymTable, pcKey) == pvValue);
+   ASSURE(SymTable_contains(psMap->oSymTable, "Jeter"));
+   if (psMap->uVisits < sizeof(psMap->acVisited))
+      psMap->acVisited[psMap->uVisits] = pcKey[0];
+   psMap->uVisits++;
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test the most basic SymTable functions. */
 
 static void testBasics(void)
@@ -396,6 +433,7 @@ static void testMap(void)
    char acCenterField[] = "Center Field";
    char acFirstBase[] = "First Base";
    char acRightField[] = "Right Field";
+   struct LookupMap sMap;
 
    int iSuccessful;
 
@@ -426,6 +464,17 @@ static void testMap(void)
    fflush(stdout);
    SymTable_map(oSymTable, printBindingSimple, NULL);
 
+   /* Lookups from within the map must not change which bindings it
+      visits */
+   sMap.oSymTable = oSymTable;
+   sMap.uVisits = 0;
+   SymTable_map(oSymTable, lookUpBinding, &sMap);
+   ASSURE(sMap.uVisits == 4);
+   ASSURE(memchr(sMap.acVisited, 'J', 4) != NULL);
+   ASSURE(memchr(sMap.acVisited, 'M', 4) != NULL);
+   ASSURE(memchr(sMap.acVisited, 'G', 4) != NULL);
+   ASSURE(memchr(sMap.acVisited, 'R', 4) != NULL);
+
    SymTable_free(oSymTable);
 }
 
@@ -0,0 +1,184 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablefreeze.c                                               */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtablehybrid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Increment the count that pvExtra points to. pcKey and pvValue are
+   unused. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)pvValue;
+
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that oSymTable binds each key "sym%d" for 0 <= i < iCount
+   such that i % iStride == 0 to the address of aiValues[i], and binds
+   no other key of that form. */
+
+static void checkContents(SymTable_T oSymTable, int iCount, int iStride,
+   int aiValues[])
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   char acKey[MAX_KEY_LENGTH];
+   size_t uMapped = 0;
+   int i;
+
+   for (i = 0; i < iCount; i++)
+   {
+      sprintf(acKey, "sym%d", i);
+      if (i % iStride == 0)
+         ASSURE(SymTable_get(oSymTable, acKey) == &aiValues[i]);
+      else
+         ASSURE(! SymTable_contains(oSymTable, acKey));
+   }
+   ASSURE(! SymTable_contains(oSymTable, "sym-1"));
+   ASSURE(SymTable_get(oSymTable, "") == NULL);
+
+   SymTable_map(oSymTable, countBinding, &uMapped);
+   ASSURE(uMapped == SymTable_getLength(oSymTable));
+   ASSURE(uMapped == (size_t)((iCount + iStride - 1) / iStride));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test freezing a table of iBindingCount bindings, using it while it
+   is frozen, and thawing it again. */
+
+static void testFreeze(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   int *aiValues;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a frozen SymTable object of %d bindings.\n",
+      iBindingCount);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   aiValues = (int*)calloc((size_t)iBindingCount + 1, sizeof(int));
+   ASSURE(aiValues != NULL);
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "sym%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, &aiValues[i]));
+   }
+
+   ASSURE(SymTable_freeze(oSymTable));
+   checkContents(oSymTable, iBindingCount, 1, aiValues);
+
+   /* Freezing a frozen table changes nothing */
+   ASSURE(SymTable_freeze(oSymTable));
+   checkContents(oSymTable, iBindingCount, 1, aiValues);
+
+   /* Replace and remove work in place while frozen */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "sym%d", i);
+      ASSURE(SymTable_replace(oSymTable, acKey, NULL) == &aiValues[i]);
+      ASSURE(SymTable_replace(oSymTable, acKey, &aiValues[i]) == NULL);
+      if (i % 2 != 0)
+         ASSURE(SymTable_remove(oSymTable, acKey) == &aiValues[i]);
+   }
+   checkContents(oSymTable, iBindingCount, 2, aiValues);
+
+   /* Put thaws the table */
+   for (i = 1; i < iBindingCount; i += 2)
+   {
+      sprintf(acKey, "sym%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, &aiValues[i]));
+   }
+   checkContents(oSymTable, iBindingCount, 1, aiValues);
+
+   /* The table can be frozen again, and shrinks back inline as it
+      empties, keeping the bindings that remain */
+   ASSURE(SymTable_freeze(oSymTable));
+   for (i = iBindingCount - 1; i >= 0; i--)
+   {
+      sprintf(acKey, "sym%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == &aiValues[i]);
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)i);
+      if (i < 16)
+         checkContents(oSymTable, i, 1, aiValues);
+   }
+   ASSURE(SymTable_put(oSymTable, "sym0", &aiValues[0]));
+   checkContents(oSymTable, 1, 1, aiValues);
+
+   SymTable_free(oSymTable);
+   free(aiValues);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_freeze() of the adaptive SymTable implementation.
+   argv[1] is the number of bindings to put into the largest SymTable
+   object. Exit with EXIT_FAILURE if argv[1] is missing or not
+   numeric. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 1)
+   {
+      fprintf(stderr, "bindingcount must be a positive number\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testFreeze(1);
+   testFreeze(8);
+   testFreeze(9);
+   testFreeze(100);
+   testFreeze(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
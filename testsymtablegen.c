@@ -0,0 +1,119 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablegen.c                                                  */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include "ckeywords.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_KEY_LENGTH = 32};
+
+/*--------------------------------------------------------------------*/
+
+/* Test the table that symtablegen generated from ckeywords.txt, with
+   iBindingCount identifiers that are not keywords. */
+
+static void testKeywords(int iBindingCount)
+{
+   static const char *apcTypes[] = {"char", "double", "enum", "float",
+      "int", "long", "short", "signed", "struct", "union", "unsigned",
+      "void", "_Bool", "_Complex", "_Imaginary"};
+   static const char *apcStatements[] = {"break", "case", "continue",
+      "default", "do", "else", "for", "goto", "if", "return", "switch",
+      "while"};
+   static const char *apcOthers[] = {"auto", "const", "extern",
+      "register", "restrict", "static", "typedef", "volatile"};
+   char acKey[MAX_KEY_LENGTH];
+   size_t u;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a generated table of keywords.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   for (u = 0; u < sizeof(apcTypes) / sizeof(apcTypes[0]); u++)
+   {
+      ASSURE(ckeywords_contains(apcTypes[u]));
+      ASSURE(strcmp((char*)ckeywords_get(apcTypes[u]), "type") == 0);
+   }
+   for (u = 0; u < sizeof(apcStatements) / sizeof(apcStatements[0]);
+        u++)
+      ASSURE(strcmp((char*)ckeywords_get(apcStatements[u]),
+         "statement") == 0);
+   for (u = 0; u < sizeof(apcOthers) / sizeof(apcOthers[0]); u++)
+      ASSURE(ckeywords_get(apcOthers[u]) != NULL);
+   ASSURE(strcmp((char*)ckeywords_get("const"), "qualifier") == 0);
+
+   /* Keys without values are bound to themselves */
+   ASSURE(strcmp((char*)ckeywords_get("sizeof"), "sizeof") == 0);
+   ASSURE(ckeywords_get("inline") == ckeywords_get("inline"));
+
+   /* The keys are compared in full */
+   ASSURE(ckeywords_get("") == NULL);
+   ASSURE(! ckeywords_contains(""));
+   ASSURE(ckeywords_get("in") == NULL);
+   ASSURE(ckeywords_get("intx") == NULL);
+   ASSURE(ckeywords_get("Int") == NULL);
+   ASSURE(ckeywords_get("#define") == NULL);
+   ASSURE(ckeywords_get("TYPE") == NULL);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "identifier%d", i);
+      ASSURE(ckeywords_get(acKey) == NULL);
+      ASSURE(! ckeywords_contains(acKey));
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the output of symtablegen. argv[1] is the number of
+   identifiers to look up. Exit with EXIT_FAILURE if argv[1] is
+   missing or not numeric. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 2)
+   {
+      fprintf(stderr, "bindingcount must be a number of at least 2\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testKeywords(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
@@ -0,0 +1,1474 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablehashext.c                                              */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtablehash.h"
+#include "keyops.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a KeyPool object on its own. */
+
+static void testKeyPool(void)
+{
+   KeyPool_T oKeyPool;
+   char acKey[] = "identifier";
+   char acLongKey[100000];
+   const char *pcInterned;
+   const char *pcLongInterned;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the KeyPool functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oKeyPool = KeyPool_new();
+   ASSURE(oKeyPool != NULL);
+   ASSURE(KeyPool_find(oKeyPool, acKey) == NULL);
+
+   pcInterned = KeyPool_intern(oKeyPool, acKey);
+   ASSURE(pcInterned != NULL);
+   ASSURE(pcInterned != acKey);
+   ASSURE(strcmp(pcInterned, acKey) == 0);
+   ASSURE(KeyPool_find(oKeyPool, "identifier") == pcInterned);
+   ASSURE(KeyPool_intern(oKeyPool, "identifier") == pcInterned);
+   ASSURE(KeyPool_getId(pcInterned) == 0);
+   ASSURE(KeyPool_getLength(oKeyPool) == 1);
+
+   /* Changing the client's string does not change the pool's copy */
+   strcpy(acKey, "xxx");
+   ASSURE(strcmp(pcInterned, "identifier") == 0);
+
+   memset(acLongKey, 'a', sizeof(acLongKey) - 1);
+   acLongKey[sizeof(acLongKey) - 1] = '\0';
+   pcLongInterned = KeyPool_intern(oKeyPool, acLongKey);
+   ASSURE(pcLongInterned != NULL);
+   ASSURE(KeyPool_getId(pcLongInterned) == 1);
+   ASSURE(KeyPool_intern(oKeyPool, "") != NULL);
+   ASSURE(KeyPool_find(oKeyPool, acLongKey) == pcLongInterned);
+   ASSURE(KeyPool_find(oKeyPool, "identifier") == pcInterned);
+   ASSURE(KeyPool_getLength(oKeyPool) == 3);
+
+   KeyPool_free(oKeyPool);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a chain of iDepth nested scopes whose SymTable objects share
+   one KeyPool object and each bind iBindingCount keys. */
+
+static void testInternedScopes(int iDepth, int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   KeyPool_T oKeyPool;
+   SymTable_T *aoScopes;
+   char acKey[MAX_KEY_LENGTH];
+   const char *pcInterned;
+   int iScope;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing nested scopes that share a KeyPool object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oKeyPool = KeyPool_new();
+   ASSURE(oKeyPool != NULL);
+   aoScopes = (SymTable_T*)malloc((size_t)iDepth * sizeof(SymTable_T));
+   ASSURE(aoScopes != NULL);
+
+   /* Scope iScope binds the keys that are multiples of iScope+1 */
+   for (iScope = 0; iScope < iDepth; iScope++)
+   {
+      aoScopes[iScope] = SymTable_newInterned(oKeyPool);
+      ASSURE(aoScopes[iScope] != NULL);
+      for (i = 0; i < iBindingCount; i += iScope + 1)
+      {
+         sprintf(acKey, "name%d", i);
+         ASSURE(SymTable_put(aoScopes[iScope], acKey,
+            &aoScopes[iScope]));
+         ASSURE(! SymTable_put(aoScopes[iScope], acKey, NULL));
+      }
+   }
+
+   /* Every table shares the pool's one copy of each key */
+   ASSURE(KeyPool_getLength(oKeyPool) == (size_t)iBindingCount);
+
+   /* Resolve each key from the innermost scope outward, interning it
+      once and comparing addresses in every scope */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "name%d", i);
+      pcInterned = KeyPool_find(oKeyPool, acKey);
+      ASSURE(pcInterned != NULL);
+      for (iScope = iDepth - 1; iScope >= 0; iScope--)
+      {
+         if (SymTable_containsInterned(aoScopes[iScope], pcInterned))
+            break;
+      }
+      ASSURE(iScope >= 0 && i % (iScope + 1) == 0);
+      ASSURE(SymTable_getInterned(aoScopes[iScope], pcInterned)
+         == &aoScopes[iScope]);
+      ASSURE(SymTable_get(aoScopes[iScope], acKey)
+         == &aoScopes[iScope]);
+   }
+
+   ASSURE(! SymTable_contains(aoScopes[0], "never interned"));
+   ASSURE(SymTable_get(aoScopes[0], "never interned") == NULL);
+   ASSURE(SymTable_remove(aoScopes[0], "never interned") == NULL);
+
+   /* Removing a binding leaves the pool's key for the other tables */
+   ASSURE(SymTable_remove(aoScopes[0], "name0") == &aoScopes[0]);
+   ASSURE(! SymTable_contains(aoScopes[0], "name0"));
+   if (iDepth > 1)
+      ASSURE(SymTable_get(aoScopes[1], "name0") == &aoScopes[1]);
+   ASSURE(SymTable_replace(aoScopes[0], "name1", NULL) == &aoScopes[0]);
+   ASSURE(SymTable_getLength(aoScopes[0]) ==
+      (size_t)(iBindingCount - 1));
+
+   for (iScope = 0; iScope < iDepth; iScope++)
+      SymTable_free(aoScopes[iScope]);
+   free(aoScopes);
+   KeyPool_free(oKeyPool);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that every supported variant of the key kernels agrees with
+   the scalar one, on keys of every length up to a few blocks, with
+   characters of every value, each ending at the last byte of a page
+   so that reading past its end would cross into the next page. */
+
+static void testKeyOps(void)
+{
+   enum {PAGE = 4096, MAX_LENGTH = 100};
+
+   char *pcMemory;
+   char *pcPageEnd;
+   char *pcKey;
+   char acCopy[MAX_LENGTH + 1];
+   size_t auHashes[MAX_LENGTH + 1];
+   size_t uVariant;
+   size_t uLength;
+   size_t u;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the variants of the key kernels.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   ASSURE(KeyOps_getVariantCount() >= 1);
+   ASSURE(strcmp(KeyOps_getVariantName(0), "scalar") == 0);
+   ASSURE(KeyOps_useVariant(0));
+
+   /* The scalar variant is the hash function of symtablehash.c */
+   ASSURE(KeyOps_hash("") == 0);
+   ASSURE(KeyOps_hash("a") == (size_t)'a');
+   ASSURE(KeyOps_hash("ab") == (size_t)'a' * 65599 + (size_t)'b');
+
+   pcMemory = (char*)malloc(3 * PAGE);
+   ASSURE(pcMemory != NULL);
+   if (pcMemory == NULL) return;
+   pcPageEnd = pcMemory + 2 * PAGE - (uintptr_t)pcMemory % PAGE;
+
+   for (uLength = 0; uLength <= MAX_LENGTH; uLength++)
+   {
+      /* A key that ends at the last byte of a page */
+      pcKey = pcPageEnd - uLength - 1;
+      for (u = 0; u < uLength; u++)
+         pcKey[u] = (char)(1 + (u * 37 + uLength) % 255);
+      pcKey[uLength] = '\0';
+      ASSURE(KeyOps_useVariant(0));
+      auHashes[uLength] = KeyOps_hash(pcKey);
+
+      for (uVariant = 1; uVariant < KeyOps_getVariantCount();
+           uVariant++)
+      {
+         if (! KeyOps_useVariant(uVariant))
+            continue;
+         ASSURE(KeyOps_hash(pcKey) == auHashes[uLength]);
+         strcpy(acCopy, pcKey);
+         ASSURE(KeyOps_equals(pcKey, acCopy));
+         ASSURE(KeyOps_equals(acCopy, pcKey));
+
+         /* Shorter and different keys */
+         if (uLength > 0)
+         {
+            acCopy[uLength - 1] = '\0';
+            ASSURE(! KeyOps_equals(pcKey, acCopy));
+            ASSURE(! KeyOps_equals(acCopy, pcKey));
+            ASSURE(! KeyOps_equals(pcKey + 1, pcKey));
+            strcpy(acCopy, pcKey);
+            acCopy[uLength / 2] ^= 1;
+            ASSURE(! KeyOps_equals(pcKey, acCopy));
+         }
+      }
+   }
+
+   free(pcMemory);
+
+   /* Go back to the fastest variant for the other tests */
+   for (uVariant = KeyOps_getVariantCount(); uVariant > 0; uVariant--)
+      if (KeyOps_useVariant(uVariant - 1))
+         break;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The number of values passed to countValue. */
+
+static size_t uFreedValues = 0;
+
+/* Count pvValue as freed, and free it. */
+
+static void countValue(void *pvValue)
+{
+   uFreedValues++;
+   free(pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newEx with a value destructor and borrowed keys that
+   the table owns, on a table of iBindingCount bindings. */
+
+static void testOptions(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   struct SymTable_Options sOptions;
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acBorrowed[] = "borrowed";
+   char *pcKey;
+   int *piValue;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects created with options.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Default options behave as SymTable_new */
+   SymTable_initOptions(&sOptions);
+   ASSURE(sOptions.pfFreeValue == NULL);
+   ASSURE(! sOptions.iBorrowKeys);
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_put(oSymTable, acBorrowed, NULL));
+   strcpy(acBorrowed, "changed");
+   ASSURE(SymTable_contains(oSymTable, "borrowed"));
+   SymTable_free(oSymTable);
+
+   /* Borrowed keys that the caller keeps */
+   strcpy(acBorrowed, "borrowed");
+   sOptions.iBorrowKeys = 1;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_put(oSymTable, acBorrowed, acBorrowed));
+   ASSURE(! SymTable_put(oSymTable, "borrowed", NULL));
+   ASSURE(SymTable_get(oSymTable, "borrowed") == acBorrowed);
+   ASSURE(SymTable_remove(oSymTable, "borrowed") == acBorrowed);
+   ASSURE(strcmp(acBorrowed, "borrowed") == 0);
+   SymTable_free(oSymTable);
+
+   /* Borrowed keys and values that the table frees in one pass */
+   sOptions.pfFreeValue = countValue;
+   sOptions.pfFreeKey = free;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcKey = (char*)malloc(strlen(acKey) + 1);
+      piValue = (int*)malloc(sizeof(int));
+      ASSURE(pcKey != NULL && piValue != NULL);
+      strcpy(pcKey, acKey);
+      *piValue = i;
+      ASSURE(SymTable_put(oSymTable, pcKey, piValue));
+   }
+
+   /* A removed value goes back to the caller, and its key is freed */
+   piValue = (int*)SymTable_remove(oSymTable, "0");
+   ASSURE(piValue != NULL && *piValue == 0);
+   free(piValue);
+   piValue = (int*)malloc(sizeof(int));
+   ASSURE(piValue != NULL);
+   free(SymTable_replace(oSymTable, "1", piValue));
+
+   uFreedValues = 0;
+   SymTable_free(oSymTable);
+   ASSURE(uFreedValues == (size_t)(iBindingCount - 1));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* An allocator that tracks the blocks it lends. */
+
+struct Allocator {
+   /* The number of bytes lent and not given back */
+   size_t uBytes;
+   /* The number of blocks lent and not given back */
+   size_t uBlocks;
+   /* 1 (TRUE) if a block came back with a size other than the one it
+      was lent with */
+   int iSizeMismatch;
+   /* 1 (TRUE) if no more blocks are to be lent */
+   int iRefuse;
+};
+
+/* The header of each block that an Allocator lends, which records
+   the block's size. Its size keeps the block aligned for any use. */
+
+union BlockHeader {
+   size_t uSize;
+   long double ldAlign;
+   void *pvAlign;
+};
+
+/* Lend a block of uSize bytes from the Allocator to which pvAllocator
+   points, or return NULL if there is no memory. */
+
+static void *lendBlock(size_t uSize, void *pvAllocator)
+{
+   struct Allocator *psAllocator = (struct Allocator*)pvAllocator;
+   union BlockHeader *psHeader;
+
+   if (psAllocator->iRefuse) return NULL;
+   psHeader = (union BlockHeader*)malloc(sizeof(union BlockHeader)
+      + uSize);
+   if (psHeader == NULL) return NULL;
+   psHeader->uSize = uSize;
+   psAllocator->uBytes += uSize;
+   psAllocator->uBlocks++;
+   return psHeader + 1;
+}
+
+/* Take back pv, a block of uSize bytes that lendBlock lent from the
+   Allocator to which pvAllocator points. */
+
+static void returnBlock(void *pv, size_t uSize, void *pvAllocator)
+{
+   struct Allocator *psAllocator = (struct Allocator*)pvAllocator;
+   union BlockHeader *psHeader = (union BlockHeader*)pv - 1;
+
+   if (psHeader->uSize != uSize) psAllocator->iSizeMismatch = 1;
+   psAllocator->uBytes -= psHeader->uSize;
+   psAllocator->uBlocks--;
+   free(psHeader);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test byte accounting, a custom allocator and a memory limit on
+   tables of up to iBindingCount bindings. */
+
+static void testMemory(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32, LIMIT = 20000};
+
+   struct SymTable_Options sOptions;
+   struct Allocator sAllocator = {0, 0, 0, 0};
+   SymTable_T oSymTable;
+   SymTable_T oOtherSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   size_t uTotalBefore;
+   size_t uBytes;
+   int iPut;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing memory accounting and limits.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* The table's count matches what its allocator lent */
+   uTotalBefore = SymTable_getTotalBytes();
+   SymTable_initOptions(&sOptions);
+   sOptions.pfMalloc = lendBlock;
+   sOptions.pfFree = returnBlock;
+   sOptions.pvAllocator = &sAllocator;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   oOtherSymTable = SymTable_new();
+   ASSURE(oOtherSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, NULL));
+      ASSURE(SymTable_getBytes(oSymTable) == sAllocator.uBytes);
+   }
+   for (i = 0; i < iBindingCount; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      SymTable_remove(oSymTable, acKey);
+   }
+   ASSURE(SymTable_getBytes(oSymTable) == sAllocator.uBytes);
+   ASSURE(SymTable_getTotalBytes() - uTotalBefore
+      == SymTable_getBytes(oSymTable)
+      + SymTable_getBytes(oOtherSymTable));
+   SymTable_free(oSymTable);
+   SymTable_free(oOtherSymTable);
+   ASSURE(sAllocator.uBytes == 0);
+   ASSURE(sAllocator.uBlocks == 0);
+   ASSURE(! sAllocator.iSizeMismatch);
+   ASSURE(SymTable_getTotalBytes() == uTotalBefore);
+
+   /* Puts fail cleanly at the limit, and succeed again after a
+      remove */
+   SymTable_initOptions(&sOptions);
+   sOptions.uMaxBytes = LIMIT;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   iPut = 0;
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (! SymTable_put(oSymTable, acKey, NULL)) break;
+      iPut++;
+   }
+   ASSURE(SymTable_getBytes(oSymTable) <= LIMIT);
+   if (iPut < iBindingCount)
+   {
+      uBytes = SymTable_getBytes(oSymTable);
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)iPut);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+      ASSURE(SymTable_getBytes(oSymTable) == uBytes);
+      ASSURE(SymTable_remove(oSymTable, "0") == NULL);
+      ASSURE(SymTable_getBytes(oSymTable) < uBytes);
+      ASSURE(SymTable_put(oSymTable, acKey, NULL));
+   }
+   SymTable_free(oSymTable);
+
+   /* A limit too small for an empty table */
+   sOptions.uMaxBytes = 1;
+   ASSURE(SymTable_newEx(&sOptions) == NULL);
+   ASSURE(SymTable_getTotalBytes() == uTotalBefore);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Apply the changes of testTransactions to oSymTable, which binds the
+   keys "0" through "iBindingCount - 1" to pvOld: remove every third
+   key, bind the next ones to pvNew, and put "new" keys after the
+   others. Also put and remove "temp", and remove and put "1" again. */
+
+static void changeTable(SymTable_T oSymTable, int iBindingCount,
+   void *pvOld, void *pvNew)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (i % 3 == 0) ASSURE(SymTable_remove(oSymTable, acKey) == pvOld);
+      else if (i % 3 == 1)
+         ASSURE(SymTable_replace(oSymTable, acKey, pvNew) == pvOld);
+      else
+      {
+         sprintf(acKey, "new%d", i);
+         ASSURE(SymTable_put(oSymTable, acKey, pvNew));
+      }
+   }
+   ASSURE(SymTable_put(oSymTable, "temp", pvNew));
+   ASSURE(SymTable_remove(oSymTable, "temp") == pvNew);
+   ASSURE(SymTable_remove(oSymTable, "1") == pvNew);
+   ASSURE(SymTable_put(oSymTable, "1", pvOld));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test transactions that commit, abort, run out of log entries or of
+   memory, on tables of iBindingCount bindings. */
+
+static void testTransactions(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32, LIMIT = 20000, MAX_CHANGES = 256};
+
+   struct SymTable_Options sOptions;
+   struct Allocator sAllocator = {0, 0, 0, 0};
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acOld[] = "old";
+   char acNew[] = "new";
+   size_t uBlocks;
+   size_t uBytes;
+   size_t uLength;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing transactions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   SymTable_initOptions(&sOptions);
+   sOptions.pfMalloc = lendBlock;
+   sOptions.pfFree = returnBlock;
+   sOptions.pvAllocator = &sAllocator;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, acOld));
+   }
+
+   /* An abort restores every binding and frees what the changes
+      allocated, though the table may keep more buckets */
+   uBlocks = sAllocator.uBlocks;
+   ASSURE(! SymTable_begin(oSymTable, 0));
+   ASSURE(SymTable_begin(oSymTable, (size_t)iBindingCount + 4));
+   ASSURE(! SymTable_begin(oSymTable, 1));
+   changeTable(oSymTable, iBindingCount, acOld, acNew);
+   SymTable_abort(oSymTable);
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iBindingCount);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == acOld);
+      sprintf(acKey, "new%d", i);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+   }
+   ASSURE(! SymTable_contains(oSymTable, "temp"));
+   ASSURE(sAllocator.uBlocks == uBlocks);
+   ASSURE(SymTable_getBytes(oSymTable) == sAllocator.uBytes);
+
+   /* A commit keeps the same changes */
+   ASSURE(SymTable_begin(oSymTable, (size_t)iBindingCount + 4));
+   changeTable(oSymTable, iBindingCount, acOld, acNew);
+   uLength = SymTable_getLength(oSymTable);
+   SymTable_commit(oSymTable);
+   ASSURE(SymTable_getLength(oSymTable) == uLength);
+   for (i = 2; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey)
+         == (i % 3 == 0 ? NULL : i % 3 == 1 ? acNew : acOld));
+      sprintf(acKey, "new%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey) == (i % 3 == 2));
+   }
+   ASSURE(SymTable_get(oSymTable, "1") == acOld);
+   ASSURE(SymTable_getBytes(oSymTable) == sAllocator.uBytes);
+
+   /* Changes beyond the log's room are refused */
+   ASSURE(SymTable_begin(oSymTable, 2));
+   ASSURE(SymTable_put(oSymTable, "a", acNew));
+   ASSURE(SymTable_replace(oSymTable, "a", acOld) == acNew);
+   ASSURE(! SymTable_put(oSymTable, "b", acNew));
+   ASSURE(! SymTable_contains(oSymTable, "b"));
+   ASSURE(SymTable_replace(oSymTable, "a", acNew) == NULL);
+   ASSURE(SymTable_remove(oSymTable, "a") == NULL);
+   ASSURE(SymTable_get(oSymTable, "a") == acOld);
+   SymTable_abort(oSymTable);
+   ASSURE(! SymTable_contains(oSymTable, "a"));
+
+   /* Freeing a table commits its open transaction */
+   ASSURE(SymTable_begin(oSymTable, 1));
+   ASSURE(SymTable_remove(oSymTable, "1") == acOld);
+   SymTable_free(oSymTable);
+   ASSURE(sAllocator.uBlocks == 0);
+   ASSURE(! sAllocator.iSizeMismatch);
+
+   /* A transaction that runs out of memory can be aborted */
+   SymTable_initOptions(&sOptions);
+   sOptions.uMaxBytes = LIMIT;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_put(oSymTable, "kept", acOld));
+   uBytes = SymTable_getBytes(oSymTable);
+   ASSURE(SymTable_begin(oSymTable, MAX_CHANGES));
+   ASSURE(SymTable_replace(oSymTable, "kept", acNew) == acOld);
+   for (i = 1; i < MAX_CHANGES; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (! SymTable_put(oSymTable, acKey, acNew)) break;
+   }
+   ASSURE(i < MAX_CHANGES);
+   SymTable_abort(oSymTable);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_get(oSymTable, "kept") == acOld);
+   ASSURE(SymTable_getBytes(oSymTable) == uBytes);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store in pvBytes, if uRoom allows, the int to which pvValue points,
+   least significant byte first. Return the number of bytes needed. */
+
+static size_t encodeInt(const void *pvValue, void *pvBytes,
+   size_t uRoom, void *pvCodec)
+{
+   unsigned char *pucBytes = (unsigned char*)pvBytes;
+   unsigned int uValue = (unsigned int)*(const int*)pvValue;
+   size_t u;
+
+   (void)pvCodec;
+   if (uRoom < 4) return 4;
+   for (u = 0; u < 4; u++)
+      pucBytes[u] = (unsigned char)(uValue >> (8 * u));
+   return 4;
+}
+
+/* Store in *ppvValue a new int decoded from the uSize bytes of
+   pvBytes. Return 1 (TRUE) on success, and 0 (FALSE) if the bytes do
+   not encode an int or insufficient memory is available. */
+
+static int decodeInt(const void *pvBytes, size_t uSize,
+   void **ppvValue, void *pvCodec)
+{
+   const unsigned char *pucBytes = (const unsigned char*)pvBytes;
+   unsigned int uValue = 0;
+   int *piValue;
+   size_t u;
+
+   (void)pvCodec;
+   if (uSize != 4) return 0;
+   for (u = 0; u < 4; u++)
+      uValue |= (unsigned int)pucBytes[u] << (8 * u);
+   piValue = (int*)malloc(sizeof(int));
+   if (piValue == NULL) return 0;
+   *piValue = (int)uValue;
+   *ppvValue = piValue;
+   return 1;
+}
+
+/* Assure that the replica pvReplica binds pcKey to an int equal to
+   the one to which pvValue points. */
+
+static void checkReplica(const char *pcKey, void *pvValue,
+   void *pvReplica)
+{
+   int *piValue = (int*)SymTable_get((SymTable_T)pvReplica, pcKey);
+
+   ASSURE(piValue != NULL && *piValue == *(int*)pvValue);
+}
+
+/* Assure that oReplica holds the same bindings as oSource. */
+
+static void assureSame(SymTable_T oSource, SymTable_T oReplica)
+{
+   ASSURE(SymTable_getLength(oReplica) == SymTable_getLength(oSource));
+   SymTable_map(oSource, checkReplica, oReplica);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the change log: keep a replica of a table of iBindingCount
+   bindings up to date with deltas and snapshots. */
+
+static void testChangeLog(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   struct SymTable_Options sOptions;
+   SymTable_T oSource;
+   SymTable_T oReplica;
+   char acKey[MAX_KEY_LENGTH];
+   int *aiValues;
+   void *pvDelta;
+   void *pvLater;
+   size_t uSize;
+   size_t uLaterSize;
+   size_t uSequence = 0;
+   size_t uMark;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the change log.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   aiValues = (int*)malloc((size_t)iBindingCount * sizeof(int));
+   ASSURE(aiValues != NULL);
+   if (aiValues == NULL) return;
+   for (i = 0; i < iBindingCount; i++) aiValues[i] = i;
+
+   SymTable_initOptions(&sOptions);
+   sOptions.pfEncodeValue = encodeInt;
+   oSource = SymTable_newEx(&sOptions);
+   ASSURE(oSource != NULL);
+   SymTable_initOptions(&sOptions);
+   sOptions.pfFreeValue = free;
+   oReplica = SymTable_newEx(&sOptions);
+   ASSURE(oReplica != NULL);
+
+   /* A replica catches up from sequence number 0 */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSource, acKey, &aiValues[i]));
+   }
+   ASSURE(! SymTable_put(oSource, "0", &aiValues[1]));
+   ASSURE(SymTable_getSequence(oSource) == (size_t)iBindingCount);
+   ASSURE(SymTable_exportChanges(oSource, 0, &pvDelta, &uSize));
+   ASSURE(SymTable_applyChanges(oReplica, pvDelta, uSize, decodeInt,
+      NULL, &uSequence));
+   ASSURE(uSequence == (size_t)iBindingCount);
+   assureSame(oSource, oReplica);
+
+   /* Deltas that overlap what the replica has are partly skipped */
+   ASSURE(SymTable_applyChanges(oReplica, pvDelta, uSize, decodeInt,
+      NULL, &uSequence));
+   ASSURE(uSequence == (size_t)iBindingCount);
+   assureSame(oSource, oReplica);
+   free(pvDelta);
+
+   /* Replaces and removes follow, and a delta that begins after the
+      replica's sequence number is refused */
+   uMark = SymTable_getSequence(oSource);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (i % 3 == 0) ASSURE(SymTable_remove(oSource, acKey) != NULL);
+      else if (i % 3 == 1)
+         ASSURE(SymTable_replace(oSource, acKey,
+            &aiValues[iBindingCount - 1 - i]) == &aiValues[i]);
+   }
+   ASSURE(SymTable_exportChanges(oSource, uMark, &pvDelta, &uSize));
+   ASSURE(SymTable_put(oSource, "0", &aiValues[1]));
+   ASSURE(SymTable_exportChanges(oSource, SymTable_getSequence(oSource)
+      - 1, &pvLater, &uLaterSize));
+   ASSURE(! SymTable_applyChanges(oReplica, pvLater, uLaterSize,
+      decodeInt, NULL, &uSequence));
+   ASSURE(uSequence == uMark);
+
+   /* A damaged delta changes nothing */
+   ASSURE(! SymTable_applyChanges(oReplica, pvDelta, uSize - 1,
+      decodeInt, NULL, &uSequence));
+   ((unsigned char*)pvDelta)[0] = 'X';
+   ASSURE(! SymTable_applyChanges(oReplica, pvDelta, uSize, decodeInt,
+      NULL, &uSequence));
+   ((unsigned char*)pvDelta)[0] = 'S';
+   ASSURE(uSequence == uMark);
+   ASSURE(SymTable_getLength(oReplica) == (size_t)iBindingCount);
+
+   ASSURE(SymTable_applyChanges(oReplica, pvDelta, uSize, decodeInt,
+      NULL, &uSequence));
+   ASSURE(SymTable_applyChanges(oReplica, pvLater, uLaterSize,
+      decodeInt, NULL, &uSequence));
+   ASSURE(uSequence == SymTable_getSequence(oSource));
+   assureSame(oSource, oReplica);
+   free(pvDelta);
+   free(pvLater);
+
+   /* An aborted transaction leaves no changes to export */
+   uMark = SymTable_getSequence(oSource);
+   ASSURE(SymTable_begin(oSource, 2));
+   ASSURE(SymTable_put(oSource, "temp", &aiValues[0]));
+   ASSURE(SymTable_remove(oSource, "1") != NULL);
+   ASSURE(! SymTable_exportChanges(oSource, uMark, &pvDelta, &uSize));
+   SymTable_abort(oSource);
+   ASSURE(SymTable_getSequence(oSource) == uMark);
+   ASSURE(SymTable_exportChanges(oSource, uMark, &pvDelta, &uSize));
+   ASSURE(SymTable_applyChanges(oReplica, pvDelta, uSize, decodeInt,
+      NULL, &uSequence));
+   ASSURE(uSequence == uMark);
+   assureSame(oSource, oReplica);
+   free(pvDelta);
+
+   /* Once the log is trimmed, a new replica starts from a snapshot */
+   SymTable_trimChanges(oSource, uMark);
+   ASSURE(! SymTable_exportChanges(oSource, 0, &pvDelta, &uSize));
+   ASSURE(SymTable_exportTable(oSource, &pvDelta, &uSize));
+   ASSURE(! SymTable_applyChanges(oReplica, pvDelta, uSize, decodeInt,
+      NULL, &uSequence));
+   SymTable_free(oReplica);
+   oReplica = SymTable_newEx(&sOptions);
+   ASSURE(oReplica != NULL);
+   uSequence = 0;
+   ASSURE(SymTable_applyChanges(oReplica, pvDelta, uSize, decodeInt,
+      NULL, &uSequence));
+   ASSURE(uSequence == uMark);
+   assureSame(oSource, oReplica);
+   free(pvDelta);
+
+   ASSURE(SymTable_replace(oSource, "2", &aiValues[0]) != NULL);
+   ASSURE(SymTable_exportChanges(oSource, uSequence, &pvDelta, &uSize));
+   ASSURE(SymTable_applyChanges(oReplica, pvDelta, uSize, decodeInt,
+      NULL, &uSequence));
+   assureSame(oSource, oReplica);
+   free(pvDelta);
+
+   SymTable_free(oReplica);
+   SymTable_free(oSource);
+   free(aiValues);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test tables with a filter of uBits bits per key, on iBindingCount
+   bindings: every present key must pass the filter through puts,
+   expansions, removes that rebuild it, aborts and bulk builds. */
+
+static void testFilter(size_t uBits, int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   struct SymTable_Options sOptions;
+   SymTable_T oSymTable;
+   SymTable_T oPlain;
+   char (*aacKeys)[MAX_KEY_LENGTH];
+   const char **apcKeys;
+   char acKey[MAX_KEY_LENGTH];
+   size_t u;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a filter of %lu bits per key.\n",
+      (unsigned long)uBits);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   SymTable_initOptions(&sOptions);
+   sOptions.uFilterBitsPerKey = uBits;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   oPlain = SymTable_new();
+   ASSURE(oPlain != NULL);
+
+   /* The filter takes memory of its own */
+   ASSURE(SymTable_getBytes(oSymTable) > SymTable_getBytes(oPlain));
+   SymTable_free(oPlain);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, oSymTable));
+      sprintf(acKey, "absent%d", i);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == oSymTable);
+   }
+
+   /* Removes inside a transaction may rebuild the filter, which must
+      keep the removed keys in case they come back */
+   ASSURE(SymTable_begin(oSymTable, (size_t)iBindingCount));
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == oSymTable);
+   }
+   SymTable_abort(oSymTable);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+   }
+
+   /* Keys put after rebuilds pass too */
+   for (i = 0; i < iBindingCount; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == oSymTable);
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey) == (i % 2 == 1));
+      sprintf(acKey, "new%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, NULL));
+   }
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "new%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+      ASSURE(SymTable_replace(oSymTable, acKey, acKey) == NULL);
+   }
+   SymTable_free(oSymTable);
+
+   /* A table built in bulk has a filter of all its keys */
+   aacKeys = (char(*)[MAX_KEY_LENGTH])
+      malloc((size_t)iBindingCount * MAX_KEY_LENGTH);
+   apcKeys = (const char**)
+      malloc((size_t)iBindingCount * sizeof(const char*));
+   ASSURE(aacKeys != NULL && apcKeys != NULL);
+   if (aacKeys == NULL || apcKeys == NULL) return;
+   for (u = 0; u < (size_t)iBindingCount; u++)
+   {
+      sprintf(aacKeys[u], "bulk%lu", (unsigned long)u);
+      apcKeys[u] = aacKeys[u];
+   }
+   oSymTable = SymTable_newBulk(apcKeys, NULL, (size_t)iBindingCount,
+      2, &sOptions, NULL);
+   ASSURE(oSymTable != NULL);
+   for (u = 0; u < (size_t)iBindingCount; u++)
+   {
+      ASSURE(SymTable_contains(oSymTable, apcKeys[u]));
+      sprintf(acKey, "absent%lu", (unsigned long)u);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+   }
+   SymTable_free(oSymTable);
+   free(aacKeys);
+   free(apcKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The evictions seen by evictCounted. */
+
+struct Evictions
+{
+   size_t uCount;
+   char acLastKey[32];
+};
+
+/* Count an eviction of pcKey in the struct Evictions at pvExtra. */
+
+static void evictCounted(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct Evictions *psEvictions = (struct Evictions*)pvExtra;
+
+   (void)pvValue;
+   psEvictions->uCount++;
+   strncpy(psEvictions->acLastKey, pcKey,
+      sizeof(psEvictions->acLastKey) - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test tables bounded by uMaxBindings and uMaxBytes, with and without
+   eviction. */
+
+static void testCache(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   struct SymTable_Options sOptions;
+   struct Evictions sEvictions;
+   struct Allocator sAllocator = {0, 0, 0, 0};
+   SymTable_T oSymTable;
+   char (*aacKeys)[MAX_KEY_LENGTH];
+   const char **apcKeys;
+   char acKey[MAX_KEY_LENGTH];
+   size_t uMax = (size_t)iBindingCount / 2;
+   size_t uHits;
+   size_t uMisses;
+   size_t uEvictions;
+   size_t uLimit;
+   size_t u;
+   int *piValue;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing tables that evict.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Without eviction, a put at the limit fails */
+   SymTable_initOptions(&sOptions);
+   sOptions.uMaxBindings = uMax;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   for (u = 0; u < uMax; u++)
+   {
+      sprintf(acKey, "%lu", (unsigned long)u);
+      ASSURE(SymTable_put(oSymTable, acKey, NULL));
+   }
+   ASSURE(! SymTable_put(oSymTable, "over", NULL));
+   ASSURE(SymTable_getLength(oSymTable) == uMax);
+   SymTable_getCacheStats(oSymTable, &uHits, &uMisses, &uEvictions);
+   ASSURE(uHits == 0 && uMisses == 0 && uEvictions == 0);
+   SymTable_free(oSymTable);
+
+   /* With eviction, the oldest bindings make way */
+   memset(&sEvictions, 0, sizeof(sEvictions));
+   sOptions.iEvict = 1;
+   sOptions.pfEvict = evictCounted;
+   sOptions.pvEvictExtra = &sEvictions;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   ASSURE(! SymTable_begin(oSymTable, 1));
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, oSymTable));
+      ASSURE(SymTable_getLength(oSymTable) <= uMax);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == uMax);
+   ASSURE(sEvictions.uCount == (size_t)iBindingCount - uMax);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey)
+         == ((size_t)i >= (size_t)iBindingCount - uMax));
+   }
+   SymTable_getCacheStats(oSymTable, &uHits, &uMisses, &uEvictions);
+   ASSURE(uHits == uMax);
+   ASSURE(uMisses == (size_t)iBindingCount - uMax);
+   ASSURE(uEvictions == sEvictions.uCount);
+   SymTable_free(oSymTable);
+
+   /* Lookups and replacements make bindings recent */
+   sOptions.uMaxBindings = 3;
+   sEvictions.uCount = 0;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_put(oSymTable, "a", NULL));
+   ASSURE(SymTable_put(oSymTable, "b", NULL));
+   ASSURE(SymTable_put(oSymTable, "c", NULL));
+   ASSURE(SymTable_get(oSymTable, "a") == NULL);
+   ASSURE(SymTable_put(oSymTable, "d", NULL));
+   ASSURE(strcmp(sEvictions.acLastKey, "b") == 0);
+   ASSURE(SymTable_contains(oSymTable, "c"));
+   ASSURE(SymTable_put(oSymTable, "e", NULL));
+   ASSURE(strcmp(sEvictions.acLastKey, "a") == 0);
+   ASSURE(SymTable_replace(oSymTable, "d", "d") == NULL);
+   ASSURE(SymTable_put(oSymTable, "f", NULL));
+   ASSURE(strcmp(sEvictions.acLastKey, "c") == 0);
+   ASSURE(SymTable_remove(oSymTable, "e") == NULL);
+   ASSURE(SymTable_put(oSymTable, "g", NULL));
+   ASSURE(SymTable_put(oSymTable, "h", NULL));
+   ASSURE(strcmp(sEvictions.acLastKey, "d") == 0);
+   ASSURE(sEvictions.uCount == 4);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+
+   /* Only lookups count as hits and misses */
+   ASSURE(SymTable_replace(oSymTable, "absent", NULL) == NULL);
+   SymTable_getCacheStats(oSymTable, &uHits, &uMisses, NULL);
+   ASSURE(uHits == 2 && uMisses == 0);
+   SymTable_free(oSymTable);
+
+   /* A put that fails evicts nothing */
+   sOptions.uMaxBindings = 2;
+   sOptions.pfMalloc = lendBlock;
+   sOptions.pfFree = returnBlock;
+   sOptions.pvAllocator = &sAllocator;
+   sEvictions.uCount = 0;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_put(oSymTable, "a", NULL));
+   ASSURE(SymTable_put(oSymTable, "b", NULL));
+   sAllocator.iRefuse = 1;
+   ASSURE(! SymTable_put(oSymTable, "c", NULL));
+   sAllocator.iRefuse = 0;
+   ASSURE(sEvictions.uCount == 0);
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+   ASSURE(SymTable_getBytes(oSymTable) == sAllocator.uBytes);
+   ASSURE(SymTable_put(oSymTable, "c", NULL));
+   ASSURE(strcmp(sEvictions.acLastKey, "a") == 0);
+   ASSURE(SymTable_contains(oSymTable, "b"));
+   ASSURE(SymTable_contains(oSymTable, "c"));
+   SymTable_free(oSymTable);
+   ASSURE(sAllocator.uBlocks == 0);
+
+   /* A byte limit is kept too, and values without an eviction
+      function are released */
+   SymTable_initOptions(&sOptions);
+   sOptions.pfFreeValue = free;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   uLimit = SymTable_getBytes(oSymTable) + 4096;
+   SymTable_free(oSymTable);
+   sOptions.uMaxBytes = uLimit;
+   sOptions.iEvict = 1;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      piValue = (int*)malloc(sizeof(int));
+      ASSURE(piValue != NULL);
+      if (piValue == NULL) break;
+      *piValue = i;
+      sprintf(acKey, "key%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, piValue));
+      ASSURE(SymTable_getBytes(oSymTable) <= uLimit);
+   }
+   ASSURE(SymTable_getLength(oSymTable) < (size_t)iBindingCount);
+   sprintf(acKey, "key%d", iBindingCount - 1);
+   piValue = (int*)SymTable_get(oSymTable, acKey);
+   ASSURE(piValue != NULL && *piValue == iBindingCount - 1);
+   SymTable_getCacheStats(oSymTable, NULL, NULL, &uEvictions);
+   ASSURE(uEvictions
+      == (size_t)iBindingCount - SymTable_getLength(oSymTable));
+   SymTable_free(oSymTable);
+
+   /* A table built in bulk keeps the bindings that fit */
+   aacKeys = (char(*)[MAX_KEY_LENGTH])
+      malloc((size_t)iBindingCount * MAX_KEY_LENGTH);
+   apcKeys = (const char**)
+      malloc((size_t)iBindingCount * sizeof(const char*));
+   ASSURE(aacKeys != NULL && apcKeys != NULL);
+   if (aacKeys == NULL || apcKeys == NULL) return;
+   for (u = 0; u < (size_t)iBindingCount; u++)
+   {
+      sprintf(aacKeys[u], "bulk%lu", (unsigned long)u);
+      apcKeys[u] = aacKeys[u];
+   }
+   SymTable_initOptions(&sOptions);
+   sOptions.uMaxBindings = uMax;
+   sOptions.iEvict = 1;
+   oSymTable = SymTable_newBulk(apcKeys, NULL, (size_t)iBindingCount,
+      2, &sOptions, NULL);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == uMax);
+   ASSURE(SymTable_put(oSymTable, "after", NULL));
+   ASSURE(SymTable_getLength(oSymTable) == uMax);
+   ASSURE(SymTable_contains(oSymTable, "after"));
+   SymTable_free(oSymTable);
+
+   /* One that cannot log its evictions is not built */
+   sOptions.uMaxBindings = 0;
+   sOptions.pfEncodeValue = encodeInt;
+   oSymTable = SymTable_newBulk(apcKeys, NULL, (size_t)iBindingCount,
+      2, &sOptions, NULL);
+   ASSURE(oSymTable != NULL);
+   uLimit = SymTable_getBytes(oSymTable);
+   SymTable_free(oSymTable);
+   sOptions.uMaxBytes = uLimit;
+   sOptions.uMaxBindings = 2;
+   ASSURE(SymTable_newBulk(apcKeys, NULL, (size_t)iBindingCount, 2,
+      &sOptions, NULL) == NULL);
+
+   /* Without eviction, a build beyond the limit fails */
+   SymTable_initOptions(&sOptions);
+   sOptions.uMaxBindings = uMax;
+   ASSURE(SymTable_newBulk(apcKeys, NULL, (size_t)iBindingCount, 2,
+      &sOptions, NULL) == NULL);
+   oSymTable = SymTable_newBulk(apcKeys, NULL, uMax, 2, &sOptions,
+      NULL);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == uMax);
+   ASSURE(! SymTable_put(oSymTable, "after", NULL));
+   SymTable_free(oSymTable);
+   free(aacKeys);
+   free(apcKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test lookups in chains longer than the part that a bucket
+   describes, while nodes are removed from their fronts and middles.
+   The keys all fall in one of the 509 buckets of a new table. */
+
+static void testLongChains(void)
+{
+   enum {CHAIN_LENGTH = 20, BUCKETS = 509, MAX_KEY_LENGTH = 32};
+
+   SymTable_T oSymTable;
+   char aacKeys[CHAIN_LENGTH][MAX_KEY_LENGTH];
+   char acMissing[MAX_KEY_LENGTH];
+   size_t uBucket;
+   int iFound = 0;
+   int i;
+   int j;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing long chains in one bucket.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Find keys that share a bucket, and one more that does too but is
+      never put */
+   uBucket = KeyOps_hash("k0") % BUCKETS;
+   for (i = 0; iFound <= CHAIN_LENGTH; i++)
+   {
+      sprintf(acMissing, "k%d", i);
+      if (KeyOps_hash(acMissing) % BUCKETS != uBucket) continue;
+      if (iFound < CHAIN_LENGTH) strcpy(aacKeys[iFound], acMissing);
+      iFound++;
+   }
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < CHAIN_LENGTH; i++)
+      ASSURE(SymTable_put(oSymTable, aacKeys[i], aacKeys[i]));
+   ASSURE(! SymTable_contains(oSymTable, acMissing));
+
+   /* Remove the newest node, an old one, and one in between */
+   ASSURE(SymTable_remove(oSymTable, aacKeys[CHAIN_LENGTH - 1])
+      == aacKeys[CHAIN_LENGTH - 1]);
+   ASSURE(SymTable_remove(oSymTable, aacKeys[0]) == aacKeys[0]);
+   ASSURE(SymTable_remove(oSymTable, aacKeys[CHAIN_LENGTH - 4])
+      == aacKeys[CHAIN_LENGTH - 4]);
+
+   /* Shrink the chain until its bucket describes all of it */
+   for (j = 1; j < CHAIN_LENGTH; j++)
+   {
+      for (i = 1; i < CHAIN_LENGTH - 1; i++)
+      {
+         if (i == CHAIN_LENGTH - 4) continue;
+         ASSURE(SymTable_get(oSymTable, aacKeys[i])
+            == (i < j ? NULL : aacKeys[i]));
+      }
+      ASSURE(! SymTable_contains(oSymTable, acMissing));
+      if (j != CHAIN_LENGTH - 4 && j < CHAIN_LENGTH - 1)
+         ASSURE(SymTable_remove(oSymTable, aacKeys[j]) == aacKeys[j]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_getBatch against SymTable_get on iBindingCount
+   bindings, looking up every key and as many absent keys, in plain
+   and interned tables. Lookups are interleaved only in tables of at
+   least 16384 bindings. */
+
+static void testGetBatch(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32, CACHE_COUNT = 20000};
+
+   struct SymTable_Options sOptions;
+   SymTable_T oSymTable;
+   KeyPool_T oKeyPool;
+   char (*aacKeys)[MAX_KEY_LENGTH];
+   const char **apcKeys;
+   void **apvValues;
+   size_t uCount;
+   size_t uHits;
+   size_t uMisses;
+   size_t u;
+   int iInterned;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing batches of lookups.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   uCount = 2 * (size_t)iBindingCount;
+   aacKeys = (char(*)[MAX_KEY_LENGTH])malloc(uCount * MAX_KEY_LENGTH);
+   apcKeys = (const char**)malloc(uCount * sizeof(const char*));
+   apvValues = (void**)malloc(uCount * sizeof(void*));
+   ASSURE(aacKeys != NULL && apcKeys != NULL && apvValues != NULL);
+
+   /* Alternate present and absent keys */
+   for (u = 0; u < uCount; u++)
+   {
+      sprintf(aacKeys[u], "%s%lu", u % 2 == 0 ? "present" : "absent",
+         (unsigned long)(u / 2));
+      apcKeys[u] = aacKeys[u];
+   }
+
+   for (iInterned = 0; iInterned <= 1; iInterned++)
+   {
+      oKeyPool = NULL;
+      if (iInterned)
+      {
+         oKeyPool = KeyPool_new();
+         ASSURE(oKeyPool != NULL);
+         oSymTable = SymTable_newInterned(oKeyPool);
+      }
+      else oSymTable = SymTable_new();
+      ASSURE(oSymTable != NULL);
+      for (u = 0; u < uCount; u += 2)
+         ASSURE(SymTable_put(oSymTable, aacKeys[u], aacKeys[u]));
+
+      SymTable_getBatch(oSymTable, apcKeys, uCount, apvValues);
+      for (u = 0; u < uCount; u++)
+         ASSURE(apvValues[u] == (u % 2 == 0 ? aacKeys[u] : NULL));
+
+      /* Batches shorter than the number of lookups in flight */
+      apvValues[0] = aacKeys[1];
+      SymTable_getBatch(oSymTable, apcKeys + 1, 1, apvValues);
+      ASSURE(apvValues[0] == NULL);
+      SymTable_getBatch(oSymTable, apcKeys, 0, apvValues);
+
+      SymTable_free(oSymTable);
+      if (oKeyPool != NULL) KeyPool_free(oKeyPool);
+   }
+
+   free(aacKeys);
+   free(apcKeys);
+   free(apvValues);
+
+   /* A table that evicts, large enough for interleaved lookups,
+      counts them and keeps the bindings they found */
+   uCount = CACHE_COUNT;
+   aacKeys = (char(*)[MAX_KEY_LENGTH])malloc(uCount * MAX_KEY_LENGTH);
+   apcKeys = (const char**)malloc(uCount * sizeof(const char*));
+   apvValues = (void**)malloc(uCount * sizeof(void*));
+   ASSURE(aacKeys != NULL && apcKeys != NULL && apvValues != NULL);
+   if (aacKeys == NULL || apcKeys == NULL || apvValues == NULL) return;
+   SymTable_initOptions(&sOptions);
+   sOptions.uMaxBindings = uCount;
+   sOptions.iEvict = 1;
+   oSymTable = SymTable_newEx(&sOptions);
+   ASSURE(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      sprintf(aacKeys[u], "cached%lu", (unsigned long)u);
+      apcKeys[u] = aacKeys[u];
+      ASSURE(SymTable_put(oSymTable, aacKeys[u], aacKeys[u]));
+   }
+   apcKeys[0] = "absent";
+   SymTable_getBatch(oSymTable, apcKeys, uCount / 2, apvValues);
+   SymTable_getCacheStats(oSymTable, &uHits, &uMisses, NULL);
+   ASSURE(uHits == uCount / 2 - 1 && uMisses == 1);
+   for (u = 0; u < uCount / 2; u++)
+   {
+      sprintf(aacKeys[u], "new%lu", (unsigned long)u);
+      ASSURE(SymTable_put(oSymTable, aacKeys[u], NULL));
+   }
+   ASSURE(SymTable_contains(oSymTable, "cached1"));
+   ASSURE(! SymTable_contains(oSymTable, "cached0"));
+   ASSURE(! SymTable_contains(oSymTable, aacKeys[uCount / 2]));
+   SymTable_free(oSymTable);
+
+   free(aacKeys);
+   free(apcKeys);
+   free(apvValues);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newBulk on iBindingCount distinct keys followed by
+   repeats of a quarter of them, with several numbers of threads. */
+
+static void testBulk(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   static const size_t auThreadCounts[] = {1, 2, 3, 8};
+   struct SymTable_Options sOptions;
+   SymTable_T oSymTable;
+   char (*aacKeys)[MAX_KEY_LENGTH];
+   const char **apcKeys;
+   const void **apvValues;
+   int *aiValues;
+   size_t uCount;
+   size_t uDuplicates;
+   size_t u;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects built in bulk.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   uCount = (size_t)iBindingCount + (size_t)iBindingCount / 4;
+   aacKeys = (char(*)[MAX_KEY_LENGTH])malloc(uCount * MAX_KEY_LENGTH);
+   apcKeys = (const char**)malloc(uCount * sizeof(const char*));
+   apvValues = (const void**)malloc(uCount * sizeof(const void*));
+   aiValues = (int*)malloc(uCount * sizeof(int));
+   ASSURE(aacKeys != NULL && apcKeys != NULL && apvValues != NULL
+      && aiValues != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      sprintf(aacKeys[u], "key%d", (int)(u % (size_t)iBindingCount));
+      aiValues[u] = (int)u;
+      apcKeys[u] = aacKeys[u];
+      apvValues[u] = &aiValues[u];
+   }
+
+   /* An empty build */
+   oSymTable = SymTable_newBulk(NULL, NULL, 0, 4, NULL, &uDuplicates);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   ASSURE(uDuplicates == 0);
+   SymTable_free(oSymTable);
+
+   for (u = 0; u < sizeof(auThreadCounts) / sizeof(auThreadCounts[0]);
+        u++)
+   {
+      oSymTable = SymTable_newBulk(apcKeys, apvValues, uCount,
+         auThreadCounts[u], NULL, &uDuplicates);
+      ASSURE(oSymTable != NULL);
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)iBindingCount);
+      ASSURE(uDuplicates == uCount - (size_t)iBindingCount);
+
+      /* The first occurrence of each key is bound */
+      for (i = 0; i < iBindingCount; i++)
+         ASSURE(SymTable_get(oSymTable, aacKeys[i]) == &aiValues[i]);
+
+      /* The result is an ordinary table that can grow and shrink */
+      ASSURE(SymTable_put(oSymTable, "extra", NULL));
+      ASSURE(! SymTable_put(oSymTable, aacKeys[0], NULL));
+      ASSURE(SymTable_remove(oSymTable, "extra") == NULL);
+      for (i = 0; i < iBindingCount; i++)
+         ASSURE(SymTable_remove(oSymTable, aacKeys[i]) == &aiValues[i]);
+      ASSURE(SymTable_getLength(oSymTable) == 0);
+      SymTable_free(oSymTable);
+   }
+
+   /* Borrowed keys, without values */
+   SymTable_initOptions(&sOptions);
+   sOptions.iBorrowKeys = 1;
+   oSymTable = SymTable_newBulk(apcKeys, NULL, uCount, 4, &sOptions,
+      NULL);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_contains(oSymTable, aacKeys[iBindingCount - 1]));
+   ASSURE(SymTable_get(oSymTable, aacKeys[0]) == NULL);
+   SymTable_free(oSymTable);
+
+   free(aacKeys);
+   free(apcKeys);
+   free(apvValues);
+   free(aiValues);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the extensions of the hash table SymTable implementation.
+   argv[1] is the number of bindings to put into the outermost scope.
+   Exit with EXIT_FAILURE if argv[1] is missing or not numeric.
+   Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 2)
+   {
+      fprintf(stderr, "bindingcount must be a number of at least 2\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testKeyOps();
+   testKeyPool();
+   testInternedScopes(8, iBindingCount);
+   testOptions(iBindingCount);
+   testMemory(iBindingCount);
+   testTransactions(iBindingCount);
+   testChangeLog(iBindingCount);
+   testFilter(10, iBindingCount);
+   testFilter(1, iBindingCount);
+   testCache(iBindingCount);
+   testLongChains();
+   testGetBatch(iBindingCount);
+   testBulk(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
@@ -0,0 +1,232 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablehpp.cpp                                                */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtable.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      std::printf("Test at line %d failed.\n", iLineNum);
+      std::fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The growth policies choose their bucket counts at compile time. */
+
+static_assert(symtable::PrimeGrowth::bucketCountFor(0) == 509);
+static_assert(symtable::PrimeGrowth::bucketCountFor(510) == 1021);
+static_assert(symtable::PowerOfTwoGrowth::bucketCountFor(513) == 1024);
+static_assert(symtable::StringHash()("ab") == 'a' * 65599 + 'b');
+
+/*--------------------------------------------------------------------*/
+
+/* Test a table of move-only values, on iBindingCount bindings. */
+
+static void testMoveOnly(int iBindingCount)
+{
+   symtable::Table<std::string, std::unique_ptr<int>> oTable;
+   std::optional<std::unique_ptr<int>> oValue;
+   long lSum = 0;
+   int i;
+
+   std::printf("------------------------------------------------------\n");
+   std::printf("Testing a table of move-only values.\n");
+   std::printf("No output should appear here:\n");
+   std::fflush(stdout);
+
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(oTable.put(std::to_string(i), std::make_unique<int>(i)));
+   ASSURE(oTable.getLength() == (std::size_t)iBindingCount);
+   ASSURE(! oTable.put("0", std::make_unique<int>(-1)));
+
+   /* Lookups take C strings without building a std::string */
+   ASSURE(oTable.contains("1"));
+   ASSURE(! oTable.contains("x"));
+   ASSURE(**oTable.get("1") == 1);
+   ASSURE(oTable.get("x") == nullptr);
+
+   oValue = oTable.replace("1", std::make_unique<int>(100));
+   ASSURE(oValue.has_value() && **oValue == 1);
+   ASSURE(**oTable.get("1") == 100);
+   ASSURE(! oTable.replace("x", nullptr).has_value());
+
+   /* The lambda may capture and change anything */
+   oTable.map([&lSum](const std::string &oKey, std::unique_ptr<int> &oPtr)
+      {
+         (void)oKey;
+         lSum += *oPtr;
+         *oPtr = -*oPtr;
+      });
+   ASSURE(lSum == (long)iBindingCount * (iBindingCount - 1) / 2 + 99);
+   ASSURE(**oTable.get("1") == -100);
+
+   for (i = 1; i < iBindingCount; i++)
+   {
+      oValue = oTable.remove(std::to_string(i));
+      ASSURE(oValue.has_value() && *oValue != nullptr);
+   }
+   ASSURE(! oTable.remove("x").has_value());
+   ASSURE(oTable.getLength() == 1);
+
+   /* Moving a table empties the source */
+   symtable::Table<std::string, std::unique_ptr<int>> oMoved(
+      std::move(oTable));
+   ASSURE(oMoved.getLength() == 1);
+   ASSURE(oTable.getLength() == 0);
+   ASSURE(! oTable.contains("0"));
+   ASSURE(oTable.put("0", nullptr));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The number of nodes and bucket arrays that CountingAllocator
+   objects have allocated and not freed, and have allocated in all. */
+
+static long lLiveBlocks = 0;
+static long lAllocations = 0;
+
+/* A standard allocator that counts its live blocks. */
+
+template <class T>
+struct CountingAllocator {
+   using value_type = T;
+
+   CountingAllocator() = default;
+
+   template <class U>
+   CountingAllocator(const CountingAllocator<U> &) {}
+
+   T *allocate(std::size_t uCount)
+   {
+      lLiveBlocks++;
+      lAllocations++;
+      return std::allocator<T>().allocate(uCount);
+   }
+
+   void deallocate(T *p, std::size_t uCount)
+   {
+      lLiveBlocks--;
+      std::allocator<T>().deallocate(p, uCount);
+   }
+
+   template <class U>
+   bool operator==(const CountingAllocator<U> &) const { return true; }
+
+   template <class U>
+   bool operator!=(const CountingAllocator<U> &) const { return false; }
+};
+
+/* A hash policy that sends every key to one bucket. */
+
+struct CollidingHash {
+   std::size_t operator()(int iKey) const { (void)iKey; return 7; }
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Test tables with other policies, on iBindingCount bindings. */
+
+static void testPolicies(int iBindingCount)
+{
+   int i;
+
+   std::printf("------------------------------------------------------\n");
+   std::printf("Testing tables with other policies.\n");
+   std::printf("No output should appear here:\n");
+   std::fflush(stdout);
+
+   {
+      symtable::Table<int, double, std::hash<int>, std::equal_to<int>,
+         CountingAllocator<std::pair<const int, double>>,
+         symtable::PowerOfTwoGrowth> oTable;
+      double dSum = 0.0;
+      long lAllocationsBefore;
+
+      /* Putting a key that is already bound allocates nothing, even
+         when the table is due to grow */
+      ASSURE(oTable.put(0, 0.0));
+      for (i = 1; i < iBindingCount; i++)
+      {
+         lAllocationsBefore = lAllocations;
+         ASSURE(! oTable.put(0, -1.0));
+         ASSURE(lAllocations == lAllocationsBefore);
+         ASSURE(oTable.put(i, i / 2.0));
+      }
+      for (i = 0; i < iBindingCount; i++)
+         ASSURE(*oTable.get(i) == i / 2.0);
+      ASSURE(lLiveBlocks == iBindingCount + 1);
+
+      const auto &oConstTable = oTable;
+      oConstTable.map([&dSum](const int &iKey, const double &dValue)
+         {
+            dSum += dValue - iKey / 2.0;
+         });
+      ASSURE(dSum == 0.0);
+      ASSURE(*oConstTable.get(3) == 1.5);
+
+      for (i = 0; i < iBindingCount; i += 2)
+         ASSURE(oTable.remove(i) == i / 2.0);
+      ASSURE(oTable.getLength() == (std::size_t)iBindingCount / 2);
+   }
+   ASSURE(lLiveBlocks == 0);
+
+   {
+      symtable::Table<int, int, CollidingHash> oTable;
+
+      for (i = 0; i < 100; i++)
+         ASSURE(oTable.put(i, -i));
+      for (i = 0; i < 100; i++)
+         ASSURE(*oTable.get(i) == -i);
+      ASSURE(! oTable.contains(100));
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the Table template of symtable.hpp. argv[1] is the number of
+   bindings to use. Exit with EXIT_FAILURE if argv[1] is missing or
+   not numeric. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      std::fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      std::exit(EXIT_FAILURE);
+   }
+
+   if (std::sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 2)
+   {
+      std::fprintf(stderr,
+         "bindingcount must be a number of at least 2\n");
+      std::exit(EXIT_FAILURE);
+   }
+
+   testMoveOnly(iBindingCount);
+   testPolicies(iBindingCount);
+
+   std::printf("------------------------------------------------------\n");
+   std::printf("End of %s.\n", argv[0]);
+   return 0;
+}
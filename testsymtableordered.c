@@ -0,0 +1,240 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableordered.c                                              */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtabletree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The keys visited by a traversal, in the order they were visited. */
+
+struct Visited
+{
+   size_t uCount;
+   char acKeys[2048];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Append pcKey and a space to the struct Visited that pvExtra points
+   to. pvValue is unused. */
+
+static void appendKey(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct Visited *psVisited = (struct Visited*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)pvValue;
+
+   strcat(psVisited->acKeys, pcKey);
+   strcat(psVisited->acKeys, " ");
+   psVisited->uCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that the keys visited by the traversal whose callback state
+   is pvExtra are in strictly ascending order. */
+
+static void checkAscending(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   char *pcPrevious = (char*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)pvValue;
+
+   ASSURE(strcmp(pcPrevious, pcKey) < 0);
+   strcpy(pcPrevious, pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_mapPrefix() and SymTable_mapRange() on a small
+   table. */
+
+static void testOrderedQueries(void)
+{
+   SymTable_T oSymTable;
+   struct Visited sVisited;
+   const char *apcKeys[] = {"std::vector", "std::map", "boost::any",
+      "std", "std::", "stdio", "main", "std::string", ""};
+   size_t u;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_mapPrefix() and SymTable_mapRange().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   for (u = 0; u < sizeof(apcKeys) / sizeof(apcKeys[0]); u++)
+      ASSURE(SymTable_put(oSymTable, apcKeys[u], apcKeys[u]));
+
+   memset(&sVisited, 0, sizeof(sVisited));
+   SymTable_mapPrefix(oSymTable, "std::", appendKey, &sVisited);
+   ASSURE(sVisited.uCount == 4);
+   ASSURE(strcmp(sVisited.acKeys,
+      "std:: std::map std::string std::vector ") == 0);
+
+   memset(&sVisited, 0, sizeof(sVisited));
+   SymTable_mapPrefix(oSymTable, "std", appendKey, &sVisited);
+   ASSURE(sVisited.uCount == 6);
+
+   memset(&sVisited, 0, sizeof(sVisited));
+   SymTable_mapPrefix(oSymTable, "zzz", appendKey, &sVisited);
+   ASSURE(sVisited.uCount == 0);
+
+   memset(&sVisited, 0, sizeof(sVisited));
+   SymTable_mapPrefix(oSymTable, "", appendKey, &sVisited);
+   ASSURE(sVisited.uCount == 9);
+
+   memset(&sVisited, 0, sizeof(sVisited));
+   SymTable_mapRange(oSymTable, "m", "std::m", appendKey, &sVisited);
+   ASSURE(strcmp(sVisited.acKeys, "main std std:: ") == 0);
+
+   memset(&sVisited, 0, sizeof(sVisited));
+   SymTable_mapRange(oSymTable, NULL, "main", appendKey, &sVisited);
+   ASSURE(strcmp(sVisited.acKeys, " boost::any ") == 0);
+
+   memset(&sVisited, 0, sizeof(sVisited));
+   SymTable_mapRange(oSymTable, "std::string", NULL, appendKey,
+      &sVisited);
+   ASSURE(strcmp(sVisited.acKeys, "std::string std::vector stdio ")
+      == 0);
+
+   memset(&sVisited, 0, sizeof(sVisited));
+   SymTable_mapRange(oSymTable, "b", "b", appendKey, &sVisited);
+   ASSURE(sVisited.uCount == 0);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that a table of iBindingCount bindings, put and removed in a
+   scrambled order, stays ordered and answers prefix queries. */
+
+static void testLargeOrdered(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   SymTable_T oSymTable;
+   struct Visited sVisited;
+   char acKey[MAX_KEY_LENGTH];
+   char acPrevious[MAX_KEY_LENGTH];
+   int i;
+   int iKey;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a large ordered SymTable object.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* 7919 is prime, so this visits every key exactly once */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      iKey = (int)(((long)i * 7919) % iBindingCount);
+      sprintf(acKey, "key%08d", iKey);
+      ASSURE(SymTable_put(oSymTable, acKey, NULL));
+   }
+   ASSURE(SymTable_getLength(oSymTable) == (size_t)iBindingCount);
+
+   acPrevious[0] = '\0';
+   SymTable_map(oSymTable, checkAscending, acPrevious);
+
+   if (iBindingCount >= 20)
+   {
+      memset(&sVisited, 0, sizeof(sVisited));
+      SymTable_mapPrefix(oSymTable, "key0000001", appendKey,
+         &sVisited);
+      ASSURE(sVisited.uCount == 10);
+   }
+
+   /* Remove the odd keys, then check order and contents again */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      iKey = (int)(((long)i * 7919) % iBindingCount);
+      if (iKey % 2 == 0) continue;
+      sprintf(acKey, "key%08d", iKey);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+      SymTable_remove(oSymTable, acKey);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+   }
+   ASSURE(SymTable_getLength(oSymTable) ==
+      (size_t)((iBindingCount + 1) / 2));
+
+   acPrevious[0] = '\0';
+   SymTable_map(oSymTable, checkAscending, acPrevious);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "key%08d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey) == (i % 2 == 0));
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ordered queries of the B-tree SymTable implementation.
+   argv[1] is the number of bindings to put into a large SymTable
+   object. Exit with EXIT_FAILURE if argv[1] is missing or not
+   numeric. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 0 || iBindingCount % 7919 == 0)
+   {
+      fprintf(stderr,
+         "bindingcount must be numeric, positive and not a multiple "
+         "of 7919\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testOrderedQueries();
+   testLargeOrdered(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
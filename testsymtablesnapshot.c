@@ -0,0 +1,223 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablesnapshot.c                                             */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtablehamt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that a few changes to a table and its snapshots stay on the
+   side that made them. */
+
+static void testIndependence(void)
+{
+   SymTable_T oSymTable;
+   SymTable_T oSnapshot;
+   SymTable_T oSecond;
+   char acFirst[] = "first";
+   char acSecond[] = "second";
+   char acThird[] = "third";
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the independence of snapshots.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* A snapshot of an empty table is empty */
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   ASSURE(SymTable_put(oSymTable, "a", acFirst));
+   ASSURE(SymTable_getLength(oSnapshot) == 0);
+   ASSURE(! SymTable_contains(oSnapshot, "a"));
+   SymTable_free(oSnapshot);
+
+   ASSURE(SymTable_put(oSymTable, "b", acFirst));
+   ASSURE(SymTable_put(oSymTable, "c", acFirst));
+   oSnapshot = SymTable_snapshot(oSymTable);
+   ASSURE(oSnapshot != NULL);
+   ASSURE(SymTable_getLength(oSnapshot) == 3);
+
+   /* Changes to the original */
+   ASSURE(SymTable_replace(oSymTable, "a", acSecond) == acFirst);
+   ASSURE(SymTable_remove(oSymTable, "b") == acFirst);
+   ASSURE(SymTable_put(oSymTable, "d", acSecond));
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+   ASSURE(SymTable_get(oSnapshot, "a") == acFirst);
+   ASSURE(SymTable_get(oSnapshot, "b") == acFirst);
+   ASSURE(! SymTable_contains(oSnapshot, "d"));
+   ASSURE(SymTable_getLength(oSnapshot) == 3);
+
+   /* Changes to the snapshot */
+   ASSURE(SymTable_replace(oSnapshot, "c", acThird) == acFirst);
+   ASSURE(SymTable_put(oSnapshot, "e", acThird));
+   ASSURE(SymTable_get(oSymTable, "c") == acFirst);
+   ASSURE(! SymTable_contains(oSymTable, "e"));
+
+   /* A snapshot of a snapshot, outliving both */
+   oSecond = SymTable_snapshot(oSnapshot);
+   ASSURE(oSecond != NULL);
+   SymTable_free(oSnapshot);
+   SymTable_free(oSymTable);
+   ASSURE(SymTable_getLength(oSecond) == 4);
+   ASSURE(SymTable_get(oSecond, "a") == acFirst);
+   ASSURE(SymTable_get(oSecond, "c") == acThird);
+   ASSURE(SymTable_get(oSecond, "e") == acThird);
+   ASSURE(SymTable_remove(oSecond, "e") == acThird);
+   ASSURE(SymTable_remove(oSecond, "a") == acFirst);
+   ASSURE(SymTable_remove(oSecond, "b") == acFirst);
+   ASSURE(SymTable_remove(oSecond, "c") == acThird);
+   ASSURE(SymTable_remove(oSecond, "c") == NULL);
+   ASSURE(SymTable_getLength(oSecond) == 0);
+   SymTable_free(oSecond);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test iSnapshotCount snapshots of one table of iBindingCount
+   bindings, each taken after changing a different slice of the
+   bindings, and time the whole run. */
+
+static void testManySnapshots(int iBindingCount, int iSnapshotCount)
+{
+   enum {MAX_KEY_LENGTH = 32};
+
+   SymTable_T oSymTable;
+   SymTable_T *aoSnapshots;
+   char acKey[MAX_KEY_LENGTH];
+   int *aiValues;
+   int iSnapshot;
+   int iSlice;
+   int i;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing many snapshots of a large table.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   aoSnapshots = (SymTable_T*)
+      malloc((size_t)iSnapshotCount * sizeof(SymTable_T));
+   ASSURE(aoSnapshots != NULL);
+   aiValues = (int*)malloc((size_t)(iSnapshotCount + 1) * sizeof(int));
+   ASSURE(aiValues != NULL);
+
+   iInitialClock = clock();
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, &aiValues[0]));
+   }
+
+   /* Snapshot iSnapshot sees slice s bound to value min(s, iSnapshot),
+      and not the keys that later snapshots removed */
+   iSlice = iBindingCount / iSnapshotCount;
+   for (iSnapshot = 0; iSnapshot < iSnapshotCount; iSnapshot++)
+   {
+      aoSnapshots[iSnapshot] = SymTable_snapshot(oSymTable);
+      ASSURE(aoSnapshots[iSnapshot] != NULL);
+      for (i = iSnapshot * iSlice; i < (iSnapshot + 1) * iSlice; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_replace(oSymTable, acKey,
+            &aiValues[iSnapshot + 1]) == &aiValues[0]);
+      }
+      sprintf(acKey, "%d", iSnapshot * iSlice);
+      ASSURE(SymTable_remove(oSymTable, acKey)
+         == &aiValues[iSnapshot + 1]);
+   }
+
+   for (iSnapshot = 0; iSnapshot < iSnapshotCount; iSnapshot++)
+   {
+      ASSURE(SymTable_getLength(aoSnapshots[iSnapshot])
+         == (size_t)(iBindingCount - iSnapshot));
+      for (i = 0; i < iSnapshotCount * iSlice; i++)
+      {
+         sprintf(acKey, "%d", i);
+         if (i % iSlice == 0 && i / iSlice < iSnapshot)
+            ASSURE(! SymTable_contains(aoSnapshots[iSnapshot], acKey));
+         else if (i / iSlice < iSnapshot)
+            ASSURE(SymTable_get(aoSnapshots[iSnapshot], acKey)
+               == &aiValues[i / iSlice + 1]);
+         else
+            ASSURE(SymTable_get(aoSnapshots[iSnapshot], acKey)
+               == &aiValues[0]);
+      }
+   }
+
+   /* Free the snapshots in an order unrelated to their ages */
+   SymTable_free(oSymTable);
+   for (iSnapshot = 0; iSnapshot < iSnapshotCount; iSnapshot += 2)
+      SymTable_free(aoSnapshots[iSnapshot]);
+   for (iSnapshot = 1; iSnapshot < iSnapshotCount; iSnapshot += 2)
+      SymTable_free(aoSnapshots[iSnapshot]);
+
+   iFinalClock = clock();
+   printf("CPU time (%d snapshots):  %f seconds\n", iSnapshotCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   fflush(stdout);
+
+   free(aoSnapshots);
+   free(aiValues);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_snapshot. argv[1] is the number of bindings in the
+   large table. Exit with EXIT_FAILURE if argv[1] is missing or not
+   numeric. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount must be a non-negative number\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testIndependence();
+   if (iBindingCount >= 100)
+      testManySnapshots(iBindingCount, 100);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
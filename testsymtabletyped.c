@@ -0,0 +1,235 @@
+/*--------------------------------------------------------------------*/
+/* testsymtabletyped.c                                                */
+/* Author: James Swinehart                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtabletyped.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_KEY_LENGTH = 32};
+
+/* A value larger than a pointer. */
+
+struct Location {
+   /* The name of the source file */
+   const char *pcFile;
+   /* The line within it */
+   long lLine;
+   /* The column within the line */
+   int iColumn;
+};
+
+/* A table of ints and a table of Locations. */
+
+SYMTABLE_DECLARE_TYPED(IntTable, int);
+SYMTABLE_DEFINE_TYPED(IntTable, int);
+
+SYMTABLE_DECLARE_TYPED(LocationTable, struct Location);
+SYMTABLE_DEFINE_TYPED(LocationTable, struct Location);
+
+/*--------------------------------------------------------------------*/
+
+/* Add *piValue to the long to which pvExtra points, then double
+   *piValue. */
+
+static void sumAndDouble(const char *pcKey, int *piValue, void *pvExtra)
+{
+   (void)pcKey;
+   *(long*)pvExtra += *piValue;
+   *piValue *= 2;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a table of ints, on iBindingCount bindings. */
+
+static void testInts(int iBindingCount)
+{
+   IntTable_T oIntTable;
+   char acKey[MAX_KEY_LENGTH];
+   int iValue;
+   int *piValue;
+   long lSum;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a table of ints.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oIntTable = IntTable_new();
+   ASSURE(oIntTable != NULL);
+   ASSURE(IntTable_getLength(oIntTable) == 0);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(IntTable_put(oIntTable, acKey, i));
+   }
+   ASSURE(IntTable_getLength(oIntTable) == (size_t)iBindingCount);
+   ASSURE(! IntTable_put(oIntTable, "0", -1));
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iValue = -1;
+      ASSURE(IntTable_get(oIntTable, acKey, &iValue));
+      ASSURE(iValue == i);
+   }
+
+   /* Missing keys leave the value alone */
+   iValue = 12345;
+   ASSURE(! IntTable_get(oIntTable, "x", &iValue));
+   ASSURE(iValue == 12345);
+   ASSURE(! IntTable_contains(oIntTable, "x"));
+   ASSURE(IntTable_contains(oIntTable, "1"));
+   ASSURE(IntTable_lookup(oIntTable, "x") == NULL);
+   ASSURE(! IntTable_replace(oIntTable, "x", 7, &iValue));
+   ASSURE(iValue == 12345);
+   ASSURE(! IntTable_remove(oIntTable, "x", &iValue));
+   ASSURE(iValue == 12345);
+
+   /* A value of 0 is distinct from a missing key */
+   ASSURE(IntTable_get(oIntTable, "0", &iValue));
+   ASSURE(iValue == 0);
+
+   ASSURE(IntTable_replace(oIntTable, "1", 100, &iValue));
+   ASSURE(iValue == 1);
+   ASSURE(IntTable_replace(oIntTable, "1", 1, NULL));
+
+   /* Values may be changed in place */
+   piValue = IntTable_lookup(oIntTable, "1");
+   ASSURE(piValue != NULL);
+   (*piValue)++;
+   ASSURE(IntTable_get(oIntTable, "1", &iValue));
+   ASSURE(iValue == 2);
+   *piValue = 1;
+
+   lSum = 0;
+   IntTable_map(oIntTable, sumAndDouble, &lSum);
+   ASSURE(lSum == (long)iBindingCount * (iBindingCount - 1) / 2);
+   ASSURE(IntTable_get(oIntTable, "1", &iValue));
+   ASSURE(iValue == 2);
+
+   for (i = 1; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(IntTable_remove(oIntTable, acKey, &iValue));
+      ASSURE(iValue == 2 * i);
+      ASSURE(! IntTable_contains(oIntTable, acKey));
+   }
+   ASSURE(IntTable_getLength(oIntTable) == 1);
+   ASSURE(IntTable_remove(oIntTable, "0", NULL));
+   ASSURE(IntTable_getLength(oIntTable) == 0);
+
+   /* Removed keys may be put again */
+   ASSURE(IntTable_put(oIntTable, "1", 3));
+   ASSURE(IntTable_get(oIntTable, "1", &iValue));
+   ASSURE(iValue == 3);
+
+   IntTable_free(oIntTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a table of structures, on iBindingCount bindings. */
+
+static void testStructures(int iBindingCount)
+{
+   LocationTable_T oLocationTable;
+   struct Location sLocation;
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a table of structures.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oLocationTable = LocationTable_new();
+   ASSURE(oLocationTable != NULL);
+
+   sLocation.pcFile = "main.c";
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "symbol%d", i);
+      sLocation.lLine = i;
+      sLocation.iColumn = i % 80;
+      ASSURE(LocationTable_put(oLocationTable, acKey, sLocation));
+   }
+
+   /* The table holds copies of the keys */
+   strcpy(acKey, "symbol0");
+   acKey[0] = 'S';
+   ASSURE(! LocationTable_contains(oLocationTable, acKey));
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "symbol%d", i);
+      ASSURE(LocationTable_get(oLocationTable, acKey, &sLocation));
+      ASSURE(strcmp(sLocation.pcFile, "main.c") == 0);
+      ASSURE(sLocation.lLine == i);
+      ASSURE(sLocation.iColumn == i % 80);
+   }
+
+   ASSURE(LocationTable_lookup(oLocationTable, "symbol1")->lLine == 1);
+   ASSURE(LocationTable_remove(oLocationTable, "symbol1", &sLocation));
+   ASSURE(sLocation.lLine == 1);
+   ASSURE(LocationTable_getLength(oLocationTable)
+      == (size_t)iBindingCount - 1);
+
+   LocationTable_free(oLocationTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the typed tables of symtabletyped.h. argv[1] is the number of
+   bindings to use. Exit with EXIT_FAILURE if argv[1] is missing or
+   not numeric. Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1
+       || iBindingCount < 2)
+   {
+      fprintf(stderr, "bindingcount must be a number of at least 2\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testInts(iBindingCount);
+   testStructures(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}